@@ -4,14 +4,31 @@
 #++
 
 lRootDir = File.expand_path(Dir.getwd)
+# Extensions needing the GMP library.
+# They are skipped when building with --without-gmp: actions using them (Compare, Mix, and functions and maps) are then unavailable.
+lGMPExtPaths = [
+  'ext/WSK/ArithmUtils',
+  'ext/WSK/FunctionUtils',
+  'ext/WSK/VolumeUtils'
+]
+lWithoutGMP = ARGV.include?('--without-gmp')
 [
   'ext/WSK/AnalyzeUtils',
   'ext/WSK/ArithmUtils',
+  'ext/WSK/CodecUtils',
   'ext/WSK/FFTUtils',
   'ext/WSK/FunctionUtils',
+  'ext/WSK/IOUtils',
+  'ext/WSK/SampleBuffer',
   'ext/WSK/SilentUtils',
   'ext/WSK/VolumeUtils'
 ].each do |iExtPath|
+  if (lWithoutGMP and
+      lGMPExtPaths.include?(iExtPath))
+    puts "===== Skipping #{iExtPath}, as it needs GMP."
+    puts ''
+    next
+  end
   puts "===== Building #{iExtPath} ..."
   Dir.chdir("#{lRootDir}/#{iExtPath}")
   if (!system('ruby -w extconf.rb'))
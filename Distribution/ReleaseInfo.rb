@@ -45,8 +45,11 @@ RubyPackager::ReleaseInfo.new.
     :extensions => [
       'ext/WSK/AnalyzeUtils/extconf.rb',
       'ext/WSK/ArithmUtils/extconf.rb',
+      'ext/WSK/CodecUtils/extconf.rb',
       'ext/WSK/FFTUtils/extconf.rb',
       'ext/WSK/FunctionUtils/extconf.rb',
+      'ext/WSK/IOUtils/extconf.rb',
+      'ext/WSK/SampleBuffer/extconf.rb',
       'ext/WSK/SilentUtils/extconf.rb',
       'ext/WSK/VolumeUtils/extconf.rb'
     ]
@@ -0,0 +1,66 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+# Measure the throughput of the samples codecs, for each format.
+# Decoding is measured with AnalyzeUtils#completeAnalyze, decoding and encoding with ArithmUtils#compareBuffers (2 buffers decoded, 1 encoded).
+# Run it after building the extensions:
+#   ruby bench/Codecs.rb [NbrSamples]
+# The WSK_SIMD environment variable (none, sse2, ssse3 or avx2) can be used to compare with lower SIMD levels.
+
+require 'benchmark'
+
+lWSKRootDir = File.expand_path("#{File.dirname(__FILE__)}/..")
+
+# Add lib path to the LOAD_PATH
+$: << "#{lWSKRootDir}/lib"
+# Add ext path to the LOAD_PATH
+$: << "#{lWSKRootDir}/ext"
+
+require 'WSK/AnalyzeUtils/AnalyzeUtils'
+require 'WSK/ArithmUtils/ArithmUtils'
+
+lNbrSamples = (ARGV[0] || 4000000).to_i
+lNbrRuns = 5
+lAnalyzeUtils = WSK::AnalyzeUtils::AnalyzeUtils.new
+lArithmUtils = WSK::ArithmUtils::ArithmUtils.new
+
+# Get the best time (in seconds) of several runs of a code block
+#
+# Parameters::
+# * *iNbrRuns* (_Integer_): Number of runs
+# * _CodeBlock_: The code to measure
+# Return::
+# * _Float_: The best time
+def best_time(iNbrRuns)
+  return (1..iNbrRuns).map { Benchmark.realtime { yield } }.min
+end
+
+puts "Codecs throughput on #{lNbrSamples} samples (MSamples/s, best of #{lNbrRuns} runs)"
+puts "Format            Decode  Decode+Encode"
+lResults = {}
+[ 16, 24 ].each do |iNbrBitsPerSample|
+  lMaxValue = (1 << (iNbrBitsPerSample-1)) - 1
+  [ 1, 2 ].each do |iNbrChannels|
+    lRawBuffer, lRawBuffer2 = [ 0.8, 0.7 ].map do |iAmplitude|
+      Array.new(lNbrSamples*iNbrChannels) { |iIdx| (lMaxValue*iAmplitude*Math.sin(iIdx/(50.0*iNbrChannels))).round }.pack('l<*').unpack('a4'*(lNbrSamples*iNbrChannels)).map { |iValue| iValue[0..(iNbrBitsPerSample/8-1)] }.join
+    end
+    lMaxValues = lAnalyzeUtils.init64bitsArray(iNbrChannels, -lMaxValue-1)
+    lMinValues = lAnalyzeUtils.init64bitsArray(iNbrChannels, lMaxValue)
+    lSumValues = lAnalyzeUtils.init64bitsArray(iNbrChannels, 0)
+    lAbsSumValues = lAnalyzeUtils.init64bitsArray(iNbrChannels, 0)
+    lSquareSumValues = lAnalyzeUtils.init128bitsArray(iNbrChannels)
+    lDecodeTime = best_time(lNbrRuns) do
+      lAnalyzeUtils.completeAnalyze(lRawBuffer, iNbrBitsPerSample, lNbrSamples, iNbrChannels, lMaxValues, lMinValues, lSumValues, lAbsSumValues, lSquareSumValues)
+    end
+    lCodecTime = best_time(lNbrRuns) do
+      lArithmUtils.compareBuffers(lRawBuffer, lRawBuffer2, iNbrBitsPerSample, iNbrChannels, lNbrSamples, 1.0, nil)
+    end
+    lResults[[iNbrBitsPerSample, iNbrChannels]] = [lNbrSamples/(lDecodeTime*1000000), lNbrSamples/(lCodecTime*1000000)]
+    puts sprintf('%2d bits %d channels %8.1f %14.1f', iNbrBitsPerSample, iNbrChannels, *lResults[[iNbrBitsPerSample, iNbrChannels]])
+  end
+end
+[ 1, 2 ].each do |iNbrChannels|
+  puts sprintf('24 bits / 16 bits ratio (%d channels): decode %.2f, decode+encode %.2f', iNbrChannels, *(0..1).map { |iIdx| lResults[[24, iNbrChannels]][iIdx]/lResults[[16, iNbrChannels]][iIdx] })
+end
@@ -0,0 +1,99 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+# Measure the throughput and the accuracy of each engine computing FFT sums without trigonometric cache (WSK_FFT_ENGINE environment variable), and with the trigonometric cache, with FFTUtils#completeSumCosSin.
+# Without cache, samples are given by buffers of 100 ms, as when computing FFT profiles, so that sums are continued across buffers.
+# With cache, each 100 ms window is computed separately, as when searching FFT samples.
+# The accuracy is the maximal deviation of FFT coefficients from the exact engine, relatively to the greatest coefficient.
+# Run it after building the extensions:
+#   ruby bench/FFTEngines.rb [NbrSamples]
+# The WSK_THREADS and WSK_SIMD environment variables are taken into account.
+
+require 'benchmark'
+
+lWSKRootDir = File.expand_path("#{File.dirname(__FILE__)}/..")
+
+# Add lib path to the LOAD_PATH
+$: << "#{lWSKRootDir}/lib"
+# Add ext path to the LOAD_PATH
+$: << "#{lWSKRootDir}/ext"
+
+require 'WSK/FFT'
+require 'WSK/FFTUtils/FFTUtils'
+
+lNbrSamples = (ARGV[0] || 441000).to_i
+lNbrRuns = 3
+lSampleRate = 44100
+lNbrChannels = 2
+lNbrSamplesPerBuffer = lSampleRate/WSK::FFT::FFTSAMPLE_FREQ
+lFFTUtils = WSK::FFTUtils::FFTUtils.new
+lNbrFreq = WSK::FFT::FREQINDEX_LAST - WSK::FFT::FREQINDEX_FIRST + 1
+lW = lFFTUtils.createWi(WSK::FFT::FREQINDEX_FIRST, WSK::FFT::FREQINDEX_LAST, lSampleRate)
+# 16 bits stereo: 2 sines over noise
+lRandom = Random.new(0)
+lRawBuffer = Array.new(lNbrSamples*lNbrChannels) do |iIdx|
+  lIdxSample = iIdx/lNbrChannels
+  (8000*Math.sin(lIdxSample*2*Math::PI*440/lSampleRate) + 4000*Math.sin(lIdxSample*2*Math::PI*(1000+iIdx%lNbrChannels)/lSampleRate) + lRandom.rand(-2000..2000)).round
+end.pack('s<*')
+
+# Compute the FFT coefficients of the whole samples with the current engine
+#
+# Parameters::
+# * *iFFTUtils* (<em>WSK::FFTUtils::FFTUtils</em>): The FFT utils
+# * *iRawBuffer* (_String_): The samples
+# * *iNbrSamples* (_Integer_): Number of samples
+# * *iNbrChannels* (_Integer_): Number of channels
+# * *iNbrFreq* (_Integer_): Number of frequencies
+# * *iW* (_Object_): Container of the Wi
+# * *iNbrSamplesPerBuffer* (_Integer_): Number of samples given per call
+# * *iTrigoCache* (_Object_): Container of the trigo cache to compute each buffer separately, or nil to compute the whole samples with the Wi [optional = nil]
+# Return::
+# * <em>list<list<Integer>></em>: FFT coefficients, per frequency, per channel (of the last buffer if a trigo cache is used)
+def compute_fft(iFFTUtils, iRawBuffer, iNbrSamples, iNbrChannels, iNbrFreq, iW, iNbrSamplesPerBuffer, iTrigoCache = nil)
+  lSampleSize = iNbrChannels*2
+  lSumCos = iFFTUtils.initSumArray(iNbrFreq, iNbrChannels)
+  lSumSin = iFFTUtils.initSumArray(iNbrFreq, iNbrChannels)
+  lIdxSample = 0
+  while (lIdxSample < iNbrSamples)
+    lNbrBufferSamples = [ iNbrSamplesPerBuffer, iNbrSamples-lIdxSample ].min
+    if (iTrigoCache == nil)
+      iFFTUtils.completeSumCosSin(iRawBuffer[lIdxSample*lSampleSize, lNbrBufferSamples*lSampleSize], lIdxSample, 16, lNbrBufferSamples, iNbrChannels, iNbrFreq, iW, nil, lSumCos, lSumSin)
+    else
+      lSumCos = iFFTUtils.initSumArray(iNbrFreq, iNbrChannels)
+      lSumSin = iFFTUtils.initSumArray(iNbrFreq, iNbrChannels)
+      iFFTUtils.completeSumCosSin(iRawBuffer[lIdxSample*lSampleSize, lNbrBufferSamples*lSampleSize], 0, 16, lNbrBufferSamples, iNbrChannels, iNbrFreq, nil, iTrigoCache, lSumCos, lSumSin)
+    end
+    lIdxSample += lNbrBufferSamples
+  end
+
+  return iFFTUtils.computeFFT(iNbrChannels, iNbrFreq, lSumCos, lSumSin)
+end
+
+puts "FFT engines on #{lNbrSamples} stereo samples, #{lNbrFreq} frequencies (MSamples/s, best of #{lNbrRuns} runs)"
+puts 'Engine     MSamples/s  Speedup  Max deviation'
+lExactFFT = nil
+lExactTime = nil
+[ 'exact', 'phasor', 'goertzel' ].each do |iEngine|
+  ENV['WSK_FFT_ENGINE'] = iEngine
+  lFFT = nil
+  lTime = (1..lNbrRuns).map { Benchmark.realtime { lFFT = compute_fft(lFFTUtils, lRawBuffer, lNbrSamples, lNbrChannels, lNbrFreq, lW, lNbrSamplesPerBuffer) } }.min
+  if (lExactFFT == nil)
+    lExactFFT = lFFT
+    lExactTime = lTime
+  end
+  lMaxCoeff = lExactFFT.flatten.max
+  lMaxDeviation = lFFT.flatten.zip(lExactFFT.flatten).map { |iCoeff, iExactCoeff| (iCoeff-iExactCoeff).abs }.max
+  puts sprintf('%-10s %10.3f %8.1f %14.2e', iEngine, lNbrSamples/(lTime*1000000), lExactTime/lTime, lMaxDeviation.to_f/lMaxCoeff)
+end
+# With the trigo cache, compared with the exact engine on the last window
+ENV['WSK_FFT_ENGINE'] = 'exact'
+lTrigoCache = lFFTUtils.initTrigoCache(lW, lNbrFreq, lNbrSamplesPerBuffer)
+lNbrLastSamples = (lNbrSamples-1) % lNbrSamplesPerBuffer + 1
+lExactFFT = compute_fft(lFFTUtils, lRawBuffer[(lNbrSamples-lNbrLastSamples)*lNbrChannels*2..-1], lNbrLastSamples, lNbrChannels, lNbrFreq, lW, lNbrSamplesPerBuffer)
+lFFT = nil
+lTime = (1..lNbrRuns).map { Benchmark.realtime { lFFT = compute_fft(lFFTUtils, lRawBuffer, lNbrSamples, lNbrChannels, lNbrFreq, lW, lNbrSamplesPerBuffer, lTrigoCache) } }.min
+lMaxCoeff = lExactFFT.flatten.max
+lMaxDeviation = lFFT.flatten.zip(lExactFFT.flatten).map { |iCoeff, iExactCoeff| (iCoeff-iExactCoeff).abs }.max
+puts sprintf('%-10s %10.3f %8.1f %14.2e', 'cache', lNbrSamples/(lTime*1000000), lExactTime/lTime, lMaxDeviation.to_f/lMaxCoeff)
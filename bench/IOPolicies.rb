@@ -0,0 +1,130 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+# Measure the sustained throughput and the page cache footprint of each page cache policy (WSK_IO_POLICY environment variable), reading a big file with RawReader and writing it with DirectStream.
+# Writes are measured until data is on the disk, whatever the policy.
+# The page cache footprint is the growth of the system page cache (Cached in /proc/meminfo) during each measure: it is only measured on Linux, and other processes disturb it.
+# Files are created in a directory that has to be on the disk to measure (not a tmpfs, that does not support O_DIRECT).
+# Run it after building the extensions:
+#   ruby bench/IOPolicies.rb [SizeMB] [Directory]
+
+require 'benchmark'
+require 'tmpdir'
+require 'rUtilAnts/Logging'
+RUtilAnts::Logging::install_logger_on_object(:mute_stdout => true)
+
+lWSKRootDir = File.expand_path("#{File.dirname(__FILE__)}/..")
+
+# Add lib path to the LOAD_PATH
+$: << "#{lWSKRootDir}/lib"
+# Add ext path to the LOAD_PATH
+$: << "#{lWSKRootDir}/ext"
+
+require 'WSK/Model/Header'
+require 'WSK/Model/RawReader'
+require 'WSK/OutputInterfaces/DirectStream'
+require 'WSK/IOUtils/IOUtils'
+
+lSize = (ARGV[0] || 1024).to_i*1048576
+lDir = ARGV[1] || Dir.tmpdir
+lIOUtils = WSK::IOUtils::IOUtils.new
+# 16 bits stereo
+lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+lSampleSize = 4
+lNbrSamples = lSize/lSampleSize
+lChunk = Array.new(2097152) { |iIdx| (iIdx*7919) % 65536 - 32768 }.pack('s<*')
+
+# Get the size of the system page cache
+#
+# Return::
+# * _Integer_: Size of the page cache in bytes, or nil if it can't be measured
+def cache_size
+  rSize = nil
+
+  if (File.exist?('/proc/meminfo'))
+    lMatch = File.read('/proc/meminfo').match(/^Cached:\s+(\d+) kB/)
+    rSize = lMatch[1].to_i*1024 if (lMatch != nil)
+  end
+
+  return rSize
+end
+
+# Measure a code block
+#
+# Parameters::
+# * _CodeBlock_: The code to measure
+# Return::
+# * _Float_: The time spent, in seconds
+# * _Integer_: The growth of the page cache in bytes, or nil if it can't be measured
+def measure
+  lCacheSizeBefore = cache_size
+  lTime = Benchmark.realtime { yield }
+  lCacheSizeAfter = cache_size
+
+  return lTime, (((lCacheSizeBefore == nil) or (lCacheSizeAfter == nil)) ? nil : lCacheSizeAfter-lCacheSizeBefore)
+end
+
+# Write a file, and drop it from the page cache
+#
+# Parameters::
+# * *iFileName* (_String_): The file name
+# * *iChunk* (_String_): The data written repeatedly
+# * *iSize* (_Integer_): The size of the file
+# * *iIOUtils* (<em>WSK::IOUtils::IOUtils</em>): The IO utils
+def create_file(iFileName, iChunk, iSize, iIOUtils)
+  File.open(iFileName, 'wb') do |oFile|
+    lNbrBytesWritten = 0
+    while (lNbrBytesWritten < iSize)
+      lNbrBytesWritten += oFile.write(iChunk[0, iSize-lNbrBytesWritten])
+    end
+    oFile.fsync
+    iIOUtils.adviseFile(oFile.fileno, WSK::IOUtils::IOUtils::ADVICE_DONTNEED, 0, iSize)
+  end
+end
+
+lInputFileName = "#{lDir}/WSKBench_IOPolicies_Input.raw"
+lOutputFileName = "#{lDir}/WSKBench_IOPolicies_Output.raw"
+begin
+  create_file(lInputFileName, lChunk, lSize, lIOUtils)
+  puts "Page cache policies on #{lSize/1048576} MB in #{lDir} (throughput in MB/s, page cache growth in MB)"
+  puts 'Policy     Read MB/s  Read cache  Write MB/s  Write cache'
+  [ 'cache', 'dontneed', 'direct' ].each do |iPolicy|
+    ENV['WSK_IO_POLICY'] = iPolicy
+    # Read the whole file, with its data out of the page cache
+    File.open(lInputFileName, 'rb') do |iFile|
+      lIOUtils.adviseFile(iFile.fileno, WSK::IOUtils::IOUtils::ADVICE_DONTNEED, 0, lSize)
+    end
+    lReadTime, lReadCacheSize = measure do
+      File.open(lInputFileName, 'rb') do |iFile|
+        WSK::Model::RawReader.new(iFile, 0, lSampleSize, lNbrSamples).each_buffer do |iBuffer, iNbrSamples|
+        end
+      end
+    end
+    # Write the same size, until it is on the disk
+    lStdOut = $stdout
+    lWriteTime, lWriteCacheSize = measure do
+      File.open(lOutputFileName, 'w+b') do |oFile|
+        # Progression is written on the standard output
+        $stdout = File.open(File::NULL, 'w')
+        lOutputInterface = WSK::OutputInterfaces::DirectStream.new
+        lOutputInterface.initInterface(oFile, lHeader, lNbrSamples)
+        lNbrBytesWritten = 0
+        while (lNbrBytesWritten < lSize)
+          lRawBuffer = lChunk[0, lSize-lNbrBytesWritten]
+          lOutputInterface.pushRawBuffer(lRawBuffer)
+          lNbrBytesWritten += lRawBuffer.size
+        end
+        lOutputInterface.finalize
+        oFile.fsync
+      end
+    end
+    $stdout = lStdOut
+    File.unlink(lOutputFileName)
+    puts sprintf('%-8s %11.1f %11s %11.1f %12s', iPolicy, lSize/(lReadTime*1048576), (lReadCacheSize == nil) ? 'n/a' : (lReadCacheSize/1048576).to_s, lSize/(lWriteTime*1048576), (lWriteCacheSize == nil) ? 'n/a' : (lWriteCacheSize/1048576).to_s)
+  end
+ensure
+  File.unlink(lInputFileName) if File.exist?(lInputFileName)
+  File.unlink(lOutputFileName) if File.exist?(lOutputFileName)
+end
@@ -0,0 +1,407 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+# Measure the throughput of the C kernels on synthetic raw buffers, for each format (8, 16 and 24 bits, 1, 2, 6 and 8 channels).
+# Throughputs are given in MB/s of input raw data and in ns per sample (a sample being the values of all channels at a given time).
+# Run it after building the extensions:
+#   ruby bench/run.rb [--samples <NbrSamples>] [--runs <NbrRuns>] [--kernels <Regexp>] [--output <JSONFile>] [--baseline <JSONFile>] [--tolerance <Percentage>]
+# rake bench runs it against the stored baseline (bench/Baseline.json), and rake bench:baseline stores a new one.
+# Baselines are only meaningful on the machine that produced them.
+# The WSK_SIMD and WSK_THREADS environment variables are taken into account, and stored in the results.
+
+require 'optparse'
+require 'benchmark'
+require 'json'
+require 'rUtilAnts/Logging'
+RUtilAnts::Logging::install_logger_on_object(:mute_stdout => true)
+
+lWSKRootDir = File.expand_path("#{File.dirname(__FILE__)}/..")
+
+# Add lib path to the LOAD_PATH
+$: << "#{lWSKRootDir}/lib"
+# Add ext path to the LOAD_PATH
+$: << "#{lWSKRootDir}/ext"
+
+require 'WSK/Model/Header'
+require 'WSK/Common'
+require 'WSK/Functions'
+require 'WSK/AnalyzeUtils/AnalyzeUtils'
+require 'WSK/ArithmUtils/ArithmUtils'
+require 'WSK/FFTUtils/FFTUtils'
+require 'WSK/FunctionUtils/FunctionUtils'
+require 'WSK/SilentUtils/SilentUtils'
+require 'WSK/VolumeUtils/VolumeUtils'
+
+module WSKBench
+
+  # Sample rate of synthetic data
+  SAMPLE_RATE = 44100
+
+  # Number of samples used by each FFT. Same as WSK::FFT.
+  NBR_FFT_SAMPLES = 4410
+
+  # Number of samples given by each raw buffer of in-memory input data
+  NBR_SAMPLES_PER_BUFFER = 65536
+
+  # Format of synthetic raw buffers
+  class Format
+
+    # Number of bits per sample
+    #   Integer
+    attr_reader :NbrBitsPerSample
+
+    # Number of channels
+    #   Integer
+    attr_reader :NbrChannels
+
+    # Number of samples
+    #   Integer
+    attr_reader :NbrSamples
+
+    # Constructor
+    #
+    # Parameters::
+    # * *iNbrBitsPerSample* (_Integer_): Number of bits per sample
+    # * *iNbrChannels* (_Integer_): Number of channels
+    # * *iNbrSamples* (_Integer_): Number of samples
+    def initialize(iNbrBitsPerSample, iNbrChannels, iNbrSamples)
+      @NbrBitsPerSample, @NbrChannels, @NbrSamples = iNbrBitsPerSample, iNbrChannels, iNbrSamples
+      # Cache of generated raw buffers, per amplitude
+      @RawBuffers = {}
+    end
+
+    # Get the maximal value of a sample
+    #
+    # Return::
+    # * _Integer_: The maximal value
+    def max_value
+      return (1 << (@NbrBitsPerSample-1)) - 1
+    end
+
+    # Get the size of a sample in a raw buffer
+    #
+    # Return::
+    # * _Integer_: The size in bytes
+    def sample_size
+      return (@NbrBitsPerSample/8)*@NbrChannels
+    end
+
+    # Get a raw buffer of a sine wave (each channel having its own frequency)
+    #
+    # Parameters::
+    # * *iAmplitude* (_Float_): Amplitude of the sine, relative to the maximal value
+    # Return::
+    # * _String_: The raw buffer
+    def raw_buffer(iAmplitude)
+      if (@RawBuffers[iAmplitude] == nil)
+        # Generate 1 period of the slowest frequency, and repeat it
+        lNbrPatternSamples = 4096
+        lValues = []
+        lNbrPatternSamples.times do |iIdxSample|
+          @NbrChannels.times do |iIdxChannel|
+            lValues << (max_value*iAmplitude*Math.sin((2*Math::PI*iIdxSample*(iIdxChannel+1))/lNbrPatternSamples)).round
+          end
+        end
+        lPattern = nil
+        case @NbrBitsPerSample
+        when 8
+          lPattern = lValues.map { |iValue| iValue + 128 }.pack('C*')
+        when 16
+          lPattern = lValues.pack('v*')
+        when 24
+          lPattern = lValues.pack('V*').unpack('a3x'*lValues.size).join
+        end
+        @RawBuffers[iAmplitude] = (lPattern*(@NbrSamples/lNbrPatternSamples + 1))[0..@NbrSamples*sample_size-1]
+      end
+
+      return @RawBuffers[iAmplitude]
+    end
+
+  end
+
+  # In-memory input data, giving raw buffers as WSK::Model::InputData does
+  class InputData
+
+    # Header of the input data
+    #   WSK::Model::Header
+    attr_reader :Header
+
+    # Constructor
+    #
+    # Parameters::
+    # * *iFormat* (<em>WSKBench::Format</em>): Format of the data
+    # * *iRawBuffer* (_String_): The whole raw data
+    def initialize(iFormat, iRawBuffer)
+      @Header = WSK::Model::Header.new(1, iFormat.NbrChannels, SAMPLE_RATE, iFormat.NbrBitsPerSample)
+      @RawBuffer = iRawBuffer
+      @SampleSize = iFormat.sample_size
+      @NbrSamples = iFormat.NbrSamples
+    end
+
+    # Iterate through the buffers in raw mode
+    #
+    # Parameters::
+    # * *iIdxBeginSample* (_Integer_): Index of the first sample to begin with [optional = 0]
+    # * *iIdxLastSample* (_Integer_): Index of the last sample to end with [optional = @NbrSamples-1]
+    # * *CodeBlock*: The code called for each iteration:
+    #   * *iInputRawBuffer* (_String_): The raw buffer
+    #   * *iNbrSamples* (_Integer_): The number of samples in this buffer
+    #   * *iNbrChannels* (_Integer_): The number of channels in this buffer
+    def each_raw_buffer(iIdxBeginSample = 0, iIdxLastSample = @NbrSamples-1)
+      lIdxSample = iIdxBeginSample
+      while (lIdxSample <= iIdxLastSample)
+        lNbrSamples = [ NBR_SAMPLES_PER_BUFFER, iIdxLastSample-lIdxSample+1 ].min
+        yield(@RawBuffer[lIdxSample*@SampleSize..(lIdxSample+lNbrSamples)*@SampleSize-1], lNbrSamples, @Header.NbrChannels)
+        lIdxSample += lNbrSamples
+      end
+    end
+
+  end
+
+  # The kernels to measure.
+  # Each one is given with a code block preparing the measure for a format, and returning:
+  # * _Integer_: The number of samples processed by the measured code, or nil if this format can't be measured
+  # * _Proc_: The code to measure
+  KERNELS = [
+    [ 'completeAnalyze', lambda do |iFormat|
+      lAnalyzeUtils = WSK::AnalyzeUtils::AnalyzeUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)
+      lMaxValues = lAnalyzeUtils.init64bitsArray(iFormat.NbrChannels, -iFormat.max_value-1)
+      lMinValues = lAnalyzeUtils.init64bitsArray(iFormat.NbrChannels, iFormat.max_value)
+      lSumValues = lAnalyzeUtils.init64bitsArray(iFormat.NbrChannels, 0)
+      lAbsSumValues = lAnalyzeUtils.init64bitsArray(iFormat.NbrChannels, 0)
+      lSquareSumValues = lAnalyzeUtils.init128bitsArray(iFormat.NbrChannels)
+      next iFormat.NbrSamples, lambda {
+        lAnalyzeUtils.completeAnalyze(lRawBuffer, iFormat.NbrBitsPerSample, iFormat.NbrSamples, iFormat.NbrChannels, lMaxValues, lMinValues, lSumValues, lAbsSumValues, lSquareSumValues)
+      }
+    end ],
+    [ 'applyMap', lambda do |iFormat|
+      # Maps of 24 bits samples take 64 MB per channel
+      next nil, nil if (iFormat.NbrBitsPerSample == 24)
+      lArithmUtils = WSK::ArithmUtils::ArithmUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)
+      lFunction = {
+        :FunctionType => WSK::Functions::FCTTYPE_PIECEWISE_LINEAR,
+        :MinValue => -iFormat.max_value-1,
+        :MaxValue => iFormat.max_value,
+        :Points => { -iFormat.max_value-1 => -iFormat.max_value/2, 0 => 0, iFormat.max_value => iFormat.max_value/2 }
+      }
+      lMap = lArithmUtils.createMapFromFunctions(iFormat.NbrBitsPerSample, [ lFunction ]*iFormat.NbrChannels)
+      next iFormat.NbrSamples, lambda {
+        lArithmUtils.applyMap(lMap, lRawBuffer, iFormat.NbrBitsPerSample, iFormat.NbrSamples, nil, nil)
+      }
+    end ],
+    [ 'mixBuffers', lambda do |iFormat|
+      lArithmUtils = WSK::ArithmUtils::ArithmUtils.new
+      lBuffers = [
+        [ nil, nil, 0.6, iFormat.raw_buffer(0.8), iFormat.NbrSamples ],
+        [ nil, nil, 0.4, iFormat.raw_buffer(0.7), iFormat.NbrSamples ]
+      ]
+      next iFormat.NbrSamples, lambda {
+        lArithmUtils.mixBuffers(lBuffers, iFormat.NbrBitsPerSample, iFormat.NbrChannels, nil, nil)
+      }
+    end ],
+    [ 'compareBuffers', lambda do |iFormat|
+      lArithmUtils = WSK::ArithmUtils::ArithmUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)
+      lRawBuffer2 = iFormat.raw_buffer(0.7)
+      next iFormat.NbrSamples, lambda {
+        lArithmUtils.compareBuffers(lRawBuffer, lRawBuffer2, iFormat.NbrBitsPerSample, iFormat.NbrChannels, iFormat.NbrSamples, 1.0, nil)
+      }
+    end ],
+    [ 'applyVolumeFct', lambda do |iFormat|
+      lVolumeUtils = WSK::VolumeUtils::VolumeUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)
+      lCFunction = WSK::FunctionUtils::FunctionUtils.new.createCFunction({
+        :FunctionType => WSK::Functions::FCTTYPE_PIECEWISE_LINEAR,
+        :Points => { Rational(0) => Rational(1), Rational(1, 2) => Rational(1, 2), Rational(1) => Rational(1) }
+      }, 0, iFormat.NbrSamples-1)
+      next iFormat.NbrSamples, lambda {
+        lVolumeUtils.applyVolumeFct(lCFunction, lRawBuffer, iFormat.NbrBitsPerSample, iFormat.NbrChannels, iFormat.NbrSamples, 0, false, nil, nil)
+      }
+    end ],
+    [ 'drawVolumeFct', lambda do |iFormat|
+      lVolumeUtils = WSK::VolumeUtils::VolumeUtils.new
+      lCFunction = WSK::FunctionUtils::FunctionUtils.new.createCFunction({
+        :FunctionType => WSK::Functions::FCTTYPE_PIECEWISE_LINEAR,
+        :Points => { Rational(0) => Rational(-6), Rational(1, 2) => Rational(0), Rational(1) => Rational(-6) }
+      }, 0, iFormat.NbrSamples-1)
+      next iFormat.NbrSamples, lambda {
+        lVolumeUtils.drawVolumeFct(lCFunction, iFormat.NbrBitsPerSample, iFormat.NbrChannels, iFormat.NbrSamples, 0, true, iFormat.max_value/2)
+      }
+    end ],
+    [ 'measureLevel', lambda do |iFormat|
+      lVolumeUtils = WSK::VolumeUtils::VolumeUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)
+      next iFormat.NbrSamples, lambda {
+        lVolumeUtils.measureLevel(lRawBuffer, iFormat.NbrBitsPerSample, iFormat.NbrChannels, iFormat.NbrSamples, 0.5)
+      }
+    end ],
+    [ 'completeSumCosSin', lambda do |iFormat|
+      # Same frequencies as WSK::FFT, on 1 FFT sample
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)[0..NBR_FFT_SAMPLES*iFormat.sample_size-1]
+      lNbrFreq = 139
+      lW = lFFTUtils.createWi(-59, 79, SAMPLE_RATE)
+      lSumCos = lFFTUtils.initSumArray(lNbrFreq, iFormat.NbrChannels)
+      lSumSin = lFFTUtils.initSumArray(lNbrFreq, iFormat.NbrChannels)
+      next NBR_FFT_SAMPLES, lambda {
+        lFFTUtils.completeSumCosSin(lRawBuffer, 0, iFormat.NbrBitsPerSample, NBR_FFT_SAMPLES, iFormat.NbrChannels, lNbrFreq, lW, nil, lSumCos, lSumSin)
+      }
+    end ],
+    [ 'completeSumCosSinWithCache', lambda do |iFormat|
+      # Same frequencies as WSK::FFT, on 1 FFT sample
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.8)[0..NBR_FFT_SAMPLES*iFormat.sample_size-1]
+      lNbrFreq = 139
+      lTrigoCache = lFFTUtils.initTrigoCache(lFFTUtils.createWi(-59, 79, SAMPLE_RATE), lNbrFreq, NBR_FFT_SAMPLES)
+      lSumCos = lFFTUtils.initSumArray(lNbrFreq, iFormat.NbrChannels)
+      lSumSin = lFFTUtils.initSumArray(lNbrFreq, iFormat.NbrChannels)
+      next NBR_FFT_SAMPLES, lambda {
+        lFFTUtils.completeSumCosSin(lRawBuffer, 0, iFormat.NbrBitsPerSample, NBR_FFT_SAMPLES, iFormat.NbrChannels, lNbrFreq, nil, lTrigoCache, lSumCos, lSumSin)
+      }
+    end ],
+    [ 'getSampleBeyondThresholds', lambda do |iFormat|
+      # All samples are within thresholds: the whole buffer is parsed
+      lSilentUtils = WSK::SilentUtils::SilentUtils.new
+      lRawBuffer = iFormat.raw_buffer(0.1)
+      lThresholds = [ [ -iFormat.max_value/5, iFormat.max_value/5 ] ]*iFormat.NbrChannels
+      next iFormat.NbrSamples, lambda {
+        lSilentUtils.getSampleBeyondThresholds(lRawBuffer, lThresholds, iFormat.NbrBitsPerSample, iFormat.NbrChannels, iFormat.NbrSamples, false)
+      }
+    end ],
+    [ 'getNextSilentInThresholds', lambda do |iFormat|
+      # Silences are too short: the whole input data is parsed
+      lSilentUtils = WSK::SilentUtils::SilentUtils.new
+      lInputData = InputData.new(iFormat, iFormat.raw_buffer(0.8))
+      lThresholds = [ [ -iFormat.max_value/5, iFormat.max_value/5 ] ]*iFormat.NbrChannels
+      next iFormat.NbrSamples, lambda {
+        lSilentUtils.getNextSilentInThresholds(lInputData, 0, lThresholds, iFormat.NbrSamples, false)
+      }
+    end ]
+  ]
+
+  # Get the best time (in seconds) of several runs of a code block
+  #
+  # Parameters::
+  # * *iNbrRuns* (_Integer_): Number of runs
+  # * *iCode* (_Proc_): The code to measure
+  # Return::
+  # * _Float_: The best time
+  def self.best_time(iNbrRuns, iCode)
+    return (1..iNbrRuns).map { Benchmark.realtime { iCode.call } }.min
+  end
+
+  # Get the key identifying a measure, used to compare with baselines
+  #
+  # Parameters::
+  # * *iMeasure* (<em>map<String,Object></em>): The measure
+  # Return::
+  # * _String_: The key
+  def self.measure_key(iMeasure)
+    return "#{iMeasure['Kernel']} #{iMeasure['NbrBitsPerSample']} bits #{iMeasure['NbrChannels']} channels"
+  end
+
+end
+
+lNbrSamples = 1000000
+lNbrRuns = 5
+lKernelsFilter = nil
+lOutputFileName = nil
+lBaselineFileName = nil
+lTolerance = 10.0
+lOptions = OptionParser.new
+lOptions.banner = 'run.rb [--samples <NbrSamples>] [--runs <NbrRuns>] [--kernels <Regexp>] [--output <JSONFile>] [--baseline <JSONFile>] [--tolerance <Percentage>]'
+lOptions.on('--samples <NbrSamples>', Integer, 'Number of samples of the synthetic buffers. Default: 1000000') do |iArg|
+  lNbrSamples = iArg
+end
+lOptions.on('--runs <NbrRuns>', Integer, 'Number of runs of each measure, the best one being kept. Default: 5') do |iArg|
+  lNbrRuns = iArg
+end
+lOptions.on('--kernels <Regexp>', String, 'Only measure kernels whose name matches this regular expression') do |iArg|
+  lKernelsFilter = Regexp.new(iArg)
+end
+lOptions.on('--output <JSONFile>', String, 'Write results in this JSON file') do |iArg|
+  lOutputFileName = iArg
+end
+lOptions.on('--baseline <JSONFile>', String, 'Compare results with this JSON file, previously written with --output') do |iArg|
+  lBaselineFileName = iArg
+end
+lOptions.on('--tolerance <Percentage>', Float, 'Slow down (in % of ns per sample) above which a measure is a regression. Default: 10') do |iArg|
+  lTolerance = iArg
+end
+lOptions.parse(ARGV)
+
+lResults = {
+  'NbrSamples' => lNbrSamples,
+  'NbrRuns' => lNbrRuns,
+  'RubyVersion' => RUBY_VERSION,
+  'SIMD' => ENV['WSK_SIMD'],
+  'Threads' => ENV['WSK_THREADS'],
+  'Measures' => []
+}
+puts "Kernels throughput on #{lNbrSamples} samples (best of #{lNbrRuns} runs)"
+puts 'Kernel                      Bits Channels       MB/s   ns/sample'
+[ 8, 16, 24 ].each do |iNbrBitsPerSample|
+  [ 1, 2, 6, 8 ].each do |iNbrChannels|
+    lFormat = WSKBench::Format.new(iNbrBitsPerSample, iNbrChannels, lNbrSamples)
+    WSKBench::KERNELS.each do |iKernelName, iSetupCode|
+      next if ((lKernelsFilter != nil) and (iKernelName.match(lKernelsFilter) == nil))
+      lNbrMeasuredSamples, lCode = iSetupCode.call(lFormat)
+      next if (lNbrMeasuredSamples == nil)
+      lTime = WSKBench::best_time(lNbrRuns, lCode)
+      lMeasure = {
+        'Kernel' => iKernelName,
+        'NbrBitsPerSample' => iNbrBitsPerSample,
+        'NbrChannels' => iNbrChannels,
+        'MBPerSecond' => (lNbrMeasuredSamples*lFormat.sample_size)/(lTime*1000000),
+        'NsPerSample' => (lTime*1000000000)/lNbrMeasuredSamples
+      }
+      lResults['Measures'] << lMeasure
+      puts sprintf('%-27s %4d %8d %10.1f %11.2f', iKernelName, iNbrBitsPerSample, iNbrChannels, lMeasure['MBPerSecond'], lMeasure['NsPerSample'])
+    end
+  end
+end
+
+if (lOutputFileName != nil)
+  File.open(lOutputFileName, 'w') do |oFile|
+    oFile.write(JSON.pretty_generate(lResults))
+  end
+  puts "Results written in #{lOutputFileName}"
+end
+
+lNbrRegressions = 0
+if (lBaselineFileName != nil)
+  # Index baseline measures
+  lBaselineMeasures = {}
+  lBaseline = JSON.parse(File.read(lBaselineFileName))
+  lBaseline['Measures'].each do |iMeasure|
+    lBaselineMeasures[WSKBench::measure_key(iMeasure)] = iMeasure
+  end
+  puts "Comparison with #{lBaselineFileName} (tolerance: #{lTolerance}%)"
+  [ 'NbrSamples', 'SIMD', 'Threads' ].each do |iProperty|
+    if (lBaseline[iProperty] != lResults[iProperty])
+      puts "  Warning: baseline was measured with #{iProperty}=#{lBaseline[iProperty].inspect} instead of #{lResults[iProperty].inspect}"
+    end
+  end
+  lResults['Measures'].each do |iMeasure|
+    lKey = WSKBench::measure_key(iMeasure)
+    lBaselineMeasure = lBaselineMeasures[lKey]
+    if (lBaselineMeasure == nil)
+      puts "  #{lKey}: not in baseline"
+    else
+      lChange = ((iMeasure['NsPerSample']-lBaselineMeasure['NsPerSample'])*100)/lBaselineMeasure['NsPerSample']
+      if (lChange > lTolerance)
+        puts sprintf('  %s: REGRESSION %+.1f%% (%.2f ns/sample instead of %.2f)', lKey, lChange, iMeasure['NsPerSample'], lBaselineMeasure['NsPerSample'])
+        lNbrRegressions += 1
+      elsif (lChange < -lTolerance)
+        puts sprintf('  %s: improvement %+.1f%%', lKey, lChange)
+      end
+    end
+  end
+  puts "#{lNbrRegressions} regressions found."
+end
+
+exit((lNbrRegressions == 0) ? 0 : 1)
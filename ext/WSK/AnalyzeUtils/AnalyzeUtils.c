@@ -16,6 +16,7 @@ typedef struct {
 
 // Structure used to give variables to iteration process
 typedef struct {
+  int nbrChannels;
   long long int * maxValues;
   long long int * minValues;
   long long int * sumValues;
@@ -92,41 +93,129 @@ static VALUE analyzeutils_init128bitsArray(
 }
 
 /**
- * Process a value read from an input buffer for the Analyze function.
- * Use the trigo cache.
+ * Process a block read from an input buffer for the Analyze function.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tAnalyzeStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int analyzeutils_processValue_Analyze(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int analyzeutils_processBlock_Analyze(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
   // Interpret parameters
   tAnalyzeStruct* lPtrVariables = (tAnalyzeStruct*)iPtrArgs;
 
-  if (iValue > lPtrVariables->maxValues[iIdxChannel]) {
-    lPtrVariables->maxValues[iIdxChannel] = iValue;
-  }
-  if (iValue < lPtrVariables->minValues[iIdxChannel]) {
-    lPtrVariables->minValues[iIdxChannel] = iValue;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  const tSampleValue* lPtrValues;
+  tSampleValue lValue;
+  long long int lMaxValue;
+  long long int lMinValue;
+  long long int lSumValue;
+  long long int lAbsSumValue;
+  // Squares of a block's values fit in 64 bits: they are summed here before being added to the 128 bits sum.
+  unsigned long long int lSquareSumValue;
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrValues = iPtrBlock->values[lIdxChannel];
+    lMaxValue = lPtrVariables->maxValues[lIdxChannel];
+    lMinValue = lPtrVariables->minValues[lIdxChannel];
+    lSumValue = 0;
+    lAbsSumValue = 0;
+    lSquareSumValue = 0;
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      lValue = lPtrValues[lIdxSample];
+      if (lValue > lMaxValue) {
+        lMaxValue = lValue;
+      }
+      if (lValue < lMinValue) {
+        lMinValue = lValue;
+      }
+      lSumValue += lValue;
+      lAbsSumValue += abs(lValue);
+      lSquareSumValue += ((long long int)lValue)*((long long int)lValue);
+    }
+    lPtrVariables->maxValues[lIdxChannel] = lMaxValue;
+    lPtrVariables->minValues[lIdxChannel] = lMinValue;
+    lPtrVariables->sumValues[lIdxChannel] += lSumValue;
+    lPtrVariables->absSumValues[lIdxChannel] += lAbsSumValue;
+    add128bits(&(lPtrVariables->squareSumValues[lIdxChannel]), lSquareSumValue);
   }
-  lPtrVariables->sumValues[iIdxChannel] += iValue;
-  lPtrVariables->absSumValues[iIdxChannel] += abs(iValue);
-  add128bits(&(lPtrVariables->squareSumValues[iIdxChannel]), ((long long int)iValue)*((long long int)iValue));
 
   return 0;
 }
 
+/**
+ * Initialize the arguments of a part of the buffer processed by a thread for the Analyze function.
+ * The part gets its own arrays, initialized as if it was the first one to be processed.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tAnalyzeStruct*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tAnalyzeStruct*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
+ */
+static void analyzeutils_initSliceArgs_Analyze(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  const tAnalyzeStruct* lPtrArgs = (const tAnalyzeStruct*)iPtrArgs;
+  tAnalyzeStruct* lPtrSliceArgs = (tAnalyzeStruct*)oPtrSliceArgs;
+  int lNbrChannels = lPtrArgs->nbrChannels;
+  lPtrSliceArgs->nbrChannels = lNbrChannels;
+  lPtrSliceArgs->maxValues = ALLOC_N(long long int, lNbrChannels);
+  lPtrSliceArgs->minValues = ALLOC_N(long long int, lNbrChannels);
+  lPtrSliceArgs->sumValues = ALLOC_N(long long int, lNbrChannels);
+  lPtrSliceArgs->absSumValues = ALLOC_N(long long int, lNbrChannels);
+  lPtrSliceArgs->squareSumValues = ALLOC_N(t128bits, lNbrChannels);
+  memcpy(lPtrSliceArgs->maxValues, lPtrArgs->maxValues, lNbrChannels*sizeof(long long int));
+  memcpy(lPtrSliceArgs->minValues, lPtrArgs->minValues, lNbrChannels*sizeof(long long int));
+  memset(lPtrSliceArgs->sumValues, 0, lNbrChannels*sizeof(long long int));
+  memset(lPtrSliceArgs->absSumValues, 0, lNbrChannels*sizeof(long long int));
+  memset(lPtrSliceArgs->squareSumValues, 0, lNbrChannels*sizeof(t128bits));
+}
+
+/**
+ * Merge the results of a part of the buffer processed by a thread for the Analyze function, and free its arrays.
+ *
+ * Parameters::
+ * * *ioPtrArgs* (<em>void*</em>): The iteration arguments. In fact a <em>tAnalyzeStruct*</em>.
+ * * *iPtrSliceArgs* (<em>void*</em>): The arguments of the part. In fact a <em>tAnalyzeStruct*</em>.
+ */
+static void analyzeutils_reduceSliceArgs_Analyze(
+  void* ioPtrArgs,
+  void* iPtrSliceArgs) {
+  tAnalyzeStruct* lPtrArgs = (tAnalyzeStruct*)ioPtrArgs;
+  tAnalyzeStruct* lPtrSliceArgs = (tAnalyzeStruct*)iPtrSliceArgs;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < lPtrArgs->nbrChannels; ++lIdxChannel) {
+    if (lPtrSliceArgs->maxValues[lIdxChannel] > lPtrArgs->maxValues[lIdxChannel]) {
+      lPtrArgs->maxValues[lIdxChannel] = lPtrSliceArgs->maxValues[lIdxChannel];
+    }
+    if (lPtrSliceArgs->minValues[lIdxChannel] < lPtrArgs->minValues[lIdxChannel]) {
+      lPtrArgs->minValues[lIdxChannel] = lPtrSliceArgs->minValues[lIdxChannel];
+    }
+    lPtrArgs->sumValues[lIdxChannel] += lPtrSliceArgs->sumValues[lIdxChannel];
+    lPtrArgs->absSumValues[lIdxChannel] += lPtrSliceArgs->absSumValues[lIdxChannel];
+    add128bits(&(lPtrArgs->squareSumValues[lIdxChannel]), lPtrSliceArgs->squareSumValues[lIdxChannel].low);
+    lPtrArgs->squareSumValues[lIdxChannel].high += lPtrSliceArgs->squareSumValues[lIdxChannel].high;
+  }
+  free(lPtrSliceArgs->maxValues);
+  free(lPtrSliceArgs->minValues);
+  free(lPtrSliceArgs->sumValues);
+  free(lPtrSliceArgs->absSumValues);
+  free(lPtrSliceArgs->squareSumValues);
+}
+
+// Functions processing parts of a buffer in parallel for the Analyze function
+static const tParallelFcts gParallelFcts_Analyze = {
+  sizeof(tAnalyzeStruct),
+  &analyzeutils_initSliceArgs_Analyze,
+  &analyzeutils_reduceSliceArgs_Analyze
+};
+
 /** Complete the arrays of sums for analyzis
  * 
  * Parameters::
@@ -153,12 +242,13 @@ static VALUE analyzeutils_completeAnalyze(
   VALUE ioValAbsSumValues,
   VALUE ioValSquareSumValues) {
   // Translate Ruby objects
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   int iNbrChannels = FIX2INT(iValNbrChannels);
   int iNbrBitsPerSample = FIX2LONG(iValNbrBitsPerSample);
   char* lPtrRawBuffer = RSTRING_PTR(iValInputRawBuffer);
   // Get the arrays
   tAnalyzeStruct lProcessParams;
+  lProcessParams.nbrChannels = iNbrChannels;
   Data_Get_Struct(ioValMaxValues, long long int, lProcessParams.maxValues);
   Data_Get_Struct(ioValMinValues, long long int, lProcessParams.minValues);
   Data_Get_Struct(ioValSumValues, long long int, lProcessParams.sumValues);
@@ -166,14 +256,15 @@ static VALUE analyzeutils_completeAnalyze(
   Data_Get_Struct(ioValSquareSumValues, t128bits, lProcessParams.squareSumValues);
 
   // Parse the data
-  commonutils_iterateThroughRawBuffer(
+  commonutils_iterateBlocksThroughRawBuffer(
     lPtrRawBuffer,
     iNbrBitsPerSample,
     iNbrChannels,
     iNbrSamples,
     0,
-    &analyzeutils_processValue_Analyze,
-    &lProcessParams
+    &analyzeutils_processBlock_Analyze,
+    &lProcessParams,
+    &gParallelFcts_Analyze
   );
 
   return Qnil;
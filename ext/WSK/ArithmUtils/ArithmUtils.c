@@ -6,6 +6,7 @@
 #include "ruby.h"
 #include <math.h>
 #include <stdio.h>
+#include <limits.h>
 #include <CommonUtils.h>
 #include <gmp.h>
 
@@ -27,10 +28,7 @@ typedef struct {
 
 // Struct used to store info about a buffer
 typedef struct {
-  // All buffers point on the same data at the beginning of the iterations
-  unsigned char* buffer_8bits;
-  signed short int* buffer_16bits;
-  t24bits* buffer_24bits;
+  const char* buffer;
   tSampleIndex nbrBufferSamples;
   long double coeff;
 } tBufferInfo;
@@ -38,22 +36,39 @@ typedef struct {
 // Struct used to convey data among iterators in the Mix method
 typedef struct {
   tBufferInfo* lstBuffers;
-  int nbrActiveBuffers;
+  int nbrBuffers;
   long double mainCoeff;
-  // Temporary attributes
-  long double tmpValue;
-  int idxBuffer;
+  int nbrBitsPerSample;
+  int sampleSize;
+  // Block used to decode additional buffers
+  tSampleBlock additionalBlock;
+  // Mixed values of the current block, per channel
+  long double** mixedValues;
 } tMixStruct;
 
+// Struct used to store a distortion found while comparing buffers
+typedef struct {
+  tSampleValue value;
+  tSampleValue mapValue;
+  tSampleValue value2;
+} tDistortion;
+
 // Struct used to convey data among iterators in the Compare method
 typedef struct {
-  unsigned char* buffer2_8bits;
-  signed short int* buffer2_16bits;
-  t24bits* buffer2_24bits;
+  const char* buffer2;
+  int nbrBitsPerSample;
+  int sampleSize;
+  // Block used to decode the second buffer
+  tSampleBlock block2;
   long double coeffDiff;
   tSampleValue* map;
   tSampleValue mapOffset;
-  VALUE self;
+  // The value that represents nil in the map
+  tSampleValue impossibleValue;
+  // Distortions found, to be logged once the iteration is over
+  tDistortion* distortions;
+  int nbrDistortions;
+  int sizeDistortions;
   mpz_t cumulativeErrors;
 } tCompareStruct;
 
@@ -234,31 +249,62 @@ static VALUE arithmutils_createMapFromFunctions(
 }
 
 /**
- * Process a value read from an input buffer for the applyMap function.
+ * Process a block read from an input buffer for the applyMap function.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tApplyMapStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int arithmutils_processValue_applyMap(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int arithmutils_processBlock_applyMap(
+  const tSampleBlock* iPtrBlock,
+  tSampleBlock* oPtrBlock,
   void* iPtrArgs) {
+  tApplyMapStruct* lPtrParams = (tApplyMapStruct*)iPtrArgs;
 
-  (*oPtrValue) = ((tApplyMapStruct*)iPtrArgs)->map[iIdxChannel][iValue + ((tApplyMapStruct*)iPtrArgs)->offsetIdxMap];
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  const tSampleValue* lPtrChannelMap;
+  const tSampleValue* lPtrValues;
+  tSampleValue* lPtrOutValues;
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrChannelMap = lPtrParams->map[lIdxChannel] + lPtrParams->offsetIdxMap;
+    lPtrValues = iPtrBlock->values[lIdxChannel];
+    lPtrOutValues = oPtrBlock->values[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      lPtrOutValues[lIdxSample] = lPtrChannelMap[lPtrValues[lIdxSample]];
+    }
+  }
 
   return 0;
 }
 
+/**
+ * Initialize the arguments of a part of the buffer processed by a thread for the applyMap function.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tApplyMapStruct*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tApplyMapStruct*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
+ */
+static void arithmutils_initSliceArgs_applyMap(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  *((tApplyMapStruct*)oPtrSliceArgs) = *((const tApplyMapStruct*)iPtrArgs);
+}
+
+// Functions processing parts of a buffer in parallel for the applyMap function
+static const tParallelFcts gParallelFcts_applyMap = {
+  sizeof(tApplyMapStruct),
+  &arithmutils_initSliceArgs_applyMap,
+  NULL
+};
+
 /**
  * Apply a map on an input buffer, and outputs a result buffer.
  *
@@ -267,17 +313,21 @@ int arithmutils_processValue_applyMap(
  * * *iValMap* (_Object_): The container of the map
  * * *iValInputBuffer* (_String_): The input buffer
  * * *iValNbrSamples* (_Integer_): Number of samples from the buffer
+ * * *iValOutputMappedFile* (_Object_): The container of a file mapped for write receiving the output, or nil to output a String (see commonutils_getOutputBuffer)
+ * * *iValOutputOffset* (_Integer_): Offset of the output in the mapped file, or nil
  * Return::
- * * _String_: Output buffer
+ * * _String_: Output buffer, or nil if it was written in the mapped file
  **/
 static VALUE arithmutils_applyMap(
   VALUE iSelf,
   VALUE iValMap,
   VALUE iValInputBuffer,
   VALUE iValNbrBitsPerSample,
-  VALUE iValNbrSamples) {
+  VALUE iValNbrSamples,
+  VALUE iValOutputMappedFile,
+  VALUE iValOutputOffset) {
   // Translate Ruby objects
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   // Get the map
   tMap* lPtrMap;
@@ -285,9 +335,10 @@ static VALUE arithmutils_applyMap(
 
   // Get the input buffer
   char* lPtrRawBuffer = RSTRING_PTR(iValInputBuffer);
-  int lBufferCharSize = RSTRING_LEN(iValInputBuffer);
-  // Allocate the output buffer
-  char* lPtrOutputBuffer = ALLOC_N(char, lBufferCharSize);
+  tSampleIndex lBufferCharSize = RSTRING_LEN(iValInputBuffer);
+  // Get the output buffer
+  VALUE rValOutputBuffer;
+  char* lPtrOutputBuffer = commonutils_getOutputBuffer(iValOutputMappedFile, iValOutputOffset, lBufferCharSize, &rValOutputBuffer);
 
   // Create parameters to give the process
   tApplyMapStruct lProcessParams;
@@ -295,7 +346,7 @@ static VALUE arithmutils_applyMap(
   lProcessParams.map = lPtrMap->map;
 
   // Iterate through the raw buffer
-  commonutils_iterateThroughRawBufferOutput(
+  commonutils_iterateBlocksThroughRawBufferOutput(
     iSelf,
     lPtrRawBuffer,
     lPtrOutputBuffer,
@@ -304,167 +355,133 @@ static VALUE arithmutils_applyMap(
     iNbrSamples,
     0,
     lPtrMap->possibleExceedValues,
-    &arithmutils_processValue_applyMap,
-    &lProcessParams
+    &arithmutils_processBlock_applyMap,
+    &lProcessParams,
+    &gParallelFcts_applyMap
   );
 
-  VALUE rValOutputBuffer = rb_str_new(lPtrOutputBuffer, lBufferCharSize);
-
-  free(lPtrOutputBuffer);
-
   return rValOutputBuffer;
 }
 
 /**
- * Process a value read from an input buffer for the mix function.
- * Optimized for 8 bits samples.
+ * Process a block read from an input buffer for the mix function.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMixStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int arithmutils_processValue_mix_8bits(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int arithmutils_processBlock_mix(
+  const tSampleBlock* iPtrBlock,
+  tSampleBlock* oPtrBlock,
   void* iPtrArgs) {
   tMixStruct* lPtrParams = (tMixStruct*)iPtrArgs;
 
-  if (lPtrParams->nbrActiveBuffers > 0) {
-    // Check if we hit the limit of the last active buffer (the one having the least samples)
-    if (iIdxSample == lPtrParams->lstBuffers[lPtrParams->nbrActiveBuffers-1].nbrBufferSamples) {
-      // We have to check the buffers that are to be removed
-      lPtrParams->idxBuffer = lPtrParams->nbrActiveBuffers-1;
-      while ((lPtrParams->idxBuffer >= 0) &&
-             (lPtrParams->lstBuffers[lPtrParams->idxBuffer].nbrBufferSamples == iIdxSample )) {
-        --lPtrParams->nbrActiveBuffers;
-        --lPtrParams->idxBuffer;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  int lIdxBuffer;
+  tBufferInfo* lPtrBufferInfo;
+  tSampleIndex lNbrBufferSamples;
+  long double* lPtrMixedValues;
+  const tSampleValue* lPtrValues;
+  tSampleValue* lPtrOutValues;
+  // Start with the main buffer
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrMixedValues = lPtrParams->mixedValues[lIdxChannel];
+    lPtrValues = iPtrBlock->values[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      lPtrMixedValues[lIdxSample] = ((long double)lPtrValues[lIdxSample])*lPtrParams->mainCoeff;
+    }
+  }
+  // Add each additional buffer still having samples in this block.
+  // Buffers are sorted from the one having the most samples to the one having the least.
+  for (lIdxBuffer = 0; lIdxBuffer < lPtrParams->nbrBuffers; ++lIdxBuffer) {
+    lPtrBufferInfo = &(lPtrParams->lstBuffers[lIdxBuffer]);
+    if (lPtrBufferInfo->nbrBufferSamples <= iPtrBlock->idxFirstSample) {
+      break;
+    }
+    lNbrBufferSamples = lPtrBufferInfo->nbrBufferSamples - iPtrBlock->idxFirstSample;
+    if (lNbrBufferSamples > iPtrBlock->nbrSamples) {
+      lNbrBufferSamples = iPtrBlock->nbrSamples;
+    }
+    commonutils_decodeBlock(
+      lPtrBufferInfo->buffer + iPtrBlock->idxFirstSample*lPtrParams->sampleSize,
+      lPtrParams->nbrBitsPerSample,
+      lNbrBufferSamples,
+      iPtrBlock->idxFirstSample,
+      &(lPtrParams->additionalBlock));
+    for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+      lPtrMixedValues = lPtrParams->mixedValues[lIdxChannel];
+      lPtrValues = lPtrParams->additionalBlock.values[lIdxChannel];
+      for (lIdxSample = 0; lIdxSample < lNbrBufferSamples; ++lIdxSample) {
+        lPtrMixedValues[lIdxSample] += ((long double)lPtrValues[lIdxSample])*lPtrBufferInfo->coeff;
       }
     }
-    // We have to mix several buffers
-    lPtrParams->tmpValue = ((long double)iValue)*lPtrParams->mainCoeff;
-    for (lPtrParams->idxBuffer = 0; lPtrParams->idxBuffer < lPtrParams->nbrActiveBuffers; ++lPtrParams->idxBuffer) {
-      lPtrParams->tmpValue += (((long double)*(lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_8bits))-128)*lPtrParams->lstBuffers[lPtrParams->idxBuffer].coeff;
-      ++lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_8bits;
+  }
+  // Export the result
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrMixedValues = lPtrParams->mixedValues[lIdxChannel];
+    lPtrOutValues = oPtrBlock->values[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      lPtrOutValues[lIdxSample] = round(lPtrMixedValues[lIdxSample]);
     }
-    // Export the result
-    (*oPtrValue) = round(lPtrParams->tmpValue);
-  } else {
-    // There is only the main buffer remaining
-    (*oPtrValue) = round(((long double)iValue)*lPtrParams->mainCoeff);
   }
 
   return 0;
 }
 
 /**
- * Process a value read from an input buffer for the mix function.
- * Optimized for 16 bits samples.
+ * Initialize the arguments of a part of the buffer processed by a thread for the mix function.
+ * The part gets its own decoding block and mixed values.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMixStruct*</em>.
- * Return::
- * * _int_: The return code:
- * ** 0: Continue iteration
- * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tMixStruct*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tMixStruct*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
  */
-int arithmutils_processValue_mix_16bits(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
-  void* iPtrArgs) {
-  tMixStruct* lPtrParams = (tMixStruct*)iPtrArgs;
-
-  if (lPtrParams->nbrActiveBuffers > 0) {
-    // Check if we hit the limit of the last active buffer (the one having the least samples)
-    if (iIdxSample == lPtrParams->lstBuffers[lPtrParams->nbrActiveBuffers-1].nbrBufferSamples) {
-      // We have to check the buffers that are to be removed
-      lPtrParams->idxBuffer = lPtrParams->nbrActiveBuffers-1;
-      while ((lPtrParams->idxBuffer >= 0) &&
-             (lPtrParams->lstBuffers[lPtrParams->idxBuffer].nbrBufferSamples == iIdxSample )) {
-        --lPtrParams->nbrActiveBuffers;
-        --lPtrParams->idxBuffer;
-      }
-    }
-    // We have to mix several buffers
-    lPtrParams->tmpValue = ((long double)iValue)*lPtrParams->mainCoeff;
-    for (lPtrParams->idxBuffer = 0; lPtrParams->idxBuffer < lPtrParams->nbrActiveBuffers; ++lPtrParams->idxBuffer) {
-      lPtrParams->tmpValue += ((long double)*(lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_16bits))*lPtrParams->lstBuffers[lPtrParams->idxBuffer].coeff;
-      ++lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_16bits;
-    }
-    // Export the result
-    (*oPtrValue) = round(lPtrParams->tmpValue);
-  } else {
-    // There is only the main buffer remaining
-    (*oPtrValue) = round(((long double)iValue)*lPtrParams->mainCoeff);
+static void arithmutils_initSliceArgs_mix(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  tMixStruct* lPtrSliceParams = (tMixStruct*)oPtrSliceArgs;
+  *lPtrSliceParams = *((const tMixStruct*)iPtrArgs);
+  int lNbrChannels = lPtrSliceParams->additionalBlock.nbrChannels;
+  commonutils_initSampleBlock(&(lPtrSliceParams->additionalBlock), lNbrChannels);
+  lPtrSliceParams->mixedValues = ALLOC_N(long double*, lNbrChannels);
+  lPtrSliceParams->mixedValues[0] = ALLOC_N(long double, lNbrChannels*COMMONUTILS_BLOCK_SIZE);
+  int lIdxChannel;
+  for (lIdxChannel = 1; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+    lPtrSliceParams->mixedValues[lIdxChannel] = lPtrSliceParams->mixedValues[0] + lIdxChannel*COMMONUTILS_BLOCK_SIZE;
   }
-
-  return 0;
 }
 
 /**
- * Process a value read from an input buffer for the mix function.
- * Optimized for 8 bits samples.
+ * Free the arguments of a part of the buffer processed by a thread for the mix function.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMixStruct*</em>.
- * Return::
- * * _int_: The return code:
- * ** 0: Continue iteration
- * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
+ * * *ioPtrArgs* (<em>void*</em>): The iteration arguments. In fact a <em>tMixStruct*</em>.
+ * * *iPtrSliceArgs* (<em>void*</em>): The arguments of the part. In fact a <em>tMixStruct*</em>.
  */
-int arithmutils_processValue_mix_24bits(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
-  void* iPtrArgs) {
-  tMixStruct* lPtrParams = (tMixStruct*)iPtrArgs;
-
-  if (lPtrParams->nbrActiveBuffers > 0) {
-    // Check if we hit the limit of the last active buffer (the one having the least samples)
-    if (iIdxSample == lPtrParams->lstBuffers[lPtrParams->nbrActiveBuffers-1].nbrBufferSamples) {
-      // We have to check the buffers that are to be removed
-      lPtrParams->idxBuffer = lPtrParams->nbrActiveBuffers-1;
-      while ((lPtrParams->idxBuffer >= 0) &&
-             (lPtrParams->lstBuffers[lPtrParams->idxBuffer].nbrBufferSamples == iIdxSample )) {
-        --lPtrParams->nbrActiveBuffers;
-        --lPtrParams->idxBuffer;
-      }
-    }
-    // We have to mix several buffers
-    lPtrParams->tmpValue = ((long double)iValue)*lPtrParams->mainCoeff;
-    for (lPtrParams->idxBuffer = 0; lPtrParams->idxBuffer < lPtrParams->nbrActiveBuffers; ++lPtrParams->idxBuffer) {
-      lPtrParams->tmpValue += ((long double)(lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_24bits->value))*lPtrParams->lstBuffers[lPtrParams->idxBuffer].coeff;
-      lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_24bits = (t24bits*)(((int)lPtrParams->lstBuffers[lPtrParams->idxBuffer].buffer_24bits)+3);
-    }
-    // Export the result
-    (*oPtrValue) = round(lPtrParams->tmpValue);
-  } else {
-    // There is only the main buffer remaining
-    (*oPtrValue) = round(((long double)iValue)*lPtrParams->mainCoeff);
-  }
-
-  return 0;
+static void arithmutils_reduceSliceArgs_mix(
+  void* ioPtrArgs,
+  void* iPtrSliceArgs) {
+  tMixStruct* lPtrSliceParams = (tMixStruct*)iPtrSliceArgs;
+  commonutils_freeSampleBlock(&(lPtrSliceParams->additionalBlock));
+  free(lPtrSliceParams->mixedValues[0]);
+  free(lPtrSliceParams->mixedValues);
 }
 
+// Functions processing parts of a buffer in parallel for the mix function
+static const tParallelFcts gParallelFcts_mix = {
+  sizeof(tMixStruct),
+  &arithmutils_initSliceArgs_mix,
+  &arithmutils_reduceSliceArgs_mix
+};
+
 /**
  * Mix a list of buffers.
  * Prerequisite: The list of buffers have to be sorted, from the one having the more samples to the one having the less.
@@ -474,15 +491,19 @@ int arithmutils_processValue_mix_24bits(
  * * *iValBuffers* (<em>list<list<Object>></em>): The list of buffers and their associated info (see Mix.rb for details)
  * * *iValNbrBitsPerSample* (_Integer_): Number of bits per sample
  * * *iValNbrChannels* (_Integer_): Number of channels
+ * * *iValOutputMappedFile* (_Object_): The container of a file mapped for write receiving the output, or nil to output a String (see commonutils_getOutputBuffer)
+ * * *iValOutputOffset* (_Integer_): Offset of the output in the mapped file, or nil
  * Return::
- * * _String_: Output buffer
+ * * _String_: Output buffer, or nil if it was written in the mapped file
  * * _Integer_: Number of samples written
  **/
 static VALUE arithmutils_mixBuffers(
   VALUE iSelf,
   VALUE iValBuffers,
   VALUE iValNbrBitsPerSample,
-  VALUE iValNbrChannels) {
+  VALUE iValNbrChannels,
+  VALUE iValOutputMappedFile,
+  VALUE iValOutputOffset) {
   // Translate Ruby objects
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   int iNbrChannels = FIX2INT(iValNbrChannels);
@@ -493,210 +514,198 @@ static VALUE arithmutils_mixBuffers(
   tBufferInfo lPtrAdditionalBuffers[lNbrBuffers-1];
   int lIdxBuffer;
   VALUE lValBufferInfo;
-  char* lPtrBuffer;
   for (lIdxBuffer = 0; lIdxBuffer < lNbrBuffers-1 ; ++lIdxBuffer) {
     lValBufferInfo = rb_ary_entry(iValBuffers, lIdxBuffer+1);
-    lPtrBuffer = RSTRING_PTR(rb_ary_entry(lValBufferInfo, 3));
+    lPtrAdditionalBuffers[lIdxBuffer].buffer = RSTRING_PTR(rb_ary_entry(lValBufferInfo, 3));
     lPtrAdditionalBuffers[lIdxBuffer].coeff = NUM2DBL(rb_ary_entry(lValBufferInfo, 2));
-    lPtrAdditionalBuffers[lIdxBuffer].buffer_8bits = (unsigned char*)lPtrBuffer;
-    lPtrAdditionalBuffers[lIdxBuffer].buffer_16bits = (signed short int*)lPtrBuffer;
-    lPtrAdditionalBuffers[lIdxBuffer].buffer_24bits = (t24bits*)lPtrBuffer;
-    lPtrAdditionalBuffers[lIdxBuffer].nbrBufferSamples = FIX2INT(rb_ary_entry(lValBufferInfo, 4));
+    lPtrAdditionalBuffers[lIdxBuffer].nbrBufferSamples = NUM2LL(rb_ary_entry(lValBufferInfo, 4));
   }
 
   // Get the first buffer: the one that has the most samples
   VALUE lValFirstBufferInfo = rb_ary_entry(iValBuffers, 0);
   VALUE lValFirstBuffer = rb_ary_entry(lValFirstBufferInfo, 3);
   char* lPtrFirstBuffer = RSTRING_PTR(lValFirstBuffer);
-  int lBufferCharSize = RSTRING_LEN(lValFirstBuffer);
-  tSampleIndex lNbrSamples = FIX2INT(rb_ary_entry(lValFirstBufferInfo, 4));
+  tSampleIndex lBufferCharSize = RSTRING_LEN(lValFirstBuffer);
+  tSampleIndex lNbrSamples = NUM2LL(rb_ary_entry(lValFirstBufferInfo, 4));
 
-  // Allocate the output buffer
-  char* lPtrOutputBuffer = ALLOC_N(char, lBufferCharSize);
+  // Get the output buffer
+  VALUE rValOutputBuffer;
+  char* lPtrOutputBuffer = commonutils_getOutputBuffer(iValOutputMappedFile, iValOutputOffset, lBufferCharSize, &rValOutputBuffer);
 
   // Create variables to give to the iteration
   tMixStruct lProcessParams;
   lProcessParams.lstBuffers = lPtrAdditionalBuffers;
-  lProcessParams.nbrActiveBuffers = lNbrBuffers - 1;
+  lProcessParams.nbrBuffers = lNbrBuffers - 1;
   lProcessParams.mainCoeff = NUM2DBL(rb_ary_entry(lValFirstBufferInfo, 2));
-
-  // Iterate through the raw buffer
-  if (iNbrBitsPerSample == 8) {
-    commonutils_iterateThroughRawBufferOutput(
-      iSelf,
-      lPtrFirstBuffer,
-      lPtrOutputBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      lNbrSamples,
-      0,
-      1,
-      &arithmutils_processValue_mix_8bits,
-      &lProcessParams
-    );
-  } else if (iNbrBitsPerSample == 16) {
-    commonutils_iterateThroughRawBufferOutput(
-      iSelf,
-      lPtrFirstBuffer,
-      lPtrOutputBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      lNbrSamples,
-      0,
-      1,
-      &arithmutils_processValue_mix_16bits,
-      &lProcessParams
-    );
-  } else {
-    // If it is not 24 bits, the method will throw an exception. So we are safe.
-    commonutils_iterateThroughRawBufferOutput(
-      iSelf,
-      lPtrFirstBuffer,
-      lPtrOutputBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      lNbrSamples,
-      0,
-      1,
-      &arithmutils_processValue_mix_24bits,
-      &lProcessParams
-    );
+  lProcessParams.nbrBitsPerSample = iNbrBitsPerSample;
+  lProcessParams.sampleSize = (iNbrBitsPerSample/8)*iNbrChannels;
+  commonutils_initSampleBlock(&(lProcessParams.additionalBlock), iNbrChannels);
+  long double lMixedValues[iNbrChannels*COMMONUTILS_BLOCK_SIZE];
+  long double* lPtrMixedValues[iNbrChannels];
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrMixedValues[lIdxChannel] = lMixedValues + lIdxChannel*COMMONUTILS_BLOCK_SIZE;
   }
+  lProcessParams.mixedValues = lPtrMixedValues;
 
-  VALUE rValOutputBuffer = rb_str_new(lPtrOutputBuffer, lBufferCharSize);
-
-  free(lPtrOutputBuffer);
+  // Iterate through the raw buffer
+  commonutils_iterateBlocksThroughRawBufferOutput(
+    iSelf,
+    lPtrFirstBuffer,
+    lPtrOutputBuffer,
+    iNbrBitsPerSample,
+    iNbrChannels,
+    lNbrSamples,
+    0,
+    1,
+    &arithmutils_processBlock_mix,
+    &lProcessParams,
+    &gParallelFcts_mix
+  );
+  commonutils_freeSampleBlock(&(lProcessParams.additionalBlock));
 
-  return rb_ary_new3(2, rValOutputBuffer, LONG2FIX(lNbrSamples));
+  return rb_ary_new3(2, rValOutputBuffer, LL2NUM(lNbrSamples));
 }
 
-// The value that represents nil in the maps
-static tSampleValue gImpossibleValue;
 static ID gID_log_warn;
 
 /**
- * Process a value read from an input buffer for the compare function.
- * Optimized for 8 bits samples.
+ * Add a 64 bits unsigned integer to an MPZ.
+ * mpz_add_ui only accepts unsigned long, which can be 32 bits only.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMixStruct*</em>.
- * Return::
- * * _int_: The return code:
- * ** 0: Continue iteration
- * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
+ * * *ioMPZ* (<em>mpz_t</em>): The mpz to modify
+ * * *iValue* (<em>const unsigned long long int</em>): The value to add
  */
-int arithmutils_processValue_compare_8bits(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
-  void* iPtrArgs) {
-  tCompareStruct* lPtrParams = (tCompareStruct*)iPtrArgs;
-
-  tSampleValue lValue2 = (*lPtrParams->buffer2_8bits)-128;
-  if (lPtrParams->map != NULL) {
-    // Complete the map
-    if (lPtrParams->map[lPtrParams->mapOffset+iValue] == gImpossibleValue) {
-      lPtrParams->map[lPtrParams->mapOffset+iValue] = lValue2;
-    } else if (lPtrParams->map[lPtrParams->mapOffset+iValue] != lValue2) {
-      char lMessage[256];
-      sprintf(lMessage, "Distortion for input value %d was found both %d and %d", iValue, lPtrParams->map[lPtrParams->mapOffset+iValue], lValue2);
-      rb_funcall(lPtrParams->self, gID_log_warn, 1, rb_str_new2(lMessage));
-    }
+static void arithmutils_mpzAddULL(
+  mpz_t ioMPZ,
+  const unsigned long long int iValue) {
+  if (iValue > ULONG_MAX) {
+    mpz_t lTmpInt;
+    mpz_init_set_ui(lTmpInt, (unsigned long)(iValue >> 32));
+    mpz_mul_2exp(lTmpInt, lTmpInt, 32);
+    mpz_add_ui(lTmpInt, lTmpInt, (unsigned long)(iValue & 0xFFFFFFFF));
+    mpz_add(ioMPZ, ioMPZ, lTmpInt);
+    mpz_clear(lTmpInt);
+  } else {
+    mpz_add_ui(ioMPZ, ioMPZ, (unsigned long)iValue);
   }
-  *oPtrValue = (tSampleValue)(((long double)(lValue2-iValue))*lPtrParams->coeffDiff);
-  mpz_add_ui(lPtrParams->cumulativeErrors, lPtrParams->cumulativeErrors, abs(lValue2-iValue));
-  ++lPtrParams->buffer2_8bits;
-
-  return 0;
 }
 
 /**
- * Process a value read from an input buffer for the compare function.
- * Optimized for 16 bits samples.
+ * Process a block read from an input buffer for the compare function.
+ * Distortions found in the map are stored, as Ruby can't be called during the iteration.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMixStruct*</em>.
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tCompareStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int arithmutils_processValue_compare_16bits(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int arithmutils_processBlock_compare(
+  const tSampleBlock* iPtrBlock,
+  tSampleBlock* oPtrBlock,
   void* iPtrArgs) {
   tCompareStruct* lPtrParams = (tCompareStruct*)iPtrArgs;
 
-  tSampleValue lValue2 = *lPtrParams->buffer2_16bits;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  tSampleValue lValue;
+  tSampleValue lValue2;
+  const tSampleValue* lPtrValues;
+  const tSampleValue* lPtrValues2;
+  tSampleValue* lPtrOutValues;
+  // Sum of errors in this block. Fits in 64 bits for a block.
+  unsigned long long int lErrors = 0;
+  // Decode the same samples from the second buffer
+  commonutils_decodeBlock(
+    lPtrParams->buffer2 + iPtrBlock->idxFirstSample*lPtrParams->sampleSize,
+    lPtrParams->nbrBitsPerSample,
+    iPtrBlock->nbrSamples,
+    iPtrBlock->idxFirstSample,
+    &(lPtrParams->block2));
   if (lPtrParams->map != NULL) {
-    // Complete the map
-    if (lPtrParams->map[lPtrParams->mapOffset+iValue] == gImpossibleValue) {
-      lPtrParams->map[lPtrParams->mapOffset+iValue] = lValue2;
-    } else if (lPtrParams->map[lPtrParams->mapOffset+iValue] != lValue2) {
-      char lMessage[256];
-      sprintf(lMessage, "Distortion for input value %d was found both %d and %d", iValue, lPtrParams->map[lPtrParams->mapOffset+iValue], lValue2);
-      rb_funcall(lPtrParams->self, gID_log_warn, 1, rb_str_new2(lMessage));
+    // Complete the map, following samples order
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+        lValue = iPtrBlock->values[lIdxChannel][lIdxSample];
+        lValue2 = lPtrParams->block2.values[lIdxChannel][lIdxSample];
+        if (lPtrParams->map[lPtrParams->mapOffset+lValue] == lPtrParams->impossibleValue) {
+          lPtrParams->map[lPtrParams->mapOffset+lValue] = lValue2;
+        } else if (lPtrParams->map[lPtrParams->mapOffset+lValue] != lValue2) {
+          // Ruby can't be called from here: the distortion is logged later
+          if (lPtrParams->nbrDistortions == lPtrParams->sizeDistortions) {
+            lPtrParams->sizeDistortions = (lPtrParams->sizeDistortions == 0) ? 64 : 2*lPtrParams->sizeDistortions;
+            lPtrParams->distortions = (tDistortion*)realloc(lPtrParams->distortions, lPtrParams->sizeDistortions*sizeof(tDistortion));
+          }
+          lPtrParams->distortions[lPtrParams->nbrDistortions].value = lValue;
+          lPtrParams->distortions[lPtrParams->nbrDistortions].mapValue = lPtrParams->map[lPtrParams->mapOffset+lValue];
+          lPtrParams->distortions[lPtrParams->nbrDistortions].value2 = lValue2;
+          ++lPtrParams->nbrDistortions;
+        }
+      }
+    }
+  }
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrValues = iPtrBlock->values[lIdxChannel];
+    lPtrValues2 = lPtrParams->block2.values[lIdxChannel];
+    lPtrOutValues = oPtrBlock->values[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      lPtrOutValues[lIdxSample] = (tSampleValue)(((long double)(lPtrValues2[lIdxSample]-lPtrValues[lIdxSample]))*lPtrParams->coeffDiff);
+      lErrors += abs(lPtrValues2[lIdxSample]-lPtrValues[lIdxSample]);
     }
   }
-  *oPtrValue = (tSampleValue)(((long double)(lValue2-iValue))*lPtrParams->coeffDiff);
-  mpz_add_ui(lPtrParams->cumulativeErrors, lPtrParams->cumulativeErrors, abs(lValue2-iValue));
-  ++lPtrParams->buffer2_16bits;
+  arithmutils_mpzAddULL(lPtrParams->cumulativeErrors, lErrors);
 
   return 0;
 }
 
 /**
- * Process a value read from an input buffer for the compare function.
- * Optimized for 8 bits samples.
+ * Initialize the arguments of a part of the buffer processed by a thread for the compare function.
+ * The part gets its own decoding block and errors sum. Only used without map, as the map has to be completed in the samples order.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMixStruct*</em>.
- * Return::
- * * _int_: The return code:
- * ** 0: Continue iteration
- * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tCompareStruct*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tCompareStruct*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
  */
-int arithmutils_processValue_compare_24bits(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
-  void* iPtrArgs) {
-  tCompareStruct* lPtrParams = (tCompareStruct*)iPtrArgs;
-
-  tSampleValue lValue2 = lPtrParams->buffer2_24bits->value;
-  if (lPtrParams->map != NULL) {
-    // Complete the map
-    if (lPtrParams->map[lPtrParams->mapOffset+iValue] == gImpossibleValue) {
-      lPtrParams->map[lPtrParams->mapOffset+iValue] = lValue2;
-    } else if (lPtrParams->map[lPtrParams->mapOffset+iValue] != lValue2) {
-      char lMessage[256];
-      sprintf(lMessage, "Distortion for input value %d was found both %d and %d", iValue, lPtrParams->map[lPtrParams->mapOffset+iValue], lValue2);
-      rb_funcall(lPtrParams->self, gID_log_warn, 1, rb_str_new2(lMessage));
-    }
-  }
-  *oPtrValue = (tSampleValue)(((long double)(lValue2-iValue))*lPtrParams->coeffDiff);
-  mpz_add_ui(lPtrParams->cumulativeErrors, lPtrParams->cumulativeErrors, abs(lValue2-iValue));
-  lPtrParams->buffer2_24bits = (t24bits*)(((int)lPtrParams->buffer2_24bits)+3);
+static void arithmutils_initSliceArgs_compare(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  tCompareStruct* lPtrSliceParams = (tCompareStruct*)oPtrSliceArgs;
+  *lPtrSliceParams = *((const tCompareStruct*)iPtrArgs);
+  commonutils_initSampleBlock(&(lPtrSliceParams->block2), lPtrSliceParams->block2.nbrChannels);
+  mpz_init(lPtrSliceParams->cumulativeErrors);
+}
 
-  return 0;
+/**
+ * Merge the results of a part of the buffer processed by a thread for the compare function, and free them.
+ *
+ * Parameters::
+ * * *ioPtrArgs* (<em>void*</em>): The iteration arguments. In fact a <em>tCompareStruct*</em>.
+ * * *iPtrSliceArgs* (<em>void*</em>): The arguments of the part. In fact a <em>tCompareStruct*</em>.
+ */
+static void arithmutils_reduceSliceArgs_compare(
+  void* ioPtrArgs,
+  void* iPtrSliceArgs) {
+  tCompareStruct* lPtrParams = (tCompareStruct*)ioPtrArgs;
+  tCompareStruct* lPtrSliceParams = (tCompareStruct*)iPtrSliceArgs;
+  mpz_add(lPtrParams->cumulativeErrors, lPtrParams->cumulativeErrors, lPtrSliceParams->cumulativeErrors);
+  mpz_clear(lPtrSliceParams->cumulativeErrors);
+  commonutils_freeSampleBlock(&(lPtrSliceParams->block2));
 }
 
+// Functions processing parts of a buffer in parallel for the compare function
+static const tParallelFcts gParallelFcts_compare = {
+  sizeof(tCompareStruct),
+  &arithmutils_initSliceArgs_compare,
+  &arithmutils_reduceSliceArgs_compare
+};
+
 /**
  * Get a Ruby integer based on an MPZ storing an integer value.
  *
@@ -745,11 +754,11 @@ static VALUE arithmutils_compareBuffers(
   // Translate Ruby objects
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   int iNbrChannels = FIX2INT(iValNbrChannels);
-  int iNbrSamples = FIX2INT(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   long double iCoeffDiff = NUM2DBL(iValCoeffDiff);
   char* lPtrBuffer1 = RSTRING_PTR(iValBuffer1);
   char* lPtrBuffer2 = RSTRING_PTR(iValBuffer2);
-  int lBufferCharSize = RSTRING_LEN(iValBuffer1);
+  tSampleIndex lBufferCharSize = RSTRING_LEN(iValBuffer1);
   int lNbrSampleValues = 0;
   // Allocate the output buffer
   char* lPtrOutputBuffer = ALLOC_N(char, lBufferCharSize);
@@ -757,21 +766,24 @@ static VALUE arithmutils_compareBuffers(
   // Create variables to give to the iteration
   tCompareStruct lProcessParams;
   lProcessParams.coeffDiff = iCoeffDiff;
-  lProcessParams.self = iSelf;
+  lProcessParams.distortions = NULL;
+  lProcessParams.nbrDistortions = 0;
+  lProcessParams.sizeDistortions = 0;
   if (ioValMap == Qnil) {
     lProcessParams.map = NULL;
   } else {
     // Create the internal map
     // Define the impossible value
-    gImpossibleValue = pow(2, iNbrBitsPerSample-1) + 1;
+    lProcessParams.impossibleValue = pow(2, iNbrBitsPerSample-1) + 1;
     lNbrSampleValues = RARRAY_LEN(ioValMap);
-    tSampleValue lMap[lNbrSampleValues];
+    // Allocated on the heap as it is used after this scope
+    tSampleValue* lMap = ALLOC_N(tSampleValue, lNbrSampleValues);
     VALUE lValMapValue;
     int lIdxSampleValue;
     for (lIdxSampleValue = 0; lIdxSampleValue < lNbrSampleValues; ++lIdxSampleValue) {
       lValMapValue = rb_ary_entry(ioValMap, lIdxSampleValue);
       if (lValMapValue == Qnil) {
-        lMap[lIdxSampleValue] = gImpossibleValue;
+        lMap[lIdxSampleValue] = lProcessParams.impossibleValue;
       } else {
         lMap[lIdxSampleValue] = FIX2LONG(lValMapValue);
       }
@@ -779,64 +791,47 @@ static VALUE arithmutils_compareBuffers(
     lProcessParams.map = lMap;
     lProcessParams.mapOffset = pow(2, iNbrBitsPerSample-1);
   }
-  lProcessParams.buffer2_8bits = (unsigned char*)lPtrBuffer2;
-  lProcessParams.buffer2_16bits = (signed short int*)lPtrBuffer2;
-  lProcessParams.buffer2_24bits = (t24bits*)lPtrBuffer2;
+  lProcessParams.buffer2 = lPtrBuffer2;
+  lProcessParams.nbrBitsPerSample = iNbrBitsPerSample;
+  lProcessParams.sampleSize = (iNbrBitsPerSample/8)*iNbrChannels;
+  commonutils_initSampleBlock(&(lProcessParams.block2), iNbrChannels);
   mpz_init(lProcessParams.cumulativeErrors);
 
   // Iterate through the raw buffer
-  if (iNbrBitsPerSample == 8) {
-    commonutils_iterateThroughRawBufferOutput(
-      iSelf,
-      lPtrBuffer1,
-      lPtrOutputBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      iNbrSamples,
-      0,
-      1,
-      &arithmutils_processValue_compare_8bits,
-      &lProcessParams
-    );
-  } else if (iNbrBitsPerSample == 16) {
-    commonutils_iterateThroughRawBufferOutput(
-      iSelf,
-      lPtrBuffer1,
-      lPtrOutputBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      iNbrSamples,
-      0,
-      1,
-      &arithmutils_processValue_compare_16bits,
-      &lProcessParams
-    );
-  } else {
-    // If it is not 24 bits, the method will throw an exception. So we are safe.
-    commonutils_iterateThroughRawBufferOutput(
-      iSelf,
-      lPtrBuffer1,
-      lPtrOutputBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      iNbrSamples,
-      0,
-      1,
-      &arithmutils_processValue_compare_24bits,
-      &lProcessParams
-    );
-  }
+  commonutils_iterateBlocksThroughRawBufferOutput(
+    iSelf,
+    lPtrBuffer1,
+    lPtrOutputBuffer,
+    iNbrBitsPerSample,
+    iNbrChannels,
+    iNbrSamples,
+    0,
+    1,
+    &arithmutils_processBlock_compare,
+    &lProcessParams,
+    (lProcessParams.map == NULL) ? &gParallelFcts_compare : NULL
+  );
+  commonutils_freeSampleBlock(&(lProcessParams.block2));
 
   if (lProcessParams.map != NULL) {
+    // Log distortions
+    char lMessage[256];
+    int lIdxDistortion;
+    for (lIdxDistortion = 0; lIdxDistortion < lProcessParams.nbrDistortions; ++lIdxDistortion) {
+      sprintf(lMessage, "Distortion for input value %d was found both %d and %d", lProcessParams.distortions[lIdxDistortion].value, lProcessParams.distortions[lIdxDistortion].mapValue, lProcessParams.distortions[lIdxDistortion].value2);
+      rb_funcall(iSelf, gID_log_warn, 1, rb_str_new2(lMessage));
+    }
+    free(lProcessParams.distortions);
     // Modify the array in parameter
     int lIdxSampleValue;
     for (lIdxSampleValue = 0; lIdxSampleValue < lNbrSampleValues; ++lIdxSampleValue) {
-      if (lProcessParams.map[lIdxSampleValue] == gImpossibleValue) {
+      if (lProcessParams.map[lIdxSampleValue] == lProcessParams.impossibleValue) {
         rb_ary_store(ioValMap, lIdxSampleValue, Qnil);
       } else {
         rb_ary_store(ioValMap, lIdxSampleValue, LONG2FIX(lProcessParams.map[lIdxSampleValue]));
       }
     }
+    free(lProcessParams.map);
   }
   VALUE rValCumulativeErrors = mpz2RubyInt(lProcessParams.cumulativeErrors);
   mpz_clear(lProcessParams.cumulativeErrors);
@@ -855,8 +850,8 @@ void Init_ArithmUtils() {
   VALUE lArithmUtilsClass = rb_define_class_under(lArithmUtilsModule, "ArithmUtils", rb_cObject);
 
   rb_define_method(lArithmUtilsClass, "createMapFromFunctions", arithmutils_createMapFromFunctions, 2);
-  rb_define_method(lArithmUtilsClass, "applyMap", arithmutils_applyMap, 4);
-  rb_define_method(lArithmUtilsClass, "mixBuffers", arithmutils_mixBuffers, 3);
+  rb_define_method(lArithmUtilsClass, "applyMap", arithmutils_applyMap, 6);
+  rb_define_method(lArithmUtilsClass, "mixBuffers", arithmutils_mixBuffers, 5);
   rb_define_method(lArithmUtilsClass, "compareBuffers", arithmutils_compareBuffers, 7);
   gID_log_warn = rb_intern("log_warn");
 }
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#include "ruby.h"
+#include <string.h>
+#include <CommonUtils.h>
+
+/**
+ * Create an empty raw buffer, with memory allocated to store a given size.
+ *
+ * Parameters::
+ * * *iSelf* (_CodecUtils_): Self
+ * * *iValCapacity* (_Integer_): Size to allocate, in bytes
+ * Return::
+ * * _String_: The raw buffer
+ */
+static VALUE codecutils_createRawBuffer(
+  VALUE iSelf,
+  VALUE iValCapacity) {
+  return rb_str_buf_new(NUM2LONG(iValCapacity));
+}
+
+/**
+ * Empty a raw buffer, keeping its allocated memory.
+ *
+ * Parameters::
+ * * *iSelf* (_CodecUtils_): Self
+ * * *ioValRawBuffer* (_String_): The raw buffer
+ * Return::
+ * * _String_: The raw buffer
+ */
+static VALUE codecutils_clearRawBuffer(
+  VALUE iSelf,
+  VALUE ioValRawBuffer) {
+  rb_str_modify(ioValRawBuffer);
+  rb_str_set_len(ioValRawBuffer, 0);
+
+  return ioValRawBuffer;
+}
+
+/**
+ * Decode PCM channel values from a raw buffer.
+ *
+ * Parameters::
+ * * *iSelf* (_CodecUtils_): Self
+ * * *iValRawBuffer* (_String_): The raw buffer
+ * * *iValNbrValues* (_Integer_): Number of channel values to decode
+ * * *iValNbrBitsPerSample* (_Integer_): Number of bits per sample
+ * Return::
+ * * <em>list<Integer></em>: The channel values
+ */
+static VALUE codecutils_decodeSamples(
+  VALUE iSelf,
+  VALUE iValRawBuffer,
+  VALUE iValNbrValues,
+  VALUE iValNbrBitsPerSample) {
+  int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
+  if ((iNbrBitsPerSample != 8) &&
+      (iNbrBitsPerSample != 16) &&
+      (iNbrBitsPerSample != 24) &&
+      (iNbrBitsPerSample != 32)) {
+    rb_raise(rb_eRuntimeError, "%d bits PCM data not supported.", iNbrBitsPerSample);
+  }
+  int lNbrBytesPerValue = iNbrBitsPerSample/8;
+  long iNbrValues = NUM2LONG(iValNbrValues);
+  if (iNbrValues*lNbrBytesPerValue > RSTRING_LEN(iValRawBuffer)) {
+    rb_raise(rb_eRuntimeError, "Unable to decode %ld values from a buffer of %ld bytes.", iNbrValues, RSTRING_LEN(iValRawBuffer));
+  }
+  const unsigned char* lPtrRawBuffer = (const unsigned char*)RSTRING_PTR(iValRawBuffer);
+
+  VALUE rValChannelSamples = rb_ary_new2(iNbrValues);
+  long lIdxValue;
+  int lChannelValue;
+  for (lIdxValue = 0; lIdxValue < iNbrValues; ++lIdxValue) {
+    switch (lNbrBytesPerValue) {
+      case 1:
+        // 8 bits values are stored unsigned
+        lChannelValue = ((int)lPtrRawBuffer[0]) - 128;
+        break;
+      case 2:
+        lChannelValue = (short)(lPtrRawBuffer[0] | (lPtrRawBuffer[1] << 8));
+        break;
+      case 3:
+        lChannelValue = ((int)((lPtrRawBuffer[0] << 8) | (lPtrRawBuffer[1] << 16) | (((unsigned int)lPtrRawBuffer[2]) << 24))) >> 8;
+        break;
+      default:
+        lChannelValue = (int)(lPtrRawBuffer[0] | (lPtrRawBuffer[1] << 8) | (lPtrRawBuffer[2] << 16) | (((unsigned int)lPtrRawBuffer[3]) << 24));
+        break;
+    }
+    rb_ary_push(rValChannelSamples, INT2NUM(lChannelValue));
+    lPtrRawBuffer += lNbrBytesPerValue;
+  }
+
+  return rValChannelSamples;
+}
+
+/**
+ * Encode a list of channel values as PCM, and append them to a raw buffer.
+ * Values exceeding the range of the samples are truncated to their lowest bits.
+ *
+ * Parameters::
+ * * *iSelf* (_CodecUtils_): Self
+ * * *ioValRawBuffer* (_String_): The raw buffer to append to
+ * * *iValChannelSamples* (<em>list<Integer></em>): The channel values to encode
+ * * *iValNbrBitsPerSample* (_Integer_): Number of bits per sample
+ * Return::
+ * * _String_: The raw buffer
+ */
+static VALUE codecutils_encodeSamples(
+  VALUE iSelf,
+  VALUE ioValRawBuffer,
+  VALUE iValChannelSamples,
+  VALUE iValNbrBitsPerSample) {
+  int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
+  if ((iNbrBitsPerSample != 8) &&
+      (iNbrBitsPerSample != 16) &&
+      (iNbrBitsPerSample != 24) &&
+      (iNbrBitsPerSample != 32)) {
+    rb_raise(rb_eRuntimeError, "%d bits PCM data not supported.", iNbrBitsPerSample);
+  }
+  int lNbrBytesPerValue = iNbrBitsPerSample/8;
+  long lNbrValues = RARRAY_LEN(iValChannelSamples);
+  long lOldSize = RSTRING_LEN(ioValRawBuffer);
+  long lNewSize = lOldSize + lNbrValues*lNbrBytesPerValue;
+
+  // Grow the buffer geometrically, so that appending stays linear
+  rb_str_modify(ioValRawBuffer);
+  long lCapacity = rb_str_capacity(ioValRawBuffer);
+  if (lCapacity < lNewSize) {
+    rb_str_modify_expand(ioValRawBuffer, ((lNewSize > 2*lCapacity) ? lNewSize : 2*lCapacity) - lOldSize);
+  }
+  unsigned char* lPtrRawBuffer = (unsigned char*)(RSTRING_PTR(ioValRawBuffer) + lOldSize);
+
+  long lIdxValue;
+  VALUE lValChannelValue;
+  long long int lChannelValue;
+  for (lIdxValue = 0; lIdxValue < lNbrValues; ++lIdxValue) {
+    lValChannelValue = rb_ary_entry(iValChannelSamples, lIdxValue);
+    lChannelValue = (FIXNUM_P(lValChannelValue) ? FIX2LONG(lValChannelValue) : NUM2LL(lValChannelValue));
+    switch (lNbrBytesPerValue) {
+      case 1:
+        // 8 bits values are stored unsigned
+        lPtrRawBuffer[0] = (unsigned char)(lChannelValue + 128);
+        break;
+      case 2:
+        lPtrRawBuffer[0] = (unsigned char)lChannelValue;
+        lPtrRawBuffer[1] = (unsigned char)(lChannelValue >> 8);
+        break;
+      case 3:
+        lPtrRawBuffer[0] = (unsigned char)lChannelValue;
+        lPtrRawBuffer[1] = (unsigned char)(lChannelValue >> 8);
+        lPtrRawBuffer[2] = (unsigned char)(lChannelValue >> 16);
+        break;
+      default:
+        lPtrRawBuffer[0] = (unsigned char)lChannelValue;
+        lPtrRawBuffer[1] = (unsigned char)(lChannelValue >> 8);
+        lPtrRawBuffer[2] = (unsigned char)(lChannelValue >> 16);
+        lPtrRawBuffer[3] = (unsigned char)(lChannelValue >> 24);
+        break;
+    }
+    lPtrRawBuffer += lNbrBytesPerValue;
+  }
+  rb_str_set_len(ioValRawBuffer, lNewSize);
+
+  return ioValRawBuffer;
+}
+
+// Initialize the module
+void Init_CodecUtils() {
+  VALUE lWSKModule = rb_define_module("WSK");
+  VALUE lCodecUtilsModule = rb_define_module_under(lWSKModule, "CodecUtils");
+  VALUE lCodecUtilsClass = rb_define_class_under(lCodecUtilsModule, "CodecUtils", rb_cObject);
+
+  rb_define_method(lCodecUtilsClass, "createRawBuffer", codecutils_createRawBuffer, 1);
+  rb_define_method(lCodecUtilsClass, "clearRawBuffer", codecutils_clearRawBuffer, 1);
+  rb_define_method(lCodecUtilsClass, "decodeSamples", codecutils_decodeSamples, 3);
+  rb_define_method(lCodecUtilsClass, "encodeSamples", codecutils_encodeSamples, 3);
+}
@@ -0,0 +1,7 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require "#{File.dirname(__FILE__)}/../CommonBuild"
+create_makefile('CodecUtils')
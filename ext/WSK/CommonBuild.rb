@@ -102,10 +102,17 @@ def find_gmp
   return rSuccess
 end
 
-$CFLAGS += ' -Wall '
-if (!find_gmp)
-  build_local_gmp
-  raise RuntimeError, 'Unable to install GMP library automatically. Please do it manually from http://gmplib.org before attempting to install WaveSwissKnife.' unless find_gmp
+# Look for GMP, and build it locally if it can't be found.
+# This is called only by extensions using GMP.
+def require_gmp
+  if (!find_gmp)
+    build_local_gmp
+    raise RuntimeError, 'Unable to install GMP library automatically. Please do it manually from http://gmplib.org before attempting to install WaveSwissKnife.' unless find_gmp
+  end
 end
 
+$CFLAGS += ' -Wall '
+
+# CommonUtils uses pthreads to process buffers with several threads
+have_library('pthread', 'pthread_create', 'pthread.h')
 build_external_libs('CommonUtils')
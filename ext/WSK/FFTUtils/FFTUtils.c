@@ -6,39 +6,166 @@
 #include "ruby.h"
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <CommonUtils.h>
 
-#include <gmp.h>
+// SIMD kernels are compiled for x86 with GCC-compatible compilers only: they rely on target attributes, and on the SIMD level detected by CommonUtils.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FFTUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
 
 // Type used to compute FFT calculations
 typedef long long int tFFTValue;
 
+// Engines computing the cos and sin sums without trigo cache
+// Exact: cos and sin are computed for each sample
+#define FFTUTILS_ENGINE_EXACT 0
+// Phasor: a complex phasor is rotated from sample to sample, and set back to exact values at each block
+#define FFTUTILS_ENGINE_PHASOR 1
+// Goertzel: the Goertzel recurrence sums each block in floating point
+#define FFTUTILS_ENGINE_GOERTZEL 2
+
+// Number of frequencies stored together for each sample in the trigo cache: their cos and sin fill 1 cache line
+#define FFTUTILS_TRIGO_CACHE_CHUNK 8
+// Alignment (in bytes) of the trigo cache values
+#define FFTUTILS_TRIGO_CACHE_ALIGNMENT 64
+
+// Number of FFT samples' lengths a sliding FFT slides by before being computed from scratch again, getting rid of accumulated rounding errors
+#define FFTUTILS_SLIDING_RESET_FFTSAMPLES 10
+
+// Struct that contains the trigo cache.
+// Frequencies are grouped by chunks of FFTUTILS_TRIGO_CACHE_CHUNK, and the table is chunk-major: all samples of a chunk are stored before the next chunk.
+// For each sample of a chunk, the cache stores the cos of the chunk's frequencies, then their sin:
+// values[(idxChunk*nbrSamples + idxSample)*2*FFTUTILS_TRIGO_CACHE_CHUNK + idxChunkFreq] = cos(Wi*t)
+// values[(idxChunk*nbrSamples + idxSample)*2*FFTUTILS_TRIGO_CACHE_CHUNK + FFTUTILS_TRIGO_CACHE_CHUNK + idxChunkFreq] = sin(Wi*t)
+// Kernels read each chunk's values contiguously, and values of frequencies padding the last chunk are 0.
+typedef struct {
+  int nbrFreq;
+  int nbrChunks;
+  tSampleIndex nbrSamples;
+  // The values, aligned on FFTUTILS_TRIGO_CACHE_ALIGNMENT bytes
+  float* values;
+  // The memory allocated to store the values
+  void* allocatedValues;
+} tTrigoCache;
+
 // Struct used to convey data among iterators in the completeSumCosSin method
 typedef struct {
   int nbrFreq;
   double* w;
   tFFTValue* sumCos;
   tFFTValue* sumSin;
-  int* ptrIdxSum;
   int nbrChannels;
-  double** cosCache;
-  double** sinCache;
+  const tTrigoCache* trigoCache;
 } tCompleteSumCosSinStruct;
 
-// Struct that contains the trigo cache
+// Struct that contains a C FFT profile.
+// Values are the energies of each frequency, normalized by the maximal energy of the samples (see fftutils_getMaxFFTValue), per frequency and per channel:
+// values[idxFreq*nbrChannels + idxChannel] = (SumCos^2 + SumSin^2)/MaxFFTValue
 typedef struct {
   int nbrFreq;
-  double** cosCache;
-  double** sinCache;
-} tTrigoCache;
+  int nbrChannels;
+  double* values;
+} tFFTProfile;
 
-// Struct that contains a C FFT profile
+// Struct that contains a sliding FFT: the cos and sin sums of a window of samples, updated incrementally when the window slides.
+// Sums are relative to the first sample of the window, as with completeSumCosSin on the window alone:
+// sumCos + i*sumSin = Sum(t=0..N-1, X(t) * e^(i*Wi*t)), with N = Number of samples of the window
 typedef struct {
   int nbrFreq;
   int nbrChannels;
-  mpf_t** profile;
-  mpf_t maxFFTValue;
-} tFFTProfile;
+  int nbrBitsPerSample;
+  // Number of samples of the window
+  tSampleIndex nbrSamples;
+  // The Wi
+  double* w;
+  // e^(i*Wi), per frequency
+  double* rotationCos;
+  double* rotationSin;
+  // e^(i*Wi*N), per frequency: rotation of a sample entering the window at its end
+  double* windowCos;
+  double* windowSin;
+  // e^(i*Wi*(N-1)), per frequency: rotation of the last sample of the window
+  double* lastCos;
+  double* lastSin;
+  // The sums, per channel and per frequency: [idxChannel*nbrFreq + idxFreq]
+  double* sumCos;
+  double* sumSin;
+  // Blocks decoding samples leaving and entering the window
+  tSampleBlock blockOut;
+  tSampleBlock blockIn;
+} tSlidingFFT;
+
+// Struct used to convey data to the sliding FFT computations done without the GVL
+typedef struct {
+  tSlidingFFT* slidingFFT;
+  const char* rawBuffer;
+  // Number of samples the window slides by
+  tSampleIndex nbrSamples;
+  // Does the window slide backwards ? 0 = no, 1 = yes
+  int backwards;
+} tSlidingFFTStruct;
+
+// Struct that contains a search of the next sample whose FFT sample is similar to a reference FFT profile (see searchFFTSample)
+typedef struct {
+  // Ruby objects used by the search, marked for the Ruby GC
+  VALUE valReferenceProfile;
+  VALUE valTrigoCache;
+  // The reference FFT profile
+  const tFFTProfile* referenceProfile;
+  // The trigo cache, used when FFT samples don't overlap
+  const tTrigoCache* trigoCache;
+  // The sliding FFT, used when FFT samples overlap, or NULL if none
+  tSlidingFFT* slidingFFT;
+  int nbrFreq;
+  int nbrChannels;
+  int nbrBitsPerSample;
+  // The thresholds that should contain the signal, per channel
+  tThresholdInfo* thresholds;
+  // Index of the sample marking the limit of the search
+  tSampleIndex idxLastPossibleSample;
+  // Do we search backwards ? 0 = no, 1 = yes
+  int backwards;
+  // Number of samples needed to have a valid FFT
+  tSampleIndex nbrSamplesFFTMax;
+  // Number of samples between 2 consecutive FFT samples
+  tSampleIndex nbrSamplesHop;
+  // The scale used to measure distances
+  double scale;
+  // Historical values of FFT distances, implementing the Moving Average algorithm.
+  // Cycling buffer of size nbrHistory*nbrHopsPerFFTSample: when FFT samples overlap, the Moving Average uses 1 value every nbrHopsPerFFTSample, so that its values don't overlap.
+  tFFTValue* history;
+  int nbrHistory;
+  int nbrHopsPerFFTSample;
+  int historySize;
+  int nbrHistoryValues;
+  int idxOldestHistory;
+  // Maximal sum and maximal value of the Moving Average values to consider a sample found
+  tFFTValue sumMaxFFTDistance;
+  tFFTValue maxHistoryFFTDistance;
+  // Index of the current sample of the search
+  tSampleIndex idxCurrentSample;
+  // Last sample checked against the thresholds, or -1 if none
+  tSampleIndex idxLastCheckedSample;
+  // First and last samples of the FFT sample computed by the sliding FFT, or -1 if none
+  tSampleIndex idxBeginSlidingSample;
+  tSampleIndex idxEndSlidingSample;
+  // Number of samples slid since the sliding FFT was computed from scratch
+  tSampleIndex nbrSlidSamples;
+  // Cos and sin sums of the current FFT sample, used when FFT samples don't overlap
+  tFFTValue* sumCos;
+  tFFTValue* sumSin;
+  // FFT profile of the current FFT sample
+  tFFTProfile windowProfile;
+} tFFTSearch;
+
+// Struct used to convey data among iterators checking thresholds in the searchFFTSample method
+typedef struct {
+  const tThresholdInfo* thresholds;
+  tSampleIndex idxSampleOut;
+} tSampleBeyondThresholdsStruct;
 
 /** Create a ruby object storing the Wi coefficients used to compute the sin and cos sums
  *
@@ -104,79 +231,464 @@ static VALUE fftutils_initSumArray(
 }
 
 /**
- * Process a value read from an input buffer for the CompleteSumCosSin function.
+ * Process a block read from an input buffer for the CompleteSumCosSin function.
+ * Each trigonometric value is computed once per sample, and used for all channels.
+ * Values and sums are the ones of the trigo cache (see fftutils_processBlock_CompleteSumCosSinWithCache): trigonometric values are rounded to floats, and products are summed in double precision over the whole block, then rounded once.
+ * Both paths give the same sums for the same samples.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tNextSilentStruct*</em>.
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tCompleteSumCosSinStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int fftutils_processValue_CompleteSumCosSin(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int fftutils_processBlock_CompleteSumCosSin(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
   // Interpret parameters
   tCompleteSumCosSinStruct* lPtrVariables = (tCompleteSumCosSinStruct*)iPtrArgs;
 
-  if (iIdxChannel == 0) {
-    *(lPtrVariables->ptrIdxSum) = 0;
+  int lNbrChannels = iPtrBlock->nbrChannels;
+  double lSumCos[lNbrChannels];
+  double lSumSin[lNbrChannels];
+  double lTrigoValue;
+  float lCos;
+  float lSin;
+  int lIdxW;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  double lValue;
+  for (lIdxW = 0; lIdxW < lPtrVariables->nbrFreq; ++lIdxW) {
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      lSumCos[lIdxChannel] = 0;
+      lSumSin[lIdxChannel] = 0;
+    }
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      // Same computation as fftutils_initTrigoCache
+      lTrigoValue = (iPtrBlock->idxFirstSample + lIdxSample)*lPtrVariables->w[lIdxW];
+      lCos = (float)cos(lTrigoValue);
+      lSin = (float)sin(lTrigoValue);
+      for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+        lValue = iPtrBlock->values[lIdxChannel][lIdxSample];
+        lSumCos[lIdxChannel] += lValue*lCos;
+        lSumSin[lIdxChannel] += lValue*lSin;
+      }
+    }
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      lPtrVariables->sumCos[lIdxChannel*lPtrVariables->nbrFreq+lIdxW] += llround(lSumCos[lIdxChannel]);
+      lPtrVariables->sumSin[lIdxChannel*lPtrVariables->nbrFreq+lIdxW] += llround(lSumSin[lIdxChannel]);
+    }
   }
+
+  return 0;
+}
+
+/**
+ * Process a block read from an input buffer for the CompleteSumCosSin function.
+ * Use a rotating phasor instead of computing cos and sin for each sample: it is set to exact values at the beginning of each block, then multiplied by the rotation of 1 sample.
+ * As with the exact engine, products are summed in double precision over the whole block, then rounded once.
+ * The drift of the phasor over 1 block is of the order of the rounding of trigonometric values to floats by the exact engine, so results are nearly identical to the exact engine.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tCompleteSumCosSinStruct*</em>.
+ * Return::
+ * * _int_: The return code:
+ * ** 0: Continue iteration
+ * ** 1: Break all iterations
+ */
+int fftutils_processBlock_CompleteSumCosSinPhasor(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
+  // Interpret parameters
+  tCompleteSumCosSinStruct* lPtrVariables = (tCompleteSumCosSinStruct*)iPtrArgs;
+
+  int lNbrChannels = iPtrBlock->nbrChannels;
+  int lNbrFreq = lPtrVariables->nbrFreq;
+  // Phasors and their rotations, per frequency
+  double lCos[lNbrFreq];
+  double lSin[lNbrFreq];
+  double lRotationCos[lNbrFreq];
+  double lRotationSin[lNbrFreq];
+  // Sums of the block, per channel and per frequency
+  double lSumCos[lNbrChannels*lNbrFreq];
+  double lSumSin[lNbrChannels*lNbrFreq];
+  double* lPtrSumCos;
+  double* lPtrSumSin;
   long double lTrigoValue;
+  double lNextCos;
+  double lValue;
   int lIdxW;
-  for (lIdxW = 0; lIdxW < lPtrVariables->nbrFreq; ++lIdxW) {
-    lTrigoValue = ((long double)lPtrVariables->w[lIdxW]) * ((long double)iIdxSample);
-    lPtrVariables->sumCos[*(lPtrVariables->ptrIdxSum)] += (tFFTValue)(iValue*cos(lTrigoValue));
-    lPtrVariables->sumSin[*(lPtrVariables->ptrIdxSum)] += (tFFTValue)(iValue*sin(lTrigoValue));
-    ++(*(lPtrVariables->ptrIdxSum));
+  int lIdxChannel;
+  int lIdxSum;
+  tSampleIndex lIdxSample;
+  for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+    lTrigoValue = ((long double)lPtrVariables->w[lIdxW]) * ((long double)iPtrBlock->idxFirstSample);
+    lCos[lIdxW] = cos(lTrigoValue);
+    lSin[lIdxW] = sin(lTrigoValue);
+    lRotationCos[lIdxW] = cos(lPtrVariables->w[lIdxW]);
+    lRotationSin[lIdxW] = sin(lPtrVariables->w[lIdxW]);
+  }
+  memset(lSumCos, 0, lNbrChannels*lNbrFreq*sizeof(double));
+  memset(lSumSin, 0, lNbrChannels*lNbrFreq*sizeof(double));
+  // Phasors of all frequencies are independent: iterating them in the inner loop hides their latency
+  for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      lValue = iPtrBlock->values[lIdxChannel][lIdxSample];
+      lPtrSumCos = lSumCos + lIdxChannel*lNbrFreq;
+      lPtrSumSin = lSumSin + lIdxChannel*lNbrFreq;
+      for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+        lPtrSumCos[lIdxW] += lValue*lCos[lIdxW];
+        lPtrSumSin[lIdxW] += lValue*lSin[lIdxW];
+      }
+    }
+    // Rotate the phasors to the next sample
+    for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+      lNextCos = lCos[lIdxW]*lRotationCos[lIdxW] - lSin[lIdxW]*lRotationSin[lIdxW];
+      lSin[lIdxW] = lSin[lIdxW]*lRotationCos[lIdxW] + lCos[lIdxW]*lRotationSin[lIdxW];
+      lCos[lIdxW] = lNextCos;
+    }
+  }
+  for (lIdxSum = 0; lIdxSum < lNbrChannels*lNbrFreq; ++lIdxSum) {
+    lPtrVariables->sumCos[lIdxSum] += llround(lSumCos[lIdxSum]);
+    lPtrVariables->sumSin[lIdxSum] += llround(lSumSin[lIdxSum]);
   }
 
   return 0;
 }
 
 /**
- * Process a value read from an input buffer for the CompleteSumCosSin function.
- * Use the trigo cache.
+ * Process a block read from an input buffer for the CompleteSumCosSin function.
+ * Use the Goertzel recurrence: each block is summed in floating point with 1 multiplication per sample, then its sums are rotated to the block's position and rounded.
+ * Its rounding errors differ from the ones of the exact engine, so results differ slightly.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tNextSilentStruct*</em>.
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tCompleteSumCosSinStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int fftutils_processValue_CompleteSumCosSinWithCache(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int fftutils_processBlock_CompleteSumCosSinGoertzel(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
   // Interpret parameters
   tCompleteSumCosSinStruct* lPtrVariables = (tCompleteSumCosSinStruct*)iPtrArgs;
 
-  if (iIdxChannel == 0) {
-    *(lPtrVariables->ptrIdxSum) = 0;
+  int lNbrChannels = iPtrBlock->nbrChannels;
+  int lNbrFreq = lPtrVariables->nbrFreq;
+  // States of the recurrences, per channel and per frequency
+  double lStates[lNbrChannels*lNbrFreq];
+  double lStatesPrevious[lNbrChannels*lNbrFreq];
+  double lCoeffs[lNbrFreq];
+  double* lPtrStates;
+  double* lPtrStatesPrevious;
+  long double lTrigoValueLast;
+  long double lTrigoValueNext;
+  double lCosLast;
+  double lSinLast;
+  double lCosNext;
+  double lSinNext;
+  double lValue;
+  double lStateNew;
+  int lIdxW;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+    lCoeffs[lIdxW] = 2*cos(lPtrVariables->w[lIdxW]);
+  }
+  memset(lStates, 0, lNbrChannels*lNbrFreq*sizeof(double));
+  memset(lStatesPrevious, 0, lNbrChannels*lNbrFreq*sizeof(double));
+  // Recurrences of all frequencies are independent: iterating them in the inner loop hides their latency
+  for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      lValue = iPtrBlock->values[lIdxChannel][lIdxSample];
+      lPtrStates = lStates + lIdxChannel*lNbrFreq;
+      lPtrStatesPrevious = lStatesPrevious + lIdxChannel*lNbrFreq;
+      for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+        lStateNew = lValue + lCoeffs[lIdxW]*lPtrStates[lIdxW] - lPtrStatesPrevious[lIdxW];
+        lPtrStatesPrevious[lIdxW] = lPtrStates[lIdxW];
+        lPtrStates[lIdxW] = lStateNew;
+      }
+    }
+  }
+  for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+    // With s the states after the last sample L of the block, and s' the ones before it:
+    // Sum(t, Xt * e^(i*W*t)) = s * e^(i*W*L) - s' * e^(i*W*(L+1))
+    lTrigoValueLast = ((long double)lPtrVariables->w[lIdxW]) * ((long double)(iPtrBlock->idxFirstSample + iPtrBlock->nbrSamples - 1));
+    lTrigoValueNext = ((long double)lPtrVariables->w[lIdxW]) * ((long double)(iPtrBlock->idxFirstSample + iPtrBlock->nbrSamples));
+    lCosLast = cos(lTrigoValueLast);
+    lSinLast = sin(lTrigoValueLast);
+    lCosNext = cos(lTrigoValueNext);
+    lSinNext = sin(lTrigoValueNext);
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      lPtrVariables->sumCos[lIdxChannel*lNbrFreq+lIdxW] += llround(lStates[lIdxChannel*lNbrFreq+lIdxW]*lCosLast - lStatesPrevious[lIdxChannel*lNbrFreq+lIdxW]*lCosNext);
+      lPtrVariables->sumSin[lIdxChannel*lNbrFreq+lIdxW] += llround(lStates[lIdxChannel*lNbrFreq+lIdxW]*lSinLast - lStatesPrevious[lIdxChannel*lNbrFreq+lIdxW]*lSinNext);
+    }
   }
+
+  return 0;
+}
+
+/**
+ * Add the sums of a chunk of frequencies computed on a block to the cos and sin sums, rounded.
+ *
+ * Parameters::
+ * * *ioPtrVariables* (<em>tCompleteSumCosSinStruct*</em>): The variables of the CompleteSumCosSin function
+ * * *iIdxChunk* (<em>const int</em>): Index of the chunk of frequencies
+ * * *iIdxChannel* (<em>const int</em>): Index of the channel
+ * * *iSumCos* (<em>const double*</em>): The cos sums of the chunk's frequencies
+ * * *iSumSin* (<em>const double*</em>): The sin sums of the chunk's frequencies
+ */
+static void fftutils_addChunkSums(
+  tCompleteSumCosSinStruct* ioPtrVariables,
+  const int iIdxChunk,
+  const int iIdxChannel,
+  const double* iSumCos,
+  const double* iSumSin) {
+  int lIdxChunkFreq;
   int lIdxW;
-  for (lIdxW = 0; lIdxW < lPtrVariables->nbrFreq; ++lIdxW) {
-    lPtrVariables->sumCos[*(lPtrVariables->ptrIdxSum)] += (tFFTValue)(iValue*lPtrVariables->cosCache[lIdxW][iIdxSample]);
-    lPtrVariables->sumSin[*(lPtrVariables->ptrIdxSum)] += (tFFTValue)(iValue*lPtrVariables->sinCache[lIdxW][iIdxSample]);
-    ++(*(lPtrVariables->ptrIdxSum));
+  for (lIdxChunkFreq = 0; lIdxChunkFreq < FFTUTILS_TRIGO_CACHE_CHUNK; ++lIdxChunkFreq) {
+    lIdxW = iIdxChunk*FFTUTILS_TRIGO_CACHE_CHUNK + lIdxChunkFreq;
+    if (lIdxW < ioPtrVariables->nbrFreq) {
+      ioPtrVariables->sumCos[iIdxChannel*ioPtrVariables->nbrFreq+lIdxW] += llround(iSumCos[lIdxChunkFreq]);
+      ioPtrVariables->sumSin[iIdxChannel*ioPtrVariables->nbrFreq+lIdxW] += llround(iSumSin[lIdxChunkFreq]);
+    }
+  }
+}
+
+/**
+ * Process a block read from an input buffer for the CompleteSumCosSin function.
+ * Use the trigo cache: for each chunk of frequencies, products are summed in double precision over the whole block, and rounded once.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tCompleteSumCosSinStruct*</em>.
+ * Return::
+ * * _int_: The return code:
+ * ** 0: Continue iteration
+ * ** 1: Break all iterations
+ */
+int fftutils_processBlock_CompleteSumCosSinWithCache(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
+  // Interpret parameters
+  tCompleteSumCosSinStruct* lPtrVariables = (tCompleteSumCosSinStruct*)iPtrArgs;
+  const tTrigoCache* lPtrTrigoCache = lPtrVariables->trigoCache;
+
+  double lSumCos[FFTUTILS_TRIGO_CACHE_CHUNK];
+  double lSumSin[FFTUTILS_TRIGO_CACHE_CHUNK];
+  double lValue;
+  const float* lPtrTrigo;
+  const tSampleValue* lPtrValues;
+  int lIdxChunk;
+  int lIdxChunkFreq;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  for (lIdxChunk = 0; lIdxChunk < lPtrTrigoCache->nbrChunks; ++lIdxChunk) {
+    for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+      lPtrValues = iPtrBlock->values[lIdxChannel];
+      lPtrTrigo = lPtrTrigoCache->values + (lIdxChunk*lPtrTrigoCache->nbrSamples + iPtrBlock->idxFirstSample)*2*FFTUTILS_TRIGO_CACHE_CHUNK;
+      for (lIdxChunkFreq = 0; lIdxChunkFreq < FFTUTILS_TRIGO_CACHE_CHUNK; ++lIdxChunkFreq) {
+        lSumCos[lIdxChunkFreq] = 0;
+        lSumSin[lIdxChunkFreq] = 0;
+      }
+      for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+        lValue = lPtrValues[lIdxSample];
+        for (lIdxChunkFreq = 0; lIdxChunkFreq < FFTUTILS_TRIGO_CACHE_CHUNK; ++lIdxChunkFreq) {
+          lSumCos[lIdxChunkFreq] += lValue*lPtrTrigo[lIdxChunkFreq];
+          lSumSin[lIdxChunkFreq] += lValue*lPtrTrigo[FFTUTILS_TRIGO_CACHE_CHUNK+lIdxChunkFreq];
+        }
+        lPtrTrigo += 2*FFTUTILS_TRIGO_CACHE_CHUNK;
+      }
+      fftutils_addChunkSums(lPtrVariables, lIdxChunk, lIdxChannel, lSumCos, lSumSin);
+    }
+  }
+
+  return 0;
+}
+
+#ifdef FFTUTILS_X86_SIMD
+/**
+ * Process a block read from an input buffer for the CompleteSumCosSin function, using AVX2.
+ * Use the trigo cache, with the same computations as fftutils_processBlock_CompleteSumCosSinWithCache: the sums of each chunk stay in registers for the whole block.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tCompleteSumCosSinStruct*</em>.
+ * Return::
+ * * _int_: The return code:
+ * ** 0: Continue iteration
+ * ** 1: Break all iterations
+ */
+__attribute__((target("avx2")))
+int fftutils_processBlock_CompleteSumCosSinWithCache_avx2(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
+  // Interpret parameters
+  tCompleteSumCosSinStruct* lPtrVariables = (tCompleteSumCosSinStruct*)iPtrArgs;
+  const tTrigoCache* lPtrTrigoCache = lPtrVariables->trigoCache;
+
+  double lSumCos[FFTUTILS_TRIGO_CACHE_CHUNK];
+  double lSumSin[FFTUTILS_TRIGO_CACHE_CHUNK];
+  __m256d lSumCosLow;
+  __m256d lSumCosHigh;
+  __m256d lSumSinLow;
+  __m256d lSumSinHigh;
+  __m256d lValue;
+  const float* lPtrTrigo;
+  const tSampleValue* lPtrValues;
+  int lIdxChunk;
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  for (lIdxChunk = 0; lIdxChunk < lPtrTrigoCache->nbrChunks; ++lIdxChunk) {
+    for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+      lPtrValues = iPtrBlock->values[lIdxChannel];
+      lPtrTrigo = lPtrTrigoCache->values + (lIdxChunk*lPtrTrigoCache->nbrSamples + iPtrBlock->idxFirstSample)*2*FFTUTILS_TRIGO_CACHE_CHUNK;
+      lSumCosLow = _mm256_setzero_pd();
+      lSumCosHigh = _mm256_setzero_pd();
+      lSumSinLow = _mm256_setzero_pd();
+      lSumSinHigh = _mm256_setzero_pd();
+      for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+        lValue = _mm256_set1_pd((double)lPtrValues[lIdxSample]);
+        // Values of each sample are aligned on a cache line
+        lSumCosLow = _mm256_add_pd(lSumCosLow, _mm256_mul_pd(lValue, _mm256_cvtps_pd(_mm_load_ps(lPtrTrigo))));
+        lSumCosHigh = _mm256_add_pd(lSumCosHigh, _mm256_mul_pd(lValue, _mm256_cvtps_pd(_mm_load_ps(lPtrTrigo + 4))));
+        lSumSinLow = _mm256_add_pd(lSumSinLow, _mm256_mul_pd(lValue, _mm256_cvtps_pd(_mm_load_ps(lPtrTrigo + 8))));
+        lSumSinHigh = _mm256_add_pd(lSumSinHigh, _mm256_mul_pd(lValue, _mm256_cvtps_pd(_mm_load_ps(lPtrTrigo + 12))));
+        lPtrTrigo += 2*FFTUTILS_TRIGO_CACHE_CHUNK;
+      }
+      _mm256_storeu_pd(lSumCos, lSumCosLow);
+      _mm256_storeu_pd(lSumCos + 4, lSumCosHigh);
+      _mm256_storeu_pd(lSumSin, lSumSinLow);
+      _mm256_storeu_pd(lSumSin + 4, lSumSinHigh);
+      fftutils_addChunkSums(lPtrVariables, lIdxChunk, lIdxChannel, lSumCos, lSumSin);
+    }
   }
 
   return 0;
 }
+#endif
+
+/**
+ * Initialize the arguments of a part of the buffer processed by a thread for the CompleteSumCosSin function.
+ * The part gets its own sums, the sample index of each block being already given by the iteration.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tCompleteSumCosSinStruct*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tCompleteSumCosSinStruct*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
+ */
+static void fftutils_initSliceArgs_CompleteSumCosSin(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  tCompleteSumCosSinStruct* lPtrSliceVariables = (tCompleteSumCosSinStruct*)oPtrSliceArgs;
+  *lPtrSliceVariables = *((const tCompleteSumCosSinStruct*)iPtrArgs);
+  int lNbrSums = lPtrSliceVariables->nbrFreq*lPtrSliceVariables->nbrChannels;
+  lPtrSliceVariables->sumCos = ALLOC_N(tFFTValue, lNbrSums);
+  lPtrSliceVariables->sumSin = ALLOC_N(tFFTValue, lNbrSums);
+  memset(lPtrSliceVariables->sumCos, 0, lNbrSums*sizeof(tFFTValue));
+  memset(lPtrSliceVariables->sumSin, 0, lNbrSums*sizeof(tFFTValue));
+}
+
+/**
+ * Merge the sums of a part of the buffer processed by a thread for the CompleteSumCosSin function, and free them.
+ *
+ * Parameters::
+ * * *ioPtrArgs* (<em>void*</em>): The iteration arguments. In fact a <em>tCompleteSumCosSinStruct*</em>.
+ * * *iPtrSliceArgs* (<em>void*</em>): The arguments of the part. In fact a <em>tCompleteSumCosSinStruct*</em>.
+ */
+static void fftutils_reduceSliceArgs_CompleteSumCosSin(
+  void* ioPtrArgs,
+  void* iPtrSliceArgs) {
+  tCompleteSumCosSinStruct* lPtrVariables = (tCompleteSumCosSinStruct*)ioPtrArgs;
+  tCompleteSumCosSinStruct* lPtrSliceVariables = (tCompleteSumCosSinStruct*)iPtrSliceArgs;
+  int lNbrSums = lPtrVariables->nbrFreq*lPtrVariables->nbrChannels;
+  int lIdxSum;
+  for (lIdxSum = 0; lIdxSum < lNbrSums; ++lIdxSum) {
+    lPtrVariables->sumCos[lIdxSum] += lPtrSliceVariables->sumCos[lIdxSum];
+    lPtrVariables->sumSin[lIdxSum] += lPtrSliceVariables->sumSin[lIdxSum];
+  }
+  free(lPtrSliceVariables->sumCos);
+  free(lPtrSliceVariables->sumSin);
+}
+
+// Functions processing parts of a buffer in parallel for the CompleteSumCosSin function
+static const tParallelFcts gParallelFcts_CompleteSumCosSin = {
+  sizeof(tCompleteSumCosSinStruct),
+  &fftutils_initSliceArgs_CompleteSumCosSin,
+  &fftutils_reduceSliceArgs_CompleteSumCosSin
+};
+
+/**
+ * Get the engine computing the cos and sin sums without trigo cache.
+ * It is read from the WSK_FFT_ENGINE environment variable at each call (exact, phasor or goertzel). Other values raise an error.
+ *
+ * Return::
+ * * _int_: The engine (one of FFTUTILS_ENGINE_*)
+ */
+static int fftutils_getEngine(void) {
+  int rEngine = FFTUTILS_ENGINE_EXACT;
+  const char* lStrEngine = getenv("WSK_FFT_ENGINE");
+
+  if (lStrEngine != NULL) {
+    if (strcmp(lStrEngine, "phasor") == 0) {
+      rEngine = FFTUTILS_ENGINE_PHASOR;
+    } else if (strcmp(lStrEngine, "goertzel") == 0) {
+      rEngine = FFTUTILS_ENGINE_GOERTZEL;
+    } else if (strcmp(lStrEngine, "exact") != 0) {
+      rb_raise(rb_eRuntimeError, "Unknown FFT engine in WSK_FFT_ENGINE: %s (exact, phasor or goertzel expected)", lStrEngine);
+    }
+  }
+
+  return rEngine;
+}
+
+/**
+ * Complete the cosinus et sinus sums by using the trigo cache.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iIdxSample* (<em>const tSampleIndex</em>): The current sample index. Samples must be within the trigo cache.
+ * * *ioPtrVariables* (<em>tCompleteSumCosSinStruct*</em>): The variables given to the process, with the trigo cache and the sums to complete
+ */
+static void fftutils_completeSumCosSinWithCache(
+  const char* iPtrRawBuffer,
+  const int iNbrBitsPerSample,
+  const tSampleIndex iNbrSamples,
+  const tSampleIndex iIdxSample,
+  tCompleteSumCosSinStruct* ioPtrVariables) {
+  tPtrFctProcessBlock lPtrProcessBlock = &fftutils_processBlock_CompleteSumCosSinWithCache;
+#ifdef FFTUTILS_X86_SIMD
+  if (commonutils_getSIMDLevel() >= COMMONUTILS_SIMD_AVX2) {
+    lPtrProcessBlock = &fftutils_processBlock_CompleteSumCosSinWithCache_avx2;
+  }
+#endif
+  // Iterate through the raw buffer by using the cache
+  commonutils_iterateBlocksThroughRawBuffer(
+    iPtrRawBuffer,
+    iNbrBitsPerSample,
+    ioPtrVariables->nbrChannels,
+    iNbrSamples,
+    iIdxSample,
+    lPtrProcessBlock,
+    ioPtrVariables,
+    &gParallelFcts_CompleteSumCosSin
+  );
+}
 
 /** Complete the cosinus et sinus sums to compute the FFT
+ * Without trigo cache, the sums are computed by the engine selected with the WSK_FFT_ENGINE environment variable:
+ * * exact (default): cos and sin are computed for each sample.
+ * * phasor: a rotating phasor replaces most cos and sin computations. Results are nearly identical to exact ones.
+ * * goertzel: the Goertzel recurrence sums samples with 1 multiplication per sample. This is the fastest, and results differ slightly from exact ones.
+ * The exact engine gives the same sums as the trigo cache.
  * 
  * Parameters::
  * * *iSelf* (_FFTUtils_): Self
@@ -204,12 +716,12 @@ static VALUE fftutils_completeSumCosSin(
   VALUE ioValSumCos,
   VALUE ioValSumSin) {
   // Translate Ruby objects
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   int iNbrChannels = FIX2INT(iValNbrChannels);
   int iNbrFreq = FIX2INT(iValNbrFreq);
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   char* lPtrRawBuffer = RSTRING_PTR(iValInputRawBuffer);
-  tSampleIndex iIdxSample = FIX2LONG(iValIdxSample);
+  tSampleIndex iIdxSample = NUM2LL(iValIdxSample);
   // Get the lW array
   double * lW = NULL;
   if (iValW != Qnil) {
@@ -226,42 +738,45 @@ static VALUE fftutils_completeSumCosSin(
   Data_Get_Struct(ioValSumCos, tFFTValue, lSumCos);
   Data_Get_Struct(ioValSumSin, tFFTValue, lSumSin);
   
-  // Parse the data. This is done differently depending on the data structure
-  // Define variables outside the loops to not allocate and initialize heap size for nothing
-  int lIdxSum = 0;
-
   // Set variables to give to the process
   tCompleteSumCosSinStruct lProcessVariables;
   lProcessVariables.nbrFreq = iNbrFreq;
   lProcessVariables.w = lW;
   lProcessVariables.sumCos = lSumCos;
   lProcessVariables.sumSin = lSumSin;
-  lProcessVariables.ptrIdxSum = &lIdxSum;
   lProcessVariables.nbrChannels = iNbrChannels;
   if (lPtrTrigoCache == NULL) {
+    // Choose the engine
+    tPtrFctProcessBlock lPtrProcessBlock;
+    switch (fftutils_getEngine()) {
+      case FFTUTILS_ENGINE_PHASOR:
+        lPtrProcessBlock = &fftutils_processBlock_CompleteSumCosSinPhasor;
+        break;
+      case FFTUTILS_ENGINE_GOERTZEL:
+        lPtrProcessBlock = &fftutils_processBlock_CompleteSumCosSinGoertzel;
+        break;
+      default:
+        lPtrProcessBlock = &fftutils_processBlock_CompleteSumCosSin;
+        break;
+    }
     // Iterate through the raw buffer
-    commonutils_iterateThroughRawBuffer(
+    commonutils_iterateBlocksThroughRawBuffer(
       lPtrRawBuffer,
       iNbrBitsPerSample,
       iNbrChannels,
       iNbrSamples,
       iIdxSample,
-      &fftutils_processValue_CompleteSumCosSin,
-      &lProcessVariables
+      lPtrProcessBlock,
+      &lProcessVariables,
+      &gParallelFcts_CompleteSumCosSin
     );
   } else {
-    lProcessVariables.cosCache = lPtrTrigoCache->cosCache;
-    lProcessVariables.sinCache = lPtrTrigoCache->sinCache;
-    // Iterate through the raw buffer by using the cache
-    commonutils_iterateThroughRawBuffer(
-      lPtrRawBuffer,
-      iNbrBitsPerSample,
-      iNbrChannels,
-      iNbrSamples,
-      iIdxSample,
-      &fftutils_processValue_CompleteSumCosSinWithCache,
-      &lProcessVariables
-    );
+    if ((iIdxSample < 0) ||
+        (iIdxSample + iNbrSamples > lPtrTrigoCache->nbrSamples)) {
+      rb_raise(rb_eRuntimeError, "Samples %lld to %lld exceed the trigo cache of %lld samples", iIdxSample, iIdxSample + iNbrSamples - 1, lPtrTrigoCache->nbrSamples);
+    }
+    lProcessVariables.trigoCache = lPtrTrigoCache;
+    fftutils_completeSumCosSinWithCache(lPtrRawBuffer, iNbrBitsPerSample, iNbrSamples, iIdxSample, &lProcessVariables);
   }
 
   return Qnil;
@@ -269,6 +784,7 @@ static VALUE fftutils_completeSumCosSin(
 
 /** Compute the final FFT coefficients in Ruby integers, per channel and per frequency.
  * Use previously computed cos and sin sum arrays.
+ * Coefficients can exceed 64 bits: they are computed with Ruby integers.
  *
  * Parameters::
  * * *iSelf* (_FFTUtils_): Self
@@ -279,57 +795,6 @@ static VALUE fftutils_completeSumCosSin(
  * Return::
  * * <em>list<list<Integer>></em>: List of FFT coefficients, per channel, per frequency
  **/
-static VALUE fftutils_computeFFT(
-  VALUE iSelf,
-  VALUE iValNbrChannels,
-  VALUE iValNbrFreq,
-  VALUE iValSumCos,
-  VALUE iValSumSin) {
-  // Translate Ruby objects
-  int lNbrChannels = FIX2INT(iValNbrChannels);
-  int lNbrFreq = FIX2INT(iValNbrFreq);
-  // Get the cos and sin sum arrays
-  tFFTValue * lSumCos;
-  tFFTValue * lSumSin;
-  Data_Get_Struct(iValSumCos, tFFTValue, lSumCos);
-  Data_Get_Struct(iValSumSin, tFFTValue, lSumSin);
-  // The C-array of the final result
-  VALUE lValFFT[lNbrFreq];
-
-  int lIdxFreq;
-  int lIdxChannel;
-  int lIdxSum;
-  // Buffer that stores string representation of tFFTValue for Ruby RBigNum
-  char lStrValue[128];
-  // The bignums to put in the result
-  VALUE lValChannelFFTs[lNbrChannels];
-  mpz_t lSinSin;
-  mpz_init(lSinSin);
-  mpz_t lFFTCoeff;
-  mpz_init(lFFTCoeff);
-  // Put back the cos and sin values in the result, summing their square values
-  for (lIdxFreq = 0; lIdxFreq < lNbrFreq; ++lIdxFreq) {
-    lIdxSum = lIdxFreq;
-    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
-      // Initialize MPZ with char* as they don't accept long long int.
-      sprintf(lStrValue, "%lld", lSumSin[lIdxSum]);
-      mpz_set_str(lSinSin, lStrValue, 10);
-      mpz_mul(lSinSin, lSinSin, lSinSin);
-      sprintf(lStrValue, "%lld", lSumCos[lIdxSum]);
-      mpz_set_str(lFFTCoeff, lStrValue, 10);
-      mpz_mul(lFFTCoeff, lFFTCoeff, lFFTCoeff);
-      mpz_add(lFFTCoeff, lFFTCoeff, lSinSin);
-      lValChannelFFTs[lIdxChannel] = rb_cstr2inum(mpz_get_str(lStrValue, 16, lFFTCoeff), 16);
-      lIdxSum += lNbrFreq;
-    }
-    lValFFT[lIdxFreq] = rb_ary_new4(lNbrChannels, lValChannelFFTs);
-  }
-  mpz_clear(lFFTCoeff);
-  mpz_clear(lSinSin);
-
-  return rb_ary_new4(lNbrFreq, lValFFT);
-}
-/* To be used if GMP library is absent.
 static VALUE fftutils_computeFFT(
   VALUE iSelf,
   VALUE iValNbrChannels,
@@ -352,27 +817,18 @@ static VALUE fftutils_computeFFT(
   int lIdxFreq;
   int lIdxChannel;
   int lIdxSum;
-  // Buffer that stores string representation of tFFTValue for Ruby RBigNum
-  char lStrValue[128];
-  // RBigNums that will store temprary arithmetic results
+  // Ruby integers that will store temporary arithmetic results
   VALUE lValCos;
   VALUE lValSin;
-  VALUE lValCosCos;
-  VALUE lValSinSin;
   // The bignums to put in the result
   VALUE lValChannelFFTs[lNbrChannels];
   // Put back the cos and sin values in the result, summing their square values
   for (lIdxFreq = 0; lIdxFreq < lNbrFreq; ++lIdxFreq) {
     lIdxSum = lIdxFreq;
     for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
-      // Initialize Ruby objects for the arithmetic, as C will not treat numbers greater than 64 bits.
-      sprintf(lStrValue, "%lld", lSumCos[lIdxSum]);
-      lValCos = rb_cstr2inum(lStrValue, 10);
-      sprintf(lStrValue, "%lld", lSumSin[lIdxSum]);
-      lValSin = rb_cstr2inum(lStrValue, 10);
-      lValCosCos = rb_funcall(lValCos, lMultiplyID, 1, lValCos);
-      lValSinSin = rb_funcall(lValSin, lMultiplyID, 1, lValSin);
-      lValChannelFFTs[lIdxChannel] = rb_funcall(lValCosCos, lPlusID, 1, lValSinSin);
+      lValCos = LL2NUM(lSumCos[lIdxSum]);
+      lValSin = LL2NUM(lSumSin[lIdxSum]);
+      lValChannelFFTs[lIdxChannel] = rb_funcall(rb_funcall(lValCos, lMultiplyID, 1, lValCos), lPlusID, 1, rb_funcall(lValSin, lMultiplyID, 1, lValSin));
       lIdxSum += lNbrFreq;
     }
     lValFFT[lIdxFreq] = rb_ary_new4(lNbrChannels, lValChannelFFTs);
@@ -380,7 +836,6 @@ static VALUE fftutils_computeFFT(
 
   return rb_ary_new4(lNbrFreq, lValFFT);
 }
-*/
 
 /**
  * Free a trigonometric cache.
@@ -392,18 +847,13 @@ static VALUE fftutils_computeFFT(
 static void fftutils_freeTrigoCache(void* iPtrTrigoCache) {
   tTrigoCache* lPtrTrigoCache = (tTrigoCache*)iPtrTrigoCache;
 
-  int lIdxW;
-  for (lIdxW = 0; lIdxW < lPtrTrigoCache->nbrFreq; ++lIdxW) {
-    // Free it
-    free(lPtrTrigoCache->cosCache[lIdxW]);
-    free(lPtrTrigoCache->sinCache[lIdxW]);
-  }
-  free(lPtrTrigoCache->cosCache);
-  free(lPtrTrigoCache->sinCache);
+  free(lPtrTrigoCache->allocatedValues);
+  free(lPtrTrigoCache);
 }
 
 /**
- * Create a cache of trigonometric values that will be then used in completeSumCosSin method
+ * Create a cache of trigonometric values that will be then used in completeSumCosSin method.
+ * Values are stored as floats, in a contiguous and aligned table ordered by chunks of frequencies, then by samples (see tTrigoCache).
  *
  * Parameters::
  * * *iSelf* (_FFTUtils_): Self
@@ -420,34 +870,42 @@ static VALUE fftutils_initTrigoCache(
   VALUE iValNbrSamples) {
   // Translate parameters in C types
   int iNbrFreq = FIX2INT(iValNbrFreq);
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   // Get the lW array
   double * lW;
   Data_Get_Struct(iValW, double, lW);
 
   // Create the cache
   int lIdxW;
+  int lIdxChunk;
+  int lIdxChunkFreq;
   tSampleIndex lIdxSample;
-  double* lTmpSamplesValuesCos;
-  double* lTmpSamplesValuesSin;
+  float* lPtrTrigo;
   double lTrigoValue;
   tTrigoCache* lPtrTrigoCache = ALLOC(tTrigoCache);
-  lPtrTrigoCache->cosCache = ALLOC_N(double*, iNbrFreq);
-  lPtrTrigoCache->sinCache = ALLOC_N(double*, iNbrFreq);
   lPtrTrigoCache->nbrFreq = iNbrFreq;
-  for (lIdxW = 0; lIdxW < iNbrFreq; ++lIdxW) {
-    // Allocate the double array storing values for each sample
-    lTmpSamplesValuesCos = ALLOC_N(double, iNbrSamples);
-    lTmpSamplesValuesSin = ALLOC_N(double, iNbrSamples);
-    // Fill it
+  lPtrTrigoCache->nbrChunks = (iNbrFreq + FFTUTILS_TRIGO_CACHE_CHUNK - 1)/FFTUTILS_TRIGO_CACHE_CHUNK;
+  lPtrTrigoCache->nbrSamples = iNbrSamples;
+  tSampleIndex lNbrValues = lPtrTrigoCache->nbrChunks*iNbrSamples*2*FFTUTILS_TRIGO_CACHE_CHUNK;
+  lPtrTrigoCache->allocatedValues = ALLOC_N(char, lNbrValues*sizeof(float) + FFTUTILS_TRIGO_CACHE_ALIGNMENT - 1);
+  lPtrTrigoCache->values = (float*)((((size_t)lPtrTrigoCache->allocatedValues) + FFTUTILS_TRIGO_CACHE_ALIGNMENT - 1) & ~((size_t)FFTUTILS_TRIGO_CACHE_ALIGNMENT - 1));
+  // Fill it
+  lPtrTrigo = lPtrTrigoCache->values;
+  for (lIdxChunk = 0; lIdxChunk < lPtrTrigoCache->nbrChunks; ++lIdxChunk) {
     for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
-      lTrigoValue = lIdxSample*lW[lIdxW];
-      lTmpSamplesValuesCos[lIdxSample] = cos(lTrigoValue);
-      lTmpSamplesValuesSin[lIdxSample] = sin(lTrigoValue);
+      for (lIdxChunkFreq = 0; lIdxChunkFreq < FFTUTILS_TRIGO_CACHE_CHUNK; ++lIdxChunkFreq) {
+        lIdxW = lIdxChunk*FFTUTILS_TRIGO_CACHE_CHUNK + lIdxChunkFreq;
+        if (lIdxW < iNbrFreq) {
+          lTrigoValue = lIdxSample*lW[lIdxW];
+          lPtrTrigo[lIdxChunkFreq] = (float)cos(lTrigoValue);
+          lPtrTrigo[FFTUTILS_TRIGO_CACHE_CHUNK+lIdxChunkFreq] = (float)sin(lTrigoValue);
+        } else {
+          lPtrTrigo[lIdxChunkFreq] = 0;
+          lPtrTrigo[FFTUTILS_TRIGO_CACHE_CHUNK+lIdxChunkFreq] = 0;
+        }
+      }
+      lPtrTrigo += 2*FFTUTILS_TRIGO_CACHE_CHUNK;
     }
-    // Store it
-    lPtrTrigoCache->cosCache[lIdxW] = lTmpSamplesValuesCos;
-    lPtrTrigoCache->sinCache[lIdxW] = lTmpSamplesValuesSin;
   }
 
   // Encapsulate it in a Ruby object
@@ -455,195 +913,1233 @@ static VALUE fftutils_initTrigoCache(
 }
 
 /**
- * Initialize an MPF number based on a Ruby's fixnum.
+ * Allocate the values of an FFT profile.
  *
  * Parameters::
- * * *ioMPF* (<em>mpf_t</em>): The mpf to initialize
- * * *iValInt* (_Integer_): The Ruby integer
- * Return::
- * * _int_: The result code of the set
+ * * *oPtrFFTProfile* (<em>tFFTProfile*</em>): The FFT profile to initialize
+ * * *iNbrFreq* (<em>const int</em>): The number of frequencies
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ */
+static void fftutils_initFFTProfile(
+  tFFTProfile* oPtrFFTProfile,
+  const int iNbrFreq,
+  const int iNbrChannels) {
+  oPtrFFTProfile->nbrFreq = iNbrFreq;
+  oPtrFFTProfile->nbrChannels = iNbrChannels;
+  oPtrFFTProfile->values = ALLOC_N(double, iNbrFreq*iNbrChannels);
+}
+
+/**
+ * Free an FFT profile.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrFFTProfile* (<em>void*</em>): The FFT profile to free (in fact a <em>tFFTProfile*</em>)
  */
-inline int initMPF(
-  mpf_t ioMPF,
-  VALUE iValInt) {
-  return mpf_init_set_str(ioMPF, RSTRING_PTR(rb_big2str(iValInt, 16)), 16);
+static void fftutils_freeFFTProfile(void* iPtrFFTProfile) {
+  free(((tFFTProfile*)iPtrFFTProfile)->values);
+  free(iPtrFFTProfile);
 }
 
 /**
- * Get a Ruby integer based on an MPF storing an integer value.
- * Prerequisite: The MPF value must be truncated before calling this function.
+ * Get the maximal value of FFT coefficients, used to normalize them.
+ * Each value is limited by the maximum value of 2*(NbrSamples*MaxAbsValue)^2
  *
  * Parameters::
- * * *iMPF* (<em>mpf_t</em>): The mpf to read
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples of the FFT
  * Return::
- * * _Integer_: The Ruby integer
+ * * _double_: The maximal value
  */
-#define MAX_NUMBER_DIGITS 256
-VALUE mpf2RubyInt(
-  mpf_t iMPF) {
-  // The buffer where it will be written
-  char lStrNumber[MAX_NUMBER_DIGITS];
-  // The exponent part. Used to add trailing 0s.
-  mp_exp_t lExp;
-  // Fill the string with the mantissa part
-  mpf_get_str(lStrNumber, &lExp, 16, MAX_NUMBER_DIGITS, iMPF);
-  int lStrSize = strlen(lStrNumber);
-  if (lExp-lStrSize > 0) {
-    // We need to add (lExp-lStrSize) trailing 0s.
-    char* lPtrStrNumber = lStrNumber + lStrSize;
-    memset(lPtrStrNumber, '0', lExp-lStrSize);
-    lPtrStrNumber[lExp-lStrSize] = 0;
-  }
+static double fftutils_getMaxFFTValue(
+  const int iNbrBitsPerSample,
+  const tSampleIndex iNbrSamples) {
+  double lMaxSum = ldexp((double)iNbrSamples, iNbrBitsPerSample-1);
 
-  return rb_cstr2inum(lStrNumber, 16);
+  return 2*lMaxSum*lMaxSum;
 }
 
 /**
- * Free an FFT profile.
- * This method is called by Ruby GC.
+ * Fill an FFT profile with the normalized energies of cos and sin sums.
  *
  * Parameters::
- * * *iPtrFFTProfile* (<em>void*</em>): The FFT profile to free (in fact a <em>tFFTProfile*</em>)
+ * * *ioPtrFFTProfile* (<em>tFFTProfile*</em>): The FFT profile, already allocated
+ * * *iSumCos* (<em>const tFFTValue*</em>): The cos sums, per channel and per frequency
+ * * *iSumSin* (<em>const tFFTValue*</em>): The sin sums, per channel and per frequency
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples summed
  */
-static void fftutils_freeFFTProfile(void* iPtrFFTProfile) {
-  tFFTProfile* lPtrFFTProfile = (tFFTProfile*)iPtrFFTProfile;
-
+static void fftutils_fillFFTProfile(
+  tFFTProfile* ioPtrFFTProfile,
+  const tFFTValue* iSumCos,
+  const tFFTValue* iSumSin,
+  const int iNbrBitsPerSample,
+  const tSampleIndex iNbrSamples) {
+  double lMaxFFTValue = fftutils_getMaxFFTValue(iNbrBitsPerSample, iNbrSamples);
+  double* lPtrValue = ioPtrFFTProfile->values;
+  double lCos;
+  double lSin;
   int lIdxFreq;
   int lIdxChannel;
-  mpf_t* lPtrChannelValues;
-  for (lIdxFreq = 0; lIdxFreq < lPtrFFTProfile->nbrFreq; ++lIdxFreq) {
-    lPtrChannelValues = lPtrFFTProfile->profile[lIdxFreq];
-    for (lIdxChannel = 0; lIdxChannel < lPtrFFTProfile->nbrChannels; ++lIdxChannel) {
-      mpf_clear(lPtrChannelValues[lIdxChannel]);
+  int lIdxSum;
+  for (lIdxFreq = 0; lIdxFreq < ioPtrFFTProfile->nbrFreq; ++lIdxFreq) {
+    lIdxSum = lIdxFreq;
+    for (lIdxChannel = 0; lIdxChannel < ioPtrFFTProfile->nbrChannels; ++lIdxChannel) {
+      lCos = (double)iSumCos[lIdxSum];
+      lSin = (double)iSumSin[lIdxSum];
+      *(lPtrValue++) = (lCos*lCos + lSin*lSin)/lMaxFFTValue;
+      lIdxSum += ioPtrFFTProfile->nbrFreq;
     }
-    // Free it
-    free(lPtrFFTProfile->profile[lIdxFreq]);
   }
-  mpf_clear(lPtrFFTProfile->maxFFTValue);
-  free(lPtrFFTProfile->profile);
 }
 
 /**
- * Initialize a C object storing a profile
+ * Compute the maximal difference between 2 arrays of normalized energies.
  *
  * Parameters::
- * * *iSelf* (_FFTUtils_): Self
- * * *iValFFTProfile* (<em>[Integer,Integer,list<list<Integer>>]</em>): FFT Profile
+ * * *iValues1* (<em>const double*</em>): Values 1
+ * * *iValues2* (<em>const double*</em>): Values 2
+ * * *iNbrValues* (<em>const int</em>): Number of values
  * Return::
- * * _Object_: Object storing a C FFT Profile, to be used with other C functions
+ * * _double_: The maximal difference (Values 2 - Values 1), or 0 if Values 2 are all below Values 1
  */
-static VALUE fftutils_createCFFTProfile(
-  VALUE iSelf,
-  VALUE iValFFTProfile) {
-  // The C profile
-  tFFTProfile* lPtrFFTProfile = ALLOC(tFFTProfile);
-  int lNbrBitsPerSample = FIX2INT(rb_ary_entry(iValFFTProfile, 0));
-  tSampleIndex lNbrSamples = FIX2LONG(rb_ary_entry(iValFFTProfile, 1));
-  VALUE lValFFTCoeffs = rb_ary_entry(iValFFTProfile, 2);
-  lPtrFFTProfile->nbrFreq = RARRAY_LEN(lValFFTCoeffs);
-  lPtrFFTProfile->nbrChannels = RARRAY_LEN(rb_ary_entry(lValFFTCoeffs, 0));
-
-  // Compute the maximal values
-  mpf_init_set_ui(lPtrFFTProfile->maxFFTValue, 1 << (lNbrBitsPerSample-1));
-  mpf_mul_ui(lPtrFFTProfile->maxFFTValue, lPtrFFTProfile->maxFFTValue, lNbrSamples);
-  mpf_mul(lPtrFFTProfile->maxFFTValue, lPtrFFTProfile->maxFFTValue, lPtrFFTProfile->maxFFTValue);
-  mpf_add(lPtrFFTProfile->maxFFTValue, lPtrFFTProfile->maxFFTValue, lPtrFFTProfile->maxFFTValue);
-
-  // Fill the C structure
-  lPtrFFTProfile->profile = ALLOC_N(mpf_t*, lPtrFFTProfile->nbrFreq);
-  mpf_t* lPtrChannelValues;
-  VALUE lValChannelValues;
-  int lConvertResult = 0;
-  int lIdxFreq;
-  int lIdxChannel;
-  for (lIdxFreq = 0; lIdxFreq < lPtrFFTProfile->nbrFreq; ++lIdxFreq) {
-    lValChannelValues = rb_ary_entry(lValFFTCoeffs, lIdxFreq);
-    lPtrChannelValues = ALLOC_N(mpf_t, lPtrFFTProfile->nbrChannels);
-    for (lIdxChannel = 0; lIdxChannel < lPtrFFTProfile->nbrChannels; ++lIdxChannel) {
-      lConvertResult += initMPF(lPtrChannelValues[lIdxChannel], rb_ary_entry(lValChannelValues, lIdxChannel));
+static double fftutils_maxDifference(
+  const double* iValues1,
+  const double* iValues2,
+  const int iNbrValues) {
+  double rMaxDist = 0;
+  double lDist;
+  int lIdxValue;
+  for (lIdxValue = 0; lIdxValue < iNbrValues; ++lIdxValue) {
+    lDist = iValues2[lIdxValue] - iValues1[lIdxValue];
+    if (lDist > rMaxDist) {
+      rMaxDist = lDist;
     }
-    lPtrFFTProfile->profile[lIdxFreq] = lPtrChannelValues;
-  }
-  if (lConvertResult != 0) {
-    // Errors occured
-    char lLogMessage[256];
-    sprintf(lLogMessage, "%d errors occurred while creating the C FFT profile.", -lConvertResult);
-    rb_funcall(iSelf, rb_intern("log_err"), 1, rb_str_new2(lLogMessage));
   }
 
-  // Encapsulate it in a Ruby object
-  return Data_Wrap_Struct(rb_cObject, NULL, fftutils_freeFFTProfile, lPtrFFTProfile);
+  return rMaxDist;
 }
 
+#ifdef FFTUTILS_X86_SIMD
 /**
- * Compare 2 FFT profiles and measure their distance.
- * Here is an FFT profile structure:
- * [ Integer,          Integer,    list<list<Integer>> ]
- * [ NbrBitsPerSample, NbrSamples, FFTValues ]
- * FFTValues are declined per channel, per frequency index.
- * Bits per sample and number of samples are taken into account to relatively compare the profiles.
+ * Compute the maximal difference between 2 arrays of normalized energies, using AVX2.
+ * It gives the same result as fftutils_maxDifference: 4 differences are compared at once.
  *
  * Parameters::
- * * *iSelf* (_FFTUtils_): Self
- * * *iValProfile1* (_Object_): Profile 1, initialized by createCFFTProfile.
- * * *iValProfile2* (_Object_): Profile 2, initialized by createCFFTProfile.
- * * *iValScale* (_Integer_): The scale used to compute values
+ * * *iValues1* (<em>const double*</em>): Values 1
+ * * *iValues2* (<em>const double*</em>): Values 2
+ * * *iNbrValues* (<em>const int</em>): Number of values
  * Return::
- * * _Integer_: Distance (Profile 2 - Profile 1).
+ * * _double_: The maximal difference (Values 2 - Values 1), or 0 if Values 2 are all below Values 1
  */
-static VALUE fftutils_distFFTProfiles(
+__attribute__((target("avx2")))
+static double fftutils_maxDifference_avx2(
+  const double* iValues1,
+  const double* iValues2,
+  const int iNbrValues) {
+  double lMaxDists[4];
+  __m256d lMaxDist = _mm256_setzero_pd();
+  int lIdxValue;
+  for (lIdxValue = 0; lIdxValue + 4 <= iNbrValues; lIdxValue += 4) {
+    lMaxDist = _mm256_max_pd(lMaxDist, _mm256_sub_pd(_mm256_loadu_pd(iValues2 + lIdxValue), _mm256_loadu_pd(iValues1 + lIdxValue)));
+  }
+  _mm256_storeu_pd(lMaxDists, lMaxDist);
+  // The remaining values
+  double rMaxDist = fftutils_maxDifference(iValues1 + lIdxValue, iValues2 + lIdxValue, iNbrValues - lIdxValue);
+  int lIdxMax;
+  for (lIdxMax = 0; lIdxMax < 4; ++lIdxMax) {
+    if (lMaxDists[lIdxMax] > rMaxDist) {
+      rMaxDist = lMaxDists[lIdxMax];
+    }
+  }
+
+  return rMaxDist;
+}
+#endif
+
+/**
+ * Check that an FFT profile has given dimensions, so that it can be compared with other FFT values.
+ *
+ * Parameters::
+ * * *iPtrFFTProfile* (<em>const tFFTProfile*</em>): The FFT profile
+ * * *iNbrFreq* (<em>const int</em>): The expected number of frequencies
+ * * *iNbrChannels* (<em>const int</em>): The expected number of channels
+ */
+static void fftutils_checkFFTProfileDimensions(
+  const tFFTProfile* iPtrFFTProfile,
+  const int iNbrFreq,
+  const int iNbrChannels) {
+  if ((iPtrFFTProfile->nbrFreq != iNbrFreq) ||
+      (iPtrFFTProfile->nbrChannels != iNbrChannels)) {
+    rb_raise(rb_eRuntimeError, "FFT profile of %d frequencies and %d channels can't be compared with FFT values of %d frequencies and %d channels", iPtrFFTProfile->nbrFreq, iPtrFFTProfile->nbrChannels, iNbrFreq, iNbrChannels);
+  }
+}
+
+/**
+ * Measure the distance between 2 C FFT profiles: the maximal distance of their normalized frequency coefficients.
+ * Profiles must have the same dimensions (see fftutils_checkFFTProfileDimensions).
+ *
+ * Parameters::
+ * * *iPtrFFTProfile1* (<em>const tFFTProfile*</em>): Profile 1
+ * * *iPtrFFTProfile2* (<em>const tFFTProfile*</em>): Profile 2
+ * Return::
+ * * _double_: Distance (Profile 2 - Profile 1), without scale
+ */
+static double fftutils_computeFFTProfilesDistance(
+  const tFFTProfile* iPtrFFTProfile1,
+  const tFFTProfile* iPtrFFTProfile2) {
+  int lNbrValues = iPtrFFTProfile1->nbrFreq*iPtrFFTProfile1->nbrChannels;
+#ifdef FFTUTILS_X86_SIMD
+  if (commonutils_getSIMDLevel() >= COMMONUTILS_SIMD_AVX2) {
+    return fftutils_maxDifference_avx2(iPtrFFTProfile1->values, iPtrFFTProfile2->values, lNbrValues);
+  }
+#endif
+
+  return fftutils_maxDifference(iPtrFFTProfile1->values, iPtrFFTProfile2->values, lNbrValues);
+}
+
+/**
+ * Initialize a C object storing a profile.
+ * This converts FFT profiles computed in Ruby (as stored in fft.result files by the FFT action) into normalized energies.
+ * Here is an FFT profile structure:
+ * [ Integer,          Integer,    list<list<Integer>> ]
+ * [ NbrBitsPerSample, NbrSamples, FFTValues ]
+ * FFTValues are declined per channel, per frequency index.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValFFTProfile* (<em>[Integer,Integer,list<list<Integer>>]</em>): FFT Profile
+ * Return::
+ * * _Object_: Object storing a C FFT Profile, to be used with other C functions
+ */
+static VALUE fftutils_createCFFTProfile(
+  VALUE iSelf,
+  VALUE iValFFTProfile) {
+  if ((!RB_TYPE_P(iValFFTProfile, T_ARRAY)) ||
+      (!RB_TYPE_P(rb_ary_entry(iValFFTProfile, 2), T_ARRAY))) {
+    rb_raise(rb_eRuntimeError, "FFT profile should be [NbrBitsPerSample, NbrSamples, FFTValues]");
+  }
+  int lNbrBitsPerSample = FIX2INT(rb_ary_entry(iValFFTProfile, 0));
+  tSampleIndex lNbrSamples = NUM2LL(rb_ary_entry(iValFFTProfile, 1));
+  VALUE lValFFTCoeffs = rb_ary_entry(iValFFTProfile, 2);
+  if ((RARRAY_LEN(lValFFTCoeffs) == 0) ||
+      (!RB_TYPE_P(rb_ary_entry(lValFFTCoeffs, 0), T_ARRAY)) ||
+      (RARRAY_LEN(rb_ary_entry(lValFFTCoeffs, 0)) == 0)) {
+    rb_raise(rb_eRuntimeError, "FFT profile has no FFT coefficients");
+  }
+  if (lNbrSamples <= 0) {
+    rb_raise(rb_eRuntimeError, "FFT profile of %lld samples can't be normalized", lNbrSamples);
+  }
+  // The C profile
+  tFFTProfile* lPtrFFTProfile = ALLOC(tFFTProfile);
+  fftutils_initFFTProfile(lPtrFFTProfile, RARRAY_LEN(lValFFTCoeffs), RARRAY_LEN(rb_ary_entry(lValFFTCoeffs, 0)));
+  // Encapsulate it in a Ruby object first, so that it is freed if conversions fail
+  VALUE rValFFTProfile = Data_Wrap_Struct(rb_cObject, NULL, fftutils_freeFFTProfile, lPtrFFTProfile);
+
+  // Fill the C structure
+  double lMaxFFTValue = fftutils_getMaxFFTValue(lNbrBitsPerSample, lNbrSamples);
+  double* lPtrValue = lPtrFFTProfile->values;
+  VALUE lValChannelValues;
+  int lIdxFreq;
+  int lIdxChannel;
+  for (lIdxFreq = 0; lIdxFreq < lPtrFFTProfile->nbrFreq; ++lIdxFreq) {
+    lValChannelValues = rb_ary_entry(lValFFTCoeffs, lIdxFreq);
+    if ((!RB_TYPE_P(lValChannelValues, T_ARRAY)) ||
+        (RARRAY_LEN(lValChannelValues) != lPtrFFTProfile->nbrChannels)) {
+      rb_raise(rb_eRuntimeError, "FFT profile should have %d channels for frequency %d", lPtrFFTProfile->nbrChannels, lIdxFreq);
+    }
+    for (lIdxChannel = 0; lIdxChannel < lPtrFFTProfile->nbrChannels; ++lIdxChannel) {
+      *(lPtrValue++) = NUM2DBL(rb_ary_entry(lValChannelValues, lIdxChannel))/lMaxFFTValue;
+    }
+  }
+
+  return rValFFTProfile;
+}
+
+/**
+ * Create a C FFT profile directly from cos and sin sums, without computing its FFT coefficients in Ruby integers.
+ * It stores the same values as createCFFTProfile with the FFT profile of the sums.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValNbrBitsPerSample* (_Integer_): Number of bits per sample
+ * * *iValNbrSamples* (_Integer_): Number of samples summed
+ * * *iValNbrChannels* (_Integer_): The number of channels
+ * * *iValNbrFreq* (_Integer_): The number of frequencies
+ * * *iValSumCos* (_Object_): Container of the cos sums (should be initialized with initSumArray)
+ * * *iValSumSin* (_Object_): Container of the sin sums (should be initialized with initSumArray)
+ * Return::
+ * * _Object_: Object storing a C FFT Profile, to be used with other C functions
+ */
+static VALUE fftutils_computeCFFTProfile(
+  VALUE iSelf,
+  VALUE iValNbrBitsPerSample,
+  VALUE iValNbrSamples,
+  VALUE iValNbrChannels,
+  VALUE iValNbrFreq,
+  VALUE iValSumCos,
+  VALUE iValSumSin) {
+  // Get the cos and sin sum arrays
+  tFFTValue* lSumCos;
+  tFFTValue* lSumSin;
+  Data_Get_Struct(iValSumCos, tFFTValue, lSumCos);
+  Data_Get_Struct(iValSumSin, tFFTValue, lSumSin);
+
+  tFFTProfile* lPtrFFTProfile = ALLOC(tFFTProfile);
+  fftutils_initFFTProfile(lPtrFFTProfile, FIX2INT(iValNbrFreq), FIX2INT(iValNbrChannels));
+  fftutils_fillFFTProfile(lPtrFFTProfile, lSumCos, lSumSin, FIX2INT(iValNbrBitsPerSample), NUM2LL(iValNbrSamples));
+
+  // Encapsulate it in a Ruby object
+  return Data_Wrap_Struct(rb_cObject, NULL, fftutils_freeFFTProfile, lPtrFFTProfile);
+}
+
+/**
+ * Compare 2 FFT profiles and measure their distance: the maximal difference of their normalized frequency coefficients.
+ * Bits per sample and number of samples are taken into account to relatively compare the profiles.
+ * Profiles must have the same numbers of frequencies and channels.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValProfile1* (_Object_): Profile 1, initialized by createCFFTProfile or computeCFFTProfile.
+ * * *iValProfile2* (_Object_): Profile 2, initialized by createCFFTProfile or computeCFFTProfile.
+ * * *iValScale* (_Integer_): The scale used to compute values
+ * Return::
+ * * _Integer_: Distance (Profile 2 - Profile 1).
+ */
+static VALUE fftutils_distFFTProfiles(
   VALUE iSelf,
   VALUE iValProfile1,
   VALUE iValProfile2,
   VALUE iValScale) {
-  // Translate parameters in C types
-  mpf_t iScale;
-  initMPF(iScale, iValScale);
   // Get the FFT Profiles
   tFFTProfile* lPtrFFTProfile1;
   Data_Get_Struct(iValProfile1, tFFTProfile, lPtrFFTProfile1);
   tFFTProfile* lPtrFFTProfile2;
   Data_Get_Struct(iValProfile2, tFFTProfile, lPtrFFTProfile2);
+  fftutils_checkFFTProfileDimensions(lPtrFFTProfile2, lPtrFFTProfile1->nbrFreq, lPtrFFTProfile1->nbrChannels);
 
-  // Return the max of the distances of each frequency coefficient
-  mpf_t lMaxDist;
-  mpf_init_set_ui(lMaxDist, 0);
-  
-  int lIdxFreq;
+  // Apply the scale
+  return LL2NUM((long long int)(fftutils_computeFFTProfilesDistance(lPtrFFTProfile1, lPtrFFTProfile2)*NUM2DBL(iValScale)));
+}
+
+/**
+ * Free a sliding FFT.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrSlidingFFT* (<em>void*</em>): The sliding FFT to free (in fact a <em>tSlidingFFT*</em>)
+ */
+static void fftutils_freeSlidingFFT(void* iPtrSlidingFFT) {
+  tSlidingFFT* lPtrSlidingFFT = (tSlidingFFT*)iPtrSlidingFFT;
+
+  commonutils_freeSampleBlock(&lPtrSlidingFFT->blockOut);
+  commonutils_freeSampleBlock(&lPtrSlidingFFT->blockIn);
+  free(lPtrSlidingFFT->w);
+  free(lPtrSlidingFFT->sumCos);
+  free(lPtrSlidingFFT);
+}
+
+/**
+ * Allocate a sliding FFT, without window.
+ *
+ * Parameters::
+ * * *iW* (<em>const double*</em>): The W coefficients
+ * * *iNbrFreq* (<em>const int</em>): The number of frequencies in the W coefficients
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * Return::
+ * * <em>tSlidingFFT*</em>: The sliding FFT, to be freed with fftutils_freeSlidingFFT
+ */
+static tSlidingFFT* fftutils_allocSlidingFFT(
+  const double* iW,
+  const int iNbrFreq,
+  const int iNbrChannels,
+  const int iNbrBitsPerSample) {
+  tSlidingFFT* rPtrSlidingFFT = ALLOC(tSlidingFFT);
+  rPtrSlidingFFT->nbrFreq = iNbrFreq;
+  rPtrSlidingFFT->nbrChannels = iNbrChannels;
+  rPtrSlidingFFT->nbrBitsPerSample = iNbrBitsPerSample;
+  // No window yet
+  rPtrSlidingFFT->nbrSamples = 0;
+  // Values per frequency
+  rPtrSlidingFFT->w = ALLOC_N(double, 7*iNbrFreq);
+  rPtrSlidingFFT->rotationCos = rPtrSlidingFFT->w + iNbrFreq;
+  rPtrSlidingFFT->rotationSin = rPtrSlidingFFT->w + 2*iNbrFreq;
+  rPtrSlidingFFT->windowCos = rPtrSlidingFFT->w + 3*iNbrFreq;
+  rPtrSlidingFFT->windowSin = rPtrSlidingFFT->w + 4*iNbrFreq;
+  rPtrSlidingFFT->lastCos = rPtrSlidingFFT->w + 5*iNbrFreq;
+  rPtrSlidingFFT->lastSin = rPtrSlidingFFT->w + 6*iNbrFreq;
+  int lIdxW;
+  for (lIdxW = 0; lIdxW < iNbrFreq; ++lIdxW) {
+    rPtrSlidingFFT->w[lIdxW] = iW[lIdxW];
+    rPtrSlidingFFT->rotationCos[lIdxW] = cos(iW[lIdxW]);
+    rPtrSlidingFFT->rotationSin[lIdxW] = sin(iW[lIdxW]);
+  }
+  // Sums per channel and frequency
+  rPtrSlidingFFT->sumCos = ALLOC_N(double, 2*iNbrFreq*iNbrChannels);
+  rPtrSlidingFFT->sumSin = rPtrSlidingFFT->sumCos + iNbrFreq*iNbrChannels;
+  memset(rPtrSlidingFFT->sumCos, 0, 2*iNbrFreq*iNbrChannels*sizeof(double));
+  commonutils_initSampleBlock(&rPtrSlidingFFT->blockOut, iNbrChannels);
+  commonutils_initSampleBlock(&rPtrSlidingFFT->blockIn, iNbrChannels);
+
+  return rPtrSlidingFFT;
+}
+
+/**
+ * Create a sliding FFT, computing FFT profiles of a window of samples that slides.
+ * Once the sums of a window are computed with resetSlidingFFT, slideSlidingFFT updates them with 1 complex multiplication per sample, frequency and channel, whatever the size of the window.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValW* (_Object_): Container of the W coefficients (initialized using createWi)
+ * * *iValNbrFreq* (_Integer_): The number of frequencies in the W coefficients
+ * * *iValNbrChannels* (_Integer_): The number of channels
+ * * *iValNbrBitsPerSample* (_Integer_): The number of bits per sample
+ * Return::
+ * * _Object_: Container of the sliding FFT
+ */
+static VALUE fftutils_initSlidingFFT(
+  VALUE iSelf,
+  VALUE iValW,
+  VALUE iValNbrFreq,
+  VALUE iValNbrChannels,
+  VALUE iValNbrBitsPerSample) {
+  // Get the lW array
+  double * lW;
+  Data_Get_Struct(iValW, double, lW);
+
+  tSlidingFFT* lPtrSlidingFFT = fftutils_allocSlidingFFT(lW, FIX2INT(iValNbrFreq), FIX2INT(iValNbrChannels), FIX2INT(iValNbrBitsPerSample));
+
+  // Encapsulate it in a Ruby object
+  return Data_Wrap_Struct(rb_cObject, NULL, fftutils_freeSlidingFFT, lPtrSlidingFFT);
+}
+
+/**
+ * Compute the sums of a new window of a sliding FFT, without the GVL.
+ * A rotating phasor gives the trigonometric values, set to exact values at the beginning of each block.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The arguments. In fact a <em>tSlidingFFTStruct*</em>: nbrSamples is the size of the window.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* fftutils_resetSlidingFFT_WithoutGVL(void* iPtrArgs) {
+  tSlidingFFTStruct* lPtrVariables = (tSlidingFFTStruct*)iPtrArgs;
+  tSlidingFFT* lPtrSlidingFFT = lPtrVariables->slidingFFT;
+
+  int lNbrFreq = lPtrSlidingFFT->nbrFreq;
+  int lNbrChannels = lPtrSlidingFFT->nbrChannels;
+  int lSampleSize = (lNbrChannels*lPtrSlidingFFT->nbrBitsPerSample)/8;
+  // Phasors, per frequency
+  double lCos[lNbrFreq];
+  double lSin[lNbrFreq];
+  double* lPtrSumCos;
+  double* lPtrSumSin;
+  long double lTrigoValue;
+  double lNextCos;
+  double lValue;
+  tSampleIndex lIdxBlockSample;
+  tSampleIndex lNbrBlockSamples;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  int lIdxW;
+  lPtrSlidingFFT->nbrSamples = lPtrVariables->nbrSamples;
+  for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+    lTrigoValue = ((long double)lPtrSlidingFFT->w[lIdxW]) * ((long double)lPtrVariables->nbrSamples);
+    lPtrSlidingFFT->windowCos[lIdxW] = cos(lTrigoValue);
+    lPtrSlidingFFT->windowSin[lIdxW] = sin(lTrigoValue);
+    lTrigoValue = ((long double)lPtrSlidingFFT->w[lIdxW]) * ((long double)(lPtrVariables->nbrSamples-1));
+    lPtrSlidingFFT->lastCos[lIdxW] = cos(lTrigoValue);
+    lPtrSlidingFFT->lastSin[lIdxW] = sin(lTrigoValue);
+  }
+  memset(lPtrSlidingFFT->sumCos, 0, 2*lNbrFreq*lNbrChannels*sizeof(double));
+  for (lIdxBlockSample = 0; lIdxBlockSample < lPtrVariables->nbrSamples; lIdxBlockSample += COMMONUTILS_BLOCK_SIZE) {
+    lNbrBlockSamples = lPtrVariables->nbrSamples - lIdxBlockSample;
+    if (lNbrBlockSamples > COMMONUTILS_BLOCK_SIZE) {
+      lNbrBlockSamples = COMMONUTILS_BLOCK_SIZE;
+    }
+    commonutils_decodeBlock(lPtrVariables->rawBuffer + lIdxBlockSample*lSampleSize, lPtrSlidingFFT->nbrBitsPerSample, lNbrBlockSamples, lIdxBlockSample, &lPtrSlidingFFT->blockIn);
+    for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+      lTrigoValue = ((long double)lPtrSlidingFFT->w[lIdxW]) * ((long double)lIdxBlockSample);
+      lCos[lIdxW] = cos(lTrigoValue);
+      lSin[lIdxW] = sin(lTrigoValue);
+    }
+    for (lIdxSample = 0; lIdxSample < lNbrBlockSamples; ++lIdxSample) {
+      for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+        lValue = lPtrSlidingFFT->blockIn.values[lIdxChannel][lIdxSample];
+        lPtrSumCos = lPtrSlidingFFT->sumCos + lIdxChannel*lNbrFreq;
+        lPtrSumSin = lPtrSlidingFFT->sumSin + lIdxChannel*lNbrFreq;
+        for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+          lPtrSumCos[lIdxW] += lValue*lCos[lIdxW];
+          lPtrSumSin[lIdxW] += lValue*lSin[lIdxW];
+        }
+      }
+      // Rotate the phasors to the next sample
+      for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+        lNextCos = lCos[lIdxW]*lPtrSlidingFFT->rotationCos[lIdxW] - lSin[lIdxW]*lPtrSlidingFFT->rotationSin[lIdxW];
+        lSin[lIdxW] = lSin[lIdxW]*lPtrSlidingFFT->rotationCos[lIdxW] + lCos[lIdxW]*lPtrSlidingFFT->rotationSin[lIdxW];
+        lCos[lIdxW] = lNextCos;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Slide the window of a sliding FFT, without the GVL.
+ * For each sample the window slides by, with X the sample leaving the window and Y the one entering it, sums S become:
+ * * Forwards: S = e^(-i*Wi) * (S - X + Y*e^(i*Wi*N))
+ * * Backwards: S = Y + e^(i*Wi) * (S - X*e^(i*Wi*(N-1)))
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The arguments. In fact a <em>tSlidingFFTStruct*</em>.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* fftutils_slideSlidingFFT_WithoutGVL(void* iPtrArgs) {
+  tSlidingFFTStruct* lPtrVariables = (tSlidingFFTStruct*)iPtrArgs;
+  tSlidingFFT* lPtrSlidingFFT = lPtrVariables->slidingFFT;
+
+  int lNbrFreq = lPtrSlidingFFT->nbrFreq;
+  int lNbrChannels = lPtrSlidingFFT->nbrChannels;
+  int lSampleSize = (lNbrChannels*lPtrSlidingFFT->nbrBitsPerSample)/8;
+  tSampleIndex lNbrWindowSamples = lPtrSlidingFFT->nbrSamples;
+  tSampleIndex lNbrSlideSamples = lPtrVariables->nbrSamples;
+  const double* lRotationCos = lPtrSlidingFFT->rotationCos;
+  const double* lRotationSin = lPtrSlidingFFT->rotationSin;
+  const double* lWindowCos = lPtrSlidingFFT->windowCos;
+  const double* lWindowSin = lPtrSlidingFFT->windowSin;
+  const double* lLastCos = lPtrSlidingFFT->lastCos;
+  const double* lLastSin = lPtrSlidingFFT->lastSin;
+  double* lPtrSumCos;
+  double* lPtrSumSin;
+  double lValueOut;
+  double lValueIn;
+  double lCos;
+  double lSin;
+  tSampleIndex lIdxBlockSample;
+  tSampleIndex lNbrBlockSamples;
+  tSampleIndex lIdxSample;
   int lIdxChannel;
-  mpf_t* lPtrChannelValues1;
-  mpf_t* lPtrChannelValues2;
-  mpf_t lDist;
-  mpf_init(lDist);
-  mpf_t lDist2;
-  mpf_init(lDist2);
-
-  for (lIdxFreq = 0; lIdxFreq < lPtrFFTProfile1->nbrFreq; ++lIdxFreq) {
-    lPtrChannelValues1 = lPtrFFTProfile1->profile[lIdxFreq];
-    lPtrChannelValues2 = lPtrFFTProfile2->profile[lIdxFreq];
-    for (lIdxChannel = 0; lIdxChannel < lPtrFFTProfile1->nbrChannels; ++lIdxChannel) {
-      // Compute iFFT2Value - iFFT1Value, on a scale of iScale
-      mpf_div(lDist, lPtrChannelValues2[lIdxChannel], lPtrFFTProfile2->maxFFTValue);
-      mpf_div(lDist2, lPtrChannelValues1[lIdxChannel], lPtrFFTProfile1->maxFFTValue);
-      mpf_sub(lDist, lDist, lDist2);
-      if (mpf_cmp(lDist, lMaxDist) > 0) {
-        mpf_set(lMaxDist, lDist);
+  int lIdxW;
+  for (lIdxBlockSample = 0; lIdxBlockSample < lNbrSlideSamples; lIdxBlockSample += COMMONUTILS_BLOCK_SIZE) {
+    lNbrBlockSamples = lNbrSlideSamples - lIdxBlockSample;
+    if (lNbrBlockSamples > COMMONUTILS_BLOCK_SIZE) {
+      lNbrBlockSamples = COMMONUTILS_BLOCK_SIZE;
+    }
+    if (lPtrVariables->backwards == 0) {
+      // The buffer begins with the current window: samples leave from its beginning, and enter after its end
+      commonutils_decodeBlock(lPtrVariables->rawBuffer + lIdxBlockSample*lSampleSize, lPtrSlidingFFT->nbrBitsPerSample, lNbrBlockSamples, lIdxBlockSample, &lPtrSlidingFFT->blockOut);
+      commonutils_decodeBlock(lPtrVariables->rawBuffer + (lNbrWindowSamples+lIdxBlockSample)*lSampleSize, lPtrSlidingFFT->nbrBitsPerSample, lNbrBlockSamples, lNbrWindowSamples+lIdxBlockSample, &lPtrSlidingFFT->blockIn);
+      for (lIdxSample = 0; lIdxSample < lNbrBlockSamples; ++lIdxSample) {
+        for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+          lValueOut = lPtrSlidingFFT->blockOut.values[lIdxChannel][lIdxSample];
+          lValueIn = lPtrSlidingFFT->blockIn.values[lIdxChannel][lIdxSample];
+          lPtrSumCos = lPtrSlidingFFT->sumCos + lIdxChannel*lNbrFreq;
+          lPtrSumSin = lPtrSlidingFFT->sumSin + lIdxChannel*lNbrFreq;
+          // Sums of all frequencies are independent: iterating them in the inner loop hides their latency
+          for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+            lCos = lPtrSumCos[lIdxW] - lValueOut + lValueIn*lWindowCos[lIdxW];
+            lSin = lPtrSumSin[lIdxW] + lValueIn*lWindowSin[lIdxW];
+            lPtrSumCos[lIdxW] = lCos*lRotationCos[lIdxW] + lSin*lRotationSin[lIdxW];
+            lPtrSumSin[lIdxW] = lSin*lRotationCos[lIdxW] - lCos*lRotationSin[lIdxW];
+          }
+        }
+      }
+    } else {
+      // The buffer ends with the current window: samples leave from its end, and enter before its beginning, the last ones first
+      commonutils_decodeBlock(lPtrVariables->rawBuffer + (lNbrWindowSamples+lNbrSlideSamples-lIdxBlockSample-lNbrBlockSamples)*lSampleSize, lPtrSlidingFFT->nbrBitsPerSample, lNbrBlockSamples, lNbrWindowSamples+lNbrSlideSamples-lIdxBlockSample-lNbrBlockSamples, &lPtrSlidingFFT->blockOut);
+      commonutils_decodeBlock(lPtrVariables->rawBuffer + (lNbrSlideSamples-lIdxBlockSample-lNbrBlockSamples)*lSampleSize, lPtrSlidingFFT->nbrBitsPerSample, lNbrBlockSamples, lNbrSlideSamples-lIdxBlockSample-lNbrBlockSamples, &lPtrSlidingFFT->blockIn);
+      for (lIdxSample = lNbrBlockSamples-1; lIdxSample >= 0; --lIdxSample) {
+        for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+          lValueOut = lPtrSlidingFFT->blockOut.values[lIdxChannel][lIdxSample];
+          lValueIn = lPtrSlidingFFT->blockIn.values[lIdxChannel][lIdxSample];
+          lPtrSumCos = lPtrSlidingFFT->sumCos + lIdxChannel*lNbrFreq;
+          lPtrSumSin = lPtrSlidingFFT->sumSin + lIdxChannel*lNbrFreq;
+          for (lIdxW = 0; lIdxW < lNbrFreq; ++lIdxW) {
+            lCos = lPtrSumCos[lIdxW] - lValueOut*lLastCos[lIdxW];
+            lSin = lPtrSumSin[lIdxW] - lValueOut*lLastSin[lIdxW];
+            lPtrSumCos[lIdxW] = lValueIn + lCos*lRotationCos[lIdxW] - lSin*lRotationSin[lIdxW];
+            lPtrSumSin[lIdxW] = lSin*lRotationCos[lIdxW] + lCos*lRotationSin[lIdxW];
+          }
+        }
       }
     }
   }
+
+  return NULL;
+}
+
+/**
+ * Compute the sums of a new window of a sliding FFT.
+ * This has to be called before sliding the window, and can be called again to get rid of rounding errors accumulated while sliding.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValSlidingFFT* (_Object_): Container of the sliding FFT (initialized with initSlidingFFT)
+ * * *iValInputRawBuffer* (_String_): The raw buffer of the window
+ * * *iValNbrSamples* (_Integer_): The number of samples of the window
+ */
+static VALUE fftutils_resetSlidingFFT(
+  VALUE iSelf,
+  VALUE iValSlidingFFT,
+  VALUE iValInputRawBuffer,
+  VALUE iValNbrSamples) {
+  tSlidingFFTStruct lSlidingVariables;
+  Data_Get_Struct(iValSlidingFFT, tSlidingFFT, lSlidingVariables.slidingFFT);
+  lSlidingVariables.rawBuffer = RSTRING_PTR(iValInputRawBuffer);
+  lSlidingVariables.nbrSamples = NUM2LL(iValNbrSamples);
+  lSlidingVariables.backwards = 0;
+  if ((lSlidingVariables.nbrSamples <= 0) ||
+      (lSlidingVariables.nbrSamples*((lSlidingVariables.slidingFFT->nbrChannels*lSlidingVariables.slidingFFT->nbrBitsPerSample)/8) > RSTRING_LEN(iValInputRawBuffer))) {
+    rb_raise(rb_eRuntimeError, "Raw buffer of %ld bytes can't contain a window of %lld samples", RSTRING_LEN(iValInputRawBuffer), lSlidingVariables.nbrSamples);
+  }
+
+  commonutils_callWithoutGVL(&fftutils_resetSlidingFFT_WithoutGVL, &lSlidingVariables);
+
+  return Qnil;
+}
+
+/**
+ * Slide the window of a sliding FFT by a number of samples.
+ * The raw buffer spans both the current window and the new one:
+ * * Forwards: it begins with the current window, followed by the samples entering the window.
+ * * Backwards: it begins with the samples entering the window, followed by the current window.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValSlidingFFT* (_Object_): Container of the sliding FFT (its window initialized with resetSlidingFFT)
+ * * *iValInputRawBuffer* (_String_): The raw buffer
+ * * *iValNbrSamples* (_Integer_): The number of samples the window slides by
+ * * *iValBackwards* (_Boolean_): Does the window slide backwards ?
+ */
+static VALUE fftutils_slideSlidingFFT(
+  VALUE iSelf,
+  VALUE iValSlidingFFT,
+  VALUE iValInputRawBuffer,
+  VALUE iValNbrSamples,
+  VALUE iValBackwards) {
+  tSlidingFFTStruct lSlidingVariables;
+  Data_Get_Struct(iValSlidingFFT, tSlidingFFT, lSlidingVariables.slidingFFT);
+  lSlidingVariables.rawBuffer = RSTRING_PTR(iValInputRawBuffer);
+  lSlidingVariables.nbrSamples = NUM2LL(iValNbrSamples);
+  lSlidingVariables.backwards = (iValBackwards == Qtrue) ? 1 : 0;
+  if (lSlidingVariables.slidingFFT->nbrSamples == 0) {
+    rb_raise(rb_eRuntimeError, "The sliding FFT has no window to slide: resetSlidingFFT has to be called first");
+  }
+  if ((lSlidingVariables.nbrSamples < 0) ||
+      ((lSlidingVariables.slidingFFT->nbrSamples+lSlidingVariables.nbrSamples)*((lSlidingVariables.slidingFFT->nbrChannels*lSlidingVariables.slidingFFT->nbrBitsPerSample)/8) > RSTRING_LEN(iValInputRawBuffer))) {
+    rb_raise(rb_eRuntimeError, "Raw buffer of %ld bytes can't contain a window of %lld samples slid by %lld samples", RSTRING_LEN(iValInputRawBuffer), lSlidingVariables.slidingFFT->nbrSamples, lSlidingVariables.nbrSamples);
+  }
+
+  commonutils_callWithoutGVL(&fftutils_slideSlidingFFT_WithoutGVL, &lSlidingVariables);
+
+  return Qnil;
+}
+
+/**
+ * Get the FFT profile of the current window of a sliding FFT.
+ * FFT coefficients are rounded to the nearest integers.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValSlidingFFT* (_Object_): Container of the sliding FFT
+ * Return::
+ * * <em>[Integer,Integer,list<list<Integer>>]</em>: The FFT profile
+ */
+static VALUE fftutils_getSlidingFFTProfile(
+  VALUE iSelf,
+  VALUE iValSlidingFFT) {
+  tSlidingFFT* lPtrSlidingFFT;
+  Data_Get_Struct(iValSlidingFFT, tSlidingFFT, lPtrSlidingFFT);
+  int lNbrFreq = lPtrSlidingFFT->nbrFreq;
+  int lNbrChannels = lPtrSlidingFFT->nbrChannels;
+  // The C-array of the FFT coefficients
+  VALUE lValFFT[lNbrFreq];
+  VALUE lValChannelFFTs[lNbrChannels];
+
+  int lIdxFreq;
+  int lIdxChannel;
+  int lIdxSum;
+  for (lIdxFreq = 0; lIdxFreq < lNbrFreq; ++lIdxFreq) {
+    lIdxSum = lIdxFreq;
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      // Coefficients can exceed 64 bits
+      lValChannelFFTs[lIdxChannel] = rb_dbl2big(round(lPtrSlidingFFT->sumCos[lIdxSum]*lPtrSlidingFFT->sumCos[lIdxSum] + lPtrSlidingFFT->sumSin[lIdxSum]*lPtrSlidingFFT->sumSin[lIdxSum]));
+      lIdxSum += lNbrFreq;
+    }
+    lValFFT[lIdxFreq] = rb_ary_new4(lNbrChannels, lValChannelFFTs);
+  }
+
+  return rb_ary_new3(3, INT2FIX(lPtrSlidingFFT->nbrBitsPerSample), LL2NUM(lPtrSlidingFFT->nbrSamples), rb_ary_new4(lNbrFreq, lValFFT));
+}
+
+/**
+ * Fill an FFT profile with the normalized energies of the current window of a sliding FFT.
+ *
+ * Parameters::
+ * * *ioPtrFFTProfile* (<em>tFFTProfile*</em>): The FFT profile, already allocated
+ * * *iPtrSlidingFFT* (<em>const tSlidingFFT*</em>): The sliding FFT
+ */
+static void fftutils_fillSlidingFFTProfile(
+  tFFTProfile* ioPtrFFTProfile,
+  const tSlidingFFT* iPtrSlidingFFT) {
+  double lMaxFFTValue = fftutils_getMaxFFTValue(iPtrSlidingFFT->nbrBitsPerSample, iPtrSlidingFFT->nbrSamples);
+  double* lPtrValue = ioPtrFFTProfile->values;
+  int lIdxFreq;
+  int lIdxChannel;
+  int lIdxSum;
+  for (lIdxFreq = 0; lIdxFreq < ioPtrFFTProfile->nbrFreq; ++lIdxFreq) {
+    lIdxSum = lIdxFreq;
+    for (lIdxChannel = 0; lIdxChannel < ioPtrFFTProfile->nbrChannels; ++lIdxChannel) {
+      *(lPtrValue++) = (iPtrSlidingFFT->sumCos[lIdxSum]*iPtrSlidingFFT->sumCos[lIdxSum] + iPtrSlidingFFT->sumSin[lIdxSum]*iPtrSlidingFFT->sumSin[lIdxSum])/lMaxFFTValue;
+      lIdxSum += iPtrSlidingFFT->nbrFreq;
+    }
+  }
+}
+
+/**
+ * Measure the distance between an FFT profile and the current window of a sliding FFT.
+ * This gives the same distance as distFFTProfiles with the profile of the window, without creating a Ruby object for it.
+ * The profile must have the numbers of frequencies and channels of the sliding FFT.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValProfile* (_Object_): Profile, initialized by createCFFTProfile.
+ * * *iValSlidingFFT* (_Object_): Container of the sliding FFT
+ * * *iValScale* (_Integer_): The scale used to compute values
+ * Return::
+ * * _Integer_: Distance (Window's profile - Profile).
+ */
+static VALUE fftutils_distSlidingFFTProfile(
+  VALUE iSelf,
+  VALUE iValProfile,
+  VALUE iValSlidingFFT,
+  VALUE iValScale) {
+  // Get the FFT Profile and the sliding FFT
+  tFFTProfile* lPtrFFTProfile;
+  Data_Get_Struct(iValProfile, tFFTProfile, lPtrFFTProfile);
+  tSlidingFFT* lPtrSlidingFFT;
+  Data_Get_Struct(iValSlidingFFT, tSlidingFFT, lPtrSlidingFFT);
+  fftutils_checkFFTProfileDimensions(lPtrFFTProfile, lPtrSlidingFFT->nbrFreq, lPtrSlidingFFT->nbrChannels);
+  if (lPtrSlidingFFT->nbrSamples == 0) {
+    rb_raise(rb_eRuntimeError, "The sliding FFT has no window to compare: resetSlidingFFT has to be called first");
+  }
+
+  // Get the profile of the window
+  double lWindowValues[lPtrFFTProfile->nbrFreq*lPtrFFTProfile->nbrChannels];
+  tFFTProfile lWindowProfile;
+  lWindowProfile.nbrFreq = lPtrFFTProfile->nbrFreq;
+  lWindowProfile.nbrChannels = lPtrFFTProfile->nbrChannels;
+  lWindowProfile.values = lWindowValues;
+  fftutils_fillSlidingFFTProfile(&lWindowProfile, lPtrSlidingFFT);
+
   // Apply the scale
-  mpf_mul(lMaxDist, lMaxDist, iScale);
-  mpf_trunc(lMaxDist, lMaxDist);
-  // Get the Ruby result
-  VALUE rValDistance = mpf2RubyInt(lMaxDist);
+  return LL2NUM((long long int)(fftutils_computeFFTProfilesDistance(lPtrFFTProfile, &lWindowProfile)*NUM2DBL(iValScale)));
+}
+
+/**
+ * Is a sample of a block within thresholds on all its channels ?
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block
+ * * *iIdxBlockSample* (<em>const tSampleIndex</em>): Index of the sample in the block
+ * * *iPtrThresholds* (<em>const tThresholdInfo*</em>): The thresholds, per channel
+ * Return::
+ * * _int_: 1 if all the channels are within thresholds, 0 otherwise
+ */
+static inline int fftutils_isSampleWithinThresholds(
+  const tSampleBlock* iPtrBlock,
+  const tSampleIndex iIdxBlockSample,
+  const tThresholdInfo* iPtrThresholds) {
+  int lIdxChannel;
+  tSampleValue lValue;
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lValue = iPtrBlock->values[lIdxChannel][iIdxBlockSample];
+    if ((lValue < iPtrThresholds[lIdxChannel].min) ||
+        (lValue > iPtrThresholds[lIdxChannel].max)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Process a block read from an input buffer for the searchFFTSample function, finding the first sample beyond thresholds.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tSampleBeyondThresholdsStruct*</em>.
+ * Return::
+ * * _int_: The return code:
+ * ** 0: Continue iteration
+ * ** 1: Break all iterations
+ */
+static int fftutils_processBlock_SampleBeyondThresholds(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
+  // Interpret parameters
+  tSampleBeyondThresholdsStruct* lPtrVariables = (tSampleBeyondThresholdsStruct*)iPtrArgs;
+
+  tSampleIndex lIdxBlockSample;
+  for (lIdxBlockSample = 0; lIdxBlockSample < iPtrBlock->nbrSamples; ++lIdxBlockSample) {
+    if (!fftutils_isSampleWithinThresholds(iPtrBlock, lIdxBlockSample, lPtrVariables->thresholds)) {
+      lPtrVariables->idxSampleOut = iPtrBlock->idxFirstSample + lIdxBlockSample;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Process a block read from an input buffer for the searchFFTSample function, finding the last sample beyond thresholds.
+ * Do it in backwards search: the block's samples are parsed from the last one to the first one.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tSampleBeyondThresholdsStruct*</em>.
+ * Return::
+ * * _int_: The return code:
+ * ** 0: Continue iteration
+ * ** 1: Break all iterations
+ */
+static int fftutils_processBlock_Reverse_SampleBeyondThresholds(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
+  // Interpret parameters
+  tSampleBeyondThresholdsStruct* lPtrVariables = (tSampleBeyondThresholdsStruct*)iPtrArgs;
 
-  // Clean memory
-  mpf_clear(lDist2);
-  mpf_clear(lDist);
-  mpf_clear(lMaxDist);
-  mpf_clear(iScale);
+  tSampleIndex lIdxBlockSample;
+  for (lIdxBlockSample = iPtrBlock->nbrSamples - 1; lIdxBlockSample >= 0; --lIdxBlockSample) {
+    if (!fftutils_isSampleWithinThresholds(iPtrBlock, lIdxBlockSample, lPtrVariables->thresholds)) {
+      lPtrVariables->idxSampleOut = iPtrBlock->idxFirstSample + lIdxBlockSample;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Mark an FFT search.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrFFTSearch* (<em>void*</em>): The FFT search (in fact a <em>tFFTSearch*</em>)
+ */
+static void fftutils_markFFTSearch(void* iPtrFFTSearch) {
+  rb_gc_mark(((tFFTSearch*)iPtrFFTSearch)->valReferenceProfile);
+  rb_gc_mark(((tFFTSearch*)iPtrFFTSearch)->valTrigoCache);
+}
+
+/**
+ * Free an FFT search.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrFFTSearch* (<em>void*</em>): The FFT search to free (in fact a <em>tFFTSearch*</em>)
+ */
+static void fftutils_freeFFTSearch(void* iPtrFFTSearch) {
+  tFFTSearch* lPtrFFTSearch = (tFFTSearch*)iPtrFFTSearch;
+
+  if (lPtrFFTSearch->slidingFFT == NULL) {
+    free(lPtrFFTSearch->sumCos);
+  } else {
+    fftutils_freeSlidingFFT(lPtrFFTSearch->slidingFFT);
+  }
+  free(lPtrFFTSearch->windowProfile.values);
+  free(lPtrFFTSearch->history);
+  free(lPtrFFTSearch->thresholds);
+  free(lPtrFFTSearch);
+}
+
+/**
+ * Initialize the search of the next sample that has an FFT sample similar to a reference FFT profile.
+ * FFT samples are consecutive, or overlap if the hop is smaller than the number of samples of an FFT sample: their FFT is then computed by sliding the previous one.
+ * The search is then run by searchFFTSample.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValW* (_Object_): Container of the W coefficients (initialized using createWi)
+ * * *iValTrigoCache* (_Object_): Container of the trigo cache of the W coefficients (initialized using initTrigoCache). It gives their number of frequencies, and computes FFT samples that don't overlap: it then needs at least iValNbrSamplesFFT samples.
+ * * *iValReferenceProfile* (_Object_): The reference FFT profile, initialized by createCFFTProfile. It must have the frequencies of the trigo cache and iValNbrChannels channels.
+ * * *iValNbrBitsPerSample* (_Integer_): The number of bits per sample
+ * * *iValNbrChannels* (_Integer_): The number of channels
+ * * *iValThresholds* (<em>list< [Integer,Integer] ></em>): The thresholds that should contain the signal, per channel
+ * * *iValIdxFirstSample* (_Integer_): First sample we are trying from
+ * * *iValIdxLastPossibleSample* (_Integer_): Index of the sample marking the limit of the search
+ * * *iValBackwards* (_Boolean_): Do we search backwards ?
+ * * *iValNbrSamplesFFT* (_Integer_): Number of samples needed to have a valid FFT
+ * * *iValNbrSamplesHop* (_Integer_): Number of samples between 2 consecutive FFT samples, at most iValNbrSamplesFFT
+ * * *iValNbrHistory* (_Integer_): Number of FFT samples needed to detect a constant Moving Average
+ * * *iValSumMaxFFTDistance* (_Integer_): Maximal sum of the Moving Average distances to consider a sample found
+ * * *iValMaxHistoryFFTDistance* (_Integer_): Maximal distance of the Moving Average to consider a sample found
+ * * *iValScale* (_Integer_): The scale used to compute distances
+ * Return::
+ * * _Object_: Container of the FFT search
+ */
+static VALUE fftutils_initFFTSearch(
+  VALUE iSelf,
+  VALUE iValW,
+  VALUE iValTrigoCache,
+  VALUE iValReferenceProfile,
+  VALUE iValNbrBitsPerSample,
+  VALUE iValNbrChannels,
+  VALUE iValThresholds,
+  VALUE iValIdxFirstSample,
+  VALUE iValIdxLastPossibleSample,
+  VALUE iValBackwards,
+  VALUE iValNbrSamplesFFT,
+  VALUE iValNbrSamplesHop,
+  VALUE iValNbrHistory,
+  VALUE iValSumMaxFFTDistance,
+  VALUE iValMaxHistoryFFTDistance,
+  VALUE iValScale) {
+  // Translate parameters in C types
+  tSampleIndex iNbrSamplesFFT = NUM2LL(iValNbrSamplesFFT);
+  tSampleIndex iNbrSamplesHop = NUM2LL(iValNbrSamplesHop);
+  int iNbrChannels = FIX2INT(iValNbrChannels);
+  int iNbrHistory = FIX2INT(iValNbrHistory);
+  tFFTProfile* lPtrReferenceProfile;
+  Data_Get_Struct(iValReferenceProfile, tFFTProfile, lPtrReferenceProfile);
+  if ((iNbrSamplesHop <= 0) ||
+      (iNbrSamplesHop > iNbrSamplesFFT)) {
+    rb_raise(rb_eRuntimeError, "Hop of %lld samples should be between 1 and %lld samples", iNbrSamplesHop, iNbrSamplesFFT);
+  }
+  if (iNbrHistory <= 0) {
+    rb_raise(rb_eRuntimeError, "At least 1 FFT sample is needed in the history, %d given", iNbrHistory);
+  }
+  if (NIL_P(iValTrigoCache)) {
+    rb_raise(rb_eRuntimeError, "The FFT search needs the trigo cache of the W coefficients");
+  }
+  tTrigoCache* lPtrTrigoCache;
+  Data_Get_Struct(iValTrigoCache, tTrigoCache, lPtrTrigoCache);
+  // Samples are compared with the reference profile for each frequency of the W coefficients and each channel
+  fftutils_checkFFTProfileDimensions(lPtrReferenceProfile, lPtrTrigoCache->nbrFreq, iNbrChannels);
+  if ((!RB_TYPE_P(iValThresholds, T_ARRAY)) ||
+      (RARRAY_LEN(iValThresholds) != iNbrChannels)) {
+    rb_raise(rb_eRuntimeError, "Thresholds should be given for each of the %d channels", iNbrChannels);
+  }
+  // Get the lW array or the trigo cache, depending on the way FFT samples are computed
+  double* lW = NULL;
+  if (iNbrSamplesHop < iNbrSamplesFFT) {
+    Data_Get_Struct(iValW, double, lW);
+    lPtrTrigoCache = NULL;
+  } else if (lPtrTrigoCache->nbrSamples < iNbrSamplesFFT) {
+    rb_raise(rb_eRuntimeError, "FFT samples of %lld samples exceed the trigo cache of %lld samples", iNbrSamplesFFT, lPtrTrigoCache->nbrSamples);
+  }
+
+  tFFTSearch* lPtrFFTSearch = ALLOC(tFFTSearch);
+  lPtrFFTSearch->valReferenceProfile = iValReferenceProfile;
+  lPtrFFTSearch->valTrigoCache = iValTrigoCache;
+  lPtrFFTSearch->referenceProfile = lPtrReferenceProfile;
+  lPtrFFTSearch->trigoCache = lPtrTrigoCache;
+  lPtrFFTSearch->nbrFreq = lPtrReferenceProfile->nbrFreq;
+  lPtrFFTSearch->nbrChannels = iNbrChannels;
+  lPtrFFTSearch->nbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
+  // Decode the thresholds
+  lPtrFFTSearch->thresholds = ALLOC_N(tThresholdInfo, iNbrChannels);
+  VALUE lTmpThresholds;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lTmpThresholds = rb_ary_entry(iValThresholds, lIdxChannel);
+    lPtrFFTSearch->thresholds[lIdxChannel].min = FIX2INT(rb_ary_entry(lTmpThresholds, 0));
+    lPtrFFTSearch->thresholds[lIdxChannel].max = FIX2INT(rb_ary_entry(lTmpThresholds, 1));
+  }
+  lPtrFFTSearch->idxLastPossibleSample = NUM2LL(iValIdxLastPossibleSample);
+  lPtrFFTSearch->backwards = (iValBackwards == Qtrue) ? 1 : 0;
+  lPtrFFTSearch->nbrSamplesFFTMax = iNbrSamplesFFT;
+  lPtrFFTSearch->nbrSamplesHop = iNbrSamplesHop;
+  lPtrFFTSearch->scale = NUM2DBL(iValScale);
+  // Initialize the history
+  lPtrFFTSearch->nbrHistory = iNbrHistory;
+  lPtrFFTSearch->nbrHopsPerFFTSample = (int)round(((double)iNbrSamplesFFT)/((double)iNbrSamplesHop));
+  lPtrFFTSearch->historySize = iNbrHistory*lPtrFFTSearch->nbrHopsPerFFTSample;
+  lPtrFFTSearch->history = ALLOC_N(tFFTValue, lPtrFFTSearch->historySize);
+  lPtrFFTSearch->nbrHistoryValues = 0;
+  lPtrFFTSearch->idxOldestHistory = 0;
+  lPtrFFTSearch->sumMaxFFTDistance = NUM2LL(iValSumMaxFFTDistance);
+  lPtrFFTSearch->maxHistoryFFTDistance = NUM2LL(iValMaxHistoryFFTDistance);
+  // Initialize the state of the search
+  lPtrFFTSearch->idxCurrentSample = NUM2LL(iValIdxFirstSample);
+  lPtrFFTSearch->idxLastCheckedSample = -1;
+  lPtrFFTSearch->idxBeginSlidingSample = -1;
+  lPtrFFTSearch->idxEndSlidingSample = -1;
+  lPtrFFTSearch->nbrSlidSamples = 0;
+  // Initialize the FFT computations
+  if (lW != NULL) {
+    lPtrFFTSearch->slidingFFT = fftutils_allocSlidingFFT(lW, lPtrFFTSearch->nbrFreq, iNbrChannels, lPtrFFTSearch->nbrBitsPerSample);
+    lPtrFFTSearch->sumCos = NULL;
+    lPtrFFTSearch->sumSin = NULL;
+  } else {
+    lPtrFFTSearch->slidingFFT = NULL;
+    lPtrFFTSearch->sumCos = ALLOC_N(tFFTValue, 2*lPtrFFTSearch->nbrFreq*iNbrChannels);
+    lPtrFFTSearch->sumSin = lPtrFFTSearch->sumCos + lPtrFFTSearch->nbrFreq*iNbrChannels;
+  }
+  fftutils_initFFTProfile(&lPtrFFTSearch->windowProfile, lPtrFFTSearch->nbrFreq, iNbrChannels);
+
+  // Encapsulate it in a Ruby object
+  return Data_Wrap_Struct(rb_cObject, fftutils_markFFTSearch, fftutils_freeFFTSearch, lPtrFFTSearch);
+}
+
+/**
+ * Get the first sample beyond the thresholds of an FFT search among some samples.
+ * Samples are checked in the direction of the search.
+ *
+ * Parameters::
+ * * *iPtrFFTSearch* (<em>const tFFTSearch*</em>): The FFT search
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer of the samples
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the raw buffer
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): Number of samples to check
+ * Return::
+ * * <em>tSampleIndex</em>: Index of the first sample beyond thresholds, or -1 if none
+ */
+static tSampleIndex fftutils_getSampleBeyondThresholds(
+  const tFFTSearch* iPtrFFTSearch,
+  const char* iPtrRawBuffer,
+  const tSampleIndex iIdxFirstSample,
+  const tSampleIndex iNbrSamples) {
+  tSampleBeyondThresholdsStruct lProcessVariables;
+  lProcessVariables.thresholds = iPtrFFTSearch->thresholds;
+  lProcessVariables.idxSampleOut = -1;
+
+  if (iNbrSamples > 0) {
+    if (iPtrFFTSearch->backwards == 1) {
+      commonutils_iterateReverseBlocksThroughRawBuffer(
+        iPtrRawBuffer,
+        iPtrFFTSearch->nbrBitsPerSample,
+        iPtrFFTSearch->nbrChannels,
+        iNbrSamples,
+        iIdxFirstSample+iNbrSamples-1,
+        &fftutils_processBlock_Reverse_SampleBeyondThresholds,
+        &lProcessVariables
+      );
+    } else {
+      commonutils_iterateBlocksThroughRawBuffer(
+        iPtrRawBuffer,
+        iPtrFFTSearch->nbrBitsPerSample,
+        iPtrFFTSearch->nbrChannels,
+        iNbrSamples,
+        iIdxFirstSample,
+        &fftutils_processBlock_SampleBeyondThresholds,
+        &lProcessVariables,
+        NULL
+      );
+    }
+  }
+
+  return lProcessVariables.idxSampleOut;
+}
+
+/**
+ * Compute the distance between the reference FFT profile of an FFT search and an FFT sample that does not overlap the previous one.
+ * It gives the same distance as distFFTProfiles with the FFT profile of the FFT sample, computed with the trigo cache.
+ *
+ * Parameters::
+ * * *ioPtrFFTSearch* (<em>tFFTSearch*</em>): The FFT search
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer of the FFT sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): Number of samples of the FFT sample
+ * Return::
+ * * _tFFTValue_: The distance (FFT sample's profile - Reference profile), on the scale of the search
+ */
+static tFFTValue fftutils_computeFFTSearchDistance(
+  tFFTSearch* ioPtrFFTSearch,
+  const char* iPtrRawBuffer,
+  const tSampleIndex iNbrSamples) {
+  // Compute the cos and sin sums
+  memset(ioPtrFFTSearch->sumCos, 0, 2*ioPtrFFTSearch->nbrFreq*ioPtrFFTSearch->nbrChannels*sizeof(tFFTValue));
+  tCompleteSumCosSinStruct lProcessVariables;
+  lProcessVariables.nbrFreq = ioPtrFFTSearch->nbrFreq;
+  lProcessVariables.w = NULL;
+  lProcessVariables.sumCos = ioPtrFFTSearch->sumCos;
+  lProcessVariables.sumSin = ioPtrFFTSearch->sumSin;
+  lProcessVariables.nbrChannels = ioPtrFFTSearch->nbrChannels;
+  lProcessVariables.trigoCache = ioPtrFFTSearch->trigoCache;
+  fftutils_completeSumCosSinWithCache(iPtrRawBuffer, ioPtrFFTSearch->nbrBitsPerSample, iNbrSamples, 0, &lProcessVariables);
+  // Fill the FFT profile of the FFT sample, and compare it
+  fftutils_fillFFTProfile(&ioPtrFFTSearch->windowProfile, ioPtrFFTSearch->sumCos, ioPtrFFTSearch->sumSin, ioPtrFFTSearch->nbrBitsPerSample, iNbrSamples);
+
+  return (tFFTValue)(fftutils_computeFFTProfilesDistance(ioPtrFFTSearch->referenceProfile, &ioPtrFFTSearch->windowProfile)*ioPtrFFTSearch->scale);
+}
+
+/**
+ * Run the search of the next sample that has an FFT sample similar to a reference FFT profile.
+ * The raw buffer is a window of the input data: every FFT sample it contains is checked against the thresholds, then compared with the reference profile, until the sample is found, or the search needs samples that are not in the window.
+ * This is called again with windows starting at the needed sample until the search is over.
+ *
+ * Parameters::
+ * * *iSelf* (_FFTUtils_): Self
+ * * *iValFFTSearch* (_Object_): Container of the FFT search (initialized with initFFTSearch)
+ * * *iValInputRawBuffer* (_String_): The raw window
+ * * *iValIdxFirstBufferSample* (_Integer_): Index of the first sample of the raw window
+ * Return::
+ * * _Integer_: Meaning of the given sample:
+ *   * *-1*: The search needs samples beyond the window: the returned sample is the first needed one (the last one for backwards searches)
+ *   * *0*: The sample has been found correctly and returned
+ *   * *1*: The sample could not be found because thresholds were hit: the first sample hitting the thresholds is returned
+ *   * *2*: The sample could not be found because the limit of search was hit before. The returned sample can be ignored.
+ * * _Integer_: Index of the sample (can be 1 after the end)
+ */
+static VALUE fftutils_searchFFTSample(
+  VALUE iSelf,
+  VALUE iValFFTSearch,
+  VALUE iValInputRawBuffer,
+  VALUE iValIdxFirstBufferSample) {
+  tFFTSearch* lPtrFFTSearch;
+  Data_Get_Struct(iValFFTSearch, tFFTSearch, lPtrFFTSearch);
+  const char* lPtrRawBuffer = RSTRING_PTR(iValInputRawBuffer);
+  tSampleIndex iIdxFirstBufferSample = NUM2LL(iValIdxFirstBufferSample);
+  int lSampleSize = (lPtrFFTSearch->nbrChannels*lPtrFFTSearch->nbrBitsPerSample)/8;
+  tSampleIndex lIdxLastBufferSample = iIdxFirstBufferSample + RSTRING_LEN(iValInputRawBuffer)/lSampleSize - 1;
+  tSampleIndex lIdxLastPossibleSample = lPtrFFTSearch->idxLastPossibleSample;
+
+  int rResultCode = -1;
+  tSampleIndex rIdxSample = -1;
+  tSampleIndex lIdxBeginFFTSample;
+  tSampleIndex lIdxEndFFTSample;
+  tSampleIndex lNbrSamplesFFT;
+  tSampleIndex lIdxFirstNeededSample;
+  tSampleIndex lIdxLastNeededSample;
+  tSampleIndex lIdxBeginCheckSample;
+  tSampleIndex lIdxEndCheckSample;
+  tSampleIndex lIdxSampleOut;
+  tSampleIndex lIdxHistory;
+  tFFTValue lDist;
+  tFFTValue lSumHistory;
+  tFFTValue lHistoryMaxDistance;
+  int lSlide;
+  int lIdxAverage;
+  tSlidingFFTStruct lSlidingVariables;
+  lSlidingVariables.slidingFFT = lPtrFFTSearch->slidingFFT;
+  lSlidingVariables.backwards = lPtrFFTSearch->backwards;
+  while (rResultCode == -1) {
+    if (((lPtrFFTSearch->backwards == 1) && (lPtrFFTSearch->idxCurrentSample < lIdxLastPossibleSample)) ||
+        ((lPtrFFTSearch->backwards == 0) && (lPtrFFTSearch->idxCurrentSample > lIdxLastPossibleSample))) {
+      // Check if the limit was hit
+      rResultCode = (lPtrFFTSearch->idxCurrentSample == ((lPtrFFTSearch->backwards == 1) ? lIdxLastPossibleSample-1 : lIdxLastPossibleSample+1)) ? 2 : 0;
+      rIdxSample = lPtrFFTSearch->idxCurrentSample;
+      break;
+    }
+    // Compute the samples of the FFT sample.
+    // Modify this number if it exceeds the range we have
+    if (lPtrFFTSearch->backwards == 1) {
+      lIdxBeginFFTSample = lPtrFFTSearch->idxCurrentSample-lPtrFFTSearch->nbrSamplesFFTMax+1;
+      lIdxEndFFTSample = lPtrFFTSearch->idxCurrentSample;
+      if (lIdxBeginFFTSample <= lIdxLastPossibleSample-1) {
+        lIdxBeginFFTSample = lIdxLastPossibleSample;
+      }
+    } else {
+      lIdxBeginFFTSample = lPtrFFTSearch->idxCurrentSample;
+      lIdxEndFFTSample = lPtrFFTSearch->idxCurrentSample+lPtrFFTSearch->nbrSamplesFFTMax-1;
+      if (lIdxEndFFTSample >= lIdxLastPossibleSample+1) {
+        lIdxEndFFTSample = lIdxLastPossibleSample;
+      }
+    }
+    lNbrSamplesFFT = lIdxEndFFTSample-lIdxBeginFFTSample+1;
+    // Can the sliding FFT slide to this FFT sample ?
+    lSlide = ((lPtrFFTSearch->slidingFFT != NULL) &&
+              (lPtrFFTSearch->idxBeginSlidingSample != -1) &&
+              (lNbrSamplesFFT == lPtrFFTSearch->nbrSamplesFFTMax) &&
+              (lPtrFFTSearch->idxEndSlidingSample-lPtrFFTSearch->idxBeginSlidingSample+1 == lPtrFFTSearch->nbrSamplesFFTMax) &&
+              (llabs(lIdxBeginFFTSample-lPtrFFTSearch->idxBeginSlidingSample) == lPtrFFTSearch->nbrSamplesHop) &&
+              (lPtrFFTSearch->nbrSlidSamples < lPtrFFTSearch->nbrSamplesFFTMax*FFTUTILS_SLIDING_RESET_FFTSAMPLES));
+    // Samples needed: when sliding, they also contain the previous FFT sample.
+    lIdxFirstNeededSample = lIdxBeginFFTSample;
+    lIdxLastNeededSample = lIdxEndFFTSample;
+    if (lSlide) {
+      lIdxFirstNeededSample = (lPtrFFTSearch->idxBeginSlidingSample < lIdxBeginFFTSample) ? lPtrFFTSearch->idxBeginSlidingSample : lIdxBeginFFTSample;
+      lIdxLastNeededSample = (lPtrFFTSearch->idxEndSlidingSample > lIdxEndFFTSample) ? lPtrFFTSearch->idxEndSlidingSample : lIdxEndFFTSample;
+    }
+    if ((lIdxFirstNeededSample < iIdxFirstBufferSample) ||
+        (lIdxLastNeededSample > lIdxLastBufferSample)) {
+      // The window does not contain the needed samples: they will be given by the next call
+      rIdxSample = (lPtrFFTSearch->backwards == 1) ? lIdxLastNeededSample : lIdxFirstNeededSample;
+      break;
+    }
+    // First, check that we are still in the thresholds.
+    // Samples already checked with previous FFT samples are skipped.
+    lIdxBeginCheckSample = lIdxBeginFFTSample;
+    lIdxEndCheckSample = lIdxEndFFTSample;
+    if (lPtrFFTSearch->idxLastCheckedSample != -1) {
+      if ((lPtrFFTSearch->backwards == 1) &&
+          (lIdxEndCheckSample > lPtrFFTSearch->idxLastCheckedSample-1)) {
+        lIdxEndCheckSample = lPtrFFTSearch->idxLastCheckedSample-1;
+      } else if ((lPtrFFTSearch->backwards == 0) &&
+                 (lIdxBeginCheckSample < lPtrFFTSearch->idxLastCheckedSample+1)) {
+        lIdxBeginCheckSample = lPtrFFTSearch->idxLastCheckedSample+1;
+      }
+    }
+    lIdxSampleOut = fftutils_getSampleBeyondThresholds(lPtrFFTSearch, lPtrRawBuffer + (lIdxBeginCheckSample-iIdxFirstBufferSample)*lSampleSize, lIdxBeginCheckSample, lIdxEndCheckSample-lIdxBeginCheckSample+1);
+    if (lIdxSampleOut != -1) {
+      // Cancel this FFT search: the signal is out of the thresholds
+      lPtrFFTSearch->idxCurrentSample = lIdxSampleOut;
+      rResultCode = 1;
+      rIdxSample = lIdxSampleOut;
+    } else {
+      lPtrFFTSearch->idxLastCheckedSample = (lPtrFFTSearch->backwards == 1) ? lIdxBeginFFTSample : lIdxEndFFTSample;
+      // Compute the distance of its FFT profile
+      if (lPtrFFTSearch->slidingFFT != NULL) {
+        lSlidingVariables.rawBuffer = lPtrRawBuffer + (lIdxFirstNeededSample-iIdxFirstBufferSample)*lSampleSize;
+        if (lSlide) {
+          lSlidingVariables.nbrSamples = lPtrFFTSearch->nbrSamplesHop;
+          commonutils_callWithoutGVL(&fftutils_slideSlidingFFT_WithoutGVL, &lSlidingVariables);
+          lPtrFFTSearch->nbrSlidSamples += lPtrFFTSearch->nbrSamplesHop;
+        } else {
+          lSlidingVariables.nbrSamples = lNbrSamplesFFT;
+          commonutils_callWithoutGVL(&fftutils_resetSlidingFFT_WithoutGVL, &lSlidingVariables);
+          lPtrFFTSearch->nbrSlidSamples = 0;
+        }
+        lPtrFFTSearch->idxBeginSlidingSample = lIdxBeginFFTSample;
+        lPtrFFTSearch->idxEndSlidingSample = lIdxEndFFTSample;
+        fftutils_fillSlidingFFTProfile(&lPtrFFTSearch->windowProfile, lPtrFFTSearch->slidingFFT);
+        lDist = (tFFTValue)(fftutils_computeFFTProfilesDistance(lPtrFFTSearch->referenceProfile, &lPtrFFTSearch->windowProfile)*lPtrFFTSearch->scale);
+      } else {
+        lDist = fftutils_computeFFTSearchDistance(lPtrFFTSearch, lPtrRawBuffer + (lIdxBeginFFTSample-iIdxFirstBufferSample)*lSampleSize, lNbrSamplesFFT);
+      }
+      // Detect if the Moving Average is going up and is below the maximal distance
+      if (lPtrFFTSearch->nbrHistoryValues == lPtrFFTSearch->historySize) {
+        // The Moving Average uses the history values that don't overlap
+        lSumHistory = 0;
+        lHistoryMaxDistance = 0;
+        for (lIdxAverage = 0; lIdxAverage < lPtrFFTSearch->nbrHistory; ++lIdxAverage) {
+          lIdxHistory = (lPtrFFTSearch->idxOldestHistory+lIdxAverage*lPtrFFTSearch->nbrHopsPerFFTSample) % lPtrFFTSearch->historySize;
+          lSumHistory += lPtrFFTSearch->history[lIdxHistory];
+          if (lPtrFFTSearch->history[lIdxHistory] > lHistoryMaxDistance) {
+            lHistoryMaxDistance = lPtrFFTSearch->history[lIdxHistory];
+          }
+        }
+        if ((lSumHistory < lPtrFFTSearch->sumMaxFFTDistance) &&
+            (lHistoryMaxDistance < lPtrFFTSearch->maxHistoryFFTDistance) &&
+            (lPtrFFTSearch->history[lPtrFFTSearch->idxOldestHistory] < lDist)) {
+          // We got it
+          rResultCode = 0;
+          rIdxSample = lPtrFFTSearch->idxCurrentSample;
+        }
+      }
+      if (rResultCode == -1) {
+        // Check next FFT sample
+        if (lPtrFFTSearch->backwards == 1) {
+          lPtrFFTSearch->idxCurrentSample = (lIdxBeginFFTSample == lIdxLastPossibleSample) ? lIdxBeginFFTSample - 1 : lIdxEndFFTSample - lPtrFFTSearch->nbrSamplesHop;
+        } else {
+          lPtrFFTSearch->idxCurrentSample = (lIdxEndFFTSample == lIdxLastPossibleSample) ? lIdxEndFFTSample + 1 : lIdxBeginFFTSample + lPtrFFTSearch->nbrSamplesHop;
+        }
+        // Update the history with the new distance
+        lPtrFFTSearch->history[lPtrFFTSearch->idxOldestHistory] = lDist;
+        ++lPtrFFTSearch->idxOldestHistory;
+        if (lPtrFFTSearch->idxOldestHistory == lPtrFFTSearch->historySize) {
+          lPtrFFTSearch->idxOldestHistory = 0;
+        }
+        if (lPtrFFTSearch->nbrHistoryValues < lPtrFFTSearch->historySize) {
+          ++lPtrFFTSearch->nbrHistoryValues;
+        }
+      }
+    }
+  }
 
-  return rValDistance;
+  return rb_ary_new3(2, INT2FIX(rResultCode), LL2NUM(rIdxSample));
 }
 
 // Initialize the module
@@ -658,5 +2154,13 @@ void Init_FFTUtils() {
   rb_define_method(lFFTUtilsClass, "initTrigoCache", fftutils_initTrigoCache, 3);
   rb_define_method(lFFTUtilsClass, "computeFFT", fftutils_computeFFT, 4);
   rb_define_method(lFFTUtilsClass, "createCFFTProfile", fftutils_createCFFTProfile, 1);
+  rb_define_method(lFFTUtilsClass, "computeCFFTProfile", fftutils_computeCFFTProfile, 6);
   rb_define_method(lFFTUtilsClass, "distFFTProfiles", fftutils_distFFTProfiles, 3);
+  rb_define_method(lFFTUtilsClass, "initSlidingFFT", fftutils_initSlidingFFT, 4);
+  rb_define_method(lFFTUtilsClass, "resetSlidingFFT", fftutils_resetSlidingFFT, 3);
+  rb_define_method(lFFTUtilsClass, "slideSlidingFFT", fftutils_slideSlidingFFT, 4);
+  rb_define_method(lFFTUtilsClass, "getSlidingFFTProfile", fftutils_getSlidingFFTProfile, 1);
+  rb_define_method(lFFTUtilsClass, "distSlidingFFTProfile", fftutils_distSlidingFFTProfile, 3);
+  rb_define_method(lFFTUtilsClass, "initFFTSearch", fftutils_initFFTSearch, 15);
+  rb_define_method(lFFTUtilsClass, "searchFFTSample", fftutils_searchFFTSample, 3);
 }
@@ -148,8 +148,8 @@ static VALUE functionutils_createCFunction(
   VALUE iValFunction,
   VALUE iValIdxBeginSample,
   VALUE iValIdxEndSample) {
-  tSampleIndex iIdxBeginSample = FIX2LONG(iValIdxBeginSample);
-  tSampleIndex iIdxEndSample = FIX2LONG(iValIdxEndSample);
+  tSampleIndex iIdxBeginSample = NUM2LL(iValIdxBeginSample);
+  tSampleIndex iIdxEndSample = NUM2LL(iValIdxEndSample);
 
   tFunction* lPtrCFunction = ALLOC(tFunction);
   // Retrieve the function type
@@ -7,7 +7,7 @@ require "#{File.dirname(__FILE__)}/../CommonBuild"
 # TODO (Cygwin): Adding -L/usr/local/lib is due to some Cygwin installs that do not include it with gcc
 $LDFLAGS += ' -L/usr/local/lib '
 begin
-  have_library('gmp')
+  require_gmp
 rescue Exception
   puts "\n\n!!! Missing library gmp in this system. Please install it from http://gmplib.org/\n\n"
   raise
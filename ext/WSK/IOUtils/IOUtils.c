@@ -0,0 +1,767 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#include "ruby.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <CommonUtils.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+// Access advices given on files and mapped files
+#define IOUTILS_ADVICE_NORMAL 0
+#define IOUTILS_ADVICE_SEQUENTIAL 1
+#define IOUTILS_ADVICE_RANDOM 2
+#define IOUTILS_ADVICE_WILLNEED 3
+#define IOUTILS_ADVICE_DONTNEED 4
+
+// Files opened with O_DIRECT are read with memory, offsets and sizes aligned on this size
+#define IOUTILS_DIRECT_ALIGNMENT 4096
+#if defined(HAVE_POSIX_MEMALIGN) && defined(HAVE_PREAD)
+#define IOUTILS_DIRECT_READ
+#endif
+
+// System calls copying data between files without passing it through user space, tried in this order
+#define IOUTILS_COPY_COPY_FILE_RANGE 0
+#define IOUTILS_COPY_SENDFILE 1
+#define IOUTILS_COPY_SPLICE 2
+#define IOUTILS_COPY_NONE 3
+
+// Struct used to copy a file range without the GVL
+typedef struct {
+  int inFileNo;
+  off_t inOffset;
+  int outFileNo;
+  tSampleIndex size;
+  // Number of bytes copied
+  tSampleIndex nbrBytesCopied;
+} tCopyFileRangeStruct;
+
+// Memory aligned to read files opened with O_DIRECT, grown when needed
+typedef struct {
+  char* data;
+  size_t size;
+} tAlignedBuffer;
+
+// Struct used to read a file opened with O_DIRECT without the GVL
+typedef struct {
+  int fileNo;
+  tAlignedBuffer* ptrAlignedBuffer;
+  // Region read, aligned
+  tSampleIndex alignedOffset;
+  size_t alignedSize;
+  // Data requested in this region
+  tSampleIndex offset;
+  tSampleIndex size;
+  char* ptrOutput;
+  // Number of bytes copied in the output
+  tSampleIndex nbrBytesRead;
+  // errno of the failed read, or 0
+  int error;
+} tReadFileDirectStruct;
+
+// Struct used to write a file range to the disk without the GVL
+typedef struct {
+  int fileNo;
+  tSampleIndex offset;
+  tSampleIndex size;
+  // Do we wait for the data to be written ?
+  int wait;
+  // errno of the failed call, or 0
+  int error;
+} tSyncFileRangeStruct;
+
+// ID of the hidden instance variable referencing the mapped file from its views
+static ID gID_mappedFile;
+
+/**
+ * Free a mapped file.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrMappedFile* (<em>void*</em>): The mapped file to free (in fact a <em>tMappedFile*</em>)
+ */
+static void ioutils_freeMappedFile(void* iPtrMappedFile) {
+  tMappedFile* lPtrMappedFile = (tMappedFile*)iPtrMappedFile;
+
+#ifdef HAVE_SYS_MMAN_H
+  // The mapping may have been released already (see unmapFile)
+  if (lPtrMappedFile->mapAddress != NULL) {
+    munmap(lPtrMappedFile->mapAddress, lPtrMappedFile->mapSize);
+  }
+#endif
+  free(lPtrMappedFile);
+}
+
+/**
+ * Map a region of a file in memory.
+ * The region is unmapped when the returned container is garbage collected.
+ *
+ * Parameters::
+ * * *iValFileNo* (_Integer_): File descriptor of the file to map
+ * * *iValOffset* (_Integer_): Offset of the region in the file
+ * * *iValSize* (_Integer_): Size of the region. It must not exceed the file.
+ * * *iWritable* (<em>const int</em>): Is the mapping writable ? Writes are then shared with the file.
+ * Return::
+ * * _Object_: Container of the mapped file
+ */
+static VALUE ioutils_mapRegion(
+  VALUE iValFileNo,
+  VALUE iValOffset,
+  VALUE iValSize,
+  const int iWritable) {
+#ifdef HAVE_SYS_MMAN_H
+  int lFileNo = FIX2INT(iValFileNo);
+  tSampleIndex lOffset = NUM2LL(iValOffset);
+  tSampleIndex lSize = NUM2LL(iValSize);
+
+  if ((lOffset < 0) ||
+      (lSize <= 0)) {
+    rb_raise(rb_eRuntimeError, "Invalid region to map: %lld bytes at offset %lld", lSize, lOffset);
+  }
+  // mmap needs an offset aligned on pages
+  tSampleIndex lPageSize = sysconf(_SC_PAGESIZE);
+  tSampleIndex lMapOffset = lOffset - (lOffset % lPageSize);
+  size_t lMapSize = (size_t)(lOffset - lMapOffset + lSize);
+  void* lMapAddress = mmap(NULL, lMapSize, (iWritable ? (PROT_READ | PROT_WRITE) : PROT_READ), MAP_SHARED, lFileNo, (off_t)lMapOffset);
+  if (lMapAddress == MAP_FAILED) {
+    rb_raise(rb_eRuntimeError, "Unable to map %lld bytes at offset %lld: %s", lSize, lOffset, strerror(errno));
+  }
+
+  tMappedFile* lPtrMappedFile = ALLOC(tMappedFile);
+  lPtrMappedFile->mapAddress = (char*)lMapAddress;
+  lPtrMappedFile->mapSize = lMapSize;
+  lPtrMappedFile->data = lPtrMappedFile->mapAddress + (lOffset - lMapOffset);
+  lPtrMappedFile->dataSize = lSize;
+  lPtrMappedFile->writable = iWritable;
+
+  return Data_Wrap_Struct(rb_cObject, NULL, ioutils_freeMappedFile, lPtrMappedFile);
+#else
+  rb_raise(rb_eRuntimeError, "Memory mapped files are not supported on this system");
+  return Qnil;
+#endif
+}
+
+/**
+ * Map a region of a file in memory, read-only.
+ * The region is unmapped when the returned container is garbage collected.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValFileNo* (_Integer_): File descriptor of the file to map
+ * * *iValOffset* (_Integer_): Offset of the region in the file
+ * * *iValSize* (_Integer_): Size of the region. It must not exceed the file.
+ * Return::
+ * * _Object_: Container of the mapped file, to be used by other methods and C extensions (see commonutils_getMappedData)
+ */
+static VALUE ioutils_mapFile(
+  VALUE iSelf,
+  VALUE iValFileNo,
+  VALUE iValOffset,
+  VALUE iValSize) {
+  return ioutils_mapRegion(iValFileNo, iValOffset, iValSize, 0);
+}
+
+/**
+ * Map a region of a file in memory, for read and write.
+ * Data written in the mapping is written in the file. The region is unmapped with unmapFile, or when the returned container is garbage collected.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValFileNo* (_Integer_): File descriptor of the file to map. It must be opened for read and write.
+ * * *iValOffset* (_Integer_): Offset of the region in the file
+ * * *iValSize* (_Integer_): Size of the region. It must not exceed the file (see allocateFile).
+ * Return::
+ * * _Object_: Container of the mapped file, to be used by other methods and C extensions as output (see commonutils_getOutputBuffer)
+ */
+static VALUE ioutils_mapFileForWrite(
+  VALUE iSelf,
+  VALUE iValFileNo,
+  VALUE iValOffset,
+  VALUE iValSize) {
+  return ioutils_mapRegion(iValFileNo, iValOffset, iValSize, 1);
+}
+
+/**
+ * Unmap a file mapped for write, without waiting for the container to be garbage collected.
+ * Written data is scheduled for writing to the disk first. The container then maps an empty region.
+ * Read-only mappings can't be unmapped this way, as views on them (see getMappedView) reference their data.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValMappedFile* (_Object_): Container of the mapped file (created with mapFileForWrite)
+ * Return::
+ * * _Object_: nil
+ */
+static VALUE ioutils_unmapFile(
+  VALUE iSelf,
+  VALUE iValMappedFile) {
+  tMappedFile* lPtrMappedFile;
+  Data_Get_Struct(iValMappedFile, tMappedFile, lPtrMappedFile);
+
+  if (!lPtrMappedFile->writable) {
+    rb_raise(rb_eRuntimeError, "Mapped file is read-only: it is unmapped when garbage collected only");
+  }
+#ifdef HAVE_SYS_MMAN_H
+  if (lPtrMappedFile->mapAddress != NULL) {
+    // Forget the mapping before releasing it, so that it is never released twice
+    char* lMapAddress = lPtrMappedFile->mapAddress;
+    size_t lMapSize = lPtrMappedFile->mapSize;
+    lPtrMappedFile->mapAddress = NULL;
+    lPtrMappedFile->mapSize = 0;
+    lPtrMappedFile->data = NULL;
+    lPtrMappedFile->dataSize = 0;
+    int lError = 0;
+    if (msync(lMapAddress, lMapSize, MS_ASYNC) != 0) {
+      lError = errno;
+    }
+    if ((munmap(lMapAddress, lMapSize) != 0) &&
+        (lError == 0)) {
+      lError = errno;
+    }
+    if (lError != 0) {
+      rb_raise(rb_eRuntimeError, "Unable to unmap %lld bytes: %s", (tSampleIndex)lMapSize, strerror(lError));
+    }
+  }
+#endif
+
+  return Qnil;
+}
+
+/**
+ * Allocate the disk space of a region of a file, extending the file if needed.
+ * Allocating space before writing in a mapping avoids failing on a full disk while accessing it.
+ * If the filesystem can't allocate space, the file is just extended.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValFileNo* (_Integer_): File descriptor of the file
+ * * *iValOffset* (_Integer_): Offset of the region in the file
+ * * *iValSize* (_Integer_): Size of the region
+ * Return::
+ * * _Object_: nil
+ */
+static VALUE ioutils_allocateFile(
+  VALUE iSelf,
+  VALUE iValFileNo,
+  VALUE iValOffset,
+  VALUE iValSize) {
+  int lFileNo = FIX2INT(iValFileNo);
+  tSampleIndex lOffset = NUM2LL(iValOffset);
+  tSampleIndex lSize = NUM2LL(iValSize);
+
+  int lError = EOPNOTSUPP;
+#ifdef HAVE_POSIX_FALLOCATE
+  lError = posix_fallocate(lFileNo, (off_t)lOffset, (off_t)lSize);
+#endif
+  if ((lError == EOPNOTSUPP) ||
+      (lError == EINVAL)) {
+    // Extend the file only
+    struct stat lStat;
+    if (fstat(lFileNo, &lStat) != 0) {
+      rb_raise(rb_eRuntimeError, "Unable to get the size of the file to allocate: %s", strerror(errno));
+    }
+    lError = 0;
+    if ((lStat.st_size < lOffset + lSize) &&
+        (ftruncate(lFileNo, (off_t)(lOffset + lSize)) != 0)) {
+      lError = errno;
+    }
+  }
+  if (lError != 0) {
+    rb_raise(rb_eRuntimeError, "Unable to allocate %lld bytes at offset %lld: %s", lSize, lOffset, strerror(lError));
+  }
+
+  return Qnil;
+}
+
+/**
+ * Write data in a file mapped for write.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValMappedFile* (_Object_): Container of the mapped file (created with mapFileForWrite)
+ * * *iValOffset* (_Integer_): Offset of the data in the mapped region
+ * * *iValData* (_String_): The data to write
+ * Return::
+ * * _Object_: nil
+ */
+static VALUE ioutils_writeMappedFile(
+  VALUE iSelf,
+  VALUE iValMappedFile,
+  VALUE iValOffset,
+  VALUE iValData) {
+  VALUE lValDummy;
+  char* lPtrData = commonutils_getOutputBuffer(iValMappedFile, iValOffset, RSTRING_LEN(iValData), &lValDummy);
+  memcpy(lPtrData, RSTRING_PTR(iValData), RSTRING_LEN(iValData));
+
+  return Qnil;
+}
+
+/**
+ * Get a read-only view on data of a mapped file.
+ * When possible, the returned String points directly to the mapping, without copying data.
+ * It keeps the mapping alive as long as it is referenced.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValMappedFile* (_Object_): Container of the mapped file (created with mapFile)
+ * * *iValOffset* (_Integer_): Offset of the data in the mapped region
+ * * *iValSize* (_Integer_): Size of the data
+ * Return::
+ * * _String_: The frozen view
+ */
+static VALUE ioutils_getMappedView(
+  VALUE iSelf,
+  VALUE iValMappedFile,
+  VALUE iValOffset,
+  VALUE iValSize) {
+  tSampleIndex lSize = NUM2LL(iValSize);
+  const char* lPtrData = commonutils_getMappedData(iValMappedFile, NUM2LL(iValOffset), lSize);
+
+#ifdef HAVE_RB_STR_NEW_STATIC
+  VALUE rValView = rb_str_new_static(lPtrData, lSize);
+  rb_ivar_set(rValView, gID_mappedFile, iValMappedFile);
+#else
+  VALUE rValView = rb_str_new(lPtrData, lSize);
+#endif
+  OBJ_FREEZE(rValView);
+
+  return rValView;
+}
+
+/**
+ * Give the system a hint on how a mapped file is going to be accessed.
+ * Errors are ignored, as hints don't change the data.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValMappedFile* (_Object_): Container of the mapped file (created with mapFile)
+ * * *iValAdvice* (_Integer_): The advice (one of ADVICE_* constants)
+ * * *iValOffset* (_Integer_): Offset of the data concerned by the advice in the mapped region
+ * * *iValSize* (_Integer_): Size of the data concerned by the advice
+ * Return::
+ * * _Object_: nil
+ */
+static VALUE ioutils_adviseMappedFile(
+  VALUE iSelf,
+  VALUE iValMappedFile,
+  VALUE iValAdvice,
+  VALUE iValOffset,
+  VALUE iValSize) {
+#ifdef HAVE_SYS_MMAN_H
+  int lAdvice;
+  switch (FIX2INT(iValAdvice)) {
+    case IOUTILS_ADVICE_SEQUENTIAL:
+      lAdvice = MADV_SEQUENTIAL;
+      break;
+    case IOUTILS_ADVICE_RANDOM:
+      lAdvice = MADV_RANDOM;
+      break;
+    case IOUTILS_ADVICE_WILLNEED:
+      lAdvice = MADV_WILLNEED;
+      break;
+    case IOUTILS_ADVICE_DONTNEED:
+      lAdvice = MADV_DONTNEED;
+      break;
+    default:
+      lAdvice = MADV_NORMAL;
+      break;
+  }
+  tSampleIndex lSize = NUM2LL(iValSize);
+  const char* lPtrData = commonutils_getMappedData(iValMappedFile, NUM2LL(iValOffset), lSize);
+  if (lSize > 0) {
+    // madvise needs an address aligned on pages
+    size_t lPageSize = sysconf(_SC_PAGESIZE);
+    char* lPtrAdvised = (char*)(((size_t)lPtrData) - (((size_t)lPtrData) % lPageSize));
+    madvise(lPtrAdvised, (size_t)(lPtrData - lPtrAdvised + lSize), lAdvice);
+  }
+#endif
+
+  return Qnil;
+}
+
+/**
+ * Give the system a hint on how a range of a file is going to be accessed.
+ * ADVICE_DONTNEED drops the range from the page cache, except the data that still has to be written to the disk (see syncFileRange).
+ * Errors are ignored, as hints don't change the data.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValFileNo* (_Integer_): File descriptor of the file
+ * * *iValAdvice* (_Integer_): The advice (one of ADVICE_* constants)
+ * * *iValOffset* (_Integer_): Offset of the range
+ * * *iValSize* (_Integer_): Size of the range
+ * Return::
+ * * _Object_: nil
+ */
+static VALUE ioutils_adviseFile(
+  VALUE iSelf,
+  VALUE iValFileNo,
+  VALUE iValAdvice,
+  VALUE iValOffset,
+  VALUE iValSize) {
+#ifdef HAVE_POSIX_FADVISE
+  int lAdvice;
+  switch (FIX2INT(iValAdvice)) {
+    case IOUTILS_ADVICE_SEQUENTIAL:
+      lAdvice = POSIX_FADV_SEQUENTIAL;
+      break;
+    case IOUTILS_ADVICE_RANDOM:
+      lAdvice = POSIX_FADV_RANDOM;
+      break;
+    case IOUTILS_ADVICE_WILLNEED:
+      lAdvice = POSIX_FADV_WILLNEED;
+      break;
+    case IOUTILS_ADVICE_DONTNEED:
+      lAdvice = POSIX_FADV_DONTNEED;
+      break;
+    default:
+      lAdvice = POSIX_FADV_NORMAL;
+      break;
+  }
+  tSampleIndex lSize = NUM2LL(iValSize);
+  if (lSize > 0) {
+    posix_fadvise(FIX2INT(iValFileNo), (off_t)NUM2LL(iValOffset), (off_t)lSize, lAdvice);
+  }
+#endif
+
+  return Qnil;
+}
+
+/**
+ * Write a range of a file to the disk, without the GVL.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The arguments. In fact a <em>tSyncFileRangeStruct*</em>.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* ioutils_syncFileRange_WithoutGVL(void* iPtrArgs) {
+  tSyncFileRangeStruct* lPtrVariables = (tSyncFileRangeStruct*)iPtrArgs;
+
+  lPtrVariables->error = 0;
+#ifdef HAVE_SYNC_FILE_RANGE
+  if (sync_file_range(lPtrVariables->fileNo, (off_t)lPtrVariables->offset, (off_t)lPtrVariables->size, (lPtrVariables->wait ? (SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) : SYNC_FILE_RANGE_WRITE)) != 0) {
+    lPtrVariables->error = errno;
+  }
+#else
+  // Without sync_file_range, only the whole file can be written, and waited for
+  if ((lPtrVariables->wait) &&
+      (fsync(lPtrVariables->fileNo) != 0)) {
+    lPtrVariables->error = errno;
+  }
+#endif
+
+  return NULL;
+}
+
+/**
+ * Write a range of a file to the disk.
+ * Data written to the disk can then be dropped from the page cache (see adviseFile).
+ * Buffers of the IO object have to be flushed before.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValFileNo* (_Integer_): File descriptor of the file
+ * * *iValOffset* (_Integer_): Offset of the range
+ * * *iValSize* (_Integer_): Size of the range
+ * * *iValWait* (_Boolean_): Do we wait for the range to be written ? If false, writing is just started.
+ * Return::
+ * * _Object_: nil
+ */
+static VALUE ioutils_syncFileRange(
+  VALUE iSelf,
+  VALUE iValFileNo,
+  VALUE iValOffset,
+  VALUE iValSize,
+  VALUE iValWait) {
+  tSyncFileRangeStruct lSyncVariables;
+  lSyncVariables.fileNo = FIX2INT(iValFileNo);
+  lSyncVariables.offset = NUM2LL(iValOffset);
+  lSyncVariables.size = NUM2LL(iValSize);
+  lSyncVariables.wait = RTEST(iValWait);
+
+  if (lSyncVariables.size > 0) {
+    commonutils_callWithoutGVL(&ioutils_syncFileRange_WithoutGVL, &lSyncVariables);
+    if (lSyncVariables.error != 0) {
+      rb_raise(rb_eRuntimeError, "Unable to write %lld bytes at offset %lld to the disk: %s", lSyncVariables.size, lSyncVariables.offset, strerror(lSyncVariables.error));
+    }
+  }
+
+  return Qnil;
+}
+
+/**
+ * Free aligned memory.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrAlignedBuffer* (<em>void*</em>): The aligned memory to free (in fact a <em>tAlignedBuffer*</em>)
+ */
+static void ioutils_freeAlignedBuffer(void* iPtrAlignedBuffer) {
+  tAlignedBuffer* lPtrAlignedBuffer = (tAlignedBuffer*)iPtrAlignedBuffer;
+
+  free(lPtrAlignedBuffer->data);
+  free(lPtrAlignedBuffer);
+}
+
+/**
+ * Create aligned memory, used to read files opened with O_DIRECT (see readFileDirect).
+ * It is allocated by the first read, and freed when the returned container is garbage collected.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * Return::
+ * * _Object_: Container of the aligned memory
+ */
+static VALUE ioutils_createAlignedBuffer(
+  VALUE iSelf) {
+  tAlignedBuffer* lPtrAlignedBuffer = ALLOC(tAlignedBuffer);
+  lPtrAlignedBuffer->data = NULL;
+  lPtrAlignedBuffer->size = 0;
+
+  return Data_Wrap_Struct(rb_cObject, NULL, ioutils_freeAlignedBuffer, lPtrAlignedBuffer);
+}
+
+/**
+ * Read a file opened with O_DIRECT, without the GVL.
+ * The aligned region is read in the aligned memory, and the requested data is copied in the output.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The read arguments. In fact a <em>tReadFileDirectStruct*</em>.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* ioutils_readFileDirect_WithoutGVL(void* iPtrArgs) {
+  tReadFileDirectStruct* lPtrVariables = (tReadFileDirectStruct*)iPtrArgs;
+
+  lPtrVariables->error = 0;
+  lPtrVariables->nbrBytesRead = 0;
+#ifdef IOUTILS_DIRECT_READ
+  size_t lNbrBytesRead = 0;
+  ssize_t lNbrBytesReadOnce;
+  while (lNbrBytesRead < lPtrVariables->alignedSize) {
+    lNbrBytesReadOnce = pread(lPtrVariables->fileNo, lPtrVariables->ptrAlignedBuffer->data + lNbrBytesRead, lPtrVariables->alignedSize - lNbrBytesRead, (off_t)(lPtrVariables->alignedOffset + lNbrBytesRead));
+    if (lNbrBytesReadOnce > 0) {
+      lNbrBytesRead += lNbrBytesReadOnce;
+      if ((lNbrBytesReadOnce % IOUTILS_DIRECT_ALIGNMENT) != 0) {
+        // End of the file
+        break;
+      }
+    } else if (lNbrBytesReadOnce == 0) {
+      // End of the file
+      break;
+    } else if (errno != EINTR) {
+      lPtrVariables->error = errno;
+      break;
+    }
+  }
+  // Copy the requested data only
+  tSampleIndex lIdxFirstByte = lPtrVariables->offset - lPtrVariables->alignedOffset;
+  if ((lPtrVariables->error == 0) &&
+      ((tSampleIndex)lNbrBytesRead > lIdxFirstByte)) {
+    lPtrVariables->nbrBytesRead = (tSampleIndex)lNbrBytesRead - lIdxFirstByte;
+    if (lPtrVariables->nbrBytesRead > lPtrVariables->size) {
+      lPtrVariables->nbrBytesRead = lPtrVariables->size;
+    }
+    memcpy(lPtrVariables->ptrOutput, lPtrVariables->ptrAlignedBuffer->data + lIdxFirstByte, lPtrVariables->nbrBytesRead);
+  }
+#endif
+
+  return NULL;
+}
+
+/**
+ * Read data from a file opened with O_DIRECT, bypassing the page cache.
+ * Data is read in aligned memory, then copied in a String, as IO#read does with an output buffer.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValAlignedBuffer* (_Object_): Container of the aligned memory (created with createAlignedBuffer). It must not be used by several threads at the same time.
+ * * *iValFileNo* (_Integer_): File descriptor of the file, opened with O_DIRECT
+ * * *iValOffset* (_Integer_): Offset of the data in the file
+ * * *iValSize* (_Integer_): Size of the data
+ * * *ioValBuffer* (_String_): The String receiving the data
+ * Return::
+ * * _String_: ioValBuffer, or nil if the end of the file was met
+ */
+static VALUE ioutils_readFileDirect(
+  VALUE iSelf,
+  VALUE iValAlignedBuffer,
+  VALUE iValFileNo,
+  VALUE iValOffset,
+  VALUE iValSize,
+  VALUE ioValBuffer) {
+#ifdef IOUTILS_DIRECT_READ
+  tReadFileDirectStruct lReadVariables;
+  Data_Get_Struct(iValAlignedBuffer, tAlignedBuffer, lReadVariables.ptrAlignedBuffer);
+  lReadVariables.fileNo = FIX2INT(iValFileNo);
+  lReadVariables.offset = NUM2LL(iValOffset);
+  lReadVariables.size = NUM2LL(iValSize);
+  lReadVariables.alignedOffset = lReadVariables.offset - (lReadVariables.offset % IOUTILS_DIRECT_ALIGNMENT);
+  lReadVariables.alignedSize = (size_t)(((lReadVariables.offset + lReadVariables.size - lReadVariables.alignedOffset + IOUTILS_DIRECT_ALIGNMENT - 1) / IOUTILS_DIRECT_ALIGNMENT) * IOUTILS_DIRECT_ALIGNMENT);
+
+  // Grow the aligned memory if needed
+  tAlignedBuffer* lPtrAlignedBuffer = lReadVariables.ptrAlignedBuffer;
+  if (lReadVariables.alignedSize > lPtrAlignedBuffer->size) {
+    free(lPtrAlignedBuffer->data);
+    lPtrAlignedBuffer->data = NULL;
+    lPtrAlignedBuffer->size = 0;
+    if (posix_memalign((void**)&(lPtrAlignedBuffer->data), IOUTILS_DIRECT_ALIGNMENT, lReadVariables.alignedSize) != 0) {
+      lPtrAlignedBuffer->data = NULL;
+      rb_raise(rb_eRuntimeError, "Unable to allocate %lld bytes of aligned memory", (tSampleIndex)lReadVariables.alignedSize);
+    }
+    lPtrAlignedBuffer->size = lReadVariables.alignedSize;
+  }
+  rb_str_resize(ioValBuffer, lReadVariables.size);
+  lReadVariables.ptrOutput = RSTRING_PTR(ioValBuffer);
+
+  commonutils_callWithoutGVL(&ioutils_readFileDirect_WithoutGVL, &lReadVariables);
+  if (lReadVariables.error != 0) {
+    rb_str_set_len(ioValBuffer, 0);
+    rb_raise(rb_eRuntimeError, "Unable to read %lld bytes at offset %lld directly: %s", lReadVariables.size, lReadVariables.offset, strerror(lReadVariables.error));
+  }
+  rb_str_set_len(ioValBuffer, lReadVariables.nbrBytesRead);
+
+  return ((lReadVariables.nbrBytesRead == 0) ? Qnil : ioValBuffer);
+#else
+  rb_raise(rb_eRuntimeError, "Direct reads are not supported on this system");
+  return Qnil;
+#endif
+}
+
+/**
+ * Copy a range of a file to another one from the kernel, without the GVL.
+ * Each system call is used until it fails because the files don't support it, and the next one is tried then.
+ * The copy stops at the first other error, or when no system call can be used anymore.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The copy arguments. In fact a <em>tCopyFileRangeStruct*</em>.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* ioutils_copyFileRange_WithoutGVL(void* iPtrArgs) {
+  tCopyFileRangeStruct* lPtrVariables = (tCopyFileRangeStruct*)iPtrArgs;
+
+  int lCopyMethod = IOUTILS_COPY_COPY_FILE_RANGE;
+  ssize_t lNbrBytesCopied;
+  size_t lNbrBytesToCopy;
+  while ((lPtrVariables->nbrBytesCopied < lPtrVariables->size) &&
+         (lCopyMethod != IOUTILS_COPY_NONE)) {
+    lNbrBytesToCopy = (size_t)(lPtrVariables->size - lPtrVariables->nbrBytesCopied);
+    // System calls copy less than 2 GB at once
+    if (lNbrBytesToCopy > 0x40000000) {
+      lNbrBytesToCopy = 0x40000000;
+    }
+    lNbrBytesCopied = -1;
+    errno = ENOSYS;
+    switch (lCopyMethod) {
+      case IOUTILS_COPY_COPY_FILE_RANGE:
+#ifdef HAVE_COPY_FILE_RANGE
+        // Filesystems supporting it can share the data blocks (reflinks)
+        lNbrBytesCopied = copy_file_range(lPtrVariables->inFileNo, &(lPtrVariables->inOffset), lPtrVariables->outFileNo, NULL, lNbrBytesToCopy, 0);
+#endif
+        break;
+      case IOUTILS_COPY_SENDFILE:
+#ifdef HAVE_SYS_SENDFILE_H
+        lNbrBytesCopied = sendfile(lPtrVariables->outFileNo, lPtrVariables->inFileNo, &(lPtrVariables->inOffset), lNbrBytesToCopy);
+#endif
+        break;
+      case IOUTILS_COPY_SPLICE:
+#ifdef HAVE_SPLICE
+        // Only works when the output is a pipe
+        lNbrBytesCopied = splice(lPtrVariables->inFileNo, &(lPtrVariables->inOffset), lPtrVariables->outFileNo, NULL, lNbrBytesToCopy, 0);
+#endif
+        break;
+    }
+    if (lNbrBytesCopied > 0) {
+      lPtrVariables->nbrBytesCopied += lNbrBytesCopied;
+    } else if (lNbrBytesCopied == 0) {
+      // End of the input file
+      break;
+    } else if (errno != EINTR) {
+      if ((errno == ENOSYS) ||
+          (errno == EINVAL) ||
+          (errno == EXDEV) ||
+          (errno == EBADF) ||
+          (errno == EOPNOTSUPP)) {
+        // Try the next system call
+        ++lCopyMethod;
+      } else {
+        break;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Copy a range of a file at the current position of another one, without passing data through user space.
+ * Data is copied from the kernel using copy_file_range, sendfile or splice, depending on what the system and the files support.
+ * The number of bytes copied can be smaller than requested, and the remaining data then has to be copied by the caller.
+ * The position of the output file is moved after the data copied, and the position of the input file is not changed.
+ * Buffers of both IO objects have to be flushed before.
+ *
+ * Parameters::
+ * * *iSelf* (_IOUtils_): Self
+ * * *iValInFileNo* (_Integer_): File descriptor of the file to copy from
+ * * *iValInOffset* (_Integer_): Offset of the range to copy
+ * * *iValOutFileNo* (_Integer_): File descriptor of the file to copy to
+ * * *iValSize* (_Integer_): Size of the range to copy
+ * Return::
+ * * _Integer_: Number of bytes copied
+ */
+static VALUE ioutils_copyFileRange(
+  VALUE iSelf,
+  VALUE iValInFileNo,
+  VALUE iValInOffset,
+  VALUE iValOutFileNo,
+  VALUE iValSize) {
+  tCopyFileRangeStruct lCopyVariables;
+  lCopyVariables.inFileNo = FIX2INT(iValInFileNo);
+  lCopyVariables.inOffset = (off_t)NUM2LL(iValInOffset);
+  lCopyVariables.outFileNo = FIX2INT(iValOutFileNo);
+  lCopyVariables.size = NUM2LL(iValSize);
+  lCopyVariables.nbrBytesCopied = 0;
+
+  commonutils_callWithoutGVL(&ioutils_copyFileRange_WithoutGVL, &lCopyVariables);
+
+  return LL2NUM(lCopyVariables.nbrBytesCopied);
+}
+
+// Initialize the module
+void Init_IOUtils() {
+  VALUE lWSKModule = rb_define_module("WSK");
+  VALUE lIOUtilsModule = rb_define_module_under(lWSKModule, "IOUtils");
+  VALUE lIOUtilsClass = rb_define_class_under(lIOUtilsModule, "IOUtils", rb_cObject);
+
+  rb_define_const(lIOUtilsClass, "ADVICE_NORMAL", INT2FIX(IOUTILS_ADVICE_NORMAL));
+  rb_define_const(lIOUtilsClass, "ADVICE_SEQUENTIAL", INT2FIX(IOUTILS_ADVICE_SEQUENTIAL));
+  rb_define_const(lIOUtilsClass, "ADVICE_RANDOM", INT2FIX(IOUTILS_ADVICE_RANDOM));
+  rb_define_const(lIOUtilsClass, "ADVICE_WILLNEED", INT2FIX(IOUTILS_ADVICE_WILLNEED));
+  rb_define_const(lIOUtilsClass, "ADVICE_DONTNEED", INT2FIX(IOUTILS_ADVICE_DONTNEED));
+  rb_define_method(lIOUtilsClass, "mapFile", ioutils_mapFile, 3);
+  rb_define_method(lIOUtilsClass, "mapFileForWrite", ioutils_mapFileForWrite, 3);
+  rb_define_method(lIOUtilsClass, "unmapFile", ioutils_unmapFile, 1);
+  rb_define_method(lIOUtilsClass, "allocateFile", ioutils_allocateFile, 3);
+  rb_define_method(lIOUtilsClass, "writeMappedFile", ioutils_writeMappedFile, 3);
+  rb_define_method(lIOUtilsClass, "getMappedView", ioutils_getMappedView, 3);
+  rb_define_method(lIOUtilsClass, "adviseMappedFile", ioutils_adviseMappedFile, 4);
+  rb_define_method(lIOUtilsClass, "copyFileRange", ioutils_copyFileRange, 4);
+  rb_define_method(lIOUtilsClass, "adviseFile", ioutils_adviseFile, 4);
+  rb_define_method(lIOUtilsClass, "syncFileRange", ioutils_syncFileRange, 4);
+  rb_define_method(lIOUtilsClass, "createAlignedBuffer", ioutils_createAlignedBuffer, 0);
+  rb_define_method(lIOUtilsClass, "readFileDirect", ioutils_readFileDirect, 5);
+  gID_mappedFile = rb_intern("mappedFile");
+}
@@ -0,0 +1,22 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require "#{File.dirname(__FILE__)}/../CommonBuild"
+# Files are mapped in memory when the system supports it
+have_header('sys/mman.h')
+# Views on mapped files don't copy data when Ruby supports it
+have_func('rb_str_new_static')
+# File ranges are copied by the kernel with the first system call supported
+have_func('copy_file_range', 'unistd.h')
+have_header('sys/sendfile.h')
+have_func('splice', 'fcntl.h')
+# Disk space of mapped output files is allocated before writing them
+have_func('posix_fallocate', 'fcntl.h')
+# Page cache policies drop data from the cache, and read it without the cache using aligned memory
+have_func('posix_fadvise', 'fcntl.h')
+have_func('sync_file_range', 'fcntl.h')
+have_func('posix_memalign', 'stdlib.h')
+have_func('pread', 'unistd.h')
+create_makefile('IOUtils')
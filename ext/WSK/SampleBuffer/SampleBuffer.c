@@ -0,0 +1,1110 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#include "ruby.h"
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <CommonUtils.h>
+
+// Types of the values stored in sample buffers
+#define SAMPLEBUFFER_TYPE_INT 0
+#define SAMPLEBUFFER_TYPE_FLOAT 1
+
+// Struct storing the values of a sample buffer, shared with its views.
+// Its capacity never shrinks, so that views stay within allocated memory.
+typedef struct {
+  // Type of the values (one of SAMPLEBUFFER_TYPE_*)
+  int type;
+  // The values, as tSampleValue* or float*
+  void* values;
+  // Number of values that can be stored
+  tSampleIndex capacity;
+} tSampleStorage;
+
+// Struct of a sample buffer: a strided view on the values of a storage.
+// The value of channel c of sample s is values[offset + s*sampleStride + c*channelStride].
+typedef struct {
+  // Container of the storage, referenced to keep it alive
+  VALUE valStorage;
+  tSampleStorage* ptrStorage;
+  int nbrChannels;
+  tSampleIndex nbrSamples;
+  // Index of the first value in the storage
+  tSampleIndex offset;
+  // Number of values between 2 consecutive samples
+  tSampleIndex sampleStride;
+  // Number of values between 2 consecutive channels of a sample
+  tSampleIndex channelStride;
+} tSampleBuffer;
+
+// Struct used to decode a raw buffer into a sample buffer
+typedef struct {
+  tSampleBuffer* ptrBuffer;
+} tDecodeStruct;
+
+// Struct used to encode a sample buffer into a raw buffer
+typedef struct {
+  tSampleBuffer* ptrBuffer;
+} tEncodeStruct;
+
+// Struct used to apply an operation on all the values of a sample buffer without the GVL
+typedef struct {
+  tSampleBuffer* ptrBuffer;
+  // Parameters of the operation, as integers and as floats
+  long long int intParams[3];
+  double floatParams[3];
+} tOperationStruct;
+
+// The class of sample buffers
+static VALUE gSampleBufferClass;
+
+/**
+ * Free a storage.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrStorage* (<em>void*</em>): The storage to free (in fact a <em>tSampleStorage*</em>)
+ */
+static void samplebuffer_freeStorage(void* iPtrStorage) {
+  tSampleStorage* lPtrStorage = (tSampleStorage*)iPtrStorage;
+
+  free(lPtrStorage->values);
+  free(lPtrStorage);
+}
+
+/**
+ * Create a storage of values, initialized with zeros.
+ *
+ * Parameters::
+ * * *iType* (<em>const int</em>): The type of values (one of SAMPLEBUFFER_TYPE_*)
+ * * *iCapacity* (<em>const tSampleIndex</em>): The number of values to store
+ * * *oPtrPtrStorage* (<em>tSampleStorage**</em>): The created storage
+ * Return::
+ * * _Object_: Container of the storage
+ */
+static VALUE samplebuffer_createStorage(
+  const int iType,
+  const tSampleIndex iCapacity,
+  tSampleStorage** oPtrPtrStorage) {
+  tSampleStorage* lPtrStorage = ALLOC(tSampleStorage);
+  lPtrStorage->type = iType;
+  lPtrStorage->capacity = iCapacity;
+  lPtrStorage->values = NULL;
+  VALUE rValStorage = Data_Wrap_Struct(rb_cObject, NULL, samplebuffer_freeStorage, lPtrStorage);
+  // Always allocate memory, even for empty buffers
+  lPtrStorage->values = (void*)ALLOC_N(char, ((iCapacity > 0) ? iCapacity : 1)*sizeof(tSampleValue));
+  memset(lPtrStorage->values, 0, iCapacity*sizeof(tSampleValue));
+  *oPtrPtrStorage = lPtrStorage;
+
+  return rValStorage;
+}
+
+/**
+ * Mark a sample buffer.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrBuffer* (<em>void*</em>): The sample buffer (in fact a <em>tSampleBuffer*</em>)
+ */
+static void samplebuffer_mark(void* iPtrBuffer) {
+  rb_gc_mark(((tSampleBuffer*)iPtrBuffer)->valStorage);
+}
+
+/**
+ * Free a sample buffer. Its storage is freed with its container.
+ * This method is called by Ruby GC.
+ *
+ * Parameters::
+ * * *iPtrBuffer* (<em>void*</em>): The sample buffer (in fact a <em>tSampleBuffer*</em>)
+ */
+static void samplebuffer_free(void* iPtrBuffer) {
+  free(iPtrBuffer);
+}
+
+/**
+ * Allocate a sample buffer, without storage.
+ *
+ * Parameters::
+ * * *iClass* (_Class_): The class to instantiate
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The sample buffer
+ */
+static VALUE samplebuffer_alloc(
+  VALUE iClass) {
+  tSampleBuffer* lPtrBuffer = ALLOC(tSampleBuffer);
+  lPtrBuffer->valStorage = Qnil;
+  lPtrBuffer->ptrStorage = NULL;
+  lPtrBuffer->nbrChannels = 0;
+  lPtrBuffer->nbrSamples = 0;
+  lPtrBuffer->offset = 0;
+  lPtrBuffer->sampleStride = 0;
+  lPtrBuffer->channelStride = 0;
+
+  return Data_Wrap_Struct(iClass, samplebuffer_mark, samplebuffer_free, lPtrBuffer);
+}
+
+/**
+ * Get a sample buffer, and check that it can be accessed.
+ *
+ * Parameters::
+ * * *iValBuffer* (<em>WSK::SampleBuffer</em>): The sample buffer
+ * Return::
+ * * <em>tSampleBuffer*</em>: The sample buffer
+ */
+static tSampleBuffer* samplebuffer_get(
+  VALUE iValBuffer) {
+  tSampleBuffer* rPtrBuffer;
+  Data_Get_Struct(iValBuffer, tSampleBuffer, rPtrBuffer);
+
+  if (rPtrBuffer->ptrStorage == NULL) {
+    rb_raise(rb_eRuntimeError, "Sample buffer is not initialized");
+  }
+  if ((rPtrBuffer->nbrSamples > 0) &&
+      (rPtrBuffer->offset + (rPtrBuffer->nbrSamples-1)*rPtrBuffer->sampleStride + (rPtrBuffer->nbrChannels-1)*rPtrBuffer->channelStride >= rPtrBuffer->ptrStorage->capacity)) {
+    rb_raise(rb_eRuntimeError, "Sample buffer exceeds its storage");
+  }
+
+  return rPtrBuffer;
+}
+
+/**
+ * Is a sample buffer contiguous ? Its values are then interleaved as in raw buffers.
+ *
+ * Parameters::
+ * * *iPtrBuffer* (<em>const tSampleBuffer*</em>): The sample buffer
+ * Return::
+ * * _int_: 1 if contiguous, 0 otherwise
+ */
+static int samplebuffer_isContiguous(
+  const tSampleBuffer* iPtrBuffer) {
+  return ((iPtrBuffer->sampleStride == iPtrBuffer->nbrChannels) &&
+          ((iPtrBuffer->channelStride == 1) ||
+           (iPtrBuffer->nbrChannels == 1)));
+}
+
+/**
+ * Saturate a value to the range of sample values
+ *
+ * Parameters::
+ * * *iValue* (<em>const long long int</em>): The value
+ * Return::
+ * * _tSampleValue_: The saturated value
+ */
+static inline tSampleValue samplebuffer_saturate(
+  const long long int iValue) {
+  if (iValue > INT_MAX) {
+    return INT_MAX;
+  } else if (iValue < INT_MIN) {
+    return INT_MIN;
+  }
+  return (tSampleValue)iValue;
+}
+
+/**
+ * Round and saturate a float value to the range of sample values
+ *
+ * Parameters::
+ * * *iValue* (<em>const double</em>): The value
+ * Return::
+ * * _tSampleValue_: The rounded value
+ */
+static inline tSampleValue samplebuffer_round(
+  const double iValue) {
+  if (iValue >= INT_MAX) {
+    return INT_MAX;
+  } else if (iValue <= INT_MIN) {
+    return INT_MIN;
+  }
+  return (tSampleValue)lround(iValue);
+}
+
+/**
+ * Initialize a sample buffer, owning its storage.
+ *
+ * Parameters::
+ * * *ioPtrBuffer* (<em>tSampleBuffer*</em>): The sample buffer
+ * * *iType* (<em>const int</em>): The type of values (one of SAMPLEBUFFER_TYPE_*)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ */
+static void samplebuffer_init(
+  tSampleBuffer* ioPtrBuffer,
+  const int iType,
+  const tSampleIndex iNbrSamples,
+  const int iNbrChannels) {
+  if ((iNbrSamples < 0) ||
+      (iNbrChannels <= 0)) {
+    rb_raise(rb_eRuntimeError, "Invalid sample buffer of %lld samples and %d channels", iNbrSamples, iNbrChannels);
+  }
+  ioPtrBuffer->valStorage = samplebuffer_createStorage(iType, iNbrSamples*iNbrChannels, &(ioPtrBuffer->ptrStorage));
+  ioPtrBuffer->nbrChannels = iNbrChannels;
+  ioPtrBuffer->nbrSamples = iNbrSamples;
+  ioPtrBuffer->offset = 0;
+  ioPtrBuffer->sampleStride = iNbrChannels;
+  ioPtrBuffer->channelStride = 1;
+}
+
+/**
+ * Create a sample buffer, initialized with silence.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iArgc* (_int_): Number of arguments
+ * * *iArgv* (<em>VALUE*</em>): Arguments:
+ *   * *iValNbrSamples* (_Integer_): The number of samples
+ *   * *iValNbrChannels* (_Integer_): The number of channels
+ *   * *iValFloat* (_Boolean_): Are values stored as floats instead of 32 bits integers ? [optional = false]
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: Self
+ */
+static VALUE samplebuffer_initialize(
+  int iArgc,
+  VALUE* iArgv,
+  VALUE iSelf) {
+  VALUE lValNbrSamples, lValNbrChannels, lValFloat;
+  rb_scan_args(iArgc, iArgv, "21", &lValNbrSamples, &lValNbrChannels, &lValFloat);
+  tSampleBuffer* lPtrBuffer;
+  Data_Get_Struct(iSelf, tSampleBuffer, lPtrBuffer);
+
+  samplebuffer_init(lPtrBuffer, (RTEST(lValFloat) ? SAMPLEBUFFER_TYPE_FLOAT : SAMPLEBUFFER_TYPE_INT), NUM2LL(lValNbrSamples), FIX2INT(lValNbrChannels));
+
+  return iSelf;
+}
+
+/**
+ * Process a decoded block to store it in a sample buffer.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block
+ * * *iPtrArgs* (<em>void*</em>): User data, in fact a <em>tDecodeStruct*</em>
+ * Return::
+ * * _int_: 0
+ */
+static int samplebuffer_processBlock_decode(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
+  tSampleBuffer* lPtrBuffer = ((tDecodeStruct*)iPtrArgs)->ptrBuffer;
+  int lNbrChannels = lPtrBuffer->nbrChannels;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    tSampleValue* lPtrValues = ((tSampleValue*)lPtrBuffer->ptrStorage->values) + iPtrBlock->idxFirstSample*lNbrChannels;
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      tSampleValue* lPtrBlockValues = iPtrBlock->values[lIdxChannel];
+      for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+        lPtrValues[lIdxSample*lNbrChannels + lIdxChannel] = lPtrBlockValues[lIdxSample];
+      }
+    }
+  } else {
+    float* lPtrValues = ((float*)lPtrBuffer->ptrStorage->values) + iPtrBlock->idxFirstSample*lNbrChannels;
+    for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+      tSampleValue* lPtrBlockValues = iPtrBlock->values[lIdxChannel];
+      for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+        lPtrValues[lIdxSample*lNbrChannels + lIdxChannel] = (float)lPtrBlockValues[lIdxSample];
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Initialize the decoding arguments of a part of a raw buffer
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The decoding arguments, in fact a <em>const tDecodeStruct*</em>
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize, in fact a <em>tDecodeStruct*</em>
+ * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): Offset of the first sample of the part
+ */
+static void samplebuffer_initSliceArgs_decode(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxOffsetSample) {
+  // Blocks give the index of their samples in the whole buffer
+  *((tDecodeStruct*)oPtrSliceArgs) = *((const tDecodeStruct*)iPtrArgs);
+}
+
+// Parallel processing of decodings
+static const tParallelFcts gParallelFcts_decode = {
+  sizeof(tDecodeStruct),
+  &samplebuffer_initSliceArgs_decode,
+  NULL
+};
+
+/**
+ * Decode a raw buffer into a contiguous sample buffer, replacing its samples.
+ * The storage is grown if needed.
+ *
+ * Parameters::
+ * * *ioPtrBuffer* (<em>tSampleBuffer*</em>): The sample buffer
+ * * *iValRawBuffer* (_String_): The raw buffer
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples to decode
+ */
+static void samplebuffer_decode(
+  tSampleBuffer* ioPtrBuffer,
+  VALUE iValRawBuffer,
+  const int iNbrBitsPerSample,
+  const tSampleIndex iNbrSamples) {
+  if ((iNbrBitsPerSample != 8) &&
+      (iNbrBitsPerSample != 16) &&
+      (iNbrBitsPerSample != 24)) {
+    rb_raise(rb_eRuntimeError, "%d bits PCM data not supported.", iNbrBitsPerSample);
+  }
+  if ((iNbrSamples < 0) ||
+      (iNbrSamples*ioPtrBuffer->nbrChannels*(iNbrBitsPerSample/8) > RSTRING_LEN(iValRawBuffer))) {
+    rb_raise(rb_eRuntimeError, "Unable to decode %lld samples from a buffer of %ld bytes.", iNbrSamples, RSTRING_LEN(iValRawBuffer));
+  }
+  // Grow the storage: views keep the previous one
+  if (iNbrSamples*ioPtrBuffer->nbrChannels > ioPtrBuffer->ptrStorage->capacity) {
+    ioPtrBuffer->valStorage = samplebuffer_createStorage(ioPtrBuffer->ptrStorage->type, iNbrSamples*ioPtrBuffer->nbrChannels, &(ioPtrBuffer->ptrStorage));
+  }
+  ioPtrBuffer->nbrSamples = iNbrSamples;
+
+  tDecodeStruct lDecode;
+  lDecode.ptrBuffer = ioPtrBuffer;
+  commonutils_iterateBlocksThroughRawBuffer(RSTRING_PTR(iValRawBuffer), iNbrBitsPerSample, ioPtrBuffer->nbrChannels, iNbrSamples, 0, &samplebuffer_processBlock_decode, &lDecode, &gParallelFcts_decode);
+}
+
+/**
+ * Create a sample buffer from a raw buffer
+ *
+ * Parameters::
+ * * *iSelf* (_Class_): Self
+ * * *iArgc* (_int_): Number of arguments
+ * * *iArgv* (<em>VALUE*</em>): Arguments:
+ *   * *iValRawBuffer* (_String_): The raw buffer
+ *   * *iValNbrBitsPerSample* (_Integer_): The number of bits per sample
+ *   * *iValNbrChannels* (_Integer_): The number of channels
+ *   * *iValNbrSamples* (_Integer_): The number of samples to decode
+ *   * *iValFloat* (_Boolean_): Are values stored as floats instead of 32 bits integers ? [optional = false]
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The sample buffer
+ */
+static VALUE samplebuffer_decodeNew(
+  int iArgc,
+  VALUE* iArgv,
+  VALUE iSelf) {
+  VALUE lValRawBuffer, lValNbrBitsPerSample, lValNbrChannels, lValNbrSamples, lValFloat;
+  rb_scan_args(iArgc, iArgv, "41", &lValRawBuffer, &lValNbrBitsPerSample, &lValNbrChannels, &lValNbrSamples, &lValFloat);
+  VALUE rValBuffer = samplebuffer_alloc(iSelf);
+  tSampleBuffer* lPtrBuffer;
+  Data_Get_Struct(rValBuffer, tSampleBuffer, lPtrBuffer);
+
+  samplebuffer_init(lPtrBuffer, (RTEST(lValFloat) ? SAMPLEBUFFER_TYPE_FLOAT : SAMPLEBUFFER_TYPE_INT), 0, FIX2INT(lValNbrChannels));
+  samplebuffer_decode(lPtrBuffer, lValRawBuffer, FIX2INT(lValNbrBitsPerSample), NUM2LL(lValNbrSamples));
+
+  return rValBuffer;
+}
+
+/**
+ * Decode a raw buffer in this sample buffer, replacing its samples.
+ * Memory is reused, so that decoding successive raw buffers does not allocate memory.
+ * Only sample buffers that are not views can be decoded in. Views created before see the decoded values, unless the storage had to grow.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValRawBuffer* (_String_): The raw buffer
+ * * *iValNbrBitsPerSample* (_Integer_): The number of bits per sample
+ * * *iValNbrSamples* (_Integer_): The number of samples to decode
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: Self
+ */
+static VALUE samplebuffer_decodeInPlace(
+  VALUE iSelf,
+  VALUE iValRawBuffer,
+  VALUE iValNbrBitsPerSample,
+  VALUE iValNbrSamples) {
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  if ((lPtrBuffer->offset != 0) ||
+      (!samplebuffer_isContiguous(lPtrBuffer))) {
+    rb_raise(rb_eRuntimeError, "Only sample buffers that are not views can be decoded in");
+  }
+
+  samplebuffer_decode(lPtrBuffer, iValRawBuffer, FIX2INT(iValNbrBitsPerSample), NUM2LL(iValNbrSamples));
+
+  return iSelf;
+}
+
+/**
+ * Create a sample buffer from a list of channel values
+ *
+ * Parameters::
+ * * *iSelf* (_Class_): Self
+ * * *iArgc* (_int_): Number of arguments
+ * * *iArgv* (<em>VALUE*</em>): Arguments:
+ *   * *iValValues* (<em>list<Numeric></em>): The channel values, interleaved as in raw buffers
+ *   * *iValNbrChannels* (_Integer_): The number of channels
+ *   * *iValFloat* (_Boolean_): Are values stored as floats instead of 32 bits integers ? [optional = false]
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The sample buffer
+ */
+static VALUE samplebuffer_fromArray(
+  int iArgc,
+  VALUE* iArgv,
+  VALUE iSelf) {
+  VALUE lValValues, lValNbrChannels, lValFloat;
+  rb_scan_args(iArgc, iArgv, "21", &lValValues, &lValNbrChannels, &lValFloat);
+  int lNbrChannels = FIX2INT(lValNbrChannels);
+  long lNbrValues = RARRAY_LEN(lValValues);
+  if ((lNbrChannels <= 0) ||
+      (lNbrValues % lNbrChannels != 0)) {
+    rb_raise(rb_eRuntimeError, "Invalid sample buffer of %ld values and %d channels", lNbrValues, lNbrChannels);
+  }
+  VALUE rValBuffer = samplebuffer_alloc(iSelf);
+  tSampleBuffer* lPtrBuffer;
+  Data_Get_Struct(rValBuffer, tSampleBuffer, lPtrBuffer);
+
+  samplebuffer_init(lPtrBuffer, (RTEST(lValFloat) ? SAMPLEBUFFER_TYPE_FLOAT : SAMPLEBUFFER_TYPE_INT), lNbrValues/lNbrChannels, lNbrChannels);
+  long lIdxValue;
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    tSampleValue* lPtrValues = (tSampleValue*)lPtrBuffer->ptrStorage->values;
+    for (lIdxValue = 0; lIdxValue < lPtrBuffer->nbrSamples*lNbrChannels; ++lIdxValue) {
+      lPtrValues[lIdxValue] = NUM2INT(rb_ary_entry(lValValues, lIdxValue));
+    }
+  } else {
+    float* lPtrValues = (float*)lPtrBuffer->ptrStorage->values;
+    for (lIdxValue = 0; lIdxValue < lPtrBuffer->nbrSamples*lNbrChannels; ++lIdxValue) {
+      lPtrValues[lIdxValue] = (float)NUM2DBL(rb_ary_entry(lValValues, lIdxValue));
+    }
+  }
+
+  return rValBuffer;
+}
+
+/**
+ * Get the channel values as a list
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * Return::
+ * * <em>list<Numeric></em>: The channel values, interleaved as in raw buffers (Integer or Float)
+ */
+static VALUE samplebuffer_toArray(
+  VALUE iSelf) {
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  VALUE rValValues = rb_ary_new2(lPtrBuffer->nbrSamples*lPtrBuffer->nbrChannels);
+
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  tSampleIndex lIdxValue;
+  for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+    for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+      lIdxValue = lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride + lIdxChannel*lPtrBuffer->channelStride;
+      if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+        rb_ary_push(rValValues, INT2NUM(((tSampleValue*)lPtrBuffer->ptrStorage->values)[lIdxValue]));
+      } else {
+        rb_ary_push(rValValues, rb_float_new(((float*)lPtrBuffer->ptrStorage->values)[lIdxValue]));
+      }
+    }
+  }
+
+  return rValValues;
+}
+
+/**
+ * Get the number of samples
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * Return::
+ * * _Integer_: The number of samples
+ */
+static VALUE samplebuffer_nbrSamples(
+  VALUE iSelf) {
+  return LL2NUM(samplebuffer_get(iSelf)->nbrSamples);
+}
+
+/**
+ * Get the number of channels
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * Return::
+ * * _Integer_: The number of channels
+ */
+static VALUE samplebuffer_nbrChannels(
+  VALUE iSelf) {
+  return INT2FIX(samplebuffer_get(iSelf)->nbrChannels);
+}
+
+/**
+ * Are values stored as floats ?
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * Return::
+ * * _Boolean_: Are values stored as floats ?
+ */
+static VALUE samplebuffer_isFloat(
+  VALUE iSelf) {
+  return ((samplebuffer_get(iSelf)->ptrStorage->type == SAMPLEBUFFER_TYPE_FLOAT) ? Qtrue : Qfalse);
+}
+
+/**
+ * Create a view on a sample buffer, sharing its values
+ *
+ * Parameters::
+ * * *iPtrBuffer* (<em>const tSampleBuffer*</em>): The viewed sample buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels of the view
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples of the view
+ * * *iOffset* (<em>const tSampleIndex</em>): The index of the first value of the view in the storage
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The view
+ */
+static VALUE samplebuffer_createView(
+  const tSampleBuffer* iPtrBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const tSampleIndex iOffset) {
+  VALUE rValView = samplebuffer_alloc(gSampleBufferClass);
+  tSampleBuffer* lPtrView;
+  Data_Get_Struct(rValView, tSampleBuffer, lPtrView);
+  *lPtrView = *iPtrBuffer;
+  lPtrView->nbrChannels = iNbrChannels;
+  lPtrView->nbrSamples = iNbrSamples;
+  lPtrView->offset = iOffset;
+
+  return rValView;
+}
+
+/**
+ * Get a view on 1 channel of the samples, without copying them.
+ * Modifying the view modifies this sample buffer.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValIdxChannel* (_Integer_): Index of the channel
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The view, having 1 channel
+ */
+static VALUE samplebuffer_channel(
+  VALUE iSelf,
+  VALUE iValIdxChannel) {
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  int lIdxChannel = FIX2INT(iValIdxChannel);
+  if ((lIdxChannel < 0) ||
+      (lIdxChannel >= lPtrBuffer->nbrChannels)) {
+    rb_raise(rb_eRuntimeError, "Invalid channel %d among %d channels", lIdxChannel, lPtrBuffer->nbrChannels);
+  }
+
+  return samplebuffer_createView(lPtrBuffer, 1, lPtrBuffer->nbrSamples, lPtrBuffer->offset + lIdxChannel*lPtrBuffer->channelStride);
+}
+
+/**
+ * Get a view on a range of samples, without copying them.
+ * Modifying the view modifies this sample buffer.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValIdxFirstSample* (_Integer_): Index of the first sample of the view
+ * * *iValNbrSamples* (_Integer_): Number of samples of the view
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The view
+ */
+static VALUE samplebuffer_slice(
+  VALUE iSelf,
+  VALUE iValIdxFirstSample,
+  VALUE iValNbrSamples) {
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  tSampleIndex lIdxFirstSample = NUM2LL(iValIdxFirstSample);
+  tSampleIndex lNbrSamples = NUM2LL(iValNbrSamples);
+  if ((lIdxFirstSample < 0) ||
+      (lNbrSamples < 0) ||
+      (lIdxFirstSample + lNbrSamples > lPtrBuffer->nbrSamples)) {
+    rb_raise(rb_eRuntimeError, "Invalid slice of %lld samples from sample %lld among %lld samples", lNbrSamples, lIdxFirstSample, lPtrBuffer->nbrSamples);
+  }
+
+  return samplebuffer_createView(lPtrBuffer, lPtrBuffer->nbrChannels, lNbrSamples, lPtrBuffer->offset + lIdxFirstSample*lPtrBuffer->sampleStride);
+}
+
+/**
+ * Get the index of a value in the storage, checking the sample and channel
+ *
+ * Parameters::
+ * * *iPtrBuffer* (<em>const tSampleBuffer*</em>): The sample buffer
+ * * *iValIdxSample* (_Integer_): Index of the sample
+ * * *iValIdxChannel* (_Integer_): Index of the channel
+ * Return::
+ * * _tSampleIndex_: Index of the value in the storage
+ */
+static tSampleIndex samplebuffer_getIdxValue(
+  const tSampleBuffer* iPtrBuffer,
+  VALUE iValIdxSample,
+  VALUE iValIdxChannel) {
+  tSampleIndex lIdxSample = NUM2LL(iValIdxSample);
+  int lIdxChannel = FIX2INT(iValIdxChannel);
+  if ((lIdxSample < 0) ||
+      (lIdxSample >= iPtrBuffer->nbrSamples) ||
+      (lIdxChannel < 0) ||
+      (lIdxChannel >= iPtrBuffer->nbrChannels)) {
+    rb_raise(rb_eRuntimeError, "Invalid value of sample %lld and channel %d among %lld samples and %d channels", lIdxSample, lIdxChannel, iPtrBuffer->nbrSamples, iPtrBuffer->nbrChannels);
+  }
+
+  return iPtrBuffer->offset + lIdxSample*iPtrBuffer->sampleStride + lIdxChannel*iPtrBuffer->channelStride;
+}
+
+/**
+ * Get the value of a channel of a sample
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValIdxSample* (_Integer_): Index of the sample
+ * * *iValIdxChannel* (_Integer_): Index of the channel
+ * Return::
+ * * _Numeric_: The value (Integer or Float)
+ */
+static VALUE samplebuffer_getValue(
+  VALUE iSelf,
+  VALUE iValIdxSample,
+  VALUE iValIdxChannel) {
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  tSampleIndex lIdxValue = samplebuffer_getIdxValue(lPtrBuffer, iValIdxSample, iValIdxChannel);
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    return INT2NUM(((tSampleValue*)lPtrBuffer->ptrStorage->values)[lIdxValue]);
+  } else {
+    return rb_float_new(((float*)lPtrBuffer->ptrStorage->values)[lIdxValue]);
+  }
+}
+
+/**
+ * Set the value of a channel of a sample
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValIdxSample* (_Integer_): Index of the sample
+ * * *iValIdxChannel* (_Integer_): Index of the channel
+ * * *iValValue* (_Numeric_): The value
+ * Return::
+ * * _Numeric_: The value
+ */
+static VALUE samplebuffer_setValue(
+  VALUE iSelf,
+  VALUE iValIdxSample,
+  VALUE iValIdxChannel,
+  VALUE iValValue) {
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  tSampleIndex lIdxValue = samplebuffer_getIdxValue(lPtrBuffer, iValIdxSample, iValIdxChannel);
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    ((tSampleValue*)lPtrBuffer->ptrStorage->values)[lIdxValue] = NUM2INT(iValValue);
+  } else {
+    ((float*)lPtrBuffer->ptrStorage->values)[lIdxValue] = (float)NUM2DBL(iValValue);
+  }
+
+  return iValValue;
+}
+
+/**
+ * Multiply all values by a coefficient, without the GVL.
+ * Integer values are rounded to the nearest integer.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The operation. In fact a <em>tOperationStruct*</em>: floatParams[0] is the coefficient.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* samplebuffer_scale_WithoutGVL(void* iPtrArgs) {
+  tOperationStruct* lPtrOperation = (tOperationStruct*)iPtrArgs;
+  tSampleBuffer* lPtrBuffer = lPtrOperation->ptrBuffer;
+  double lCoeff = lPtrOperation->floatParams[0];
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      tSampleValue* lPtrValues = ((tSampleValue*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] = samplebuffer_round(lPtrValues[lIdxChannel*lPtrBuffer->channelStride]*lCoeff);
+      }
+    }
+  } else {
+    float lFloatCoeff = (float)lCoeff;
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      float* lPtrValues = ((float*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] *= lFloatCoeff;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Add an offset to all values, without the GVL.
+ * Integer values are saturated to 32 bits.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The operation. In fact a <em>tOperationStruct*</em>: intParams[0] and floatParams[0] are the offset.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* samplebuffer_offset_WithoutGVL(void* iPtrArgs) {
+  tOperationStruct* lPtrOperation = (tOperationStruct*)iPtrArgs;
+  tSampleBuffer* lPtrBuffer = lPtrOperation->ptrBuffer;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    long long int lOffset = lPtrOperation->intParams[0];
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      tSampleValue* lPtrValues = ((tSampleValue*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] = samplebuffer_saturate(lPtrValues[lIdxChannel*lPtrBuffer->channelStride] + lOffset);
+      }
+    }
+  } else {
+    float lOffset = (float)lPtrOperation->floatParams[0];
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      float* lPtrValues = ((float*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] += lOffset;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Limit all values to a range, without the GVL.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The operation. In fact a <em>tOperationStruct*</em>: params [0] and [1] are the minimal and maximal values.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* samplebuffer_clamp_WithoutGVL(void* iPtrArgs) {
+  tOperationStruct* lPtrOperation = (tOperationStruct*)iPtrArgs;
+  tSampleBuffer* lPtrBuffer = lPtrOperation->ptrBuffer;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    tSampleValue lMin = samplebuffer_saturate(lPtrOperation->intParams[0]);
+    tSampleValue lMax = samplebuffer_saturate(lPtrOperation->intParams[1]);
+    tSampleValue lValue;
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      tSampleValue* lPtrValues = ((tSampleValue*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lValue = lPtrValues[lIdxChannel*lPtrBuffer->channelStride];
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] = ((lValue < lMin) ? lMin : ((lValue > lMax) ? lMax : lValue));
+      }
+    }
+  } else {
+    float lMin = (float)lPtrOperation->floatParams[0];
+    float lMax = (float)lPtrOperation->floatParams[1];
+    float lValue;
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      float* lPtrValues = ((float*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lValue = lPtrValues[lIdxChannel*lPtrBuffer->channelStride];
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] = ((lValue < lMin) ? lMin : ((lValue > lMax) ? lMax : lValue));
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Apply a linear fade ramp on all values, without the GVL.
+ * Values of sample i are multiplied by (begin + i*step)/denominator. Integer values are rounded down, as Ruby integer divisions.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): The operation. In fact a <em>tOperationStruct*</em>: params [0], [1] and [2] are the begin and step numerators, and the denominator.
+ * Return::
+ * * <em>void*</em>: NULL
+ */
+static void* samplebuffer_fade_WithoutGVL(void* iPtrArgs) {
+  tOperationStruct* lPtrOperation = (tOperationStruct*)iPtrArgs;
+  tSampleBuffer* lPtrBuffer = lPtrOperation->ptrBuffer;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+
+  if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+    long long int lDenominator = lPtrOperation->intParams[2];
+    long long int lNumerator = lPtrOperation->intParams[0];
+    long long int lProduct;
+    long long int lQuotient;
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      tSampleValue* lPtrValues = ((tSampleValue*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lProduct = lPtrValues[lIdxChannel*lPtrBuffer->channelStride]*lNumerator;
+        lQuotient = lProduct/lDenominator;
+        // C divisions are rounded towards zero
+        if (((lProduct % lDenominator) != 0) &&
+            ((lProduct < 0) != (lDenominator < 0))) {
+          --lQuotient;
+        }
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] = samplebuffer_saturate(lQuotient);
+      }
+      lNumerator += lPtrOperation->intParams[1];
+    }
+  } else {
+    double lCoeff = lPtrOperation->floatParams[0]/lPtrOperation->floatParams[2];
+    double lCoeffStep = lPtrOperation->floatParams[1]/lPtrOperation->floatParams[2];
+    for (lIdxSample = 0; lIdxSample < lPtrBuffer->nbrSamples; ++lIdxSample) {
+      float* lPtrValues = ((float*)lPtrBuffer->ptrStorage->values) + lPtrBuffer->offset + lIdxSample*lPtrBuffer->sampleStride;
+      float lFloatCoeff = (float)(lCoeff + lIdxSample*lCoeffStep);
+      for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+        lPtrValues[lIdxChannel*lPtrBuffer->channelStride] *= lFloatCoeff;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Apply an operation on all values of a sample buffer, without the GVL
+ *
+ * Parameters::
+ * * *iValBuffer* (<em>WSK::SampleBuffer</em>): The sample buffer
+ * * *iPtrFct* (<em>const tPtrFctWithoutGVL</em>): The operation
+ * * *iNbrParams* (<em>const int</em>): Number of parameters
+ * * *iValParams* (<em>VALUE*</em>): The parameters (Numeric)
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: The sample buffer
+ */
+static VALUE samplebuffer_applyOperation(
+  VALUE iValBuffer,
+  const tPtrFctWithoutGVL iPtrFct,
+  const int iNbrParams,
+  VALUE* iValParams) {
+  tOperationStruct lOperation;
+  lOperation.ptrBuffer = samplebuffer_get(iValBuffer);
+  rb_check_frozen(iValBuffer);
+  int lIdxParam;
+  for (lIdxParam = 0; lIdxParam < iNbrParams; ++lIdxParam) {
+    lOperation.floatParams[lIdxParam] = NUM2DBL(iValParams[lIdxParam]);
+    lOperation.intParams[lIdxParam] = ((RB_INTEGER_TYPE_P(iValParams[lIdxParam])) ? NUM2LL(iValParams[lIdxParam]) : (long long int)llround(lOperation.floatParams[lIdxParam]));
+  }
+
+  commonutils_callWithoutGVL(iPtrFct, &lOperation);
+
+  return iValBuffer;
+}
+
+/**
+ * Multiply all values by a coefficient.
+ * Integer values are rounded to the nearest integer.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValCoeff* (_Numeric_): The coefficient
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: Self
+ */
+static VALUE samplebuffer_scale(
+  VALUE iSelf,
+  VALUE iValCoeff) {
+  return samplebuffer_applyOperation(iSelf, &samplebuffer_scale_WithoutGVL, 1, &iValCoeff);
+}
+
+/**
+ * Add an offset to all values
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValOffset* (_Numeric_): The offset
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: Self
+ */
+static VALUE samplebuffer_offset(
+  VALUE iSelf,
+  VALUE iValOffset) {
+  return samplebuffer_applyOperation(iSelf, &samplebuffer_offset_WithoutGVL, 1, &iValOffset);
+}
+
+/**
+ * Limit all values to a range
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValMin* (_Numeric_): The minimal value
+ * * *iValMax* (_Numeric_): The maximal value
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: Self
+ */
+static VALUE samplebuffer_clamp(
+  VALUE iSelf,
+  VALUE iValMin,
+  VALUE iValMax) {
+  VALUE lValParams[2] = { iValMin, iValMax };
+
+  return samplebuffer_applyOperation(iSelf, &samplebuffer_clamp_WithoutGVL, 2, lValParams);
+}
+
+/**
+ * Apply a linear fade ramp on all values.
+ * Values of sample i are multiplied by (iValNumeratorBegin + i*iValNumeratorStep)/iValDenominator.
+ * Integer values are rounded down, as Ruby integer divisions.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iValNumeratorBegin* (_Integer_): Numerator of the coefficient of the first sample
+ * * *iValNumeratorStep* (_Integer_): Increment of the numerator between 2 samples
+ * * *iValDenominator* (_Integer_): Denominator of the coefficients
+ * Return::
+ * * <em>WSK::SampleBuffer</em>: Self
+ */
+static VALUE samplebuffer_fade(
+  VALUE iSelf,
+  VALUE iValNumeratorBegin,
+  VALUE iValNumeratorStep,
+  VALUE iValDenominator) {
+  VALUE lValParams[3] = { iValNumeratorBegin, iValNumeratorStep, iValDenominator };
+  if (NUM2DBL(iValDenominator) == 0) {
+    rb_raise(rb_eZeroDivError, "Fade denominator is 0");
+  }
+
+  return samplebuffer_applyOperation(iSelf, &samplebuffer_fade_WithoutGVL, 3, lValParams);
+}
+
+/**
+ * Fill a block to be encoded with the values of a sample buffer
+ *
+ * Parameters::
+ * * *ioPtrBlock* (<em>tSampleBlock*</em>): The block to fill
+ * * *iPtrArgs* (<em>void*</em>): User data, in fact a <em>tEncodeStruct*</em>
+ * Return::
+ * * _int_: 0
+ */
+static int samplebuffer_processBlock_encode(
+  tSampleBlock* ioPtrBlock,
+  void* iPtrArgs) {
+  tSampleBuffer* lPtrBuffer = ((tEncodeStruct*)iPtrArgs)->ptrBuffer;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+
+  for (lIdxChannel = 0; lIdxChannel < lPtrBuffer->nbrChannels; ++lIdxChannel) {
+    tSampleValue* lPtrBlockValues = ioPtrBlock->values[lIdxChannel];
+    tSampleIndex lIdxValue = lPtrBuffer->offset + ioPtrBlock->idxFirstSample*lPtrBuffer->sampleStride + lIdxChannel*lPtrBuffer->channelStride;
+    if (lPtrBuffer->ptrStorage->type == SAMPLEBUFFER_TYPE_INT) {
+      tSampleValue* lPtrValues = ((tSampleValue*)lPtrBuffer->ptrStorage->values) + lIdxValue;
+      for (lIdxSample = 0; lIdxSample < ioPtrBlock->nbrSamples; ++lIdxSample) {
+        lPtrBlockValues[lIdxSample] = lPtrValues[lIdxSample*lPtrBuffer->sampleStride];
+      }
+    } else {
+      float* lPtrValues = ((float*)lPtrBuffer->ptrStorage->values) + lIdxValue;
+      for (lIdxSample = 0; lIdxSample < ioPtrBlock->nbrSamples; ++lIdxSample) {
+        lPtrBlockValues[lIdxSample] = samplebuffer_round(lPtrValues[lIdxSample*lPtrBuffer->sampleStride]);
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Initialize the encoding arguments of a part of a raw buffer
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The encoding arguments, in fact a <em>const tEncodeStruct*</em>
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize, in fact a <em>tEncodeStruct*</em>
+ * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): Offset of the first sample of the part
+ */
+static void samplebuffer_initSliceArgs_encode(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxOffsetSample) {
+  // Blocks give the index of their samples in the whole buffer
+  *((tEncodeStruct*)oPtrSliceArgs) = *((const tEncodeStruct*)iPtrArgs);
+}
+
+// Parallel processing of encodings
+static const tParallelFcts gParallelFcts_encode = {
+  sizeof(tEncodeStruct),
+  &samplebuffer_initSliceArgs_encode,
+  NULL
+};
+
+/**
+ * Encode the samples as PCM.
+ * Values exceeding the range of the samples are saturated, and reported as clipped samples.
+ *
+ * Parameters::
+ * * *iSelf* (<em>WSK::SampleBuffer</em>): Self
+ * * *iArgc* (_int_): Number of arguments
+ * * *iArgv* (<em>VALUE*</em>): Arguments:
+ *   * *iValNbrBitsPerSample* (_Integer_): The number of bits per sample
+ *   * *iValOutput* (_Object_): Where to encode samples [optional = nil]:
+ *     * nil: A new String is returned.
+ *     * _String_: Samples are appended to this raw buffer.
+ *     * Container of an output file mapped for write (created with IOUtils#mapFileForWrite): Samples are written in it.
+ *   * *iValOutputOffset* (_Integer_): Offset of the samples in the mapped output file, if any [optional = nil]
+ * Return::
+ * * _String_: The raw buffer, or nil if the samples were written in a mapped file
+ */
+static VALUE samplebuffer_encode(
+  int iArgc,
+  VALUE* iArgv,
+  VALUE iSelf) {
+  VALUE lValNbrBitsPerSample, lValOutput, lValOutputOffset;
+  rb_scan_args(iArgc, iArgv, "12", &lValNbrBitsPerSample, &lValOutput, &lValOutputOffset);
+  tSampleBuffer* lPtrBuffer = samplebuffer_get(iSelf);
+  int lNbrBitsPerSample = FIX2INT(lValNbrBitsPerSample);
+  if ((lNbrBitsPerSample != 8) &&
+      (lNbrBitsPerSample != 16) &&
+      (lNbrBitsPerSample != 24)) {
+    rb_raise(rb_eRuntimeError, "%d bits PCM data not supported.", lNbrBitsPerSample);
+  }
+  tSampleIndex lSize = lPtrBuffer->nbrSamples*lPtrBuffer->nbrChannels*(lNbrBitsPerSample/8);
+
+  VALUE rValRawBuffer;
+  char* lPtrRawBuffer;
+  if (RB_TYPE_P(lValOutput, T_STRING)) {
+    // Append to the raw buffer, growing it geometrically so that appending stays linear
+    long lOldSize = RSTRING_LEN(lValOutput);
+    rb_str_modify(lValOutput);
+    long lCapacity = rb_str_capacity(lValOutput);
+    if (lCapacity < lOldSize + lSize) {
+      rb_str_modify_expand(lValOutput, ((lOldSize + lSize > 2*lCapacity) ? lOldSize + lSize : 2*lCapacity) - lOldSize);
+    }
+    lPtrRawBuffer = RSTRING_PTR(lValOutput) + lOldSize;
+    rValRawBuffer = lValOutput;
+  } else {
+    lPtrRawBuffer = commonutils_getOutputBuffer(lValOutput, lValOutputOffset, lSize, &rValRawBuffer);
+  }
+
+  tEncodeStruct lEncode;
+  lEncode.ptrBuffer = lPtrBuffer;
+  commonutils_iterateBlocksThroughRawBufferOutputOnly(iSelf, lPtrRawBuffer, lNbrBitsPerSample, lPtrBuffer->nbrChannels, lPtrBuffer->nbrSamples, 0, 1, &samplebuffer_processBlock_encode, &lEncode, &gParallelFcts_encode);
+  if (RB_TYPE_P(lValOutput, T_STRING)) {
+    rb_str_set_len(lValOutput, RSTRING_LEN(lValOutput) + lSize);
+  }
+
+  return rValRawBuffer;
+}
+
+// Initialize the module
+void Init_SampleBuffer() {
+  VALUE lWSKModule = rb_define_module("WSK");
+  gSampleBufferClass = rb_define_class_under(lWSKModule, "SampleBuffer", rb_cObject);
+
+  rb_define_alloc_func(gSampleBufferClass, samplebuffer_alloc);
+  rb_define_method(gSampleBufferClass, "initialize", samplebuffer_initialize, -1);
+  rb_define_singleton_method(gSampleBufferClass, "decode", samplebuffer_decodeNew, -1);
+  rb_define_singleton_method(gSampleBufferClass, "fromArray", samplebuffer_fromArray, -1);
+  rb_define_method(gSampleBufferClass, "decode!", samplebuffer_decodeInPlace, 3);
+  rb_define_method(gSampleBufferClass, "encode", samplebuffer_encode, -1);
+  rb_define_method(gSampleBufferClass, "toArray", samplebuffer_toArray, 0);
+  rb_define_method(gSampleBufferClass, "nbrSamples", samplebuffer_nbrSamples, 0);
+  rb_define_method(gSampleBufferClass, "nbrChannels", samplebuffer_nbrChannels, 0);
+  rb_define_method(gSampleBufferClass, "float?", samplebuffer_isFloat, 0);
+  rb_define_method(gSampleBufferClass, "channel", samplebuffer_channel, 1);
+  rb_define_method(gSampleBufferClass, "slice", samplebuffer_slice, 2);
+  rb_define_method(gSampleBufferClass, "[]", samplebuffer_getValue, 2);
+  rb_define_method(gSampleBufferClass, "[]=", samplebuffer_setValue, 3);
+  rb_define_method(gSampleBufferClass, "scale!", samplebuffer_scale, 1);
+  rb_define_method(gSampleBufferClass, "offset!", samplebuffer_offset, 1);
+  rb_define_method(gSampleBufferClass, "clamp!", samplebuffer_clamp, 2);
+  rb_define_method(gSampleBufferClass, "fade!", samplebuffer_fade, 3);
+}
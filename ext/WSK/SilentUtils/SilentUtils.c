@@ -31,102 +31,121 @@ typedef struct {
 } tNextSilentInThresholdsStruct;
 
 /**
- * Process a value read from an input buffer for the NextSilentSample function.
+ * Is a sample of a block within thresholds on all its channels ?
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block
+ * * *iIdxBlockSample* (<em>const tSampleIndex</em>): Index of the sample in the block
+ * * *iPtrThresholds* (<em>const tThresholdInfo*</em>): The thresholds, per channel
+ * Return::
+ * * _int_: 1 if all the channels are within thresholds, 0 otherwise
+ */
+static inline int silentutils_isSampleWithinThresholds(
+  const tSampleBlock* iPtrBlock,
+  const tSampleIndex iIdxBlockSample,
+  const tThresholdInfo* iPtrThresholds) {
+  int lIdxChannel;
+  tSampleValue lValue;
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lValue = iPtrBlock->values[lIdxChannel][iIdxBlockSample];
+    if ((lValue < iPtrThresholds[lIdxChannel].min) ||
+        (lValue > iPtrThresholds[lIdxChannel].max)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Process a block read from an input buffer for the NextSilentSample function.
+ * A sample is silent only if all its channels are within the silence thresholds.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tFindSilentStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int silentutils_processValue(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int silentutils_processBlock(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
-  int rResult = 0;
-
   // Interpret parameters
   tFindSilentStruct* lPtrVariables = (tFindSilentStruct*)iPtrArgs;
 
-  if ((iValue < (lPtrVariables->ptrSilenceThresholds)[iIdxChannel].min) ||
-      (iValue > (lPtrVariables->ptrSilenceThresholds)[iIdxChannel].max)) {
-    // This value is not silent
-    // If we were in silence that has not yet reached its minimal duration, cancel this last silence
-    *(lPtrVariables->ptrIdxFirstSilentSample) = -1;
-    // Don't even read other channels
-    rResult = 2;
-  } else {
-    // This value is silent
-    if ((*(lPtrVariables->ptrIdxFirstSilentSample)) == -1) {
-      // This is the first silent value we have
-      *(lPtrVariables->ptrIdxFirstSilentSample) = iIdxSample;
-    }
-    // Check if the minimal duration has been reached
-    if (iIdxSample - (*(lPtrVariables->ptrIdxFirstSilentSample)) + 1 >= lPtrVariables->minSilenceSamples) {
-      // We have found a silence according to thresholds.
-      *(lPtrVariables->ptrIdxSilenceSample_Result) = *(lPtrVariables->ptrIdxFirstSilentSample);
-      // Stop iterations
-      rResult = 1;
+  tSampleIndex lIdxBlockSample;
+  tSampleIndex lIdxSample;
+  for (lIdxBlockSample = 0; lIdxBlockSample < iPtrBlock->nbrSamples; ++lIdxBlockSample) {
+    if (silentutils_isSampleWithinThresholds(iPtrBlock, lIdxBlockSample, lPtrVariables->ptrSilenceThresholds)) {
+      // This sample is silent
+      lIdxSample = iPtrBlock->idxFirstSample + lIdxBlockSample;
+      if ((*(lPtrVariables->ptrIdxFirstSilentSample)) == -1) {
+        // This is the first silent sample we have
+        *(lPtrVariables->ptrIdxFirstSilentSample) = lIdxSample;
+      }
+      // Check if the minimal duration has been reached
+      if (lIdxSample - (*(lPtrVariables->ptrIdxFirstSilentSample)) + 1 >= lPtrVariables->minSilenceSamples) {
+        // We have found a silence according to thresholds.
+        *(lPtrVariables->ptrIdxSilenceSample_Result) = *(lPtrVariables->ptrIdxFirstSilentSample);
+        // Stop iterations
+        return 1;
+      }
+    } else {
+      // This sample is not silent
+      // If we were in silence that has not yet reached its minimal duration, cancel this last silence
+      *(lPtrVariables->ptrIdxFirstSilentSample) = -1;
     }
   }
 
-  return rResult;
+  return 0;
 }
 
 /**
- * Process a value read from an input buffer for the NextSilentSample function.
- * Do it in backwards search.
+ * Process a block read from an input buffer for the NextSilentSample function.
+ * Do it in backwards search: the block's samples are parsed from the last one to the first one.
+ * A sample is silent only if all its channels are within the silence thresholds.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tFindSilentStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int silentutils_Reverse_processValue(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int silentutils_Reverse_processBlock(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
-  int rResult = 0;
-
   // Interpret parameters
   tFindSilentStruct* lPtrVariables = (tFindSilentStruct*)iPtrArgs;
 
-  if ((iValue < (lPtrVariables->ptrSilenceThresholds)[iIdxChannel].min) ||
-      (iValue > (lPtrVariables->ptrSilenceThresholds)[iIdxChannel].max)) {
-    // This value is not silent
-    // If we were in silence that has not yet reached its minimal duration, cancel this last silence
-    *(lPtrVariables->ptrIdxFirstSilentSample) = -1;
-    // Don't even read other channels
-    rResult = 2;
-  } else {
-    // This value is silent
-    if ((*(lPtrVariables->ptrIdxFirstSilentSample)) == -1) {
-      // This is the first silent value we have
-      *(lPtrVariables->ptrIdxFirstSilentSample) = iIdxSample;
-    }
-    // Check if the minimal duration has been reached
-    if ((*(lPtrVariables->ptrIdxFirstSilentSample)) - iIdxSample + 1 >= lPtrVariables->minSilenceSamples) {
-      // We have found a silence according to thresholds.
-      *(lPtrVariables->ptrIdxSilenceSample_Result) = *(lPtrVariables->ptrIdxFirstSilentSample);
-      // Stop iterations
-      rResult = 1;
+  tSampleIndex lIdxBlockSample;
+  tSampleIndex lIdxSample;
+  for (lIdxBlockSample = iPtrBlock->nbrSamples - 1; lIdxBlockSample >= 0; --lIdxBlockSample) {
+    if (silentutils_isSampleWithinThresholds(iPtrBlock, lIdxBlockSample, lPtrVariables->ptrSilenceThresholds)) {
+      // This sample is silent
+      lIdxSample = iPtrBlock->idxFirstSample + lIdxBlockSample;
+      if ((*(lPtrVariables->ptrIdxFirstSilentSample)) == -1) {
+        // This is the first silent sample we have
+        *(lPtrVariables->ptrIdxFirstSilentSample) = lIdxSample;
+      }
+      // Check if the minimal duration has been reached
+      if ((*(lPtrVariables->ptrIdxFirstSilentSample)) - lIdxSample + 1 >= lPtrVariables->minSilenceSamples) {
+        // We have found a silence according to thresholds.
+        *(lPtrVariables->ptrIdxSilenceSample_Result) = *(lPtrVariables->ptrIdxFirstSilentSample);
+        // Stop iterations
+        return 1;
+      }
+    } else {
+      // This sample is not silent
+      // If we were in silence that has not yet reached its minimal duration, cancel this last silence
+      *(lPtrVariables->ptrIdxFirstSilentSample) = -1;
     }
   }
 
-  return rResult;
+  return 0;
 }
 
 /**
@@ -161,9 +180,9 @@ static VALUE silentutils_blockEachRawBuffer(
   VALUE iValBackwardsSearch = rb_ary_entry(iValContextArgs, 3);
   // Translate parameters in C types
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   int iNbrChannels = FIX2INT(iValNbrChannels);
-  tSampleIndex iMinSilenceSamples = FIX2LONG(iValMinSilenceSamples);
+  tSampleIndex iMinSilenceSamples = NUM2LL(iValMinSilenceSamples);
   // Get C pointers back from the data
   tNextSilentInThresholdsStruct* lPtrData;
   Data_Get_Struct(iValData, tNextSilentInThresholdsStruct, lPtrData);
@@ -185,24 +204,25 @@ static VALUE silentutils_blockEachRawBuffer(
 
   // Iterate through the raw buffer
   if (iValBackwardsSearch == Qtrue) {
-    commonutils_iterateReverseThroughRawBuffer(
+    commonutils_iterateReverseBlocksThroughRawBuffer(
       lPtrRawBuffer,
       iNbrBitsPerSample,
       iNbrChannels,
       iNbrSamples,
       *lPtrIdxSample,
-      &silentutils_Reverse_processValue,
+      &silentutils_Reverse_processBlock,
       &lProcessVariables
     );
   } else {
-    commonutils_iterateThroughRawBuffer(
+    commonutils_iterateBlocksThroughRawBuffer(
       lPtrRawBuffer,
       iNbrBitsPerSample,
       iNbrChannels,
       iNbrSamples,
       *lPtrIdxSample,
-      &silentutils_processValue,
-      &lProcessVariables
+      &silentutils_processBlock,
+      &lProcessVariables,
+      NULL
     );
   }
 
@@ -244,7 +264,7 @@ static VALUE silentutils_getNextSilentInThresholds(
   VALUE rValNextSilentSample = Qnil;
 
   // Translate parameters in C types
-  tSampleIndex iIdxStartSample = FIX2LONG(iValIdxStartSample);
+  tSampleIndex iIdxStartSample = NUM2LL(iValIdxStartSample);
 
   // The cursor of samples. Set it to the first sample we start from searching.
   tSampleIndex lIdxSample = iIdxStartSample;
@@ -273,7 +293,7 @@ static VALUE silentutils_getNextSilentInThresholds(
   tNextSilentInThresholdsStruct lData;
   lData.ptrIdxSample = &lIdxSample;
   lData.ptrIdxFirstSilentSample = &lIdxFirstSilentSample;
-  lData.ptrSilenceThresholds = &lSilenceThresholds;
+  lData.ptrSilenceThresholds = lSilenceThresholds;
   lData.ptrIdxSilenceSample_Result = &lIdxSilenceSample_Result;
   VALUE lValData = Data_Wrap_Struct(rb_cObject, NULL, NULL, &lData);
 
@@ -282,7 +302,7 @@ static VALUE silentutils_getNextSilentInThresholds(
 
   // Parse the data, using thresholds matching only
   VALUE lEachArgs[1];
-  lEachArgs[0] = LONG2FIX(lIdxSample);
+  lEachArgs[0] = LL2NUM(lIdxSample);
   if (iValBackwardsSearch == Qtrue) {
     rb_block_call(
       iValInputData,
@@ -312,44 +332,69 @@ static VALUE silentutils_getNextSilentInThresholds(
   }
 
   if (lIdxSilenceSample_Result != -1) {
-    rValNextSilentSample = LONG2FIX(lIdxSilenceSample_Result);
+    rValNextSilentSample = LL2NUM(lIdxSilenceSample_Result);
   }
 
   return rValNextSilentSample;
 }
 
 /**
- * Process a value read from an input buffer for the NextSilentSample function.
+ * Process a block read from an input buffer for the getSampleBeyondThresholds function.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact an <em>tFirstSampleBeyondThresholdStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int silentutils_sbt_processValue(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int silentutils_sbt_processBlock(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
-  int rResult = 0;
+  // Interpret parameters
+  tFirstSampleBeyondThresholdStruct* lPtrVariables = (tFirstSampleBeyondThresholdStruct*)iPtrArgs;
 
+  tSampleIndex lIdxBlockSample;
+  for (lIdxBlockSample = 0; lIdxBlockSample < iPtrBlock->nbrSamples; ++lIdxBlockSample) {
+    if (!silentutils_isSampleWithinThresholds(iPtrBlock, lIdxBlockSample, lPtrVariables->ptrThresholds)) {
+      // This sample is not silent
+      *(lPtrVariables->ptrIdxSample_Result) = iPtrBlock->idxFirstSample + lIdxBlockSample;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Process a block read from an input buffer for the getSampleBeyondThresholds function.
+ * Do it in backwards search: the block's samples are parsed from the last one to the first one.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact an <em>tFirstSampleBeyondThresholdStruct*</em>.
+ * Return::
+ * * _int_: The return code:
+ * ** 0: Continue iteration
+ * ** 1: Break all iterations
+ */
+int silentutils_sbt_Reverse_processBlock(
+  const tSampleBlock* iPtrBlock,
+  void* iPtrArgs) {
   // Interpret parameters
   tFirstSampleBeyondThresholdStruct* lPtrVariables = (tFirstSampleBeyondThresholdStruct*)iPtrArgs;
 
-  if ((iValue < (lPtrVariables->ptrThresholds)[iIdxChannel].min) ||
-      (iValue > (lPtrVariables->ptrThresholds)[iIdxChannel].max)) {
-    // This value is not silent
-    rResult = 1;
-    *(lPtrVariables->ptrIdxSample_Result) = iIdxSample;
+  tSampleIndex lIdxBlockSample;
+  for (lIdxBlockSample = iPtrBlock->nbrSamples - 1; lIdxBlockSample >= 0; --lIdxBlockSample) {
+    if (!silentutils_isSampleWithinThresholds(iPtrBlock, lIdxBlockSample, lPtrVariables->ptrThresholds)) {
+      // This sample is not silent
+      *(lPtrVariables->ptrIdxSample_Result) = iPtrBlock->idxFirstSample + lIdxBlockSample;
+      return 1;
+    }
   }
 
-  return rResult;
+  return 0;
 }
 
 /**
@@ -377,7 +422,7 @@ static VALUE silentutils_getSampleBeyondThresholds(
   VALUE rValIdxFirstSample = Qnil;
 
   // Translate parameters in C types
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   int iNbrChannels = FIX2INT(iValNbrChannels);
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   // Get the underlying char*
@@ -400,28 +445,29 @@ static VALUE silentutils_getSampleBeyondThresholds(
 
   // Parse the buffer
   if (iValLastSample == Qtrue) {
-    commonutils_iterateReverseThroughRawBuffer(
+    commonutils_iterateReverseBlocksThroughRawBuffer(
       lPtrRawBuffer,
       iNbrBitsPerSample,
       iNbrChannels,
       iNbrSamples,
       iNbrSamples-1,
-      &silentutils_sbt_processValue,
+      &silentutils_sbt_Reverse_processBlock,
       &lProcessVariables
     );
   } else {
-    commonutils_iterateThroughRawBuffer(
+    commonutils_iterateBlocksThroughRawBuffer(
       lPtrRawBuffer,
       iNbrBitsPerSample,
       iNbrChannels,
       iNbrSamples,
       0,
-      &silentutils_sbt_processValue,
-      &lProcessVariables
+      &silentutils_sbt_processBlock,
+      &lProcessVariables,
+      NULL
     );
   }
   if (lIdxSampleOut != -1) {
-    rValIdxFirstSample = LONG2FIX(lIdxSampleOut);
+    rValIdxFirstSample = LL2NUM(lIdxSampleOut);
   }
 
   return rValIdxFirstSample;
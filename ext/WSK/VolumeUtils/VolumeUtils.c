@@ -6,6 +6,7 @@
 #include "ruby.h"
 #include <math.h>
 #include <stdio.h>
+#include <limits.h>
 #include <CommonUtils.h>
 #include <gmp.h>
 
@@ -50,41 +51,38 @@ typedef struct {
 
 // Struct used to convey data among iterators in the MeasureLevel method
 typedef struct {
+  int nbrChannels;
   mpz_t* squareSums;
   tSampleValue* maxAbsValue;
-  mpz_t tmpInt;
 } tMeasureLevelStruct;
 
 /**
- * Process a value read from an input buffer for the applyVolumeFct function in case of piecewise linear function.
+ * Process a block read from an input buffer for the applyVolumeFct function in case of piecewise linear function.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tApplyVolumeFctStruct_PiecewiseLinear*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int volumeutils_processValue_applyVolumeFct_PiecewiseLinear(
-  const tSampleValue iValue,
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int volumeutils_processBlock_applyVolumeFct_PiecewiseLinear(
+  const tSampleBlock* iPtrBlock,
+  tSampleBlock* oPtrBlock,
   void* iPtrArgs) {
   tApplyVolumeFctStruct_PiecewiseLinear* lPtrArgs = (tApplyVolumeFctStruct_PiecewiseLinear*)iPtrArgs;
 
-  // Change caches if needed
-  if (iIdxChannel == 0) {
+  tSampleIndex lIdxBlockSample;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxBlockSample = 0; lIdxBlockSample < iPtrBlock->nbrSamples; ++lIdxBlockSample) {
+    lIdxSample = iPtrBlock->idxFirstSample + lIdxBlockSample;
+    // Change caches if needed
     // Switch to the next segment if we arrived at the end and it is the last one
-    if ((iIdxSample == lPtrArgs->idxNextSegmentX) &&
+    if ((lIdxSample == lPtrArgs->idxNextSegmentX) &&
         (lPtrArgs->idxNextPoint != lPtrArgs->idxLastPoint)) {
-/*
-      printf("[%lld] Changing segment (%lld reached) to [%d - %d] ([%lld - %lld])\n", iIdxSample, lPtrArgs->idxNextSegmentX, lPtrArgs->idxPreviousPoint+1, lPtrArgs->idxNextPoint+1, lPtrArgs->fctData->pointsX[lPtrArgs->idxPreviousPoint+1], lPtrArgs->fctData->pointsX[lPtrArgs->idxNextPoint+1]);
-*/
       ++lPtrArgs->idxNextPoint;
       ++lPtrArgs->idxPreviousPoint;
       // Compute next cache values
@@ -96,23 +94,58 @@ int volumeutils_processValue_applyVolumeFct_PiecewiseLinear(
     }
     // Compute the ratio to apply
     if (lPtrArgs->unitDB == 1) {
-      lPtrArgs->currentRatio = pow(2, (lPtrArgs->idxPreviousPointY+((iIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX)/6);
+      lPtrArgs->currentRatio = pow(2, (lPtrArgs->idxPreviousPointY+((lIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX)/6);
     } else {
-      lPtrArgs->currentRatio = lPtrArgs->idxPreviousPointY+((iIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX;
+      lPtrArgs->currentRatio = lPtrArgs->idxPreviousPointY+((lIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX;
     }
-/*
-    if ((iIdxSample > 26563930) && (iIdxSample < 26563940)) {
-      printf("[%lld] idxPreviousPoint=%d idxPreviousPointX=%lld idxPreviousPointY=%Lf idxNextPoint=%d distWithNextX=%lld distWithNextY=%Lf idxNextSegmentX=%lld currentRatio=%Lf\n", iIdxSample, lPtrArgs->idxPreviousPoint, lPtrArgs->idxPreviousPointX, lPtrArgs->idxPreviousPointY, lPtrArgs->idxNextPoint, lPtrArgs->distWithNextX, lPtrArgs->distWithNextY, lPtrArgs->idxNextSegmentX, lPtrArgs->currentRatio);
+    // Write the correct values
+    for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+      oPtrBlock->values[lIdxChannel][lIdxBlockSample] = iPtrBlock->values[lIdxChannel][lIdxBlockSample]*lPtrArgs->currentRatio;
     }
-*/
   }
 
-  // Write the correct value
-  (*oPtrValue) = iValue*lPtrArgs->currentRatio;
-  
   return 0;
 }
 
+/**
+ * Initialize the arguments of a part of the buffer processed by a thread for the applyVolumeFct function in case of piecewise linear function.
+ * The segment is moved to the one the previous samples' processing would end on.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tApplyVolumeFctStruct_PiecewiseLinear*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tApplyVolumeFctStruct_PiecewiseLinear*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
+ */
+static void volumeutils_initSliceArgs_applyVolumeFct_PiecewiseLinear(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  tApplyVolumeFctStruct_PiecewiseLinear* lPtrArgs = (tApplyVolumeFctStruct_PiecewiseLinear*)oPtrSliceArgs;
+  *lPtrArgs = *((const tApplyVolumeFctStruct_PiecewiseLinear*)iPtrArgs);
+  // Switch segments the same way processing previous samples does: at most once per sample
+  tSampleIndex lIdxSwitchSample = -1;
+  while ((lPtrArgs->idxNextPoint != lPtrArgs->idxLastPoint) &&
+         (lPtrArgs->idxNextSegmentX > lIdxSwitchSample) &&
+         (lPtrArgs->idxNextSegmentX < iIdxFirstSample)) {
+    lIdxSwitchSample = lPtrArgs->idxNextSegmentX;
+    ++lPtrArgs->idxNextPoint;
+    ++lPtrArgs->idxPreviousPoint;
+    // Compute next cache values
+    lPtrArgs->idxPreviousPointX = lPtrArgs->fctData->pointsX[lPtrArgs->idxPreviousPoint];
+    lPtrArgs->distWithNextX = lPtrArgs->fctData->pointsX[lPtrArgs->idxNextPoint]-lPtrArgs->idxPreviousPointX;
+    lPtrArgs->idxPreviousPointY = lPtrArgs->fctData->pointsY[lPtrArgs->idxPreviousPoint];
+    lPtrArgs->distWithNextY = lPtrArgs->fctData->pointsY[lPtrArgs->idxNextPoint]-lPtrArgs->idxPreviousPointY;
+    lPtrArgs->idxNextSegmentX = lPtrArgs->fctData->pointsX[lPtrArgs->idxNextPoint]+1;
+  }
+}
+
+// Functions processing parts of a buffer in parallel for the applyVolumeFct function in case of piecewise linear function
+static const tParallelFcts gParallelFcts_applyVolumeFct_PiecewiseLinear = {
+  sizeof(tApplyVolumeFctStruct_PiecewiseLinear),
+  &volumeutils_initSliceArgs_applyVolumeFct_PiecewiseLinear,
+  NULL
+};
+
 /**
  * Apply a function on the volume of an input buffer, and outputs a result buffer.
  *
@@ -125,8 +158,10 @@ int volumeutils_processValue_applyVolumeFct_PiecewiseLinear(
  * * *iValNbrSamples* (_Integer_): Number of samples
  * * *iValIdxBufferFirstSample* (_Integer_): Index of the first buffer's sample in the input data
  * * *iValUnitDB* (_Boolean_): Are the units in DB scale ?
+ * * *iValOutputMappedFile* (_Object_): The container of a file mapped for write receiving the output, or nil to output a String (see commonutils_getOutputBuffer)
+ * * *iValOutputOffset* (_Integer_): Offset of the output in the mapped file, or nil
  * Return::
- * * _String_: Output buffer
+ * * _String_: Output buffer, or nil if it was written in the mapped file
  **/
 static VALUE volumeutils_applyVolumeFct(
   VALUE iSelf,
@@ -136,21 +171,24 @@ static VALUE volumeutils_applyVolumeFct(
   VALUE iValNbrChannels,
   VALUE iValNbrSamples,
   VALUE iValIdxBufferFirstSample,
-  VALUE iValUnitDB) {
+  VALUE iValUnitDB,
+  VALUE iValOutputMappedFile,
+  VALUE iValOutputOffset) {
   // Translate Ruby objects
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   int iNbrChannels = FIX2INT(iValNbrChannels);
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
-  tSampleIndex iIdxBufferFirstSample = FIX2LONG(iValIdxBufferFirstSample);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
+  tSampleIndex iIdxBufferFirstSample = NUM2LL(iValIdxBufferFirstSample);
   int iUnitDB = (iValUnitDB == Qtrue ? 1 : 0);
   // Get the C function
   tFunction* lPtrFct;
   Data_Get_Struct(iValCFunction, tFunction, lPtrFct);
   // Get the input buffer
   char* lPtrRawBuffer = RSTRING_PTR(iValInputBuffer);
-  int lBufferCharSize = RSTRING_LEN(iValInputBuffer);
-  // Allocate the output buffer
-  char* lPtrOutputBuffer = ALLOC_N(char, lBufferCharSize);
+  tSampleIndex lBufferCharSize = RSTRING_LEN(iValInputBuffer);
+  // Get the output buffer
+  VALUE rValOutputBuffer;
+  char* lPtrOutputBuffer = commonutils_getOutputBuffer(iValOutputMappedFile, iValOutputOffset, lBufferCharSize, &rValOutputBuffer);
 
   // Call the relevant method based on the type
   switch (lPtrFct->fctType) {
@@ -180,7 +218,7 @@ static VALUE volumeutils_applyVolumeFct(
       lProcessParams.distWithNextY = lProcessParams.fctData->pointsY[lProcessParams.idxNextPoint]-lProcessParams.idxPreviousPointY;
       lProcessParams.idxNextSegmentX = lProcessParams.fctData->pointsX[lProcessParams.idxNextPoint]+1;
       // Iterate through the raw buffer
-      commonutils_iterateThroughRawBufferOutput(
+      commonutils_iterateBlocksThroughRawBufferOutput(
         iSelf,
         lPtrRawBuffer,
         lPtrOutputBuffer,
@@ -189,8 +227,9 @@ static VALUE volumeutils_applyVolumeFct(
         iNbrSamples,
         iIdxBufferFirstSample,
         1,
-        &volumeutils_processValue_applyVolumeFct_PiecewiseLinear,
-        &lProcessParams
+        &volumeutils_processBlock_applyVolumeFct_PiecewiseLinear,
+        &lProcessParams,
+        &gParallelFcts_applyVolumeFct_PiecewiseLinear
       );
       break;
     default: ; // The ; is here to make gcc compile: variables declarations are forbidden after a label.
@@ -200,41 +239,35 @@ static VALUE volumeutils_applyVolumeFct(
       break;
   }
 
-  VALUE rValOutputBuffer = rb_str_new(lPtrOutputBuffer, lBufferCharSize);
-
-  free(lPtrOutputBuffer);
-
   return rValOutputBuffer;
 }
 
 /**
- * Process a value read from an input buffer for the drawVolumeFct function in case of piecewise linear function.
+ * Fill a block for the drawVolumeFct function in case of piecewise linear function.
  *
  * Parameters::
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
- * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tApplyVolumeFctStruct_PiecewiseLinear*</em>.
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
+ * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tDrawVolumeFctStruct_PiecewiseLinear*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int volumeutils_processValue_drawVolumeFct_PiecewiseLinear(
-  tSampleValue* oPtrValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int volumeutils_processBlock_drawVolumeFct_PiecewiseLinear(
+  tSampleBlock* oPtrBlock,
   void* iPtrArgs) {
   tDrawVolumeFctStruct_PiecewiseLinear* lPtrArgs = (tDrawVolumeFctStruct_PiecewiseLinear*)iPtrArgs;
 
-  // Change caches if needed
-  if (iIdxChannel == 0) {
+  tSampleIndex lIdxBlockSample;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  tSampleValue lValue;
+  for (lIdxBlockSample = 0; lIdxBlockSample < oPtrBlock->nbrSamples; ++lIdxBlockSample) {
+    lIdxSample = oPtrBlock->idxFirstSample + lIdxBlockSample;
+    // Change caches if needed
     // Switch to the next segment if we arrived at the end and it is the last one
-    if ((iIdxSample == lPtrArgs->idxNextSegmentX) &&
+    if ((lIdxSample == lPtrArgs->idxNextSegmentX) &&
         (lPtrArgs->idxNextPoint != lPtrArgs->idxLastPoint)) {
-/*
-      printf("[%lld] Changing segment (%lld reached) to [%d - %d] ([%lld - %lld])\n", iIdxSample, lPtrArgs->idxNextSegmentX, lPtrArgs->idxPreviousPoint+1, lPtrArgs->idxNextPoint+1, lPtrArgs->fctData->pointsX[lPtrArgs->idxPreviousPoint+1], lPtrArgs->fctData->pointsX[lPtrArgs->idxNextPoint+1]);
-*/
       ++lPtrArgs->idxNextPoint;
       ++lPtrArgs->idxPreviousPoint;
       // Compute next cache values
@@ -246,23 +279,59 @@ int volumeutils_processValue_drawVolumeFct_PiecewiseLinear(
     }
     // Compute the ratio to apply
     if (lPtrArgs->unitDB == 1) {
-      lPtrArgs->currentRatio = pow(2, (lPtrArgs->idxPreviousPointY+((iIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX)/6);
+      lPtrArgs->currentRatio = pow(2, (lPtrArgs->idxPreviousPointY+((lIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX)/6);
     } else {
-      lPtrArgs->currentRatio = lPtrArgs->idxPreviousPointY+((iIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX;
+      lPtrArgs->currentRatio = lPtrArgs->idxPreviousPointY+((lIdxSample-lPtrArgs->idxPreviousPointX)*lPtrArgs->distWithNextY)/lPtrArgs->distWithNextX;
     }
-/*
-    if ((iIdxSample > 15) && (iIdxSample < 25)) {
-      printf("[%lld] idxPreviousPoint=%d idxPreviousPointX=%lld idxPreviousPointY=%Lf idxNextPoint=%d distWithNextX=%lld distWithNextY=%Lf idxNextSegmentX=%lld idxLastPoint=%d currentRatio=%Lf\n", iIdxSample, lPtrArgs->idxPreviousPoint, lPtrArgs->idxPreviousPointX, lPtrArgs->idxPreviousPointY, lPtrArgs->idxNextPoint, lPtrArgs->distWithNextX, lPtrArgs->distWithNextY, lPtrArgs->idxNextSegmentX, lPtrArgs->idxLastPoint, lPtrArgs->currentRatio);
+    // Write the correct values
+    lValue = (lPtrArgs->medianValue)*(lPtrArgs->currentRatio);
+    for (lIdxChannel = 0; lIdxChannel < oPtrBlock->nbrChannels; ++lIdxChannel) {
+      oPtrBlock->values[lIdxChannel][lIdxBlockSample] = lValue;
     }
-*/
-}
-
-  // Write the correct value
-  (*oPtrValue) = (lPtrArgs->medianValue)*(lPtrArgs->currentRatio);
+  }
 
   return 0;
 }
 
+/**
+ * Initialize the arguments of a part of the buffer processed by a thread for the drawVolumeFct function in case of piecewise linear function.
+ * The segment is moved to the one the previous samples' processing would end on.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tDrawVolumeFctStruct_PiecewiseLinear*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tDrawVolumeFctStruct_PiecewiseLinear*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
+ */
+static void volumeutils_initSliceArgs_drawVolumeFct_PiecewiseLinear(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  tDrawVolumeFctStruct_PiecewiseLinear* lPtrArgs = (tDrawVolumeFctStruct_PiecewiseLinear*)oPtrSliceArgs;
+  *lPtrArgs = *((const tDrawVolumeFctStruct_PiecewiseLinear*)iPtrArgs);
+  // Switch segments the same way processing previous samples does: at most once per sample
+  tSampleIndex lIdxSwitchSample = -1;
+  while ((lPtrArgs->idxNextPoint != lPtrArgs->idxLastPoint) &&
+         (lPtrArgs->idxNextSegmentX > lIdxSwitchSample) &&
+         (lPtrArgs->idxNextSegmentX < iIdxFirstSample)) {
+    lIdxSwitchSample = lPtrArgs->idxNextSegmentX;
+    ++lPtrArgs->idxNextPoint;
+    ++lPtrArgs->idxPreviousPoint;
+    // Compute next cache values
+    lPtrArgs->idxPreviousPointX = lPtrArgs->fctData->pointsX[lPtrArgs->idxPreviousPoint];
+    lPtrArgs->distWithNextX = lPtrArgs->fctData->pointsX[lPtrArgs->idxNextPoint]-lPtrArgs->idxPreviousPointX;
+    lPtrArgs->idxPreviousPointY = lPtrArgs->fctData->pointsY[lPtrArgs->idxPreviousPoint];
+    lPtrArgs->distWithNextY = lPtrArgs->fctData->pointsY[lPtrArgs->idxNextPoint]-lPtrArgs->idxPreviousPointY;
+    lPtrArgs->idxNextSegmentX = lPtrArgs->fctData->pointsX[lPtrArgs->idxNextPoint]+1;
+  }
+}
+
+// Functions processing parts of a buffer in parallel for the drawVolumeFct function in case of piecewise linear function
+static const tParallelFcts gParallelFcts_drawVolumeFct_PiecewiseLinear = {
+  sizeof(tDrawVolumeFctStruct_PiecewiseLinear),
+  &volumeutils_initSliceArgs_drawVolumeFct_PiecewiseLinear,
+  NULL
+};
+
 /**
  * Draw a function on an output buffer.
  *
@@ -290,14 +359,14 @@ static VALUE volumeutils_drawVolumeFct(
   // Translate Ruby objects
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   int iNbrChannels = FIX2INT(iValNbrChannels);
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
-  tSampleIndex iIdxBufferFirstSample = FIX2LONG(iValIdxBufferFirstSample);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
+  tSampleIndex iIdxBufferFirstSample = NUM2LL(iValIdxBufferFirstSample);
   int iUnitDB = (iValUnitDB == Qtrue ? 1 : 0);
   tSampleValue iMedianValue = FIX2LONG(iValMedianValue);
   // Get the C function
   tFunction* lPtrFct;
   Data_Get_Struct(iValCFunction, tFunction, lPtrFct);
-  int lBufferCharSize = (iNbrSamples*iNbrChannels*iNbrBitsPerSample)/8;
+  tSampleIndex lBufferCharSize = (iNbrSamples*iNbrChannels*iNbrBitsPerSample)/8;
   // Allocate the output buffer
   char* lPtrOutputBuffer = ALLOC_N(char, lBufferCharSize);
 
@@ -327,7 +396,7 @@ static VALUE volumeutils_drawVolumeFct(
       lProcessParams.distWithNextY = lProcessParams.fctData->pointsY[lProcessParams.idxNextPoint]-lProcessParams.idxPreviousPointY;
       lProcessParams.idxNextSegmentX = lProcessParams.fctData->pointsX[lProcessParams.idxNextPoint]+1;
       // Iterate through the raw buffer
-      commonutils_iterateThroughRawBufferOutputOnly(
+      commonutils_iterateBlocksThroughRawBufferOutputOnly(
         iSelf,
         lPtrOutputBuffer,
         iNbrBitsPerSample,
@@ -335,8 +404,9 @@ static VALUE volumeutils_drawVolumeFct(
         iNbrSamples,
         iIdxBufferFirstSample,
         1,
-        &volumeutils_processValue_drawVolumeFct_PiecewiseLinear,
-        &lProcessParams
+        &volumeutils_processBlock_drawVolumeFct_PiecewiseLinear,
+        &lProcessParams,
+        &gParallelFcts_drawVolumeFct_PiecewiseLinear
       );
       break;
     default: ; // The ; is here to make gcc compile: variables declarations are forbidden after a label.
@@ -354,40 +424,126 @@ static VALUE volumeutils_drawVolumeFct(
 }
 
 /**
- * Process a value read from an input buffer for the MeasureLevel function.
- * Use the trigo cache.
+ * Add a 64 bits unsigned integer to an MPZ.
+ * mpz_add_ui only accepts unsigned long, which can be 32 bits only.
  *
  * Parameters::
- * * *iValue* (<em>const tSampleValue</em>): The value being read
- * * *iIdxSample* (<em>const tSampleIndex</em>): Index of this sample
- * * *iIdxChannel* (<em>const int</em>): Channel corresponding to the value being read
+ * * *ioMPZ* (<em>mpz_t</em>): The mpz to modify
+ * * *iValue* (<em>const unsigned long long int</em>): The value to add
+ */
+static void volumeutils_mpzAddULL(
+  mpz_t ioMPZ,
+  const unsigned long long int iValue) {
+  if (iValue > ULONG_MAX) {
+    mpz_t lTmpInt;
+    mpz_init_set_ui(lTmpInt, (unsigned long)(iValue >> 32));
+    mpz_mul_2exp(lTmpInt, lTmpInt, 32);
+    mpz_add_ui(lTmpInt, lTmpInt, (unsigned long)(iValue & 0xFFFFFFFF));
+    mpz_add(ioMPZ, ioMPZ, lTmpInt);
+    mpz_clear(lTmpInt);
+  } else {
+    mpz_add_ui(ioMPZ, ioMPZ, (unsigned long)iValue);
+  }
+}
+
+/**
+ * Process a block read from an input buffer for the MeasureLevel function.
+ *
+ * Parameters::
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block being read
  * * *iPtrArgs* (<em>void*</em>): additional arguments. In fact a <em>tMeasureLevelStruct*</em>.
  * Return::
  * * _int_: The return code:
  * ** 0: Continue iteration
  * ** 1: Break all iterations
- * ** 2: Skip directly to the next sample (don't call us for other channels of this sample)
  */
-int volumeutils_processValue_MeasureLevel(
-  const tSampleValue iValue,
-  const tSampleIndex iIdxSample,
-  const int iIdxChannel,
+int volumeutils_processBlock_MeasureLevel(
+  const tSampleBlock* iPtrBlock,
   void* iPtrArgs) {
   // Interpret parameters
   tMeasureLevelStruct* lPtrParams = (tMeasureLevelStruct*)iPtrArgs;
 
-  // RMS computation
-  mpz_set_si(lPtrParams->tmpInt, iValue);
-  mpz_addmul(lPtrParams->squareSums[iIdxChannel], lPtrParams->tmpInt, lPtrParams->tmpInt);
-  // Peak computation
-  if (abs(iValue) > lPtrParams->maxAbsValue[iIdxChannel]) {
-    lPtrParams->maxAbsValue[iIdxChannel] = abs(iValue);
+  int lIdxChannel;
+  tSampleIndex lIdxSample;
+  const tSampleValue* lPtrValues;
+  // Squares of a block's values fit in 64 bits: they are summed here before being added to the MPZ.
+  unsigned long long int lSquareSum;
+  tSampleValue lMaxAbsValue;
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrValues = iPtrBlock->values[lIdxChannel];
+    lSquareSum = 0;
+    lMaxAbsValue = lPtrParams->maxAbsValue[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iPtrBlock->nbrSamples; ++lIdxSample) {
+      // RMS computation
+      lSquareSum += ((long long int)lPtrValues[lIdxSample])*((long long int)lPtrValues[lIdxSample]);
+      // Peak computation
+      if (abs(lPtrValues[lIdxSample]) > lMaxAbsValue) {
+        lMaxAbsValue = abs(lPtrValues[lIdxSample]);
+      }
+    }
+    volumeutils_mpzAddULL(lPtrParams->squareSums[lIdxChannel], lSquareSum);
+    lPtrParams->maxAbsValue[lIdxChannel] = lMaxAbsValue;
   }
 
-
   return 0;
 }
 
+/**
+ * Initialize the arguments of a part of the buffer processed by a thread for the MeasureLevel function.
+ * The part gets its own sums and maximal values.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>const void*</em>): The iteration arguments. In fact a <em>const tMeasureLevelStruct*</em>.
+ * * *oPtrSliceArgs* (<em>void*</em>): The arguments to initialize. In fact a <em>tMeasureLevelStruct*</em>.
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): Index of the first sample of the part
+ */
+static void volumeutils_initSliceArgs_MeasureLevel(
+  const void* iPtrArgs,
+  void* oPtrSliceArgs,
+  const tSampleIndex iIdxFirstSample) {
+  tMeasureLevelStruct* lPtrSliceParams = (tMeasureLevelStruct*)oPtrSliceArgs;
+  int lNbrChannels = ((const tMeasureLevelStruct*)iPtrArgs)->nbrChannels;
+  lPtrSliceParams->nbrChannels = lNbrChannels;
+  lPtrSliceParams->squareSums = ALLOC_N(mpz_t, lNbrChannels);
+  lPtrSliceParams->maxAbsValue = ALLOC_N(tSampleValue, lNbrChannels);
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < lNbrChannels; ++lIdxChannel) {
+    mpz_init(lPtrSliceParams->squareSums[lIdxChannel]);
+    lPtrSliceParams->maxAbsValue[lIdxChannel] = 0;
+  }
+}
+
+/**
+ * Merge the results of a part of the buffer processed by a thread for the MeasureLevel function, and free them.
+ *
+ * Parameters::
+ * * *ioPtrArgs* (<em>void*</em>): The iteration arguments. In fact a <em>tMeasureLevelStruct*</em>.
+ * * *iPtrSliceArgs* (<em>void*</em>): The arguments of the part. In fact a <em>tMeasureLevelStruct*</em>.
+ */
+static void volumeutils_reduceSliceArgs_MeasureLevel(
+  void* ioPtrArgs,
+  void* iPtrSliceArgs) {
+  tMeasureLevelStruct* lPtrParams = (tMeasureLevelStruct*)ioPtrArgs;
+  tMeasureLevelStruct* lPtrSliceParams = (tMeasureLevelStruct*)iPtrSliceArgs;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < lPtrParams->nbrChannels; ++lIdxChannel) {
+    mpz_add(lPtrParams->squareSums[lIdxChannel], lPtrParams->squareSums[lIdxChannel], lPtrSliceParams->squareSums[lIdxChannel]);
+    mpz_clear(lPtrSliceParams->squareSums[lIdxChannel]);
+    if (lPtrSliceParams->maxAbsValue[lIdxChannel] > lPtrParams->maxAbsValue[lIdxChannel]) {
+      lPtrParams->maxAbsValue[lIdxChannel] = lPtrSliceParams->maxAbsValue[lIdxChannel];
+    }
+  }
+  free(lPtrSliceParams->squareSums);
+  free(lPtrSliceParams->maxAbsValue);
+}
+
+// Functions processing parts of a buffer in parallel for the MeasureLevel function
+static const tParallelFcts gParallelFcts_MeasureLevel = {
+  sizeof(tMeasureLevelStruct),
+  &volumeutils_initSliceArgs_MeasureLevel,
+  &volumeutils_reduceSliceArgs_MeasureLevel
+};
+
 /**
  * Measure the Level values of a given raw buffer.
  *
@@ -411,7 +567,7 @@ static VALUE volumeutils_measureLevel(
   // Translate Ruby objects
   int iNbrBitsPerSample = FIX2INT(iValNbrBitsPerSample);
   int iNbrChannels = FIX2INT(iValNbrChannels);
-  tSampleIndex iNbrSamples = FIX2LONG(iValNbrSamples);
+  tSampleIndex iNbrSamples = NUM2LL(iValNbrSamples);
   double iRMSRatio = NUM2DBL(iValRMSRatio);
   // Get the input buffer
   char* lPtrRawBuffer = RSTRING_PTR(iValInputRawBuffer);
@@ -429,19 +585,19 @@ static VALUE volumeutils_measureLevel(
 
   // Parse the data
   tMeasureLevelStruct lParams;
+  lParams.nbrChannels = iNbrChannels;
   lParams.squareSums = lSquareSums;
   lParams.maxAbsValue = lMaxAbsValues;
-  mpz_init(lParams.tmpInt);
-  commonutils_iterateThroughRawBuffer(
+  commonutils_iterateBlocksThroughRawBuffer(
     lPtrRawBuffer,
     iNbrBitsPerSample,
     iNbrChannels,
     iNbrSamples,
     0,
-    &volumeutils_processValue_MeasureLevel,
-    &lParams
+    &volumeutils_processBlock_MeasureLevel,
+    &lParams,
+    &gParallelFcts_MeasureLevel
   );
-  mpz_clear(lParams.tmpInt);
 
   // Build the resulting array
   VALUE lLevelValues[iNbrChannels];
@@ -488,7 +644,7 @@ void Init_VolumeUtils() {
   VALUE lVolumeUtilsModule = rb_define_module_under(lWSKModule, "VolumeUtils");
   VALUE lVolumeUtilsClass = rb_define_class_under(lVolumeUtilsModule, "VolumeUtils", rb_cObject);
 
-  rb_define_method(lVolumeUtilsClass, "applyVolumeFct", volumeutils_applyVolumeFct, 7);
+  rb_define_method(lVolumeUtilsClass, "applyVolumeFct", volumeutils_applyVolumeFct, 9);
   rb_define_method(lVolumeUtilsClass, "drawVolumeFct", volumeutils_drawVolumeFct, 7);
   rb_define_method(lVolumeUtilsClass, "measureLevel", volumeutils_measureLevel, 5);
 }
@@ -12,6 +12,11 @@ if (!File.exists?("lib/lib#{lLibName}.a"))
   # Create it as static, as Ruby does not seem to be able to require libraries linking to external shared libraries (at least on cygwin), even when LD_LIBRARY_PATH is set correctly. The only workaround (unacceptable) is to put the shared library in the exact same directory as the Ruby library.
   $static = true
   $CFLAGS += ' -Wall -Iinclude'
+  # Iterations release the GVL when Ruby provides a way to do it
+  have_header('ruby/thread.h')
+  have_func('rb_thread_call_without_gvl', 'ruby/thread.h')
+  # Buffers are processed by several threads when pthreads are available
+  have_header('pthread.h')
   create_makefile(lLibName, 'src')
   if (!system('make static'))
     raise RuntimeError.new("Error while running 'make static': #{$?}")
@@ -8,23 +8,105 @@
 
 #include "ruby.h"
 
-// Struct used to interpret raw buffers data of 24 bits
-typedef struct {
-  signed int value:24;
-} t24bits;
-
 // Type used to identify each sample value
 typedef int tSampleValue;
 
 // Type used to identify each sample index
 typedef long long int tSampleIndex;
 
-// Pointer to a function that can be called when parsing a raw buffer
-typedef int(*tPtrFctProcess)(const tSampleValue, const tSampleIndex, const int, void*);
-// Pointer to a function that can be called when parsing a raw buffer and writing another raw buffer
-typedef int(*tPtrFctProcessOutput)(const tSampleValue, tSampleValue*, const tSampleIndex, const int, void*);
-// Pointer to a function that can be called when writing a raw buffer
-typedef int(*tPtrFctProcessOutputOnly)(tSampleValue*, const tSampleIndex, const int, void*);
+// Number of samples decoded at once by the block iterators.
+// Small enough for the decoded span of a stereo block to stay in L1 cache.
+#define COMMONUTILS_BLOCK_SIZE 1024
+
+// Alignment (in bytes) of the values stored in blocks, suitable for SIMD instructions
+#define COMMONUTILS_BLOCK_ALIGNMENT 32
+
+// SIMD instructions levels that can be used by codecs
+#define COMMONUTILS_SIMD_NONE 0
+#define COMMONUTILS_SIMD_SSE2 1
+#define COMMONUTILS_SIMD_SSSE3 2
+#define COMMONUTILS_SIMD_AVX2 3
+
+// Verbosity levels of the clipping reports
+// No report
+#define COMMONUTILS_CLIPLOG_NONE 0
+// 1 warning per channel summarizing clipped samples of a raw buffer
+#define COMMONUTILS_CLIPLOG_SUMMARY 1
+// Summary, and 1 warning per range of consecutive clipped samples
+#define COMMONUTILS_CLIPLOG_RANGES 2
+
+// Maximal number of ranges of clipped samples detailed per channel and per report
+#define COMMONUTILS_CLIP_MAX_RANGES 64
+
+// Struct containing a block of decoded samples.
+// Values are stored per channel: values[idxChannel][idxBlockSample].
+typedef struct {
+  // Number of channels
+  int nbrChannels;
+  // Number of samples in this block
+  tSampleIndex nbrSamples;
+  // Index of the first sample of this block, as counted by the iterator
+  tSampleIndex idxFirstSample;
+  // The decoded values, per channel
+  tSampleValue** values;
+  // The memory allocated to store the values
+  void* allocatedValues;
+} tSampleBlock;
+
+// Struct containing a range of consecutive clipped samples
+typedef struct {
+  tSampleIndex idxFirstSample;
+  tSampleIndex idxLastSample;
+} tClipRange;
+
+// Struct containing clipping events of a channel
+typedef struct {
+  // Number of clipped samples
+  tSampleIndex nbrClippedSamples;
+  // Indexes of the first and last clipped samples
+  tSampleIndex idxFirstSample;
+  tSampleIndex idxLastSample;
+  // Maximal distance between a clipped value and the limit it exceeded
+  tSampleValue peakOvershoot;
+  // Number of ranges of consecutive clipped samples
+  tSampleIndex nbrRanges;
+  // The first ranges (up to COMMONUTILS_CLIP_MAX_RANGES), only stored with COMMONUTILS_CLIPLOG_RANGES verbosity
+  tClipRange ranges[COMMONUTILS_CLIP_MAX_RANGES];
+} tClipInfo;
+
+// Struct containing clipping events of all channels, collected while encoding blocks
+typedef struct {
+  int nbrChannels;
+  // The verbosity to be used (one of COMMONUTILS_CLIPLOG_*)
+  int verbosity;
+  // The clipping events, per channel
+  tClipInfo* channels;
+} tClipReport;
+
+// Pointer to a function that can be called on each block of a raw buffer
+typedef int(*tPtrFctProcessBlock)(const tSampleBlock*, void*);
+// Pointer to a function that can be called on each block of a raw buffer, filling a block to be written in another raw buffer
+typedef int(*tPtrFctProcessBlockOutput)(const tSampleBlock*, tSampleBlock*, void*);
+// Pointer to a function that can be called to fill each block to be written in a raw buffer
+typedef int(*tPtrFctProcessBlockOutputOnly)(tSampleBlock*, void*);
+
+// Pointer to a function that can be called without the GVL
+typedef void*(*tPtrFctWithoutGVL)(void*);
+
+// Pointer to a function initializing the processing arguments of a part of a buffer processed by a thread.
+// Parameters are the arguments given to the iteration, the arguments to initialize and the offset of the first sample of the part.
+typedef void(*tPtrFctInitSliceArgs)(const void*, void*, const tSampleIndex);
+// Pointer to a function merging the results of a part of a buffer into the arguments given to the iteration.
+// It is called once per part, in the samples order. It can be NULL if parts have no result to merge.
+typedef void(*tPtrFctReduceSliceArgs)(void*, void*);
+
+// Struct describing how a processing can be split among threads
+typedef struct {
+  // Size of the processing arguments
+  size_t argsSize;
+  tPtrFctInitSliceArgs initSliceArgs;
+  tPtrFctReduceSliceArgs reduceSliceArgs;
+} tParallelFcts;
 
 // Struct containing data for a threshold information
 typedef struct {
@@ -56,8 +138,197 @@ typedef struct {
   void* fctData;
 } tFunction;
 
+// Struct used to store a region of a file mapped in memory (see IOUtils#mapFile)
+typedef struct {
+  // The mapping, aligned on pages
+  char* mapAddress;
+  size_t mapSize;
+  // The mapped region of the file
+  char* data;
+  tSampleIndex dataSize;
+  // Is the mapping writable (see IOUtils#mapFileForWrite) ?
+  int writable;
+} tMappedFile;
+
+/**
+ * Get the SIMD instructions level used by the codecs.
+ * It is detected once from the running CPU. The WSK_SIMD environment variable (none, sse2, ssse3 or avx2) can lower it.
+ *
+ * Return::
+ * * _int_: The SIMD level (one of COMMONUTILS_SIMD_*)
+ */
+int commonutils_getSIMDLevel(void);
+
+/**
+ * Get the number of threads used to process buffers.
+ * It is read from the WSK_THREADS environment variable (0 meaning the number of processors) each time a buffer is processed, and defaults to 1.
+ *
+ * Return::
+ * * _int_: The number of threads
+ */
+int commonutils_getNbrThreads(void);
+
+/**
+ * Get the verbosity of clipping reports.
+ * It is read from the WSK_CLIP_LOG environment variable (none, summary or ranges) each time a report is initialized, and defaults to summary.
+ *
+ * Return::
+ * * _int_: The verbosity (one of COMMONUTILS_CLIPLOG_*)
+ */
+int commonutils_getClipLogVerbosity(void);
+
+/**
+ * Initialize an empty clipping report.
+ *
+ * Parameters::
+ * * *oPtrClipReport* (<em>tClipReport*</em>): The report to initialize
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ */
+void commonutils_initClipReport(
+  tClipReport* oPtrClipReport,
+  const int iNbrChannels);
+
+/**
+ * Free a clipping report initialized with commonutils_initClipReport.
+ *
+ * Parameters::
+ * * *ioPtrClipReport* (<em>tClipReport*</em>): The report to free
+ */
+void commonutils_freeClipReport(
+  tClipReport* ioPtrClipReport);
+
+/**
+ * Record in a clipping report the values of a block that exceed the range of a given number of bits per sample.
+ * Values are left unchanged: saturating them is the job of the encoder.
+ *
+ * Parameters::
+ * * *ioPtrClipReport* (<em>tClipReport*</em>): The report to complete
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block to check
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ */
+void commonutils_checkClipsBlock(
+  tClipReport* ioPtrClipReport,
+  const tSampleBlock* iPtrBlock,
+  const int iNbrBitsPerSample);
+
+/**
+ * Log the content of a clipping report as warnings, according to its verbosity.
+ * Nothing is logged if no sample was clipped.
+ *
+ * Parameters::
+ * * *iSelf* (_Object_): Object used to call log methods
+ * * *iPtrClipReport* (<em>const tClipReport*</em>): The report to log
+ */
+void commonutils_logClipReport(
+  VALUE iSelf,
+  const tClipReport* iPtrClipReport);
+
+/**
+ * Allocate the values of a samples block.
+ * The block can then store up to COMMONUTILS_BLOCK_SIZE samples, and values of each channel are aligned on COMMONUTILS_BLOCK_ALIGNMENT bytes.
+ *
+ * Parameters::
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to initialize
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ */
+void commonutils_initSampleBlock(
+  tSampleBlock* oPtrBlock,
+  const int iNbrChannels);
+
+/**
+ * Free the values of a samples block initialized with commonutils_initSampleBlock.
+ *
+ * Parameters::
+ * * *ioPtrBlock* (<em>tSampleBlock*</em>): The block to free
+ */
+void commonutils_freeSampleBlock(
+  tSampleBlock* ioPtrBlock);
+
+/**
+ * Decode samples from a raw buffer into a block.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer, pointing on the first sample to decode
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples to decode (at most COMMONUTILS_BLOCK_SIZE)
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): The index of the first sample, to be stored in the block
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
+ */
+void commonutils_decodeBlock(
+  const char* iPtrRawBuffer,
+  const int iNbrBitsPerSample,
+  const tSampleIndex iNbrSamples,
+  const tSampleIndex iIdxFirstSample,
+  tSampleBlock* oPtrBlock);
+
+/**
+ * Encode samples from a block into a raw buffer.
+ * When checking is needed, values exceeding the range are saturated, and a clipping report is logged.
+ *
+ * Parameters::
+ * * *iSelf* (_Object_): Object used to call log methods
+ * * *ioPtrBlock* (<em>tSampleBlock*</em>): The block to encode
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write, pointing on the first sample to encode
+ */
+void commonutils_encodeBlock(
+  VALUE iSelf,
+  tSampleBlock* ioPtrBlock,
+  const int iNbrBitsPerSample,
+  const int iNeedCheck,
+  char* oPtrRawBuffer);
+
 /**
- * Iterate through a raw buffer.
+ * Call a function without holding Ruby's GVL, so that other Ruby threads can run meanwhile.
+ * The function must not call any Ruby API. If the Ruby version can't release the GVL, the function is simply called.
+ *
+ * Parameters::
+ * * *iPtrFct* (<em>const tPtrFctWithoutGVL</em>): The function to call
+ * * *iPtrArgs* (<em>void*</em>): The argument to give the function
+ */
+void commonutils_callWithoutGVL(
+  const tPtrFctWithoutGVL iPtrFct,
+  void* iPtrArgs);
+
+/**
+ * Get a pointer to some data of a file mapped in memory.
+ * Data can be processed in place. It stays valid as long as the container of the mapped file is referenced.
+ *
+ * Parameters::
+ * * *iValMappedFile* (_Object_): Container of the mapped file (created with IOUtils#mapFile)
+ * * *iOffset* (<em>const tSampleIndex</em>): Offset of the data in the mapped region
+ * * *iSize* (<em>const tSampleIndex</em>): Size of the data
+ * Return::
+ * * <em>const char*</em>: The data
+ */
+const char* commonutils_getMappedData(
+  VALUE iValMappedFile,
+  const tSampleIndex iOffset,
+  const tSampleIndex iSize);
+
+/**
+ * Get the output buffer of a processing function.
+ * It is either a region of a file mapped in memory for write, so that results are written directly in the output file, or a new Ruby String.
+ *
+ * Parameters::
+ * * *iValOutputMappedFile* (_Object_): Container of the output file mapped for write (created with IOUtils#mapFileForWrite), or nil to create a String
+ * * *iValOutputOffset* (_Integer_): Offset of the output data in the mapped region (ignored if no mapped file is given)
+ * * *iSize* (<em>const tSampleIndex</em>): Size of the output buffer
+ * * *oPtrValOutputBuffer* (<em>VALUE*</em>): The String created, or nil if the output is written in the mapped file
+ * Return::
+ * * <em>char*</em>: The output buffer
+ */
+char* commonutils_getOutputBuffer(
+  VALUE iValOutputMappedFile,
+  VALUE iValOutputOffset,
+  const tSampleIndex iSize,
+  VALUE* oPtrValOutputBuffer);
+
+/**
+ * Iterate through a raw buffer, block by block.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API.
+ * When parallel functions are given, parts of the buffer can be processed by different threads: the processing method can't break iterations then.
  *
  * Parameters::
  * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
@@ -65,20 +336,24 @@ typedef struct {
  * * *iNbrChannels* (<em>const int</em>): The number of channels
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
  * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
- * * *iPtrProcessMethod* (<em>const tPtrFctProcess</em>): Pointer to the method to call for processing
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlock</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process parts of the buffer in parallel, or NULL to process it with 1 thread
  */
-void commonutils_iterateThroughRawBuffer(
+void commonutils_iterateBlocksThroughRawBuffer(
   const char* iPtrRawBuffer,
   const int iNbrBitsPerSample,
   const int iNbrChannels,
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
-  const tPtrFctProcess iPtrProcessMethod,
-  void* iPtrArgs);
+  const tPtrFctProcessBlock iPtrProcessMethod,
+  void* iPtrArgs,
+  const tParallelFcts* iPtrParallelFcts);
 
 /**
- * Iterate through a raw buffer, and writes another raw buffer.
+ * Iterate through a raw buffer block by block, and writes another raw buffer.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API. Clipped samples are logged once the GVL is acquired back.
+ * When parallel functions are given, parts of the buffer can be processed by different threads: the processing method can't break iterations then.
  *
  * Parameters::
  * * *iSelf* (_Object_): Object used to call log methods
@@ -89,10 +364,11 @@ void commonutils_iterateThroughRawBuffer(
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
  * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
  * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
- * * *iPtrProcessMethod* (<em>const tPtrFctProcessOutput</em>): Pointer to the method to call for processing
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlockOutput</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process parts of the buffer in parallel, or NULL to process it with 1 thread
  */
-void commonutils_iterateThroughRawBufferOutput(
+void commonutils_iterateBlocksThroughRawBufferOutput(
   VALUE iSelf,
   const char* iPtrRawBuffer,
   char* oPtrRawBufferOut,
@@ -101,11 +377,14 @@ void commonutils_iterateThroughRawBufferOutput(
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
   const int iNeedCheck,
-  const tPtrFctProcessOutput iPtrProcessMethod,
-  void* iPtrArgs);
+  const tPtrFctProcessBlockOutput iPtrProcessMethod,
+  void* iPtrArgs,
+  const tParallelFcts* iPtrParallelFcts);
 
 /**
- * Iterate through an output raw buffer only, without input raw buffer.
+ * Iterate block by block through an output raw buffer only, without input raw buffer.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API. Clipped samples are logged once the GVL is acquired back.
+ * When parallel functions are given, parts of the buffer can be processed by different threads: the processing method can't break iterations then.
  *
  * Parameters::
  * * *iSelf* (_Object_): Object used to call log methods
@@ -115,10 +394,11 @@ void commonutils_iterateThroughRawBufferOutput(
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
  * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
  * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
- * * *iPtrProcessMethod* (<em>const tPtrFctProcessOutputOnly</em>): Pointer to the method to call for processing
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlockOutputOnly</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process parts of the buffer in parallel, or NULL to process it with 1 thread
  */
-void commonutils_iterateThroughRawBufferOutputOnly(
+void commonutils_iterateBlocksThroughRawBufferOutputOnly(
   VALUE iSelf,
   char* oPtrRawBufferOut,
   const int iNbrBitsPerSample,
@@ -126,28 +406,31 @@ void commonutils_iterateThroughRawBufferOutputOnly(
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
   const int iNeedCheck,
-  const tPtrFctProcessOutputOnly iPtrProcessMethod,
-  void* iPtrArgs);
+  const tPtrFctProcessBlockOutputOnly iPtrProcessMethod,
+  void* iPtrArgs,
+  const tParallelFcts* iPtrParallelFcts);
 
 /**
- * Iterate through a raw buffer in reverse mode.
+ * Iterate through a raw buffer block by block, in reverse mode.
+ * Blocks are given from the end of the raw buffer to its beginning, but samples inside each block keep their natural order: the processing method has to parse them backwards.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API.
  *
  * Parameters::
  * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
  * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
  * * *iNbrChannels* (<em>const int</em>): The number of channels
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
- * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
- * * *iPtrProcessMethod* (<em>const tPtrFctProcess</em>): Pointer to the method to call for processing
+ * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The offset of the last sample, to be counted and given to the processing method
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlock</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
  */
-void commonutils_iterateReverseThroughRawBuffer(
+void commonutils_iterateReverseBlocksThroughRawBuffer(
   const char* iPtrRawBuffer,
   const int iNbrBitsPerSample,
   const int iNbrChannels,
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
-  const tPtrFctProcess iPtrProcessMethod,
+  const tPtrFctProcessBlock iPtrProcessMethod,
   void* iPtrArgs);
 
 #endif
@@ -0,0 +1,1281 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#include "CommonCodecs.h"
+#include "ruby.h"
+#include <stdlib.h>
+#include <string.h>
+
+// SIMD kernels are compiled for x86 with GCC-compatible compilers only: they rely on target attributes and runtime CPU detection.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COMMONUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// The SIMD level to be used, or -1 if not yet computed
+static int gSIMDLevel = -1;
+
+/**
+ * Decode 8 bits samples.
+ * Declared inline so that calls with a constant number of channels get specialized by the compiler.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+static inline void commonutils_decode8(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const unsigned char* lPtrData;
+  tSampleValue* lPtrValues;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrData = ((const unsigned char*)iPtrRawBuffer) + lIdxChannel;
+    lPtrValues = oPtrValues[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+      lPtrValues[lIdxSample] = ((tSampleValue)lPtrData[lIdxSample*iNbrChannels]) - 128;
+    }
+  }
+}
+
+/**
+ * Decode 16 bits samples.
+ * Declared inline so that calls with a constant number of channels get specialized by the compiler.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+static inline void commonutils_decode16(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const signed short int* lPtrData;
+  tSampleValue* lPtrValues;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrData = ((const signed short int*)iPtrRawBuffer) + lIdxChannel;
+    lPtrValues = oPtrValues[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+      lPtrValues[lIdxSample] = (tSampleValue)lPtrData[lIdxSample*iNbrChannels];
+    }
+  }
+}
+
+/**
+ * Decode 24 bits samples.
+ * Bytes are assembled in the high part of an int, and shifted back to get the sign extension.
+ * Declared inline so that calls with a constant number of channels get specialized by the compiler.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+static inline void commonutils_decode24(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const unsigned char* lPtrData;
+  tSampleValue* lPtrValues;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrData = ((const unsigned char*)iPtrRawBuffer) + 3*lIdxChannel;
+    lPtrValues = oPtrValues[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+      lPtrValues[lIdxSample] = ((tSampleValue)(
+        (((unsigned int)lPtrData[0]) << 8) |
+        (((unsigned int)lPtrData[1]) << 16) |
+        (((unsigned int)lPtrData[2]) << 24))) >> 8;
+      lPtrData += 3*iNbrChannels;
+    }
+  }
+}
+
+/**
+ * Saturate a value to the range of a given number of bits per sample.
+ *
+ * Parameters::
+ * * *iValue* (<em>const tSampleValue</em>): The value
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * Return::
+ * * <em>tSampleValue</em>: The saturated value
+ */
+static inline tSampleValue commonutils_saturate(
+  const tSampleValue iValue,
+  const int iNbrBitsPerSample) {
+  tSampleValue lMaxValue = (1 << (iNbrBitsPerSample-1)) - 1;
+  tSampleValue lMinValue = -(1 << (iNbrBitsPerSample-1));
+
+  return (iValue > lMaxValue) ? lMaxValue : ((iValue < lMinValue) ? lMinValue : iValue);
+}
+
+/**
+ * Tell if some values exceed a given range.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>const tSampleValue*</em>): The values
+ * * *iNbrValues* (<em>const tSampleIndex</em>): The number of values
+ * * *iMinValue* (<em>const tSampleValue</em>): The minimal value of the range
+ * * *iMaxValue* (<em>const tSampleValue</em>): The maximal value of the range
+ * Return::
+ * * _int_: 1 if at least 1 value is out of the range, 0 otherwise
+ */
+static int commonutils_isOutOfRange(
+  const tSampleValue* iPtrValues,
+  const tSampleIndex iNbrValues,
+  const tSampleValue iMinValue,
+  const tSampleValue iMaxValue) {
+  int lExceeding = 0;
+  tSampleIndex lIdxValue;
+  for (lIdxValue = 0; lIdxValue < iNbrValues; ++lIdxValue) {
+    lExceeding |= ((iPtrValues[lIdxValue] > iMaxValue) | (iPtrValues[lIdxValue] < iMinValue));
+  }
+
+  return lExceeding;
+}
+
+/**
+ * Encode 8 bits samples.
+ * Declared inline so that calls with a constant number of channels get specialized by the compiler.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+static inline void commonutils_encode8(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  unsigned char* lPtrData;
+  const tSampleValue* lPtrValues;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrData = ((unsigned char*)oPtrRawBuffer) + lIdxChannel;
+    lPtrValues = iPtrValues[lIdxChannel];
+    if (iSaturate != 0) {
+      for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+        lPtrData[lIdxSample*iNbrChannels] = (unsigned char)(commonutils_saturate(lPtrValues[lIdxSample], 8) + 128);
+      }
+    } else {
+      for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+        lPtrData[lIdxSample*iNbrChannels] = (unsigned char)(lPtrValues[lIdxSample] + 128);
+      }
+    }
+  }
+}
+
+/**
+ * Encode 16 bits samples.
+ * Declared inline so that calls with a constant number of channels get specialized by the compiler.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+static inline void commonutils_encode16(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  signed short int* lPtrData;
+  const tSampleValue* lPtrValues;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrData = ((signed short int*)oPtrRawBuffer) + lIdxChannel;
+    lPtrValues = iPtrValues[lIdxChannel];
+    if (iSaturate != 0) {
+      for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+        lPtrData[lIdxSample*iNbrChannels] = (signed short int)commonutils_saturate(lPtrValues[lIdxSample], 16);
+      }
+    } else {
+      for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+        lPtrData[lIdxSample*iNbrChannels] = (signed short int)lPtrValues[lIdxSample];
+      }
+    }
+  }
+}
+
+/**
+ * Encode 24 bits samples.
+ * Declared inline so that calls with a constant number of channels get specialized by the compiler.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+static inline void commonutils_encode24(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  unsigned char* lPtrData;
+  const tSampleValue* lPtrValues;
+  tSampleValue lValue;
+  tSampleIndex lIdxSample;
+  int lIdxChannel;
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    lPtrData = ((unsigned char*)oPtrRawBuffer) + 3*lIdxChannel;
+    lPtrValues = iPtrValues[lIdxChannel];
+    for (lIdxSample = 0; lIdxSample < iNbrSamples; ++lIdxSample) {
+      lValue = (iSaturate != 0) ? commonutils_saturate(lPtrValues[lIdxSample], 24) : lPtrValues[lIdxSample];
+      lPtrData[0] = (unsigned char)lValue;
+      lPtrData[1] = (unsigned char)(lValue >> 8);
+      lPtrData[2] = (unsigned char)(lValue >> 16);
+      lPtrData += 3*iNbrChannels;
+    }
+  }
+}
+
+// Specialized variants for the most common formats
+static void commonutils_decode8_generic(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode8(iPtrRawBuffer, iNbrChannels, iNbrSamples, oPtrValues);
+}
+static void commonutils_decode16_mono(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode16(iPtrRawBuffer, 1, iNbrSamples, oPtrValues);
+}
+static void commonutils_decode16_stereo(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode16(iPtrRawBuffer, 2, iNbrSamples, oPtrValues);
+}
+static void commonutils_decode16_generic(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode16(iPtrRawBuffer, iNbrChannels, iNbrSamples, oPtrValues);
+}
+static void commonutils_decode24_mono(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode24(iPtrRawBuffer, 1, iNbrSamples, oPtrValues);
+}
+static void commonutils_decode24_stereo(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode24(iPtrRawBuffer, 2, iNbrSamples, oPtrValues);
+}
+static void commonutils_decode24_generic(const char* iPtrRawBuffer, const int iNbrChannels, const tSampleIndex iNbrSamples, tSampleValue** oPtrValues) {
+  commonutils_decode24(iPtrRawBuffer, iNbrChannels, iNbrSamples, oPtrValues);
+}
+static void commonutils_encode8_generic(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode8(iPtrValues, iNbrChannels, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+static void commonutils_encode16_mono(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode16(iPtrValues, 1, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+static void commonutils_encode16_stereo(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode16(iPtrValues, 2, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+static void commonutils_encode16_generic(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode16(iPtrValues, iNbrChannels, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+static void commonutils_encode24_mono(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode24(iPtrValues, 1, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+static void commonutils_encode24_stereo(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode24(iPtrValues, 2, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+static void commonutils_encode24_generic(tSampleValue** iPtrValues, const int iNbrChannels, const tSampleIndex iNbrSamples, const int iSaturate, char* oPtrRawBuffer) {
+  commonutils_encode24(iPtrValues, iNbrChannels, iNbrSamples, iSaturate, oPtrRawBuffer);
+}
+
+#ifdef COMMONUTILS_X86_SIMD
+
+// SIMD kernels.
+// Each kernel processes the largest possible multiple of its vector width, and lets the scalar version handle the remaining samples.
+// Raw buffers have no alignment guarantee, so unaligned loads and stores are used everywhere.
+
+/**
+ * Decode 8 bits mono samples using SSE2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("sse2")))
+static void commonutils_decode8_mono_sse2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  tSampleValue* lPtrValues = oPtrValues[0];
+  const __m128i lZero = _mm_setzero_si128();
+  const __m128i lOffset = _mm_set1_epi32(128);
+  __m128i lRaw;
+  __m128i lLow;
+  __m128i lHigh;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 16 <= iNbrSamples; lIdxSample += 16) {
+    lRaw = _mm_loadu_si128((const __m128i*)(iPtrRawBuffer + lIdxSample));
+    lLow = _mm_unpacklo_epi8(lRaw, lZero);
+    lHigh = _mm_unpackhi_epi8(lRaw, lZero);
+    _mm_storeu_si128((__m128i*)(lPtrValues + lIdxSample), _mm_sub_epi32(_mm_unpacklo_epi16(lLow, lZero), lOffset));
+    _mm_storeu_si128((__m128i*)(lPtrValues + lIdxSample + 4), _mm_sub_epi32(_mm_unpackhi_epi16(lLow, lZero), lOffset));
+    _mm_storeu_si128((__m128i*)(lPtrValues + lIdxSample + 8), _mm_sub_epi32(_mm_unpacklo_epi16(lHigh, lZero), lOffset));
+    _mm_storeu_si128((__m128i*)(lPtrValues + lIdxSample + 12), _mm_sub_epi32(_mm_unpackhi_epi16(lHigh, lZero), lOffset));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_decode8(iPtrRawBuffer + lIdxSample, 1, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Encode 8 bits mono samples using SSE2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("sse2")))
+static void commonutils_encode8_mono_sse2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  tSampleValue* lPtrValues = iPtrValues[0];
+  const __m128i lOffset = _mm_set1_epi32(128);
+  // When truncating, only the lowest byte is kept: packing instructions then never saturate.
+  const __m128i lMask = _mm_set1_epi32((iSaturate != 0) ? -1 : 0xFF);
+  __m128i lValues0;
+  __m128i lValues1;
+  __m128i lValues2;
+  __m128i lValues3;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 16 <= iNbrSamples; lIdxSample += 16) {
+    lValues0 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample)), lOffset), lMask);
+    lValues1 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample + 4)), lOffset), lMask);
+    lValues2 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample + 8)), lOffset), lMask);
+    lValues3 = _mm_and_si128(_mm_add_epi32(_mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample + 12)), lOffset), lMask);
+    _mm_storeu_si128(
+      (__m128i*)(oPtrRawBuffer + lIdxSample),
+      _mm_packus_epi16(_mm_packs_epi32(lValues0, lValues1), _mm_packs_epi32(lValues2, lValues3)));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_encode8(lPtrRemainingValues, 1, iNbrSamples - lIdxSample, iSaturate, oPtrRawBuffer + lIdxSample);
+}
+
+/**
+ * Decode 16 bits mono samples using SSE2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("sse2")))
+static void commonutils_decode16_mono_sse2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const signed short int* lPtrData = (const signed short int*)iPtrRawBuffer;
+  tSampleValue* lPtrValues = oPtrValues[0];
+  __m128i lRaw;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 8 <= iNbrSamples; lIdxSample += 8) {
+    lRaw = _mm_loadu_si128((const __m128i*)(lPtrData + lIdxSample));
+    // Put each 16 bits value in the high part of a 32 bits value, and shift it back to get the sign extension
+    _mm_storeu_si128((__m128i*)(lPtrValues + lIdxSample), _mm_srai_epi32(_mm_unpacklo_epi16(lRaw, lRaw), 16));
+    _mm_storeu_si128((__m128i*)(lPtrValues + lIdxSample + 4), _mm_srai_epi32(_mm_unpackhi_epi16(lRaw, lRaw), 16));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_decode16((const char*)(lPtrData + lIdxSample), 1, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Decode 16 bits stereo samples using SSE2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("sse2")))
+static void commonutils_decode16_stereo_sse2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const signed short int* lPtrData = (const signed short int*)iPtrRawBuffer;
+  tSampleValue* lPtrLeftValues = oPtrValues[0];
+  tSampleValue* lPtrRightValues = oPtrValues[1];
+  __m128i lRaw;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 4 <= iNbrSamples; lIdxSample += 4) {
+    // Each 32 bits value contains a whole sample: left channel in the low part, right channel in the high part
+    lRaw = _mm_loadu_si128((const __m128i*)(lPtrData + 2*lIdxSample));
+    _mm_storeu_si128((__m128i*)(lPtrLeftValues + lIdxSample), _mm_srai_epi32(_mm_slli_epi32(lRaw, 16), 16));
+    _mm_storeu_si128((__m128i*)(lPtrRightValues + lIdxSample), _mm_srai_epi32(lRaw, 16));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_decode16((const char*)(lPtrData + 2*lIdxSample), 2, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Get 8 packed 16 bits values out of 8 32 bits values, using SSE2.
+ *
+ * Parameters::
+ * * *iValues0* (<em>__m128i</em>): The first 4 values
+ * * *iValues1* (<em>__m128i</em>): The next 4 values
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * Return::
+ * * <em>__m128i</em>: The packed values
+ */
+__attribute__((target("sse2")))
+static inline __m128i commonutils_pack16_sse2(
+  __m128i iValues0,
+  __m128i iValues1,
+  const int iSaturate) {
+  if (iSaturate == 0) {
+    // Sign-extend the low 16 bits first, so that packing never saturates
+    iValues0 = _mm_srai_epi32(_mm_slli_epi32(iValues0, 16), 16);
+    iValues1 = _mm_srai_epi32(_mm_slli_epi32(iValues1, 16), 16);
+  }
+
+  return _mm_packs_epi32(iValues0, iValues1);
+}
+
+/**
+ * Encode 16 bits mono samples using SSE2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("sse2")))
+static void commonutils_encode16_mono_sse2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  signed short int* lPtrData = (signed short int*)oPtrRawBuffer;
+  tSampleValue* lPtrValues = iPtrValues[0];
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 8 <= iNbrSamples; lIdxSample += 8) {
+    _mm_storeu_si128(
+      (__m128i*)(lPtrData + lIdxSample),
+      commonutils_pack16_sse2(
+        _mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample)),
+        _mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample + 4)),
+        iSaturate));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_encode16(lPtrRemainingValues, 1, iNbrSamples - lIdxSample, iSaturate, (char*)(lPtrData + lIdxSample));
+}
+
+/**
+ * Encode 16 bits stereo samples using SSE2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("sse2")))
+static void commonutils_encode16_stereo_sse2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  signed short int* lPtrData = (signed short int*)oPtrRawBuffer;
+  tSampleValue* lPtrLeftValues = iPtrValues[0];
+  tSampleValue* lPtrRightValues = iPtrValues[1];
+  __m128i lLeft;
+  __m128i lRight;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 8 <= iNbrSamples; lIdxSample += 8) {
+    lLeft = commonutils_pack16_sse2(
+      _mm_loadu_si128((const __m128i*)(lPtrLeftValues + lIdxSample)),
+      _mm_loadu_si128((const __m128i*)(lPtrLeftValues + lIdxSample + 4)),
+      iSaturate);
+    lRight = commonutils_pack16_sse2(
+      _mm_loadu_si128((const __m128i*)(lPtrRightValues + lIdxSample)),
+      _mm_loadu_si128((const __m128i*)(lPtrRightValues + lIdxSample + 4)),
+      iSaturate);
+    _mm_storeu_si128((__m128i*)(lPtrData + 2*lIdxSample), _mm_unpacklo_epi16(lLeft, lRight));
+    _mm_storeu_si128((__m128i*)(lPtrData + 2*lIdxSample + 8), _mm_unpackhi_epi16(lLeft, lRight));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_encode16(lPtrRemainingValues, 2, iNbrSamples - lIdxSample, iSaturate, (char*)(lPtrData + 2*lIdxSample));
+}
+
+/**
+ * Decode 8 bits mono samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("avx2")))
+static void commonutils_decode8_mono_avx2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  tSampleValue* lPtrValues = oPtrValues[0];
+  const __m256i lOffset = _mm256_set1_epi32(128);
+  __m128i lRaw;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 16 <= iNbrSamples; lIdxSample += 16) {
+    lRaw = _mm_loadu_si128((const __m128i*)(iPtrRawBuffer + lIdxSample));
+    _mm256_storeu_si256((__m256i*)(lPtrValues + lIdxSample), _mm256_sub_epi32(_mm256_cvtepu8_epi32(lRaw), lOffset));
+    _mm256_storeu_si256((__m256i*)(lPtrValues + lIdxSample + 8), _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(lRaw, 8)), lOffset));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_decode8(iPtrRawBuffer + lIdxSample, 1, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Decode 16 bits mono samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("avx2")))
+static void commonutils_decode16_mono_avx2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const signed short int* lPtrData = (const signed short int*)iPtrRawBuffer;
+  tSampleValue* lPtrValues = oPtrValues[0];
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 16 <= iNbrSamples; lIdxSample += 16) {
+    _mm256_storeu_si256((__m256i*)(lPtrValues + lIdxSample), _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(lPtrData + lIdxSample))));
+    _mm256_storeu_si256((__m256i*)(lPtrValues + lIdxSample + 8), _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(lPtrData + lIdxSample + 8))));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_decode16((const char*)(lPtrData + lIdxSample), 1, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Decode 16 bits stereo samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("avx2")))
+static void commonutils_decode16_stereo_avx2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  const signed short int* lPtrData = (const signed short int*)iPtrRawBuffer;
+  tSampleValue* lPtrLeftValues = oPtrValues[0];
+  tSampleValue* lPtrRightValues = oPtrValues[1];
+  __m256i lRaw;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 8 <= iNbrSamples; lIdxSample += 8) {
+    // Each 32 bits value contains a whole sample: left channel in the low part, right channel in the high part
+    lRaw = _mm256_loadu_si256((const __m256i*)(lPtrData + 2*lIdxSample));
+    _mm256_storeu_si256((__m256i*)(lPtrLeftValues + lIdxSample), _mm256_srai_epi32(_mm256_slli_epi32(lRaw, 16), 16));
+    _mm256_storeu_si256((__m256i*)(lPtrRightValues + lIdxSample), _mm256_srai_epi32(lRaw, 16));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_decode16((const char*)(lPtrData + 2*lIdxSample), 2, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Get 16 packed 16 bits values out of 16 32 bits values, using AVX2.
+ * Packing instructions work in each 128 bits lane, so the result is in lanes order: 0-3, 8-11, 4-7, 12-15.
+ *
+ * Parameters::
+ * * *iValues0* (<em>__m256i</em>): The first 8 values
+ * * *iValues1* (<em>__m256i</em>): The next 8 values
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * Return::
+ * * <em>__m256i</em>: The packed values
+ */
+__attribute__((target("avx2")))
+static inline __m256i commonutils_pack16_avx2(
+  __m256i iValues0,
+  __m256i iValues1,
+  const int iSaturate) {
+  if (iSaturate == 0) {
+    // Sign-extend the low 16 bits first, so that packing never saturates
+    iValues0 = _mm256_srai_epi32(_mm256_slli_epi32(iValues0, 16), 16);
+    iValues1 = _mm256_srai_epi32(_mm256_slli_epi32(iValues1, 16), 16);
+  }
+
+  return _mm256_packs_epi32(iValues0, iValues1);
+}
+
+/**
+ * Encode 16 bits mono samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("avx2")))
+static void commonutils_encode16_mono_avx2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  signed short int* lPtrData = (signed short int*)oPtrRawBuffer;
+  tSampleValue* lPtrValues = iPtrValues[0];
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 16 <= iNbrSamples; lIdxSample += 16) {
+    _mm256_storeu_si256(
+      (__m256i*)(lPtrData + lIdxSample),
+      // Put 64 bits quarters back in order
+      _mm256_permute4x64_epi64(
+        commonutils_pack16_avx2(
+          _mm256_loadu_si256((const __m256i*)(lPtrValues + lIdxSample)),
+          _mm256_loadu_si256((const __m256i*)(lPtrValues + lIdxSample + 8)),
+          iSaturate),
+        0xD8));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_encode16(lPtrRemainingValues, 1, iNbrSamples - lIdxSample, iSaturate, (char*)(lPtrData + lIdxSample));
+}
+
+/**
+ * Encode 16 bits stereo samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("avx2")))
+static void commonutils_encode16_stereo_avx2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  signed short int* lPtrData = (signed short int*)oPtrRawBuffer;
+  tSampleValue* lPtrLeftValues = iPtrValues[0];
+  tSampleValue* lPtrRightValues = iPtrValues[1];
+  __m256i lLeft;
+  __m256i lRight;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; lIdxSample + 16 <= iNbrSamples; lIdxSample += 16) {
+    lLeft = commonutils_pack16_avx2(
+      _mm256_loadu_si256((const __m256i*)(lPtrLeftValues + lIdxSample)),
+      _mm256_loadu_si256((const __m256i*)(lPtrLeftValues + lIdxSample + 8)),
+      iSaturate);
+    lRight = commonutils_pack16_avx2(
+      _mm256_loadu_si256((const __m256i*)(lPtrRightValues + lIdxSample)),
+      _mm256_loadu_si256((const __m256i*)(lPtrRightValues + lIdxSample + 8)),
+      iSaturate);
+    // The lanes order of packed values is compensated by the lanes order of the interleaving: samples 0-7 are in the low interleaved part, 8-15 in the high one.
+    _mm256_storeu_si256((__m256i*)(lPtrData + 2*lIdxSample), _mm256_unpacklo_epi16(lLeft, lRight));
+    _mm256_storeu_si256((__m256i*)(lPtrData + 2*lIdxSample + 16), _mm256_unpackhi_epi16(lLeft, lRight));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_encode16(lPtrRemainingValues, 2, iNbrSamples - lIdxSample, iSaturate, (char*)(lPtrData + 2*lIdxSample));
+}
+
+/**
+ * Saturate 4 32 bits values to the 24 bits range, using SSE2 only.
+ *
+ * Parameters::
+ * * *iValues* (<em>__m128i</em>): The values
+ * Return::
+ * * <em>__m128i</em>: The saturated values
+ */
+__attribute__((target("sse2")))
+static inline __m128i commonutils_saturate24_sse2(
+  __m128i iValues) {
+  const __m128i lMaxValue = _mm_set1_epi32(8388607);
+  const __m128i lMinValue = _mm_set1_epi32(-8388608);
+  __m128i lMask = _mm_cmpgt_epi32(iValues, lMaxValue);
+  iValues = _mm_or_si128(_mm_and_si128(lMask, lMaxValue), _mm_andnot_si128(lMask, iValues));
+  lMask = _mm_cmplt_epi32(iValues, lMinValue);
+
+  return _mm_or_si128(_mm_and_si128(lMask, lMinValue), _mm_andnot_si128(lMask, iValues));
+}
+
+// 24 bits kernels.
+// They load and store 16 or 32 bytes to process 12 or 24 bytes of samples: loops stop early enough to never access bytes past the buffer's end.
+// Stores writing bytes past the processed samples are always followed by stores (or the scalar version) overwriting them.
+
+/**
+ * Decode 24 bits mono samples using SSSE3.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("ssse3")))
+static void commonutils_decode24_mono_ssse3(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  tSampleValue* lPtrValues = oPtrValues[0];
+  // Put the 3 bytes of each sample in the high part of a 32 bits value. It is then shifted back to get the sign extension.
+  const __m128i lShuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 3*lIdxSample + 16 <= 3*iNbrSamples; lIdxSample += 4) {
+    _mm_storeu_si128(
+      (__m128i*)(lPtrValues + lIdxSample),
+      _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(iPtrRawBuffer + 3*lIdxSample)), lShuffle), 8));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_decode24(iPtrRawBuffer + 3*lIdxSample, 1, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Decode 24 bits stereo samples using SSSE3.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("ssse3")))
+static void commonutils_decode24_stereo_ssse3(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  tSampleValue* lPtrLeftValues = oPtrValues[0];
+  tSampleValue* lPtrRightValues = oPtrValues[1];
+  // From 2 samples, get left values in the low 64 bits and right values in the high 64 bits
+  const __m128i lShuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 6, 7, 8, -1, 3, 4, 5, -1, 9, 10, 11);
+  __m128i lSamples01;
+  __m128i lSamples23;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 6*lIdxSample + 28 <= 6*iNbrSamples; lIdxSample += 4) {
+    lSamples01 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(iPtrRawBuffer + 6*lIdxSample)), lShuffle);
+    lSamples23 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(iPtrRawBuffer + 6*lIdxSample + 12)), lShuffle);
+    _mm_storeu_si128((__m128i*)(lPtrLeftValues + lIdxSample), _mm_srai_epi32(_mm_unpacklo_epi64(lSamples01, lSamples23), 8));
+    _mm_storeu_si128((__m128i*)(lPtrRightValues + lIdxSample), _mm_srai_epi32(_mm_unpackhi_epi64(lSamples01, lSamples23), 8));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_decode24(iPtrRawBuffer + 6*lIdxSample, 2, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Encode 24 bits mono samples using SSSE3.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("ssse3")))
+static void commonutils_encode24_mono_ssse3(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  tSampleValue* lPtrValues = iPtrValues[0];
+  // Keep the 3 low bytes of each 32 bits value
+  const __m128i lShuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  __m128i lValues;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 3*lIdxSample + 16 <= 3*iNbrSamples; lIdxSample += 4) {
+    lValues = _mm_loadu_si128((const __m128i*)(lPtrValues + lIdxSample));
+    if (iSaturate != 0) {
+      lValues = commonutils_saturate24_sse2(lValues);
+    }
+    _mm_storeu_si128((__m128i*)(oPtrRawBuffer + 3*lIdxSample), _mm_shuffle_epi8(lValues, lShuffle));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_encode24(lPtrRemainingValues, 1, iNbrSamples - lIdxSample, iSaturate, oPtrRawBuffer + 3*lIdxSample);
+}
+
+/**
+ * Encode 24 bits stereo samples using SSSE3.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("ssse3")))
+static void commonutils_encode24_stereo_ssse3(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  tSampleValue* lPtrLeftValues = iPtrValues[0];
+  tSampleValue* lPtrRightValues = iPtrValues[1];
+  // Keep the 3 low bytes of each 32 bits value
+  const __m128i lShuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  __m128i lLeft;
+  __m128i lRight;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 6*lIdxSample + 28 <= 6*iNbrSamples; lIdxSample += 4) {
+    lLeft = _mm_loadu_si128((const __m128i*)(lPtrLeftValues + lIdxSample));
+    lRight = _mm_loadu_si128((const __m128i*)(lPtrRightValues + lIdxSample));
+    if (iSaturate != 0) {
+      lLeft = commonutils_saturate24_sse2(lLeft);
+      lRight = commonutils_saturate24_sse2(lRight);
+    }
+    _mm_storeu_si128((__m128i*)(oPtrRawBuffer + 6*lIdxSample), _mm_shuffle_epi8(_mm_unpacklo_epi32(lLeft, lRight), lShuffle));
+    _mm_storeu_si128((__m128i*)(oPtrRawBuffer + 6*lIdxSample + 12), _mm_shuffle_epi8(_mm_unpackhi_epi32(lLeft, lRight), lShuffle));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_encode24(lPtrRemainingValues, 2, iNbrSamples - lIdxSample, iSaturate, oPtrRawBuffer + 6*lIdxSample);
+}
+
+/**
+ * Load 2 unaligned 128 bits values in the 2 lanes of a 256 bits value, using AVX2.
+ *
+ * Parameters::
+ * * *iPtrLow* (<em>const char*</em>): Address of the low lane
+ * * *iPtrHigh* (<em>const char*</em>): Address of the high lane
+ * Return::
+ * * <em>__m256i</em>: The loaded value
+ */
+__attribute__((target("avx2")))
+static inline __m256i commonutils_loadLanes_avx2(
+  const char* iPtrLow,
+  const char* iPtrHigh) {
+  return _mm256_inserti128_si256(
+    _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)iPtrLow)),
+    _mm_loadu_si128((const __m128i*)iPtrHigh),
+    1);
+}
+
+/**
+ * Get 24 contiguous bytes from 8 32 bits values, keeping their 3 low bytes, using AVX2.
+ * The 8 last bytes are zeros.
+ *
+ * Parameters::
+ * * *iValues* (<em>__m256i</em>): The values
+ * Return::
+ * * <em>__m256i</em>: The packed bytes
+ */
+__attribute__((target("avx2")))
+static inline __m256i commonutils_pack24_avx2(
+  __m256i iValues) {
+  // Keep the 3 low bytes of each 32 bits value, in each lane
+  const __m256i lShuffle = _mm256_setr_epi8(
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  // Then join the 12 bytes of each lane
+  const __m256i lPermutation = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+  return _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(iValues, lShuffle), lPermutation);
+}
+
+/**
+ * Decode 24 bits mono samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("avx2")))
+static void commonutils_decode24_mono_avx2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  tSampleValue* lPtrValues = oPtrValues[0];
+  // Put the 3 bytes of each sample in the high part of a 32 bits value. It is then shifted back to get the sign extension.
+  const __m256i lShuffle = _mm256_setr_epi8(
+    -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+    -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 3*lIdxSample + 28 <= 3*iNbrSamples; lIdxSample += 8) {
+    _mm256_storeu_si256(
+      (__m256i*)(lPtrValues + lIdxSample),
+      _mm256_srai_epi32(
+        _mm256_shuffle_epi8(commonutils_loadLanes_avx2(iPtrRawBuffer + 3*lIdxSample, iPtrRawBuffer + 3*lIdxSample + 12), lShuffle),
+        8));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_decode24(iPtrRawBuffer + 3*lIdxSample, 1, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Decode 24 bits stereo samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *oPtrValues* (<em>tSampleValue**</em>): The values to write, per channel
+ */
+__attribute__((target("avx2")))
+static void commonutils_decode24_stereo_avx2(
+  const char* iPtrRawBuffer,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  tSampleValue** oPtrValues) {
+  tSampleValue* lPtrLeftValues = oPtrValues[0];
+  tSampleValue* lPtrRightValues = oPtrValues[1];
+  // In each lane, from 2 samples, get left values in the low 64 bits and right values in the high 64 bits
+  const __m256i lShuffle = _mm256_setr_epi8(
+    -1, 0, 1, 2, -1, 6, 7, 8, -1, 3, 4, 5, -1, 9, 10, 11,
+    -1, 0, 1, 2, -1, 6, 7, 8, -1, 3, 4, 5, -1, 9, 10, 11);
+  __m256i lSamples0145;
+  __m256i lSamples2367;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 6*lIdxSample + 52 <= 6*iNbrSamples; lIdxSample += 8) {
+    lSamples0145 = _mm256_shuffle_epi8(commonutils_loadLanes_avx2(iPtrRawBuffer + 6*lIdxSample, iPtrRawBuffer + 6*lIdxSample + 24), lShuffle);
+    lSamples2367 = _mm256_shuffle_epi8(commonutils_loadLanes_avx2(iPtrRawBuffer + 6*lIdxSample + 12, iPtrRawBuffer + 6*lIdxSample + 36), lShuffle);
+    _mm256_storeu_si256((__m256i*)(lPtrLeftValues + lIdxSample), _mm256_srai_epi32(_mm256_unpacklo_epi64(lSamples0145, lSamples2367), 8));
+    _mm256_storeu_si256((__m256i*)(lPtrRightValues + lIdxSample), _mm256_srai_epi32(_mm256_unpackhi_epi64(lSamples0145, lSamples2367), 8));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_decode24(iPtrRawBuffer + 6*lIdxSample, 2, iNbrSamples - lIdxSample, lPtrRemainingValues);
+}
+
+/**
+ * Encode 24 bits mono samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (1)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("avx2")))
+static void commonutils_encode24_mono_avx2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  tSampleValue* lPtrValues = iPtrValues[0];
+  const __m256i lMaxValue = _mm256_set1_epi32(8388607);
+  const __m256i lMinValue = _mm256_set1_epi32(-8388608);
+  __m256i lValues;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 3*lIdxSample + 32 <= 3*iNbrSamples; lIdxSample += 8) {
+    lValues = _mm256_loadu_si256((const __m256i*)(lPtrValues + lIdxSample));
+    if (iSaturate != 0) {
+      lValues = _mm256_max_epi32(_mm256_min_epi32(lValues, lMaxValue), lMinValue);
+    }
+    _mm256_storeu_si256((__m256i*)(oPtrRawBuffer + 3*lIdxSample), commonutils_pack24_avx2(lValues));
+  }
+  tSampleValue* lPtrRemainingValues[1] = { lPtrValues + lIdxSample };
+  commonutils_encode24(lPtrRemainingValues, 1, iNbrSamples - lIdxSample, iSaturate, oPtrRawBuffer + 3*lIdxSample);
+}
+
+/**
+ * Encode 24 bits stereo samples using AVX2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>tSampleValue**</em>): The values to read, per channel
+ * * *iNbrChannels* (<em>const int</em>): The number of channels (2)
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iSaturate* (<em>const int</em>): Do we saturate values out of range (1), or truncate them (0) ?
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write
+ */
+__attribute__((target("avx2")))
+static void commonutils_encode24_stereo_avx2(
+  tSampleValue** iPtrValues,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const int iSaturate,
+  char* oPtrRawBuffer) {
+  tSampleValue* lPtrLeftValues = iPtrValues[0];
+  tSampleValue* lPtrRightValues = iPtrValues[1];
+  const __m256i lMaxValue = _mm256_set1_epi32(8388607);
+  const __m256i lMinValue = _mm256_set1_epi32(-8388608);
+  __m256i lLeft;
+  __m256i lRight;
+  __m256i lInterleavedLow;
+  __m256i lInterleavedHigh;
+  tSampleIndex lIdxSample;
+  for (lIdxSample = 0; 6*lIdxSample + 56 <= 6*iNbrSamples; lIdxSample += 8) {
+    lLeft = _mm256_loadu_si256((const __m256i*)(lPtrLeftValues + lIdxSample));
+    lRight = _mm256_loadu_si256((const __m256i*)(lPtrRightValues + lIdxSample));
+    if (iSaturate != 0) {
+      lLeft = _mm256_max_epi32(_mm256_min_epi32(lLeft, lMaxValue), lMinValue);
+      lRight = _mm256_max_epi32(_mm256_min_epi32(lRight, lMaxValue), lMinValue);
+    }
+    // Interleaving works in each lane: samples 0, 1, 4, 5 and 2, 3, 6, 7
+    lInterleavedLow = _mm256_unpacklo_epi32(lLeft, lRight);
+    lInterleavedHigh = _mm256_unpackhi_epi32(lLeft, lRight);
+    _mm256_storeu_si256((__m256i*)(oPtrRawBuffer + 6*lIdxSample), commonutils_pack24_avx2(_mm256_permute2x128_si256(lInterleavedLow, lInterleavedHigh, 0x20)));
+    _mm256_storeu_si256((__m256i*)(oPtrRawBuffer + 6*lIdxSample + 24), commonutils_pack24_avx2(_mm256_permute2x128_si256(lInterleavedLow, lInterleavedHigh, 0x31)));
+  }
+  tSampleValue* lPtrRemainingValues[2] = { lPtrLeftValues + lIdxSample, lPtrRightValues + lIdxSample };
+  commonutils_encode24(lPtrRemainingValues, 2, iNbrSamples - lIdxSample, iSaturate, oPtrRawBuffer + 6*lIdxSample);
+}
+
+/**
+ * Tell if some values exceed a given range, using SSE2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>const tSampleValue*</em>): The values
+ * * *iNbrValues* (<em>const tSampleIndex</em>): The number of values
+ * * *iMinValue* (<em>const tSampleValue</em>): The minimal value of the range
+ * * *iMaxValue* (<em>const tSampleValue</em>): The maximal value of the range
+ * Return::
+ * * _int_: 1 if at least 1 value is out of the range, 0 otherwise
+ */
+__attribute__((target("sse2")))
+static int commonutils_isOutOfRange_sse2(
+  const tSampleValue* iPtrValues,
+  const tSampleIndex iNbrValues,
+  const tSampleValue iMinValue,
+  const tSampleValue iMaxValue) {
+  const __m128i lMinValue = _mm_set1_epi32(iMinValue);
+  const __m128i lMaxValue = _mm_set1_epi32(iMaxValue);
+  __m128i lExceeding = _mm_setzero_si128();
+  __m128i lValues;
+  tSampleIndex lIdxValue;
+  for (lIdxValue = 0; lIdxValue + 4 <= iNbrValues; lIdxValue += 4) {
+    lValues = _mm_loadu_si128((const __m128i*)(iPtrValues + lIdxValue));
+    lExceeding = _mm_or_si128(lExceeding, _mm_or_si128(_mm_cmpgt_epi32(lValues, lMaxValue), _mm_cmplt_epi32(lValues, lMinValue)));
+  }
+
+  return (_mm_movemask_epi8(lExceeding) != 0) | commonutils_isOutOfRange(iPtrValues + lIdxValue, iNbrValues - lIdxValue, iMinValue, iMaxValue);
+}
+
+/**
+ * Tell if some values exceed a given range, using AVX2.
+ *
+ * Parameters::
+ * * *iPtrValues* (<em>const tSampleValue*</em>): The values
+ * * *iNbrValues* (<em>const tSampleIndex</em>): The number of values
+ * * *iMinValue* (<em>const tSampleValue</em>): The minimal value of the range
+ * * *iMaxValue* (<em>const tSampleValue</em>): The maximal value of the range
+ * Return::
+ * * _int_: 1 if at least 1 value is out of the range, 0 otherwise
+ */
+__attribute__((target("avx2")))
+static int commonutils_isOutOfRange_avx2(
+  const tSampleValue* iPtrValues,
+  const tSampleIndex iNbrValues,
+  const tSampleValue iMinValue,
+  const tSampleValue iMaxValue) {
+  const __m256i lMinValue = _mm256_set1_epi32(iMinValue);
+  const __m256i lMaxValue = _mm256_set1_epi32(iMaxValue);
+  __m256i lExceeding = _mm256_setzero_si256();
+  __m256i lValues;
+  tSampleIndex lIdxValue;
+  // Clamping values with min/max keeps them unchanged if and only if they are in the range
+  for (lIdxValue = 0; lIdxValue + 8 <= iNbrValues; lIdxValue += 8) {
+    lValues = _mm256_loadu_si256((const __m256i*)(iPtrValues + lIdxValue));
+    lExceeding = _mm256_or_si256(lExceeding, _mm256_xor_si256(lValues, _mm256_max_epi32(_mm256_min_epi32(lValues, lMaxValue), lMinValue)));
+  }
+
+  return (_mm256_testz_si256(lExceeding, lExceeding) == 0) | commonutils_isOutOfRange(iPtrValues + lIdxValue, iNbrValues - lIdxValue, iMinValue, iMaxValue);
+}
+
+#endif
+
+/**
+ * Get the SIMD instructions level used by the codecs.
+ * It is detected once from the running CPU. The WSK_SIMD environment variable (none, sse2, ssse3 or avx2) can lower it.
+ *
+ * Return::
+ * * _int_: The SIMD level (one of COMMONUTILS_SIMD_*)
+ */
+int commonutils_getSIMDLevel(void) {
+  if (gSIMDLevel == -1) {
+    int lSIMDLevel = COMMONUTILS_SIMD_NONE;
+#ifdef COMMONUTILS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      lSIMDLevel = COMMONUTILS_SIMD_AVX2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+      lSIMDLevel = COMMONUTILS_SIMD_SSSE3;
+    } else if (__builtin_cpu_supports("sse2")) {
+      lSIMDLevel = COMMONUTILS_SIMD_SSE2;
+    }
+#endif
+    const char* lStrMaxLevel = getenv("WSK_SIMD");
+    if (lStrMaxLevel != NULL) {
+      int lMaxLevel = lSIMDLevel;
+      if (strcmp(lStrMaxLevel, "none") == 0) {
+        lMaxLevel = COMMONUTILS_SIMD_NONE;
+      } else if (strcmp(lStrMaxLevel, "sse2") == 0) {
+        lMaxLevel = COMMONUTILS_SIMD_SSE2;
+      } else if (strcmp(lStrMaxLevel, "ssse3") == 0) {
+        lMaxLevel = COMMONUTILS_SIMD_SSSE3;
+      } else if (strcmp(lStrMaxLevel, "avx2") == 0) {
+        lMaxLevel = COMMONUTILS_SIMD_AVX2;
+      }
+      if (lMaxLevel < lSIMDLevel) {
+        lSIMDLevel = lMaxLevel;
+      }
+    }
+    gSIMDLevel = lSIMDLevel;
+  }
+
+  return gSIMDLevel;
+}
+
+/**
+ * Get the decoding function to be used for a given format.
+ * The fastest function available on the running CPU is returned.
+ *
+ * Parameters::
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * Return::
+ * * <em>tPtrFctDecode</em>: The decoding function
+ */
+tPtrFctDecode commonutils_getDecoder(
+  const int iNbrBitsPerSample,
+  const int iNbrChannels) {
+  tPtrFctDecode rPtrDecode = NULL;
+
+  if (iNbrBitsPerSample == 8) {
+    rPtrDecode = &commonutils_decode8_generic;
+  } else if (iNbrBitsPerSample == 16) {
+    rPtrDecode = (iNbrChannels == 1) ? &commonutils_decode16_mono : ((iNbrChannels == 2) ? &commonutils_decode16_stereo : &commonutils_decode16_generic);
+  } else if (iNbrBitsPerSample == 24) {
+    rPtrDecode = (iNbrChannels == 1) ? &commonutils_decode24_mono : ((iNbrChannels == 2) ? &commonutils_decode24_stereo : &commonutils_decode24_generic);
+  } else {
+    rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
+  }
+#ifdef COMMONUTILS_X86_SIMD
+  int lSIMDLevel = commonutils_getSIMDLevel();
+  if (lSIMDLevel >= COMMONUTILS_SIMD_SSE2) {
+    if (rPtrDecode == &commonutils_decode8_generic) {
+      if (iNbrChannels == 1) {
+        rPtrDecode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_decode8_mono_avx2 : &commonutils_decode8_mono_sse2;
+      }
+    } else if (rPtrDecode == &commonutils_decode16_mono) {
+      rPtrDecode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_decode16_mono_avx2 : &commonutils_decode16_mono_sse2;
+    } else if (rPtrDecode == &commonutils_decode16_stereo) {
+      rPtrDecode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_decode16_stereo_avx2 : &commonutils_decode16_stereo_sse2;
+    }
+  }
+  if (lSIMDLevel >= COMMONUTILS_SIMD_SSSE3) {
+    if (rPtrDecode == &commonutils_decode24_mono) {
+      rPtrDecode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_decode24_mono_avx2 : &commonutils_decode24_mono_ssse3;
+    } else if (rPtrDecode == &commonutils_decode24_stereo) {
+      rPtrDecode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_decode24_stereo_avx2 : &commonutils_decode24_stereo_ssse3;
+    }
+  }
+#endif
+
+  return rPtrDecode;
+}
+
+/**
+ * Get the encoding function to be used for a given format.
+ * The fastest function available on the running CPU is returned.
+ *
+ * Parameters::
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * Return::
+ * * <em>tPtrFctEncode</em>: The encoding function
+ */
+tPtrFctEncode commonutils_getEncoder(
+  const int iNbrBitsPerSample,
+  const int iNbrChannels) {
+  tPtrFctEncode rPtrEncode = NULL;
+
+  if (iNbrBitsPerSample == 8) {
+    rPtrEncode = &commonutils_encode8_generic;
+  } else if (iNbrBitsPerSample == 16) {
+    rPtrEncode = (iNbrChannels == 1) ? &commonutils_encode16_mono : ((iNbrChannels == 2) ? &commonutils_encode16_stereo : &commonutils_encode16_generic);
+  } else if (iNbrBitsPerSample == 24) {
+    rPtrEncode = (iNbrChannels == 1) ? &commonutils_encode24_mono : ((iNbrChannels == 2) ? &commonutils_encode24_stereo : &commonutils_encode24_generic);
+  } else {
+    rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
+  }
+#ifdef COMMONUTILS_X86_SIMD
+  int lSIMDLevel = commonutils_getSIMDLevel();
+  if (lSIMDLevel >= COMMONUTILS_SIMD_SSE2) {
+    if (rPtrEncode == &commonutils_encode8_generic) {
+      if (iNbrChannels == 1) {
+        rPtrEncode = &commonutils_encode8_mono_sse2;
+      }
+    } else if (rPtrEncode == &commonutils_encode16_mono) {
+      rPtrEncode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_encode16_mono_avx2 : &commonutils_encode16_mono_sse2;
+    } else if (rPtrEncode == &commonutils_encode16_stereo) {
+      rPtrEncode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_encode16_stereo_avx2 : &commonutils_encode16_stereo_sse2;
+    }
+  }
+  if (lSIMDLevel >= COMMONUTILS_SIMD_SSSE3) {
+    if (rPtrEncode == &commonutils_encode24_mono) {
+      rPtrEncode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_encode24_mono_avx2 : &commonutils_encode24_mono_ssse3;
+    } else if (rPtrEncode == &commonutils_encode24_stereo) {
+      rPtrEncode = (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) ? &commonutils_encode24_stereo_avx2 : &commonutils_encode24_stereo_ssse3;
+    }
+  }
+#endif
+
+  return rPtrEncode;
+}
+
+/**
+ * Get the function telling if values exceed a given range.
+ * The fastest function available on the running CPU is returned.
+ *
+ * Return::
+ * * <em>tPtrFctIsOutOfRange</em>: The range checking function
+ */
+tPtrFctIsOutOfRange commonutils_getOutOfRangeChecker(void) {
+  tPtrFctIsOutOfRange rPtrIsOutOfRange = &commonutils_isOutOfRange;
+#ifdef COMMONUTILS_X86_SIMD
+  int lSIMDLevel = commonutils_getSIMDLevel();
+  if (lSIMDLevel >= COMMONUTILS_SIMD_AVX2) {
+    rPtrIsOutOfRange = &commonutils_isOutOfRange_avx2;
+  } else if (lSIMDLevel >= COMMONUTILS_SIMD_SSE2) {
+    rPtrIsOutOfRange = &commonutils_isOutOfRange_sse2;
+  }
+#endif
+
+  return rPtrIsOutOfRange;
+}
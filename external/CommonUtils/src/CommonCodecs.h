@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#ifndef __COMMONUTILS_COMMONCODECS_H__
+#define __COMMONUTILS_COMMONCODECS_H__
+
+#include "CommonUtils.h"
+
+// Pointer to a function decoding interleaved raw samples into per channel values
+typedef void(*tPtrFctDecode)(const char*, const int, const tSampleIndex, tSampleValue**);
+// Pointer to a function encoding per channel values into interleaved raw samples.
+// The int parameter tells whether values out of range are saturated (1) or truncated (0).
+typedef void(*tPtrFctEncode)(tSampleValue**, const int, const tSampleIndex, const int, char*);
+// Pointer to a function telling if some values exceed a range [min, max]
+typedef int(*tPtrFctIsOutOfRange)(const tSampleValue*, const tSampleIndex, const tSampleValue, const tSampleValue);
+
+/**
+ * Get the decoding function to be used for a given format.
+ * The fastest function available on the running CPU is returned.
+ *
+ * Parameters::
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * Return::
+ * * <em>tPtrFctDecode</em>: The decoding function
+ */
+tPtrFctDecode commonutils_getDecoder(
+  const int iNbrBitsPerSample,
+  const int iNbrChannels);
+
+/**
+ * Get the encoding function to be used for a given format.
+ * The fastest function available on the running CPU is returned.
+ *
+ * Parameters::
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * Return::
+ * * <em>tPtrFctEncode</em>: The encoding function
+ */
+tPtrFctEncode commonutils_getEncoder(
+  const int iNbrBitsPerSample,
+  const int iNbrChannels);
+
+/**
+ * Get the function telling if values exceed a given range.
+ * The fastest function available on the running CPU is returned.
+ *
+ * Return::
+ * * <em>tPtrFctIsOutOfRange</em>: The range checking function
+ */
+tPtrFctIsOutOfRange commonutils_getOutOfRangeChecker(void);
+
+#endif
@@ -0,0 +1,259 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#include "CommonThreads.h"
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+// Maximal number of threads used to process a buffer
+#define COMMONUTILS_MAX_THREADS 256
+
+/**
+ * Get the number of threads used to process buffers.
+ * It is read from the WSK_THREADS environment variable (0 meaning the number of processors) each time a buffer is processed, and defaults to 1.
+ *
+ * Return::
+ * * _int_: The number of threads
+ */
+int commonutils_getNbrThreads(void) {
+  int rNbrThreads = 1;
+
+#ifdef HAVE_PTHREAD_H
+  const char* lStrNbrThreads = getenv("WSK_THREADS");
+  if (lStrNbrThreads != NULL) {
+    char* lPtrEnd;
+    long lValue = strtol(lStrNbrThreads, &lPtrEnd, 10);
+    if ((lPtrEnd != lStrNbrThreads) &&
+        (*lPtrEnd == 0)) {
+      if (lValue == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        lValue = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        lValue = 1;
+#endif
+      }
+      if (lValue > COMMONUTILS_MAX_THREADS) {
+        lValue = COMMONUTILS_MAX_THREADS;
+      }
+      if (lValue > 1) {
+        rNbrThreads = lValue;
+      }
+    }
+  }
+#endif
+
+  return rNbrThreads;
+}
+
+#ifdef HAVE_PTHREAD_H
+
+// Struct describing a group of tasks submitted at once
+typedef struct tTasksGroupStruct {
+  tPtrFctWithoutGVL fct;
+  char* tasksArgs;
+  size_t taskArgsSize;
+  int nbrTasks;
+  // Index of the next task to be started
+  int idxNextTask;
+  // Number of finished tasks
+  int nbrFinishedTasks;
+  // Next group having tasks to be started
+  struct tTasksGroupStruct* next;
+} tTasksGroup;
+
+// The pool: workers wait for groups of tasks in a queue
+typedef struct {
+  pthread_mutex_t mutex;
+  // Signaled when tasks are queued
+  pthread_cond_t tasksCond;
+  // Signaled when tasks are finished
+  pthread_cond_t finishedCond;
+  // The queue of groups having tasks to be started
+  tTasksGroup* firstGroup;
+  tTasksGroup* lastGroup;
+  // Number of workers created
+  int nbrWorkers;
+} tThreadsPool;
+
+// The pool of the process.
+// Each C extension links its own copy of CommonUtils: the pool is shared among them through the WSK module (see commonutils_initThreadsPool), so that they don't create as many workers each.
+static tThreadsPool* gPtrPool = NULL;
+
+/**
+ * Reset the pool in a forked child process: workers of the parent don't exist there.
+ */
+static void commonutils_resetPoolAfterFork(void) {
+  pthread_mutex_init(&gPtrPool->mutex, NULL);
+  pthread_cond_init(&gPtrPool->tasksCond, NULL);
+  pthread_cond_init(&gPtrPool->finishedCond, NULL);
+  gPtrPool->firstGroup = NULL;
+  gPtrPool->lastGroup = NULL;
+  gPtrPool->nbrWorkers = 0;
+}
+
+/**
+ * Start the first task of the queue, and wait for its end.
+ * The pool mutex must be locked: it is unlocked while the task runs.
+ */
+static void commonutils_runNextTask(void) {
+  tTasksGroup* lPtrGroup = gPtrPool->firstGroup;
+  int lIdxTask = lPtrGroup->idxNextTask;
+  ++lPtrGroup->idxNextTask;
+  if (lPtrGroup->idxNextTask == lPtrGroup->nbrTasks) {
+    // All tasks of this group are started: remove it from the queue
+    gPtrPool->firstGroup = lPtrGroup->next;
+    if (gPtrPool->firstGroup == NULL) {
+      gPtrPool->lastGroup = NULL;
+    }
+  }
+  pthread_mutex_unlock(&gPtrPool->mutex);
+  lPtrGroup->fct(lPtrGroup->tasksArgs + lIdxTask*lPtrGroup->taskArgsSize);
+  pthread_mutex_lock(&gPtrPool->mutex);
+  ++lPtrGroup->nbrFinishedTasks;
+  if (lPtrGroup->nbrFinishedTasks == lPtrGroup->nbrTasks) {
+    pthread_cond_broadcast(&gPtrPool->finishedCond);
+  }
+}
+
+/**
+ * Main loop of a worker thread.
+ *
+ * Parameters::
+ * * *iPtrArgs* (<em>void*</em>): Unused
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* commonutils_worker(
+  void* iPtrArgs) {
+  pthread_mutex_lock(&gPtrPool->mutex);
+  while (1) {
+    while (gPtrPool->firstGroup == NULL) {
+      pthread_cond_wait(&gPtrPool->tasksCond, &gPtrPool->mutex);
+    }
+    commonutils_runNextTask();
+  }
+
+  return NULL;
+}
+
+/**
+ * Create workers until the pool has enough of them.
+ * The pool mutex must be locked.
+ *
+ * Parameters::
+ * * *iNbrWorkers* (<em>const int</em>): The number of workers needed
+ */
+static void commonutils_createWorkers(
+  const int iNbrWorkers) {
+  if (gPtrPool->nbrWorkers < iNbrWorkers) {
+    // Workers inherit a mask blocking all signals: signals are left to Ruby threads.
+    sigset_t lAllSignals;
+    sigset_t lOldSignals;
+    sigfillset(&lAllSignals);
+    pthread_sigmask(SIG_SETMASK, &lAllSignals, &lOldSignals);
+    pthread_attr_t lAttributes;
+    pthread_attr_init(&lAttributes);
+    pthread_attr_setdetachstate(&lAttributes, PTHREAD_CREATE_DETACHED);
+    pthread_t lThread;
+    while ((gPtrPool->nbrWorkers < iNbrWorkers) &&
+           (pthread_create(&lThread, &lAttributes, &commonutils_worker, NULL) == 0)) {
+      ++gPtrPool->nbrWorkers;
+    }
+    pthread_attr_destroy(&lAttributes);
+    pthread_sigmask(SIG_SETMASK, &lOldSignals, NULL);
+  }
+}
+
+#endif
+
+/**
+ * Initialize the threads pool of the process, or get the one already created by another C extension.
+ * This must be called with the GVL, before running tasks with commonutils_runTasks.
+ */
+void commonutils_initThreadsPool(void) {
+#ifdef HAVE_PTHREAD_H
+  if (gPtrPool == NULL) {
+    // The first C extension using the pool creates it, and the other ones find it in the WSK module.
+    VALUE lValWSKModule = rb_define_module("WSK");
+    ID lIDPool = rb_intern("__threads_pool__");
+    VALUE lValPool = rb_attr_get(lValWSKModule, lIDPool);
+    if (lValPool == Qnil) {
+      tThreadsPool* lPtrPool = ALLOC(tThreadsPool);
+      pthread_mutex_init(&lPtrPool->mutex, NULL);
+      pthread_cond_init(&lPtrPool->tasksCond, NULL);
+      pthread_cond_init(&lPtrPool->finishedCond, NULL);
+      lPtrPool->firstGroup = NULL;
+      lPtrPool->lastGroup = NULL;
+      lPtrPool->nbrWorkers = 0;
+      // Workers are never stopped: the pool is never freed.
+      lValPool = Data_Wrap_Struct(rb_cObject, NULL, NULL, lPtrPool);
+      rb_ivar_set(lValWSKModule, lIDPool, lValPool);
+      gPtrPool = lPtrPool;
+      pthread_atfork(NULL, NULL, &commonutils_resetPoolAfterFork);
+    } else {
+      Data_Get_Struct(lValPool, tThreadsPool, gPtrPool);
+    }
+  }
+#endif
+}
+
+/**
+ * Run tasks using the threads pool, and wait for all of them to be finished.
+ * The calling thread runs tasks too. As the tasks, it does not need the GVL.
+ * The pool must have been initialized with commonutils_initThreadsPool.
+ *
+ * Parameters::
+ * * *iPtrFct* (<em>const tPtrFctWithoutGVL</em>): The function to call for each task
+ * * *iPtrTasksArgs* (<em>char*</em>): The arguments of the tasks, stored contiguously
+ * * *iTaskArgsSize* (<em>const size_t</em>): The size of the arguments of 1 task
+ * * *iNbrTasks* (<em>const int</em>): The number of tasks
+ */
+void commonutils_runTasks(
+  const tPtrFctWithoutGVL iPtrFct,
+  char* iPtrTasksArgs,
+  const size_t iTaskArgsSize,
+  const int iNbrTasks) {
+#ifdef HAVE_PTHREAD_H
+  if (iNbrTasks > 1) {
+    tTasksGroup lGroup;
+    lGroup.fct = iPtrFct;
+    lGroup.tasksArgs = iPtrTasksArgs;
+    lGroup.taskArgsSize = iTaskArgsSize;
+    lGroup.nbrTasks = iNbrTasks;
+    lGroup.idxNextTask = 0;
+    lGroup.nbrFinishedTasks = 0;
+    lGroup.next = NULL;
+    pthread_mutex_lock(&gPtrPool->mutex);
+    commonutils_createWorkers(iNbrTasks - 1);
+    if (gPtrPool->lastGroup == NULL) {
+      gPtrPool->firstGroup = &lGroup;
+    } else {
+      gPtrPool->lastGroup->next = &lGroup;
+    }
+    gPtrPool->lastGroup = &lGroup;
+    pthread_cond_broadcast(&gPtrPool->tasksCond);
+    // Run tasks until all of them are started, then wait for the ones run by workers.
+    // Groups queued before this one are run first.
+    while (lGroup.idxNextTask < lGroup.nbrTasks) {
+      commonutils_runNextTask();
+    }
+    while (lGroup.nbrFinishedTasks < lGroup.nbrTasks) {
+      pthread_cond_wait(&gPtrPool->finishedCond, &gPtrPool->mutex);
+    }
+    pthread_mutex_unlock(&gPtrPool->mutex);
+  } else {
+#endif
+    int lIdxTask;
+    for (lIdxTask = 0; lIdxTask < iNbrTasks; ++lIdxTask) {
+      iPtrFct(iPtrTasksArgs + lIdxTask*iTaskArgsSize);
+    }
+#ifdef HAVE_PTHREAD_H
+  }
+#endif
+}
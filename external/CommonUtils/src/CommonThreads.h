@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+ * Licensed under the terms specified in LICENSE file. No warranty is provided.
+ **/
+
+#ifndef __COMMONUTILS_COMMONTHREADS_H__
+#define __COMMONUTILS_COMMONTHREADS_H__
+
+#include "CommonUtils.h"
+
+/**
+ * Initialize the threads pool of the process, or get the one already created by another C extension.
+ * This must be called with the GVL, before running tasks with commonutils_runTasks.
+ */
+void commonutils_initThreadsPool(void);
+
+/**
+ * Run tasks using the threads pool, and wait for all of them to be finished.
+ * The calling thread runs tasks too. As the tasks, it does not need the GVL.
+ * The pool must have been initialized with commonutils_initThreadsPool.
+ *
+ * Parameters::
+ * * *iPtrFct* (<em>const tPtrFctWithoutGVL</em>): The function to call for each task
+ * * *iPtrTasksArgs* (<em>char*</em>): The arguments of the tasks, stored contiguously
+ * * *iTaskArgsSize* (<em>const size_t</em>): The size of the arguments of 1 task
+ * * *iNbrTasks* (<em>const int</em>): The number of tasks
+ */
+void commonutils_runTasks(
+  const tPtrFctWithoutGVL iPtrFct,
+  char* iPtrTasksArgs,
+  const size_t iTaskArgsSize,
+  const int iNbrTasks);
+
+#endif
@@ -4,100 +4,731 @@
  **/
 
 #include "CommonUtils.h"
+#include "CommonCodecs.h"
+#include "CommonThreads.h"
 #include "ruby.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_RUBY_THREAD_H
+#include "ruby/thread.h"
+#endif
 
 /**
- * Iterate through a raw buffer.
+ * Get the verbosity of clipping reports.
+ * It is read from the WSK_CLIP_LOG environment variable (none, summary or ranges) each time a report is initialized, and defaults to summary.
+ *
+ * Return::
+ * * _int_: The verbosity (one of COMMONUTILS_CLIPLOG_*)
+ */
+int commonutils_getClipLogVerbosity(void) {
+  int rVerbosity = COMMONUTILS_CLIPLOG_SUMMARY;
+
+  const char* lStrVerbosity = getenv("WSK_CLIP_LOG");
+  if (lStrVerbosity != NULL) {
+    if (strcmp(lStrVerbosity, "none") == 0) {
+      rVerbosity = COMMONUTILS_CLIPLOG_NONE;
+    } else if (strcmp(lStrVerbosity, "ranges") == 0) {
+      rVerbosity = COMMONUTILS_CLIPLOG_RANGES;
+    }
+  }
+
+  return rVerbosity;
+}
+
+/**
+ * Initialize an empty clipping report.
  *
  * Parameters::
- * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
- * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *oPtrClipReport* (<em>tClipReport*</em>): The report to initialize
  * * *iNbrChannels* (<em>const int</em>): The number of channels
- * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
- * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
- * * *iPtrProcessMethod* (<em>const tPtrFctProcess</em>): Pointer to the method to call for processing
- * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
  */
-void commonutils_iterateThroughRawBuffer(
-  const char* iPtrRawBuffer,
-  const int iNbrBitsPerSample,
-  const int iNbrChannels,
-  const tSampleIndex iNbrSamples,
-  const tSampleIndex iIdxOffsetSample,
-  const tPtrFctProcess iPtrProcessMethod,
-  void* iPtrArgs) {
-  // Parse the data. This is done differently depending on the data structure
-  // Define variables outside the loops to not allocate and initialize heap size for nothing
-  tSampleIndex lIdxBufferSample;
+void commonutils_initClipReport(
+  tClipReport* oPtrClipReport,
+  const int iNbrChannels) {
+  int lIdxChannel;
+  oPtrClipReport->nbrChannels = iNbrChannels;
+  oPtrClipReport->verbosity = commonutils_getClipLogVerbosity();
+  oPtrClipReport->channels = ALLOC_N(tClipInfo, iNbrChannels);
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    oPtrClipReport->channels[lIdxChannel].nbrClippedSamples = 0;
+    oPtrClipReport->channels[lIdxChannel].idxFirstSample = 0;
+    oPtrClipReport->channels[lIdxChannel].idxLastSample = 0;
+    oPtrClipReport->channels[lIdxChannel].peakOvershoot = 0;
+    oPtrClipReport->channels[lIdxChannel].nbrRanges = 0;
+  }
+}
+
+/**
+ * Free a clipping report initialized with commonutils_initClipReport.
+ *
+ * Parameters::
+ * * *ioPtrClipReport* (<em>tClipReport*</em>): The report to free
+ */
+void commonutils_freeClipReport(
+  tClipReport* ioPtrClipReport) {
+  free(ioPtrClipReport->channels);
+  ioPtrClipReport->channels = NULL;
+}
+
+/**
+ * Record in a clipping report the values of a block that exceed the range of a given number of bits per sample.
+ * Values are left unchanged: saturating them is the job of the encoder.
+ *
+ * Parameters::
+ * * *ioPtrClipReport* (<em>tClipReport*</em>): The report to complete
+ * * *iPtrBlock* (<em>const tSampleBlock*</em>): The block to check
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ */
+void commonutils_checkClipsBlock(
+  tClipReport* ioPtrClipReport,
+  const tSampleBlock* iPtrBlock,
+  const int iNbrBitsPerSample) {
+  tSampleValue lMaxValue = (1 << (iNbrBitsPerSample-1)) - 1;
+  tSampleValue lMinValue = -(1 << (iNbrBitsPerSample-1));
+  tPtrFctIsOutOfRange lPtrIsOutOfRange = commonutils_getOutOfRangeChecker();
+  int lStoreRanges = (ioPtrClipReport->verbosity >= COMMONUTILS_CLIPLOG_RANGES);
+  tSampleIndex lIdxSample;
+  tSampleIndex lIdxBlockSample;
+  tSampleValue lOvershoot;
   int lIdxChannel;
-  tSampleIndex lIdxSample = iIdxOffsetSample;
-  // 0: Continue iterations
-  // 1: Break all
-  // 2: Skip to the next sample
-  int lProcessResult;
-  if (iNbrBitsPerSample == 8) {
-    unsigned char* lPtrData = (unsigned char*)iPtrRawBuffer;
-    for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-      lProcessResult = 0;
-      for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-        if (lProcessResult == 0) {
-          lProcessResult = iPtrProcessMethod(((tSampleValue)(*lPtrData)) - 128, lIdxSample, lIdxChannel, iPtrArgs);
+  const tSampleValue* lPtrValues;
+  tClipInfo* lPtrClipInfo;
+  for (lIdxChannel = 0; lIdxChannel < iPtrBlock->nbrChannels; ++lIdxChannel) {
+    lPtrValues = iPtrBlock->values[lIdxChannel];
+    // Clipping is the rare case: only channels having values out of range are scanned sample by sample.
+    if (lPtrIsOutOfRange(lPtrValues, iPtrBlock->nbrSamples, lMinValue, lMaxValue) != 0) {
+      lPtrClipInfo = &(ioPtrClipReport->channels[lIdxChannel]);
+      for (lIdxBlockSample = 0; lIdxBlockSample < iPtrBlock->nbrSamples; ++lIdxBlockSample) {
+        if (lPtrValues[lIdxBlockSample] > lMaxValue) {
+          lOvershoot = lPtrValues[lIdxBlockSample] - lMaxValue;
+        } else if (lPtrValues[lIdxBlockSample] < lMinValue) {
+          lOvershoot = lMinValue - lPtrValues[lIdxBlockSample];
+        } else {
+          continue;
+        }
+        lIdxSample = iPtrBlock->idxFirstSample + lIdxBlockSample;
+        if (lPtrClipInfo->nbrClippedSamples == 0) {
+          lPtrClipInfo->idxFirstSample = lIdxSample;
+        }
+        if ((lPtrClipInfo->nbrClippedSamples == 0) ||
+            (lIdxSample != lPtrClipInfo->idxLastSample + 1)) {
+          // A new range begins
+          if ((lStoreRanges != 0) &&
+              (lPtrClipInfo->nbrRanges < COMMONUTILS_CLIP_MAX_RANGES)) {
+            lPtrClipInfo->ranges[lPtrClipInfo->nbrRanges].idxFirstSample = lIdxSample;
+          }
+          ++lPtrClipInfo->nbrRanges;
         }
-        if (lProcessResult == 1) {
-          break;
+        if ((lStoreRanges != 0) &&
+            (lPtrClipInfo->nbrRanges <= COMMONUTILS_CLIP_MAX_RANGES)) {
+          lPtrClipInfo->ranges[lPtrClipInfo->nbrRanges-1].idxLastSample = lIdxSample;
+        }
+        lPtrClipInfo->idxLastSample = lIdxSample;
+        ++lPtrClipInfo->nbrClippedSamples;
+        if (lOvershoot > lPtrClipInfo->peakOvershoot) {
+          lPtrClipInfo->peakOvershoot = lOvershoot;
         }
-        ++lPtrData;
-      }
-      if (lProcessResult == 1) {
-        break;
       }
-      ++lIdxSample;
     }
-  } else if (iNbrBitsPerSample == 16) {
-    signed short int* lPtrData = (signed short int*)iPtrRawBuffer;
-    for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-      lProcessResult = 0;
-      for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-        if (lProcessResult == 0) {
-          lProcessResult = iPtrProcessMethod((tSampleValue)(*lPtrData), lIdxSample, lIdxChannel, iPtrArgs);
-        }
-        if (lProcessResult == 1) {
-          break;
+  }
+}
+
+/**
+ * Log the content of a clipping report as warnings, according to its verbosity.
+ * Nothing is logged if no sample was clipped.
+ *
+ * Parameters::
+ * * *iSelf* (_Object_): Object used to call log methods
+ * * *iPtrClipReport* (<em>const tClipReport*</em>): The report to log
+ */
+void commonutils_logClipReport(
+  VALUE iSelf,
+  const tClipReport* iPtrClipReport) {
+  if (iPtrClipReport->verbosity != COMMONUTILS_CLIPLOG_NONE) {
+    char lLogMessage[256];
+    ID lIDLogWarn = rb_intern("log_warn");
+    const tClipInfo* lPtrClipInfo;
+    tSampleIndex lIdxRange;
+    int lIdxChannel;
+    for (lIdxChannel = 0; lIdxChannel < iPtrClipReport->nbrChannels; ++lIdxChannel) {
+      lPtrClipInfo = &(iPtrClipReport->channels[lIdxChannel]);
+      if (lPtrClipInfo->nbrClippedSamples > 0) {
+        sprintf(lLogMessage, "@%lld-%lld,%d - %lld samples exceeding limits in %lld ranges (peak overshoot: %d), saturated", lPtrClipInfo->idxFirstSample, lPtrClipInfo->idxLastSample, lIdxChannel, lPtrClipInfo->nbrClippedSamples, lPtrClipInfo->nbrRanges, lPtrClipInfo->peakOvershoot);
+        rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
+        if (iPtrClipReport->verbosity >= COMMONUTILS_CLIPLOG_RANGES) {
+          for (lIdxRange = 0; (lIdxRange < lPtrClipInfo->nbrRanges) && (lIdxRange < COMMONUTILS_CLIP_MAX_RANGES); ++lIdxRange) {
+            sprintf(lLogMessage, "@%lld-%lld,%d - Samples exceeding limits", lPtrClipInfo->ranges[lIdxRange].idxFirstSample, lPtrClipInfo->ranges[lIdxRange].idxLastSample, lIdxChannel);
+            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
+          }
+          if (lPtrClipInfo->nbrRanges > COMMONUTILS_CLIP_MAX_RANGES) {
+            sprintf(lLogMessage, "@%lld-%lld,%d - %lld more ranges exceeding limits", lPtrClipInfo->ranges[COMMONUTILS_CLIP_MAX_RANGES-1].idxLastSample + 1, lPtrClipInfo->idxLastSample, lIdxChannel, lPtrClipInfo->nbrRanges - COMMONUTILS_CLIP_MAX_RANGES);
+            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
+          }
         }
-        ++lPtrData;
       }
-      if (lProcessResult == 1) {
-        break;
-      }
-      ++lIdxSample;
     }
-  } else if (iNbrBitsPerSample == 24) {
-    t24bits* lPtrData = (t24bits*)iPtrRawBuffer;
-    for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-      lProcessResult = 0;
-      for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-        if (lProcessResult == 0) {
-          lProcessResult = iPtrProcessMethod((tSampleValue)(lPtrData->value), lIdxSample, lIdxChannel, iPtrArgs);
-        }
-        if (lProcessResult == 1) {
-          break;
+  }
+}
+
+/**
+ * Merge a clipping report in another one.
+ * The merged report has to cover samples following the ones of the report to complete: the result is the same as if all samples were recorded in the same report.
+ *
+ * Parameters::
+ * * *ioPtrClipReport* (<em>tClipReport*</em>): The report to complete
+ * * *iPtrClipReport* (<em>const tClipReport*</em>): The report to merge
+ */
+static void commonutils_mergeClipReport(
+  tClipReport* ioPtrClipReport,
+  const tClipReport* iPtrClipReport) {
+  int lStoreRanges = (ioPtrClipReport->verbosity >= COMMONUTILS_CLIPLOG_RANGES);
+  int lIdxChannel;
+  tSampleIndex lIdxRange;
+  tSampleIndex lIdxFirstNewRange;
+  tClipInfo* lPtrClipInfo;
+  const tClipInfo* lPtrMergedClipInfo;
+  for (lIdxChannel = 0; lIdxChannel < ioPtrClipReport->nbrChannels; ++lIdxChannel) {
+    lPtrClipInfo = &(ioPtrClipReport->channels[lIdxChannel]);
+    lPtrMergedClipInfo = &(iPtrClipReport->channels[lIdxChannel]);
+    if (lPtrMergedClipInfo->nbrClippedSamples > 0) {
+      lIdxFirstNewRange = 0;
+      if (lPtrClipInfo->nbrClippedSamples == 0) {
+        lPtrClipInfo->idxFirstSample = lPtrMergedClipInfo->idxFirstSample;
+      } else if (lPtrMergedClipInfo->idxFirstSample == lPtrClipInfo->idxLastSample + 1) {
+        // The first merged range continues the last one
+        if ((lStoreRanges != 0) &&
+            (lPtrClipInfo->nbrRanges <= COMMONUTILS_CLIP_MAX_RANGES)) {
+          lPtrClipInfo->ranges[lPtrClipInfo->nbrRanges-1].idxLastSample = lPtrMergedClipInfo->ranges[0].idxLastSample;
+        }
+        lIdxFirstNewRange = 1;
+      }
+      if (lStoreRanges != 0) {
+        for (lIdxRange = lIdxFirstNewRange; (lIdxRange < lPtrMergedClipInfo->nbrRanges) && (lIdxRange < COMMONUTILS_CLIP_MAX_RANGES); ++lIdxRange) {
+          if (lPtrClipInfo->nbrRanges + lIdxRange - lIdxFirstNewRange < COMMONUTILS_CLIP_MAX_RANGES) {
+            lPtrClipInfo->ranges[lPtrClipInfo->nbrRanges + lIdxRange - lIdxFirstNewRange] = lPtrMergedClipInfo->ranges[lIdxRange];
+          }
         }
-        // Increase lPtrData this way to ensure alignment.
-        lPtrData = (t24bits*)(((int)lPtrData)+3);
       }
-      if (lProcessResult == 1) {
-        break;
+      lPtrClipInfo->nbrRanges += lPtrMergedClipInfo->nbrRanges - lIdxFirstNewRange;
+      lPtrClipInfo->idxLastSample = lPtrMergedClipInfo->idxLastSample;
+      lPtrClipInfo->nbrClippedSamples += lPtrMergedClipInfo->nbrClippedSamples;
+      if (lPtrMergedClipInfo->peakOvershoot > lPtrClipInfo->peakOvershoot) {
+        lPtrClipInfo->peakOvershoot = lPtrMergedClipInfo->peakOvershoot;
       }
-      ++lIdxSample;
     }
+  }
+}
+
+/**
+ * Allocate the values of a samples block.
+ * The block can then store up to COMMONUTILS_BLOCK_SIZE samples, and values of each channel are aligned on COMMONUTILS_BLOCK_ALIGNMENT bytes.
+ *
+ * Parameters::
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to initialize
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ */
+void commonutils_initSampleBlock(
+  tSampleBlock* oPtrBlock,
+  const int iNbrChannels) {
+  int lIdxChannel;
+  // All channels share the same allocated memory.
+  // Values are aligned on COMMONUTILS_BLOCK_ALIGNMENT bytes, so that each channel is aligned too.
+  tSampleValue* lPtrValues;
+  oPtrBlock->allocatedValues = ALLOC_N(char, COMMONUTILS_BLOCK_SIZE*iNbrChannels*sizeof(tSampleValue) + COMMONUTILS_BLOCK_ALIGNMENT - 1);
+  lPtrValues = (tSampleValue*)((((size_t)oPtrBlock->allocatedValues) + COMMONUTILS_BLOCK_ALIGNMENT - 1) & ~((size_t)COMMONUTILS_BLOCK_ALIGNMENT - 1));
+
+  oPtrBlock->nbrChannels = iNbrChannels;
+  oPtrBlock->nbrSamples = 0;
+  oPtrBlock->idxFirstSample = 0;
+  oPtrBlock->values = ALLOC_N(tSampleValue*, iNbrChannels);
+  for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
+    oPtrBlock->values[lIdxChannel] = lPtrValues + lIdxChannel*COMMONUTILS_BLOCK_SIZE;
+  }
+}
+
+/**
+ * Free the values of a samples block initialized with commonutils_initSampleBlock.
+ *
+ * Parameters::
+ * * *ioPtrBlock* (<em>tSampleBlock*</em>): The block to free
+ */
+void commonutils_freeSampleBlock(
+  tSampleBlock* ioPtrBlock) {
+  free(ioPtrBlock->allocatedValues);
+  free(ioPtrBlock->values);
+  ioPtrBlock->allocatedValues = NULL;
+  ioPtrBlock->values = NULL;
+}
+
+/**
+ * Decode samples from a raw buffer into a block.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer, pointing on the first sample to decode
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples to decode (at most COMMONUTILS_BLOCK_SIZE)
+ * * *iIdxFirstSample* (<em>const tSampleIndex</em>): The index of the first sample, to be stored in the block
+ * * *oPtrBlock* (<em>tSampleBlock*</em>): The block to fill
+ */
+void commonutils_decodeBlock(
+  const char* iPtrRawBuffer,
+  const int iNbrBitsPerSample,
+  const tSampleIndex iNbrSamples,
+  const tSampleIndex iIdxFirstSample,
+  tSampleBlock* oPtrBlock) {
+  oPtrBlock->nbrSamples = iNbrSamples;
+  oPtrBlock->idxFirstSample = iIdxFirstSample;
+  (commonutils_getDecoder(iNbrBitsPerSample, oPtrBlock->nbrChannels))(iPtrRawBuffer, oPtrBlock->nbrChannels, iNbrSamples, oPtrBlock->values);
+}
+
+/**
+ * Encode samples from a block into a raw buffer.
+ * When checking is needed, values exceeding the range are saturated, and a clipping report is logged.
+ *
+ * Parameters::
+ * * *iSelf* (_Object_): Object used to call log methods
+ * * *ioPtrBlock* (<em>tSampleBlock*</em>): The block to encode
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
+ * * *oPtrRawBuffer* (<em>char*</em>): The raw buffer to write, pointing on the first sample to encode
+ */
+void commonutils_encodeBlock(
+  VALUE iSelf,
+  tSampleBlock* ioPtrBlock,
+  const int iNbrBitsPerSample,
+  const int iNeedCheck,
+  char* oPtrRawBuffer) {
+  tPtrFctEncode lPtrEncode = commonutils_getEncoder(iNbrBitsPerSample, ioPtrBlock->nbrChannels);
+  if (iNeedCheck != 0) {
+    tClipReport lClipReport;
+    commonutils_initClipReport(&lClipReport, ioPtrBlock->nbrChannels);
+    commonutils_checkClipsBlock(&lClipReport, ioPtrBlock, iNbrBitsPerSample);
+    lPtrEncode(ioPtrBlock->values, ioPtrBlock->nbrChannels, ioPtrBlock->nbrSamples, iNeedCheck, oPtrRawBuffer);
+    commonutils_logClipReport(iSelf, &lClipReport);
+    commonutils_freeClipReport(&lClipReport);
+  } else {
+    lPtrEncode(ioPtrBlock->values, ioPtrBlock->nbrChannels, ioPtrBlock->nbrSamples, iNeedCheck, oPtrRawBuffer);
+  }
+}
+
+/**
+ * Call a function without holding Ruby's GVL, so that other Ruby threads can run meanwhile.
+ * The function must not call any Ruby API. If the Ruby version can't release the GVL, the function is simply called.
+ *
+ * Parameters::
+ * * *iPtrFct* (<em>const tPtrFctWithoutGVL</em>): The function to call
+ * * *iPtrArgs* (<em>void*</em>): The argument to give the function
+ */
+void commonutils_callWithoutGVL(
+  const tPtrFctWithoutGVL iPtrFct,
+  void* iPtrArgs) {
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+  rb_thread_call_without_gvl(iPtrFct, iPtrArgs, NULL, NULL);
+#else
+  iPtrFct(iPtrArgs);
+#endif
+}
+
+/**
+ * Get a pointer to some data of a file mapped in memory.
+ * Data can be processed in place. It stays valid as long as the container of the mapped file is referenced.
+ *
+ * Parameters::
+ * * *iValMappedFile* (_Object_): Container of the mapped file (created with IOUtils#mapFile)
+ * * *iOffset* (<em>const tSampleIndex</em>): Offset of the data in the mapped region
+ * * *iSize* (<em>const tSampleIndex</em>): Size of the data
+ * Return::
+ * * <em>const char*</em>: The data
+ */
+const char* commonutils_getMappedData(
+  VALUE iValMappedFile,
+  const tSampleIndex iOffset,
+  const tSampleIndex iSize) {
+  tMappedFile* lPtrMappedFile;
+  Data_Get_Struct(iValMappedFile, tMappedFile, lPtrMappedFile);
+
+  if ((iOffset < 0) ||
+      (iSize < 0) ||
+      (iOffset > lPtrMappedFile->dataSize) ||
+      (iSize > lPtrMappedFile->dataSize - iOffset)) {
+    rb_raise(rb_eRuntimeError, "Data [%lld-%lld] is out of the mapped region of %lld bytes", iOffset, iOffset+iSize, lPtrMappedFile->dataSize);
+  }
+
+  return lPtrMappedFile->data + iOffset;
+}
+
+/**
+ * Get the output buffer of a processing function.
+ * It is either a region of a file mapped in memory for write, so that results are written directly in the output file, or a new Ruby String.
+ *
+ * Parameters::
+ * * *iValOutputMappedFile* (_Object_): Container of the output file mapped for write (created with IOUtils#mapFileForWrite), or nil to create a String
+ * * *iValOutputOffset* (_Integer_): Offset of the output data in the mapped region (ignored if no mapped file is given)
+ * * *iSize* (<em>const tSampleIndex</em>): Size of the output buffer
+ * * *oPtrValOutputBuffer* (<em>VALUE*</em>): The String created, or nil if the output is written in the mapped file
+ * Return::
+ * * <em>char*</em>: The output buffer
+ */
+char* commonutils_getOutputBuffer(
+  VALUE iValOutputMappedFile,
+  VALUE iValOutputOffset,
+  const tSampleIndex iSize,
+  VALUE* oPtrValOutputBuffer) {
+  char* rPtrOutputBuffer;
+
+  if (iValOutputMappedFile == Qnil) {
+    // The String is filled directly: no intermediate buffer to copy
+    *oPtrValOutputBuffer = rb_str_new(NULL, iSize);
+    rPtrOutputBuffer = RSTRING_PTR(*oPtrValOutputBuffer);
   } else {
-    rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
+    tMappedFile* lPtrMappedFile;
+    Data_Get_Struct(iValOutputMappedFile, tMappedFile, lPtrMappedFile);
+    if (!lPtrMappedFile->writable) {
+      rb_raise(rb_eRuntimeError, "Mapped file is read-only: it can't receive output data");
+    }
+    rPtrOutputBuffer = (char*)commonutils_getMappedData(iValOutputMappedFile, NUM2LL(iValOutputOffset), iSize);
+    *oPtrValOutputBuffer = Qnil;
+  }
+
+  return rPtrOutputBuffer;
+}
+
+// Struct used to convey the parameters of an iteration to the functions iterating without the GVL
+typedef struct {
+  const char* rawBuffer;
+  char* rawBufferOut;
+  int nbrBitsPerSample;
+  int nbrChannels;
+  tSampleIndex nbrSamples;
+  tSampleIndex idxOffsetSample;
+  int sampleSize;
+  tPtrFctDecode decode;
+  tPtrFctEncode encode;
+  // The report of clipped samples, or NULL if output values don't need checking
+  tClipReport* clipReport;
+  tSampleBlock* block;
+  tSampleBlock* blockOut;
+  // The processing method: only the one corresponding to the iteration is set
+  tPtrFctProcessBlock processBlock;
+  tPtrFctProcessBlockOutput processBlockOutput;
+  tPtrFctProcessBlockOutputOnly processBlockOutputOnly;
+  void* args;
+} tIterationStruct;
+
+/**
+ * Iterate through a raw buffer, block by block.
+ * Called without the GVL.
+ *
+ * Parameters::
+ * * *iPtrIteration* (<em>void*</em>): The iteration parameters. In fact a <em>tIterationStruct*</em>.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* commonutils_iterateWithoutGVL(
+  void* iPtrIteration) {
+  tIterationStruct* lPtrIteration = (tIterationStruct*)iPtrIteration;
+  tSampleBlock* lPtrBlock = lPtrIteration->block;
+  tSampleIndex lIdxBufferSample = 0;
+  while (lIdxBufferSample < lPtrIteration->nbrSamples) {
+    lPtrBlock->nbrSamples = lPtrIteration->nbrSamples - lIdxBufferSample;
+    if (lPtrBlock->nbrSamples > COMMONUTILS_BLOCK_SIZE) {
+      lPtrBlock->nbrSamples = COMMONUTILS_BLOCK_SIZE;
+    }
+    lPtrBlock->idxFirstSample = lPtrIteration->idxOffsetSample + lIdxBufferSample;
+    lPtrIteration->decode(lPtrIteration->rawBuffer + lIdxBufferSample*lPtrIteration->sampleSize, lPtrIteration->nbrChannels, lPtrBlock->nbrSamples, lPtrBlock->values);
+    if (lPtrIteration->processBlock(lPtrBlock, lPtrIteration->args) == 1) {
+      break;
+    }
+    lIdxBufferSample += lPtrBlock->nbrSamples;
+  }
+
+  return NULL;
+}
+
+/**
+ * Iterate through a raw buffer block by block, and writes another raw buffer.
+ * Called without the GVL.
+ *
+ * Parameters::
+ * * *iPtrIteration* (<em>void*</em>): The iteration parameters. In fact a <em>tIterationStruct*</em>.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* commonutils_iterateOutputWithoutGVL(
+  void* iPtrIteration) {
+  tIterationStruct* lPtrIteration = (tIterationStruct*)iPtrIteration;
+  tSampleBlock* lPtrBlock = lPtrIteration->block;
+  tSampleBlock* lPtrBlockOut = lPtrIteration->blockOut;
+  tSampleIndex lIdxBufferSample = 0;
+  int lProcessResult = 0;
+  while ((lProcessResult != 1) &&
+         (lIdxBufferSample < lPtrIteration->nbrSamples)) {
+    lPtrBlock->nbrSamples = lPtrIteration->nbrSamples - lIdxBufferSample;
+    if (lPtrBlock->nbrSamples > COMMONUTILS_BLOCK_SIZE) {
+      lPtrBlock->nbrSamples = COMMONUTILS_BLOCK_SIZE;
+    }
+    lPtrBlock->idxFirstSample = lPtrIteration->idxOffsetSample + lIdxBufferSample;
+    lPtrBlockOut->nbrSamples = lPtrBlock->nbrSamples;
+    lPtrBlockOut->idxFirstSample = lPtrBlock->idxFirstSample;
+    lPtrIteration->decode(lPtrIteration->rawBuffer + lIdxBufferSample*lPtrIteration->sampleSize, lPtrIteration->nbrChannels, lPtrBlock->nbrSamples, lPtrBlock->values);
+    lProcessResult = lPtrIteration->processBlockOutput(lPtrBlock, lPtrBlockOut, lPtrIteration->args);
+    // Write the output block
+    if (lPtrIteration->clipReport != NULL) {
+      commonutils_checkClipsBlock(lPtrIteration->clipReport, lPtrBlockOut, lPtrIteration->nbrBitsPerSample);
+    }
+    lPtrIteration->encode(lPtrBlockOut->values, lPtrIteration->nbrChannels, lPtrBlockOut->nbrSamples, (lPtrIteration->clipReport != NULL), lPtrIteration->rawBufferOut + lIdxBufferSample*lPtrIteration->sampleSize);
+    lIdxBufferSample += lPtrBlock->nbrSamples;
   }
+
+  return NULL;
+}
+
+/**
+ * Iterate block by block through an output raw buffer only, without input raw buffer.
+ * Called without the GVL.
+ *
+ * Parameters::
+ * * *iPtrIteration* (<em>void*</em>): The iteration parameters. In fact a <em>tIterationStruct*</em>.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* commonutils_iterateOutputOnlyWithoutGVL(
+  void* iPtrIteration) {
+  tIterationStruct* lPtrIteration = (tIterationStruct*)iPtrIteration;
+  tSampleBlock* lPtrBlockOut = lPtrIteration->blockOut;
+  tSampleIndex lIdxBufferSample = 0;
+  int lProcessResult = 0;
+  while ((lProcessResult != 1) &&
+         (lIdxBufferSample < lPtrIteration->nbrSamples)) {
+    lPtrBlockOut->nbrSamples = lPtrIteration->nbrSamples - lIdxBufferSample;
+    if (lPtrBlockOut->nbrSamples > COMMONUTILS_BLOCK_SIZE) {
+      lPtrBlockOut->nbrSamples = COMMONUTILS_BLOCK_SIZE;
+    }
+    lPtrBlockOut->idxFirstSample = lPtrIteration->idxOffsetSample + lIdxBufferSample;
+    lProcessResult = lPtrIteration->processBlockOutputOnly(lPtrBlockOut, lPtrIteration->args);
+    // Write the output block
+    if (lPtrIteration->clipReport != NULL) {
+      commonutils_checkClipsBlock(lPtrIteration->clipReport, lPtrBlockOut, lPtrIteration->nbrBitsPerSample);
+    }
+    lPtrIteration->encode(lPtrBlockOut->values, lPtrIteration->nbrChannels, lPtrBlockOut->nbrSamples, (lPtrIteration->clipReport != NULL), lPtrIteration->rawBufferOut + lIdxBufferSample*lPtrIteration->sampleSize);
+    lIdxBufferSample += lPtrBlockOut->nbrSamples;
+  }
+
+  return NULL;
 }
 
 /**
- * Iterate through a raw buffer, and writes another raw buffer.
+ * Iterate through a raw buffer block by block, in reverse mode.
+ * Called without the GVL.
+ *
+ * Parameters::
+ * * *iPtrIteration* (<em>void*</em>): The iteration parameters. In fact a <em>tIterationStruct*</em>.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* commonutils_iterateReverseWithoutGVL(
+  void* iPtrIteration) {
+  tIterationStruct* lPtrIteration = (tIterationStruct*)iPtrIteration;
+  tSampleBlock* lPtrBlock = lPtrIteration->block;
+  // Index (in the buffer) of the sample following the block to process
+  tSampleIndex lIdxBufferSampleEnd = lPtrIteration->nbrSamples;
+  tSampleIndex lIdxBufferSample;
+  while (lIdxBufferSampleEnd > 0) {
+    lPtrBlock->nbrSamples = lIdxBufferSampleEnd;
+    if (lPtrBlock->nbrSamples > COMMONUTILS_BLOCK_SIZE) {
+      lPtrBlock->nbrSamples = COMMONUTILS_BLOCK_SIZE;
+    }
+    lIdxBufferSample = lIdxBufferSampleEnd - lPtrBlock->nbrSamples;
+    lPtrBlock->idxFirstSample = lPtrIteration->idxOffsetSample - (lPtrIteration->nbrSamples - 1) + lIdxBufferSample;
+    lPtrIteration->decode(lPtrIteration->rawBuffer + lIdxBufferSample*lPtrIteration->sampleSize, lPtrIteration->nbrChannels, lPtrBlock->nbrSamples, lPtrBlock->values);
+    if (lPtrIteration->processBlock(lPtrBlock, lPtrIteration->args) == 1) {
+      break;
+    }
+    lIdxBufferSampleEnd = lIdxBufferSample;
+  }
+
+  return NULL;
+}
+
+// Minimal number of blocks processed by a thread: smaller buffers are not worth being split
+#define COMMONUTILS_MIN_BLOCKS_PER_SLICE 16
+
+// Struct used to give the iterations of all slices to the function running them without the GVL
+typedef struct {
+  tPtrFctWithoutGVL iterateFct;
+  tIterationStruct* slices;
+  int nbrSlices;
+} tSlicesStruct;
+
+/**
+ * Run the iterations of all slices of a buffer in parallel.
+ * Called without the GVL.
+ *
+ * Parameters::
+ * * *iPtrSlices* (<em>void*</em>): The slices. In fact a <em>tSlicesStruct*</em>.
+ * Return::
+ * * <em>void*</em>: Unused
+ */
+static void* commonutils_iterateSlicesWithoutGVL(
+  void* iPtrSlices) {
+  tSlicesStruct* lPtrSlices = (tSlicesStruct*)iPtrSlices;
+  commonutils_runTasks(lPtrSlices->iterateFct, (char*)lPtrSlices->slices, sizeof(tIterationStruct), lPtrSlices->nbrSlices);
+
+  return NULL;
+}
+
+/**
+ * Run an iteration without the GVL.
+ * If possible, the buffer is split in slices that are processed in parallel, each one with its own processing arguments.
+ * Slices begin on blocks boundaries, and their results are merged in the samples order: results are the same as with 1 thread.
+ *
+ * Parameters::
+ * * *iSelf* (_Object_): Object used to call log methods
+ * * *iPtrIteration* (<em>const tIterationStruct*</em>): The iteration to run, without its blocks
+ * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
+ * * *iPtrIterateFct* (<em>const tPtrFctWithoutGVL</em>): The function running the iteration
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process slices in parallel, or NULL if the processing can't be parallelized
+ */
+static void commonutils_iterate(
+  VALUE iSelf,
+  const tIterationStruct* iPtrIteration,
+  const int iNeedCheck,
+  const tPtrFctWithoutGVL iPtrIterateFct,
+  const tParallelFcts* iPtrParallelFcts) {
+  int lNbrSlices = 1;
+  tSampleIndex lNbrBlocks = (iPtrIteration->nbrSamples + COMMONUTILS_BLOCK_SIZE - 1)/COMMONUTILS_BLOCK_SIZE;
+  if (iPtrParallelFcts != NULL) {
+    lNbrSlices = commonutils_getNbrThreads();
+    if (lNbrSlices > lNbrBlocks/COMMONUTILS_MIN_BLOCKS_PER_SLICE) {
+      lNbrSlices = lNbrBlocks/COMMONUTILS_MIN_BLOCKS_PER_SLICE;
+    }
+    if (lNbrSlices < 1) {
+      lNbrSlices = 1;
+    }
+  }
+  tSampleIndex lNbrSliceSamples = ((lNbrBlocks + lNbrSlices - 1)/lNbrSlices)*COMMONUTILS_BLOCK_SIZE;
+  tIterationStruct lSlices[lNbrSlices];
+  tSampleBlock lBlocks[lNbrSlices];
+  tSampleBlock lBlocksOut[lNbrSlices];
+  tClipReport lClipReports[lNbrSlices];
+  // Processing arguments of each slice, when split
+  char* lPtrSlicesArgs = NULL;
+  if (lNbrSlices > 1) {
+    lPtrSlicesArgs = ALLOC_N(char, lNbrSlices*iPtrParallelFcts->argsSize);
+  }
+  tIterationStruct* lPtrSlice;
+  tSampleIndex lIdxBufferSample;
+  int lIdxSlice;
+  for (lIdxSlice = 0; lIdxSlice < lNbrSlices; ++lIdxSlice) {
+    lPtrSlice = &(lSlices[lIdxSlice]);
+    *lPtrSlice = *iPtrIteration;
+    lIdxBufferSample = lIdxSlice*lNbrSliceSamples;
+    lPtrSlice->nbrSamples = iPtrIteration->nbrSamples - lIdxBufferSample;
+    if (lPtrSlice->nbrSamples > lNbrSliceSamples) {
+      lPtrSlice->nbrSamples = lNbrSliceSamples;
+    }
+    lPtrSlice->idxOffsetSample = iPtrIteration->idxOffsetSample + lIdxBufferSample;
+    if (iPtrIteration->rawBuffer != NULL) {
+      lPtrSlice->rawBuffer = iPtrIteration->rawBuffer + lIdxBufferSample*iPtrIteration->sampleSize;
+      commonutils_initSampleBlock(&(lBlocks[lIdxSlice]), iPtrIteration->nbrChannels);
+      lPtrSlice->block = &(lBlocks[lIdxSlice]);
+    }
+    if (iPtrIteration->rawBufferOut != NULL) {
+      lPtrSlice->rawBufferOut = iPtrIteration->rawBufferOut + lIdxBufferSample*iPtrIteration->sampleSize;
+      commonutils_initSampleBlock(&(lBlocksOut[lIdxSlice]), iPtrIteration->nbrChannels);
+      lPtrSlice->blockOut = &(lBlocksOut[lIdxSlice]);
+    }
+    lPtrSlice->clipReport = NULL;
+    if (iNeedCheck != 0) {
+      commonutils_initClipReport(&(lClipReports[lIdxSlice]), iPtrIteration->nbrChannels);
+      lPtrSlice->clipReport = &(lClipReports[lIdxSlice]);
+    }
+    if (lNbrSlices > 1) {
+      lPtrSlice->args = lPtrSlicesArgs + lIdxSlice*iPtrParallelFcts->argsSize;
+      iPtrParallelFcts->initSliceArgs(iPtrIteration->args, lPtrSlice->args, lPtrSlice->idxOffsetSample);
+    }
+  }
+  if (lNbrSlices > 1) {
+    commonutils_initThreadsPool();
+    tSlicesStruct lSlicesStruct;
+    lSlicesStruct.iterateFct = iPtrIterateFct;
+    lSlicesStruct.slices = lSlices;
+    lSlicesStruct.nbrSlices = lNbrSlices;
+    commonutils_callWithoutGVL(&commonutils_iterateSlicesWithoutGVL, &lSlicesStruct);
+  } else {
+    commonutils_callWithoutGVL(iPtrIterateFct, &(lSlices[0]));
+  }
+  // Merge results in the samples order
+  for (lIdxSlice = 0; lIdxSlice < lNbrSlices; ++lIdxSlice) {
+    if ((lNbrSlices > 1) &&
+        (iPtrParallelFcts->reduceSliceArgs != NULL)) {
+      iPtrParallelFcts->reduceSliceArgs(iPtrIteration->args, lSlices[lIdxSlice].args);
+    }
+    if (iPtrIteration->rawBuffer != NULL) {
+      commonutils_freeSampleBlock(&(lBlocks[lIdxSlice]));
+    }
+    if (iPtrIteration->rawBufferOut != NULL) {
+      commonutils_freeSampleBlock(&(lBlocksOut[lIdxSlice]));
+    }
+    if ((iNeedCheck != 0) &&
+        (lIdxSlice > 0)) {
+      commonutils_mergeClipReport(&(lClipReports[0]), &(lClipReports[lIdxSlice]));
+      commonutils_freeClipReport(&(lClipReports[lIdxSlice]));
+    }
+  }
+  if (lPtrSlicesArgs != NULL) {
+    free(lPtrSlicesArgs);
+  }
+  // Report clipped samples once for the whole buffer
+  if (iNeedCheck != 0) {
+    commonutils_logClipReport(iSelf, &(lClipReports[0]));
+    commonutils_freeClipReport(&(lClipReports[0]));
+  }
+}
+
+/**
+ * Iterate through a raw buffer, block by block.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API.
+ * When parallel functions are given, parts of the buffer can be processed by different threads: the processing method can't break iterations then.
+ *
+ * Parameters::
+ * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
+ * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
+ * * *iNbrChannels* (<em>const int</em>): The number of channels
+ * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
+ * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlock</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
+ * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process parts of the buffer in parallel, or NULL to process it with 1 thread
+ */
+void commonutils_iterateBlocksThroughRawBuffer(
+  const char* iPtrRawBuffer,
+  const int iNbrBitsPerSample,
+  const int iNbrChannels,
+  const tSampleIndex iNbrSamples,
+  const tSampleIndex iIdxOffsetSample,
+  const tPtrFctProcessBlock iPtrProcessMethod,
+  void* iPtrArgs,
+  const tParallelFcts* iPtrParallelFcts) {
+  tIterationStruct lIteration;
+  lIteration.rawBuffer = iPtrRawBuffer;
+  lIteration.rawBufferOut = NULL;
+  lIteration.nbrBitsPerSample = iNbrBitsPerSample;
+  lIteration.nbrChannels = iNbrChannels;
+  lIteration.nbrSamples = iNbrSamples;
+  lIteration.idxOffsetSample = iIdxOffsetSample;
+  lIteration.sampleSize = (iNbrBitsPerSample/8)*iNbrChannels;
+  lIteration.decode = commonutils_getDecoder(iNbrBitsPerSample, iNbrChannels);
+  lIteration.processBlock = iPtrProcessMethod;
+  lIteration.args = iPtrArgs;
+  commonutils_iterate(Qnil, &lIteration, 0, &commonutils_iterateWithoutGVL, iPtrParallelFcts);
+}
+
+/**
+ * Iterate through a raw buffer block by block, and writes another raw buffer.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API. Clipped samples are logged once the GVL is acquired back.
+ * When parallel functions are given, parts of the buffer can be processed by different threads: the processing method can't break iterations then.
  *
  * Parameters::
  * * *iSelf* (_Object_): Object used to call log methods
@@ -108,10 +739,11 @@ void commonutils_iterateThroughRawBuffer(
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
  * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
  * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
- * * *iPtrProcessMethod* (<em>const tPtrFctProcessOutput</em>): Pointer to the method to call for processing
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlockOutput</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process parts of the buffer in parallel, or NULL to process it with 1 thread
  */
-void commonutils_iterateThroughRawBufferOutput(
+void commonutils_iterateBlocksThroughRawBufferOutput(
   VALUE iSelf,
   const char* iPtrRawBuffer,
   char* oPtrRawBufferOut,
@@ -120,198 +752,28 @@ void commonutils_iterateThroughRawBufferOutput(
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
   const int iNeedCheck,
-  const tPtrFctProcessOutput iPtrProcessMethod,
-  void* iPtrArgs) {
-  // Parse the data. This is done differently depending on the data structure
-  // Define variables outside the loops to not allocate and initialize heap size for nothing
-  tSampleIndex lIdxBufferSample;
-  int lIdxChannel;
-  tSampleIndex lIdxSample = iIdxOffsetSample;
-  // 0: Continue iterations
-  // 1: Break all
-  // 2: Skip to the next sample
-  int lProcessResult;
-  tSampleValue lOutputValue;
-  // Compute max and min values if needed only
-  if (iNeedCheck != 0) {
-    char lLogMessage[256];
-    ID lIDLogWarn = rb_intern("log_warn");
-    int lMaxValue = (1 << (iNbrBitsPerSample-1)) - 1;
-    int lMinValue = -(1 << (iNbrBitsPerSample-1));
-    if (iNbrBitsPerSample == 8) {
-      unsigned char* lPtrData = (unsigned char*)iPtrRawBuffer;
-      unsigned char* lPtrDataOut = (unsigned char*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(((tSampleValue)(*lPtrData)) - 128, &lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          if (lOutputValue > lMaxValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding maximal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMaxValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMaxValue;
-          } else if (lOutputValue < lMinValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding minimal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMinValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMinValue;
-          }
-          (*lPtrDataOut) = (unsigned char)(lOutputValue + 128);
-          ++lPtrDataOut;
-          ++lPtrData;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 16) {
-      signed short int* lPtrData = (signed short int*)iPtrRawBuffer;
-      signed short int* lPtrDataOut = (signed short int*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod((tSampleValue)(*lPtrData), &lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          if (lOutputValue > lMaxValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding maximal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMaxValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMaxValue;
-          } else if (lOutputValue < lMinValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding minimal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMinValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMinValue;
-          }
-          (*lPtrDataOut) = (signed short int)lOutputValue;
-          ++lPtrDataOut;
-          ++lPtrData;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 24) {
-      t24bits* lPtrData = (t24bits*)iPtrRawBuffer;
-      t24bits* lPtrDataOut = (t24bits*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod((tSampleValue)(lPtrData->value), &lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          if (lOutputValue > lMaxValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding maximal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMaxValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMaxValue;
-          } else if (lOutputValue < lMinValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding minimal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMinValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMinValue;
-          }
-          lPtrDataOut->value = lOutputValue;
-          lPtrDataOut = (t24bits*)(((int)lPtrDataOut)+3);
-          // Increase lPtrData this way to ensure alignment.
-          lPtrData = (t24bits*)(((int)lPtrData)+3);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else {
-      rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
-    }
-  } else {
-    // No check needed here. Just write what we get.
-    if (iNbrBitsPerSample == 8) {
-      unsigned char* lPtrData = (unsigned char*)iPtrRawBuffer;
-      unsigned char* lPtrDataOut = (unsigned char*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(((tSampleValue)(*lPtrData)) - 128, &lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          (*lPtrDataOut) = (unsigned char)(lOutputValue + 128);
-          ++lPtrDataOut;
-          ++lPtrData;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 16) {
-      signed short int* lPtrData = (signed short int*)iPtrRawBuffer;
-      signed short int* lPtrDataOut = (signed short int*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod((tSampleValue)(*lPtrData), &lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          (*lPtrDataOut) = (signed short int)lOutputValue;
-          ++lPtrDataOut;
-          ++lPtrData;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 24) {
-      t24bits* lPtrData = (t24bits*)iPtrRawBuffer;
-      t24bits* lPtrDataOut = (t24bits*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod((tSampleValue)(lPtrData->value), &lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          lPtrDataOut->value = lOutputValue;
-          lPtrDataOut = (t24bits*)(((int)lPtrDataOut)+3);
-          // Increase lPtrData this way to ensure alignment.
-          lPtrData = (t24bits*)(((int)lPtrData)+3);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else {
-      rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
-    }
-  }
+  const tPtrFctProcessBlockOutput iPtrProcessMethod,
+  void* iPtrArgs,
+  const tParallelFcts* iPtrParallelFcts) {
+  tIterationStruct lIteration;
+  lIteration.rawBuffer = iPtrRawBuffer;
+  lIteration.rawBufferOut = oPtrRawBufferOut;
+  lIteration.nbrBitsPerSample = iNbrBitsPerSample;
+  lIteration.nbrChannels = iNbrChannels;
+  lIteration.nbrSamples = iNbrSamples;
+  lIteration.idxOffsetSample = iIdxOffsetSample;
+  lIteration.sampleSize = (iNbrBitsPerSample/8)*iNbrChannels;
+  lIteration.decode = commonutils_getDecoder(iNbrBitsPerSample, iNbrChannels);
+  lIteration.encode = commonutils_getEncoder(iNbrBitsPerSample, iNbrChannels);
+  lIteration.processBlockOutput = iPtrProcessMethod;
+  lIteration.args = iPtrArgs;
+  commonutils_iterate(iSelf, &lIteration, iNeedCheck, &commonutils_iterateOutputWithoutGVL, iPtrParallelFcts);
 }
 
 /**
- * Iterate through an output raw buffer only, without input raw buffer.
+ * Iterate block by block through an output raw buffer only, without input raw buffer.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API. Clipped samples are logged once the GVL is acquired back.
+ * When parallel functions are given, parts of the buffer can be processed by different threads: the processing method can't break iterations then.
  *
  * Parameters::
  * * *iSelf* (_Object_): Object used to call log methods
@@ -321,10 +783,11 @@ void commonutils_iterateThroughRawBufferOutput(
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
  * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
  * * *iNeedCheck* (<em>const int</em>): Do we need checking output value ranges ? 0 = no, 1 = yes
- * * *iPtrProcessMethod* (<em>const tPtrFctProcessOutputOnly</em>): Pointer to the method to call for processing
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlockOutputOnly</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
+ * * *iPtrParallelFcts* (<em>const tParallelFcts*</em>): The functions used to process parts of the buffer in parallel, or NULL to process it with 1 thread
  */
-void commonutils_iterateThroughRawBufferOutputOnly(
+void commonutils_iterateBlocksThroughRawBufferOutputOnly(
   VALUE iSelf,
   char* oPtrRawBufferOut,
   const int iNbrBitsPerSample,
@@ -332,272 +795,55 @@ void commonutils_iterateThroughRawBufferOutputOnly(
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
   const int iNeedCheck,
-  const tPtrFctProcessOutputOnly iPtrProcessMethod,
-  void* iPtrArgs) {
-  // Parse the data. This is done differently depending on the data structure
-  // Define variables outside the loops to not allocate and initialize heap size for nothing
-  tSampleIndex lIdxBufferSample;
-  int lIdxChannel;
-  tSampleIndex lIdxSample = iIdxOffsetSample;
-  // 0: Continue iterations
-  // 1: Break all
-  // 2: Skip to the next sample
-  int lProcessResult;
-  tSampleValue lOutputValue;
-  // Compute max and min values if needed only
-  if (iNeedCheck != 0) {
-    char lLogMessage[256];
-    ID lIDLogWarn = rb_intern("log_warn");
-    int lMaxValue = (1 << (iNbrBitsPerSample-1)) - 1;
-    int lMinValue = -(1 << (iNbrBitsPerSample-1));
-    if (iNbrBitsPerSample == 8) {
-      unsigned char* lPtrDataOut = (unsigned char*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(&lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          if (lOutputValue > lMaxValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding maximal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMaxValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMaxValue;
-          } else if (lOutputValue < lMinValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding minimal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMinValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMinValue;
-          }
-          (*lPtrDataOut) = (unsigned char)(lOutputValue + 128);
-          ++lPtrDataOut;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 16) {
-      signed short int* lPtrDataOut = (signed short int*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(&lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          if (lOutputValue > lMaxValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding maximal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMaxValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMaxValue;
-          } else if (lOutputValue < lMinValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding minimal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMinValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMinValue;
-          }
-          (*lPtrDataOut) = (signed short int)lOutputValue;
-          ++lPtrDataOut;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 24) {
-      t24bits* lPtrDataOut = (t24bits*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(&lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          if (lOutputValue > lMaxValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding maximal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMaxValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMaxValue;
-          } else if (lOutputValue < lMinValue) {
-            sprintf(lLogMessage, "@%lld,%d - Exceeding minimal value: %d, set to %d", lIdxSample, lIdxChannel, lOutputValue, lMinValue);
-            rb_funcall(iSelf, lIDLogWarn, 1, rb_str_new2(lLogMessage));
-            lOutputValue = lMinValue;
-          }
-          lPtrDataOut->value = lOutputValue;
-          // Increase lPtrDataOut this way to ensure alignment.
-          lPtrDataOut = (t24bits*)(((int)lPtrDataOut)+3);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else {
-      rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
-    }
-  } else {
-    // No check needed here. Just write what we get.
-    if (iNbrBitsPerSample == 8) {
-      unsigned char* lPtrDataOut = (unsigned char*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(&lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          (*lPtrDataOut) = (unsigned char)(lOutputValue + 128);
-          ++lPtrDataOut;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 16) {
-      signed short int* lPtrDataOut = (signed short int*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(&lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          (*lPtrDataOut) = (signed short int)lOutputValue;
-          ++lPtrDataOut;
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else if (iNbrBitsPerSample == 24) {
-      t24bits* lPtrDataOut = (t24bits*)oPtrRawBufferOut;
-      for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-        lProcessResult = 0;
-        for (lIdxChannel = 0; lIdxChannel < iNbrChannels; ++lIdxChannel) {
-          if (lProcessResult == 0) {
-            lProcessResult = iPtrProcessMethod(&lOutputValue, lIdxSample, lIdxChannel, iPtrArgs);
-          }
-          if (lProcessResult == 1) {
-            break;
-          }
-          // Write lOutputValue
-          lPtrDataOut->value = lOutputValue;
-          // Increase lPtrDataOut this way to ensure alignment.
-          lPtrDataOut = (t24bits*)(((int)lPtrDataOut)+3);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        ++lIdxSample;
-      }
-    } else {
-      rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
-    }
-  }
+  const tPtrFctProcessBlockOutputOnly iPtrProcessMethod,
+  void* iPtrArgs,
+  const tParallelFcts* iPtrParallelFcts) {
+  tIterationStruct lIteration;
+  lIteration.rawBuffer = NULL;
+  lIteration.rawBufferOut = oPtrRawBufferOut;
+  lIteration.nbrBitsPerSample = iNbrBitsPerSample;
+  lIteration.nbrChannels = iNbrChannels;
+  lIteration.nbrSamples = iNbrSamples;
+  lIteration.idxOffsetSample = iIdxOffsetSample;
+  lIteration.sampleSize = (iNbrBitsPerSample/8)*iNbrChannels;
+  lIteration.encode = commonutils_getEncoder(iNbrBitsPerSample, iNbrChannels);
+  lIteration.processBlockOutputOnly = iPtrProcessMethod;
+  lIteration.args = iPtrArgs;
+  commonutils_iterate(iSelf, &lIteration, iNeedCheck, &commonutils_iterateOutputOnlyWithoutGVL, iPtrParallelFcts);
 }
 
 /**
- * Iterate through a raw buffer in reverse mode.
+ * Iterate through a raw buffer block by block, in reverse mode.
+ * Blocks are given from the end of the raw buffer to its beginning, but samples inside each block keep their natural order: the processing method has to parse them backwards.
+ * The iteration is done without the GVL: the processing method must not call any Ruby API.
  *
  * Parameters::
  * * *iPtrRawBuffer* (<em>const char*</em>): The raw buffer
  * * *iNbrBitsPerSample* (<em>const int</em>): The number of bits per sample
  * * *iNbrChannels* (<em>const int</em>): The number of channels
  * * *iNbrSamples* (<em>const tSampleIndex</em>): The number of samples
- * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The base offset of samples to be counted and given to the processing method
- * * *iPtrProcessMethod* (<em>const tPtrFctProcess</em>): Pointer to the method to call for processing
+ * * *iIdxOffsetSample* (<em>const tSampleIndex</em>): The offset of the last sample, to be counted and given to the processing method
+ * * *iPtrProcessMethod* (<em>const tPtrFctProcessBlock</em>): Pointer to the method to call for processing. It returns 0 to continue, 1 to break all iterations.
  * * *iPtrArgs* (<em>void*</em>): Pointer to a user specific struct that will be given to the processing function
  */
-void commonutils_iterateReverseThroughRawBuffer(
+void commonutils_iterateReverseBlocksThroughRawBuffer(
   const char* iPtrRawBuffer,
   const int iNbrBitsPerSample,
   const int iNbrChannels,
   const tSampleIndex iNbrSamples,
   const tSampleIndex iIdxOffsetSample,
-  const tPtrFctProcess iPtrProcessMethod,
+  const tPtrFctProcessBlock iPtrProcessMethod,
   void* iPtrArgs) {
-  // Parse the data. This is done differently depending on the data structure
-  // Define variables outside the loops to not allocate and initialize heap size for nothing
-  tSampleIndex lIdxBufferSample;
-  int lIdxChannel;
-  tSampleIndex lIdxSample = iIdxOffsetSample;
-  // 0: Continue iterations
-  // 1: Break all
-  // 2: Skip to the next sample
-  int lProcessResult;
-  if (iNbrBitsPerSample == 8) {
-    unsigned char* lPtrData = (unsigned char*)iPtrRawBuffer;
-    lPtrData += iNbrSamples*iNbrChannels - 1;
-    for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-      lProcessResult = 0;
-      for (lIdxChannel = iNbrChannels-1; lIdxChannel >= 0; --lIdxChannel) {
-        if (lProcessResult == 0) {
-          lProcessResult = iPtrProcessMethod(((tSampleValue)(*lPtrData)) - 128, lIdxSample, lIdxChannel, iPtrArgs);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        --lPtrData;
-      }
-      if (lProcessResult == 1) {
-        break;
-      }
-      --lIdxSample;
-    }
-  } else if (iNbrBitsPerSample == 16) {
-    signed short int* lPtrData = (signed short int*)iPtrRawBuffer;
-    lPtrData += iNbrSamples*iNbrChannels - 1;
-    for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-      lProcessResult = 0;
-      for (lIdxChannel = iNbrChannels-1; lIdxChannel >= 0; --lIdxChannel) {
-        if (lProcessResult == 0) {
-          lProcessResult = iPtrProcessMethod((tSampleValue)(*lPtrData), lIdxSample, lIdxChannel, iPtrArgs);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        --lPtrData;
-      }
-      if (lProcessResult == 1) {
-        break;
-      }
-      --lIdxSample;
-    }
-  } else if (iNbrBitsPerSample == 24) {
-    t24bits* lPtrData = (t24bits*)iPtrRawBuffer;
-    lPtrData = (t24bits*)(((int)lPtrData)+3*(((int)iNbrSamples)*iNbrChannels - 1));
-    for (lIdxBufferSample = 0; lIdxBufferSample < iNbrSamples; ++lIdxBufferSample) {
-      lProcessResult = 0;
-      for (lIdxChannel = iNbrChannels-1; lIdxChannel >= 0; --lIdxChannel) {
-        if (lProcessResult == 0) {
-          lProcessResult = iPtrProcessMethod((tSampleValue)(lPtrData->value), lIdxSample, lIdxChannel, iPtrArgs);
-        }
-        if (lProcessResult == 1) {
-          break;
-        }
-        // Increase lPtrData this way to ensure alignment.
-        lPtrData = (t24bits*)(((int)lPtrData)-3);
-      }
-      if (lProcessResult == 1) {
-        break;
-      }
-      --lIdxSample;
-    }
-  } else {
-    rb_raise(rb_eRuntimeError, "Unknown bits per samples: %d\n", iNbrBitsPerSample);
-  }
+  tIterationStruct lIteration;
+  lIteration.rawBuffer = iPtrRawBuffer;
+  lIteration.rawBufferOut = NULL;
+  lIteration.nbrBitsPerSample = iNbrBitsPerSample;
+  lIteration.nbrChannels = iNbrChannels;
+  lIteration.nbrSamples = iNbrSamples;
+  lIteration.idxOffsetSample = iIdxOffsetSample;
+  lIteration.sampleSize = (iNbrBitsPerSample/8)*iNbrChannels;
+  lIteration.decode = commonutils_getDecoder(iNbrBitsPerSample, iNbrChannels);
+  lIteration.processBlock = iPtrProcessMethod;
+  lIteration.args = iPtrArgs;
+  commonutils_iterate(Qnil, &lIteration, 0, &commonutils_iterateReverseWithoutGVL, NULL);
 }
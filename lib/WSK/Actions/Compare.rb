@@ -95,7 +95,7 @@ module WSK
               end
             elsif (lRawBuffer2 == nil)
               computeInverseMap
-              oOutputData.pushRawBuffer(@ArithmUtils.applyMap(@InverseMap, lRawBuffer1, @NbrBitsPerSample, lNbrSamples1))
+              oOutputData.pushRawBuffer(@ArithmUtils.applyMap(@InverseMap, lRawBuffer1, @NbrBitsPerSample, lNbrSamples1, nil, nil))
               lNbrSamplesProcessed += lNbrSamples1
               if (lNbrSamplesProcessed == @TotalNbrSamples)
                 lRawBuffer1 = nil
@@ -131,7 +131,7 @@ module WSK
               @CumulativeErrors += lCumulativeErrors
               # Write remaining buffer (-Buffer1)
               computeInverseMap
-              oOutputData.pushRawBuffer(@ArithmUtils.applyMap(@InverseMap, lRawBuffer1[lRawBuffer2.size..-1], @NbrBitsPerSample, lNbrSamples2 - lNbrSamples1))
+              oOutputData.pushRawBuffer(@ArithmUtils.applyMap(@InverseMap, lRawBuffer1[lRawBuffer2.size..-1], @NbrBitsPerSample, lNbrSamples2 - lNbrSamples1, nil, nil))
               # Buffer2 is finished
               lRawBuffer2 = nil
               lNbrSamplesProcessed += lNbrSamples1
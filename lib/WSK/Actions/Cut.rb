@@ -34,21 +34,12 @@ module WSK
       # Return::
       # * _Exception_: An error, or nil if success
       def execute(iInputData, oOutputData)
-        lChannelsSampleSize = (iInputData.Header.NbrChannels*iInputData.Header.NbrBitsPerSample)/8
-        lIdxFirstSample = @IdxBeginSample
-        iInputData.each_raw_buffer(@IdxBeginSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-          # If the end sample is in this buffer, write only up to it
-          if (@IdxEndSample < lIdxFirstSample + iNbrSamples - 1)
-            oOutputData.pushRawBuffer(iInputRawBuffer[0..(@IdxEndSample-lIdxFirstSample+1)*lChannelsSampleSize-1])
-          else
-            oOutputData.pushRawBuffer(iInputRawBuffer)
-          end
-          if (@IdxEndSample < lIdxFirstSample + iNbrSamples)
-            # Nothing left to write
-            break
-          end
-          lIdxFirstSample += iNbrSamples
+        # Samples beyond the input data are padded with silence
+        lIdxLastSample = @IdxEndSample
+        if (lIdxLastSample >= iInputData.NbrSamples)
+          lIdxLastSample = iInputData.NbrSamples - 1
         end
+        oOutputData.pushFileRange(iInputData, @IdxBeginSample, lIdxLastSample)
 
         return nil
       end
@@ -58,9 +58,7 @@ module WSK
       # Return::
       # * _Exception_: An error, or nil if success
       def execute(iInputData, oOutputData)
-        iInputData.each_raw_buffer(@IdxStartSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-          oOutputData.pushRawBuffer(iInputRawBuffer)
-        end
+        oOutputData.pushFileRange(iInputData, @IdxStartSample, iInputData.NbrSamples-1)
 
         return nil
       end
@@ -4,7 +4,7 @@
 #++
 
 {
-  :OutputInterface => 'DirectStream',
+  :OutputInterface => 'MappedFile',
   :Options => {
     :Offset => [
       '--offset <DCOffset>', String,
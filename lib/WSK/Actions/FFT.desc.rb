@@ -0,0 +1,9 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+{
+  # Input data is scanned once, sequentially: it does not need to stay in the page cache
+  :IOPolicy => 'direct'
+}
\ No newline at end of file
@@ -33,53 +33,60 @@ module WSK
       # * _Exception_: An error, or nil if success
       def execute(iInputData, oOutputData)
 
-        # 1. Create the whole FFT profile
+        # 1. Create the whole FFT profile, and the FFT profiles of each FFT sample along the same pass
         log_info 'Creating FFT profile ...'
+        require 'WSK/FFTUtils/FFTUtils'
+        lFFTUtils = FFTUtils::FFTUtils.new
         # Object that will create the FFT
         lFFTComputing = FFTComputing.new(false, iInputData.Header)
+        # Object that will create the FFT of each FFT sample
+        lFFTComputing2 = FFTComputing.new(true, iInputData.Header)
+        # Number of samples needed to have a valid FFT.
+        lNbrSamplesFFTMax = iInputData.Header.SampleRate/FFTSAMPLE_FREQ
+        lSampleSize = (iInputData.Header.NbrChannels*iInputData.Header.NbrBitsPerSample)/8
+        # The FFT profiles of each FFT sample, to be compared with the whole FFT profile once it is complete
+        # list<Object>
+        lCFFTSampleProfiles = []
+        # Number of samples already given to the current FFT sample
+        lNbrSamplesFFT = 0
         # Parse the data
         lIdxSample = 0
         iInputData.each_raw_buffer do |iInputRawBuffer, iNbrSamples, iNbrChannels|
           lFFTComputing.completeFFT(iInputRawBuffer, iNbrSamples)
+          # Split this buffer among FFT samples
+          lIdxBufferSample = 0
+          while (lIdxBufferSample < iNbrSamples)
+            lNbrSamplesToComplete = [ lNbrSamplesFFTMax-lNbrSamplesFFT, iNbrSamples-lIdxBufferSample ].min
+            if (lNbrSamplesToComplete == iNbrSamples)
+              lFFTComputing2.completeFFT(iInputRawBuffer, lNbrSamplesToComplete)
+            else
+              lFFTComputing2.completeFFT(iInputRawBuffer[lIdxBufferSample*lSampleSize, lNbrSamplesToComplete*lSampleSize], lNbrSamplesToComplete)
+            end
+            lNbrSamplesFFT += lNbrSamplesToComplete
+            lIdxBufferSample += lNbrSamplesToComplete
+            if ((lNbrSamplesFFT == lNbrSamplesFFTMax) or
+                (lIdxSample+lIdxBufferSample == iInputData.NbrSamples))
+              # This FFT sample is complete
+              lCFFTSampleProfiles << lFFTComputing2.getCFFTProfile
+              lFFTComputing2.resetData
+              lNbrSamplesFFT = 0
+            end
+          end
           lIdxSample += iNbrSamples
           $stdout.write("#{(lIdxSample*100)/iInputData.NbrSamples} %\015")
           $stdout.flush
         end
         # Compute the result
-        require 'WSK/FFTUtils/FFTUtils'
-        lFFTUtils = FFTUtils::FFTUtils.new
         lFFTProfile = lFFTComputing.getFFTProfile
         lFFTReferenceProfile = lFFTUtils.createCFFTProfile(lFFTProfile)
 
         # 2. Compute the distance obtained by comparing this profile with a normal file pass
         log_info 'Computing average distance ...'
-        lFFTComputing2 = FFTComputing.new(true, iInputData.Header)
-        lIdxSample = 0
         lNbrTimes = 0
         lSumDist = 0
-        while (lIdxSample < iInputData.NbrSamples)
-          # Compute the number of samples needed to have a valid FFT.
-          # Modify this number if it exceeds the range we have
-          lNbrSamplesFFTMax = iInputData.Header.SampleRate/FFTSAMPLE_FREQ
-          lIdxBeginFFTSample = lIdxSample
-          lIdxEndFFTSample = lIdxSample+lNbrSamplesFFTMax-1
-          if (lIdxEndFFTSample >= iInputData.NbrSamples)
-            lIdxEndFFTSample = iInputData.NbrSamples-1
-          end
-          lNbrSamplesFFT = lIdxEndFFTSample-lIdxBeginFFTSample+1
-          # Load an FFT buffer of this
-          lFFTBuffer = ''
-          iInputData.each_raw_buffer(lIdxBeginFFTSample, lIdxEndFFTSample, :nbr_samples_prefetch => iInputData.NbrSamples-lIdxBeginFFTSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-            lFFTBuffer.concat(iInputRawBuffer)
-          end
-          # Compute its FFT profile
-          lFFTComputing2.resetData
-          lFFTComputing2.completeFFT(lFFTBuffer, lNbrSamplesFFT)
-          lSumDist += lFFTUtils.distFFTProfiles(lFFTReferenceProfile, lFFTUtils.createCFFTProfile(lFFTComputing2.getFFTProfile), FFTDIST_MAX).abs
+        lCFFTSampleProfiles.each do |iCFFTSampleProfile|
+          lSumDist += lFFTUtils.distFFTProfiles(lFFTReferenceProfile, iCFFTSampleProfile, FFTDIST_MAX).abs
           lNbrTimes += 1
-          lIdxSample = lIdxEndFFTSample+1
-          $stdout.write("#{(lIdxSample*100)/iInputData.NbrSamples} %\015")
-          $stdout.flush
         end
         lAverageDist = lSumDist/lNbrTimes
         log_debug "Average distance with silence: #{lAverageDist}"
@@ -89,7 +96,8 @@ module WSK
           log_debug "[#{(440*(2**(iIdx/12.0))).round} Hz]: #{lFFTProfile[2][iIdxFreq].join(', ')}"
         end
 
-        # Write the result in a file
+        # Write the result in a file.
+        # Profiles are summed as with the trigo cache used by the FFT samples. Files written by versions truncating each term of the sums should be generated again.
         File.open('fft.result', 'wb') do |oFile|
           oFile.write(Marshal.dump([lAverageDist, lFFTProfile]))
         end
@@ -29,6 +29,7 @@ module WSK
       # Return::
       # * _Exception_: An error, or nil if success
       def execute(iInputData, oOutputData)
+        require 'WSK/SampleBuffer/SampleBuffer'
         # Compute values used to create sawtooth
         lMaxValue = 2**(iInputData.Header.NbrBitsPerSample-1)-1
         # Compute the number of complete periods to put in the samples we want
@@ -37,13 +38,15 @@ module WSK
         lBuffer = nil
         if (lNbrPeriods > 0)
           # Generate a buffer with a omplete period in it
-          lBuffer = []
+          lValues = []
           lNbrSamplesPeriod.times do |iIdx|
-            lBuffer.concat( [(Math.sin((2*Math::PI*iIdx)/lNbrSamplesPeriod)*lMaxValue).round] * iInputData.Header.NbrChannels )
+            lValues.concat( [(Math.sin((2*Math::PI*iIdx)/lNbrSamplesPeriod)*lMaxValue).round] * iInputData.Header.NbrChannels )
           end
+          # Keep it packed in a native sample buffer, encoded directly for each period
+          lBuffer = WSK::SampleBuffer.fromArray(lValues, iInputData.Header.NbrChannels)
           # Write them
           lNbrPeriods.times do |iIdx|
-            oOutputData.pushBuffer(lBuffer)
+            oOutputData.pushSampleBuffer(lBuffer)
           end
         end
         lRemainingSamples = @NbrSamples % lNbrSamplesPeriod
@@ -51,15 +54,16 @@ module WSK
           # Add the remaining part of the buffer
           if (lBuffer == nil)
             # Generate a part of the buffer
-            lBuffer = []
+            lValues = []
             lRemainingSamples.times do |iIdx|
-              lBuffer.concat( [(Math.sin((2*Math::PI*iIdx)/lNbrSamplesPeriod)*lMaxValue).round] * iInputData.Header.NbrChannels )
+              lValues.concat( [(Math.sin((2*Math::PI*iIdx)/lNbrSamplesPeriod)*lMaxValue).round] * iInputData.Header.NbrChannels )
             end
+            lBuffer = WSK::SampleBuffer.fromArray(lValues, iInputData.Header.NbrChannels)
             # Write it
-            oOutputData.pushBuffer(lBuffer)
+            oOutputData.pushSampleBuffer(lBuffer)
           else
             # Write a part of the already generated buffer
-            oOutputData.pushBuffer(lBuffer[0..iInputData.Header.NbrChannels*lRemainingSamples-1])
+            oOutputData.pushSampleBuffer(lBuffer.slice(0, lRemainingSamples))
           end
         end
 
@@ -110,8 +110,12 @@ module WSK
           lLstRemainingOpenedFiles = lLstOpenedFiles.clone
           lNbrSamplesProcessed = 0
           while (!lLstRemainingOpenedFiles.empty?)
-            # Mix all buffers
-            lMixRawBuffer, lNbrSamplesWritten = lArithmUtils.mixBuffers(lLstRemainingOpenedFiles, iInputData.Header.NbrBitsPerSample, iInputData.Header.NbrChannels)
+            # Mix all buffers: the first one has the most samples
+            lNbrSamplesWritten = nil
+            oOutputData.fillRawBuffer(lLstRemainingOpenedFiles[0][4]) do |iOutputMappedFile, iOutputOffset|
+              lMixRawBuffer, lNbrSamplesWritten = lArithmUtils.mixBuffers(lLstRemainingOpenedFiles, iInputData.Header.NbrBitsPerSample, iInputData.Header.NbrChannels, iOutputMappedFile, iOutputOffset)
+              next lMixRawBuffer
+            end
             # Remove the ones that don't have data anymore
             lLstRemainingOpenedFiles.delete_if do |ioFileInfo|
               lFileHandle, lInputData, lCoeff, lRawBuffer = ioFileInfo
@@ -120,6 +124,7 @@ module WSK
               if (lNbrSamplesProcessed + lNbrSamplesWritten >= lInputData.NbrSamples)
                 # Close the handle if it is not the main input
                 if (lFileHandle != nil)
+                  lInputData.close
                   lFileHandle.close
                 end
                 rToBeDeleted = true
@@ -134,7 +139,6 @@ module WSK
               end
               next rToBeDeleted
             end
-            oOutputData.pushRawBuffer(lMixRawBuffer)
             lNbrSamplesProcessed += lNbrSamplesWritten
           end
         end
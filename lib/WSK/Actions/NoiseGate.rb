@@ -67,29 +67,23 @@ module WSK
           # Write a blank buffer if needed
           if (lIdxBeginFadeIn > lNextSampleToWrite)
             log_debug "Write #{lIdxBeginFadeIn - lNextSampleToWrite} samples of silence"
-            oOutputData.pushRawBuffer("\000" * (((lIdxBeginFadeIn - lNextSampleToWrite)*iInputData.Header.NbrChannels*iInputData.Header.NbrBitsPerSample)/8))
+            oOutputData.pushSilence(lIdxBeginFadeIn - lNextSampleToWrite)
           end
           lFadeInSize = iIdxBegin-lIdxBeginFadeIn
           if (lFadeInSize > 0)
-            lBuffer = []
+            log_debug "Write #{lFadeInSize} samples of fadein."
             lIdxFadeSample = 0
-            iInputData.each(lIdxBeginFadeIn) do |iChannelValues|
-              if (lIdxFadeSample == lFadeInSize)
-                break
-              end
-              lBuffer.concat(iChannelValues.map { |iValue| (iValue*lIdxFadeSample)/lFadeInSize })
-              lIdxFadeSample += 1
+            iInputData.each_sample_buffer(lIdxBeginFadeIn, iIdxBegin-1) do |iSampleBuffer, iNbrSamples, iNbrChannels|
+              # Values of sample i are multiplied by i/lFadeInSize
+              oOutputData.pushSampleBuffer(iSampleBuffer.fade!(lIdxFadeSample, 1, lFadeInSize))
+              lIdxFadeSample += iNbrSamples
             end
-            log_debug "Write #{lBuffer.size/iInputData.Header.NbrChannels} samples of fadein."
-            oOutputData.pushBuffer(lBuffer)
           else
             log_debug 'Ignore empty fadein.'
           end
           # Write the file
           log_debug "Write #{iIdxEnd-iIdxBegin+1} samples of audio."
-          iInputData.each_raw_buffer(iIdxBegin, iIdxEnd) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-            oOutputData.pushRawBuffer(iInputRawBuffer)
-          end
+          oOutputData.pushFileRange(iInputData, iIdxBegin, iIdxEnd)
           # Write the fadeout buffer
           lIdxEndFadeOut = iIdxEnd + lReleaseDuration
           if (lIdxEndFadeOut >= iInputData.NbrSamples)
@@ -97,17 +91,13 @@ module WSK
           end
           lFadeOutSize = lIdxEndFadeOut-iIdxEnd
           if (lFadeOutSize > 0)
-            lBuffer = []
+            log_debug "Write #{lFadeOutSize} samples of fadeout."
             lIdxFadeSample = 0
-            iInputData.each(iIdxEnd+1) do |iChannelValues|
-              if (lIdxFadeSample == lFadeOutSize)
-                break
-              end
-              lBuffer.concat(iChannelValues.map { |iValue| (iValue*(lFadeOutSize-lIdxFadeSample))/lFadeOutSize })
-              lIdxFadeSample += 1
+            iInputData.each_sample_buffer(iIdxEnd+1, lIdxEndFadeOut) do |iSampleBuffer, iNbrSamples, iNbrChannels|
+              # Values of sample i are multiplied by (lFadeOutSize-i)/lFadeOutSize
+              oOutputData.pushSampleBuffer(iSampleBuffer.fade!(lFadeOutSize-lIdxFadeSample, -1, lFadeOutSize))
+              lIdxFadeSample += iNbrSamples
             end
-            log_debug "Write #{lBuffer.size/iInputData.Header.NbrChannels} samples of fadeout."
-            oOutputData.pushBuffer(lBuffer)
           else
             log_debug 'Ignore empty fadeout.'
           end
@@ -116,7 +106,7 @@ module WSK
         # If there is remaining silence, write it
         if (lNextSampleToWrite < iInputData.NbrSamples)
           log_debug "Write #{iInputData.NbrSamples - lNextSampleToWrite} samples of last silence"
-          oOutputData.pushRawBuffer("\000" * (((iInputData.NbrSamples - lNextSampleToWrite)*iInputData.Header.NbrChannels*iInputData.Header.NbrBitsPerSample)/8))
+          oOutputData.pushSilence(iInputData.NbrSamples - lNextSampleToWrite)
         end
 
         return nil
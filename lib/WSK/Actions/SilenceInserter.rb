@@ -11,10 +11,6 @@ module WSK
 
       include WSK::Common
 
-      # Number of samples in the silent buffer
-      #   Integer
-      SILENT_BUFFER_SIZE = 2097152
-
       # Get the number of samples that will be written.
       # This is called before execute, as it is needed to write the output file.
       # It is possible to give a majoration: it will be padded with silence.
@@ -38,36 +34,15 @@ module WSK
       # Return::
       # * _Exception_: An error, or nil if success
       def execute(iInputData, oOutputData)
-        pushSilence(iInputData, oOutputData, @NbrBeginSilentSamples)
+        oOutputData.pushSilence(@NbrBeginSilentSamples)
         pushFile(iInputData, oOutputData)
-        pushSilence(iInputData, oOutputData, @NbrEndSilentSamples)
+        oOutputData.pushSilence(@NbrEndSilentSamples)
         
         return nil
       end
       
       private
       
-      # Push silence in the file
-      #
-      # Parameters::
-      # * *iInputData* (<em>WSK::Model::InputData</em>): The input data
-      # * *oOutputData* (_Object_): The output data to fill
-      # * *iNbrSamples* (_Integer_): The number of silent samples to insert
-      def pushSilence(iInputData, oOutputData, iNbrSamples)
-        lRawSampleSize = (iInputData.Header.NbrChannels*iInputData.Header.NbrBitsPerSample)/8
-        lNbrCompleteBuffers = iNbrSamples/SILENT_BUFFER_SIZE
-        if (lNbrCompleteBuffers > 0)
-          lCompleteRawBuffer = "\000"*SILENT_BUFFER_SIZE*lRawSampleSize
-          lNbrCompleteBuffers.times do |iIdx|
-            oOutputData.pushRawBuffer(lCompleteRawBuffer)
-          end
-        end
-        lLastBufferSize = iNbrSamples % SILENT_BUFFER_SIZE
-        if (lLastBufferSize > 0)
-          oOutputData.pushRawBuffer("\000"*lLastBufferSize*lRawSampleSize)
-        end
-      end
-
       # Push the file
       #
       # Parameters::
@@ -75,9 +50,7 @@ module WSK
       # * *oOutputData* (_Object_): The output data to fill
       def pushFile(iInputData, oOutputData)
         # Then write the file
-        iInputData.each_raw_buffer do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-          oOutputData.pushRawBuffer(iInputRawBuffer)
-        end
+        oOutputData.pushFileRange(iInputData, 0, iInputData.NbrSamples-1)
       end
 
     end
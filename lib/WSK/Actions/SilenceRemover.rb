@@ -60,9 +60,7 @@ module WSK
       # Return::
       # * _Exception_: An error, or nil if success
       def execute(iInputData, oOutputData)
-        iInputData.each_raw_buffer(@IdxFirstSample, @IdxLastSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-          oOutputData.pushRawBuffer(iInputRawBuffer)
-        end
+        oOutputData.pushFileRange(iInputData, @IdxFirstSample, @IdxLastSample)
 
         return nil
       end
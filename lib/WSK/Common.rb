@@ -8,6 +8,10 @@ module WSK
   # Common methods
   module Common
 
+    # File name designating the standard input or output streams
+    #   String
+    STREAM_FILE_NAME = '-'
+
     # Parse plugins
     def parsePlugins
       # Protect from re-entrance to avoid useless error messages in regression
@@ -26,7 +30,7 @@ module WSK
     # Proxies are used to cache accesses as they might be time consuming.
     #
     # Parameters::
-    # * *iFileName* (_String_): The file name to open
+    # * *iFileName* (_String_): The file name to open, or STREAM_FILE_NAME to read the standard input
     # * *CodeBlock*: The code block called when accessing the file:
     #   * *iHeader* (<em>WSK::Model::Header</em>): The file header information
     #   * *iInputData* (<em>WSK::Model::InputData</em>): The file data proxy
@@ -37,11 +41,15 @@ module WSK
     def accessInputWaveFile(iFileName)
       rError = nil
 
-      File.open(iFileName, 'rb') do |iFile|
+      openWaveFile(iFileName, 'rb') do |iFile|
         log_info "Access #{iFileName}"
         rError, lHeader, lInputData = getWaveFileAccesses(iFile)
-        if (rError == nil)
-          rError = yield(lHeader, lInputData)
+        begin
+          if (rError == nil)
+            rError = yield(lHeader, lInputData)
+          end
+        ensure
+          lInputData.close if (lInputData != nil)
         end
       end
       
@@ -78,7 +86,7 @@ module WSK
     # Proxies are used to cache accesses as they might be time consuming.
     #
     # Parameters::
-    # * *iFileName* (_String_): The file name to write
+    # * *iFileName* (_String_): The file name to write, or STREAM_FILE_NAME to write the standard output
     # * *iHeader* (<em>WSK::Model::Header</em>): The file header information to write
     # * *iOutputInterface* (_Object_): The output interface
     # * *iNbrOutputDataSamples* (_Integer_): The number of output data samples
@@ -90,7 +98,8 @@ module WSK
     def accessOutputWaveFile(iFileName, iHeader, iOutputInterface, iNbrOutputDataSamples)
       rError = nil
 
-      File.open(iFileName, 'wb') do |oFile|
+      # Files are opened for read as well, so that output interfaces can map them in memory
+      openWaveFile(iFileName, 'w+b') do |oFile|
         # Initialize the output interface
         rError = iOutputInterface.initInterface(oFile, iHeader, iNbrOutputDataSamples)
         if (rError == nil)
@@ -103,12 +112,13 @@ module WSK
             if (rError == nil)
               # Finalize the output interface
               lNbrSamplesWritten = iOutputInterface.finalize
-              # Pad with \x00 if lNbrSamplesWritten is below iNbrOutputDataSamples
+              # Pad with silence if lNbrSamplesWritten is below iNbrOutputDataSamples
               if (lNbrSamplesWritten < iNbrOutputDataSamples)
                 log_warn "#{lNbrSamplesWritten} samples written out of #{iNbrOutputDataSamples}: padding with silence."
-                oFile.write(iHeader.getEncodedString([0]*(iNbrOutputDataSamples-lNbrSamplesWritten)*iHeader.NbrChannels))
+                iOutputInterface.pushSilence(iNbrOutputDataSamples-lNbrSamplesWritten)
               elsif (lNbrSamplesWritten > iNbrOutputDataSamples)
                 log_warn "#{lNbrSamplesWritten} samples written, but #{iNbrOutputDataSamples} only were expected. #{lNbrSamplesWritten - iNbrOutputDataSamples} samples more."
+                patchHeader(oFile, iHeader, iNbrOutputDataSamples, lNbrSamplesWritten)
               end
             end
           end
@@ -216,6 +226,42 @@ module WSK
 
     private
 
+    # Open a file, or the standard streams if the file name is STREAM_FILE_NAME.
+    # The standard input is accessed directly if it is redirected from a regular file, and through a WSK::StreamFile otherwise.
+    # The standard output is written without being buffered, and is not closed.
+    #
+    # Parameters::
+    # * *iFileName* (_String_): The file name
+    # * *iMode* (_String_): The open mode ('rb' to read, 'w+b' to write)
+    # * *CodeBlock*: The code block called with the opened file:
+    #   * *ioFile* (_IO_): The file
+    # Return::
+    # * _Object_: The code block's result
+    def openWaveFile(iFileName, iMode)
+      rResult = nil
+
+      if (iFileName == STREAM_FILE_NAME)
+        if (iMode == 'rb')
+          STDIN.binmode
+          if (STDIN.stat.file?)
+            rResult = yield(STDIN)
+          else
+            rResult = yield(WSK::StreamFile.new(STDIN))
+          end
+        else
+          STDOUT.binmode
+          STDOUT.sync = true
+          rResult = yield(STDOUT)
+        end
+      else
+        rResult = File.open(iFileName, iMode) do |ioFile|
+          next yield(ioFile)
+        end
+      end
+
+      return rResult
+    end
+
     # Write the header to a file.
     #
     # Parameters::
@@ -227,11 +273,56 @@ module WSK
     def writeHeader(oFile, iHeader, iNbrOutputDataSamples)
       rError = nil
 
+      oFile.write(getHeaderData(iHeader, iNbrOutputDataSamples))
+
+      return rError
+    end
+
+    # Rewrite the header of a file with the number of samples effectively written.
+    # This is only possible on regular files, and if the header keeps the same size: otherwise the header written first is kept.
+    #
+    # Parameters::
+    # * *ioFile* (_IO_): File to patch
+    # * *iHeader* (<em>WSK::Model::Header</em>): The header to write
+    # * *iNbrOutputDataSamples* (_Integer_): The number of output data samples written in the header
+    # * *iNbrSamplesWritten* (_Integer_): The number of samples effectively written
+    def patchHeader(ioFile, iHeader, iNbrOutputDataSamples, iNbrSamplesWritten)
+      lHeaderData = getHeaderData(iHeader, iNbrSamplesWritten)
+      if (!ioFile.stat.file?)
+        log_warn "Output is a stream: its header can't be patched with the #{iNbrSamplesWritten} samples written."
+      elsif (lHeaderData.size != getHeaderData(iHeader, iNbrOutputDataSamples).size)
+        log_warn "Header can't be patched with the #{iNbrSamplesWritten} samples written, as it would change the RIFF format."
+      else
+        log_debug "Patch header with the #{iNbrSamplesWritten} samples written"
+        lPos = ioFile.pos
+        ioFile.seek(0)
+        ioFile.write(lHeaderData)
+        ioFile.seek(lPos)
+      end
+    end
+
+    # Get the header data to be written in a file.
+    # Data exceeding 4 GB is written as RF64, storing 64 bits sizes in a ds64 chunk.
+    #
+    # Parameters::
+    # * *iHeader* (<em>WSK::Model::Header</em>): The header to write
+    # * *iNbrOutputDataSamples* (_Integer_): The number of output data samples
+    # Return::
+    # * _String_: The header data
+    def getHeaderData(iHeader, iNbrOutputDataSamples)
+      rHeaderData = nil
+
       lBlockAlign = (iHeader.NbrChannels*iHeader.NbrBitsPerSample)/8
       lOutputDataSize = iNbrOutputDataSamples * lBlockAlign
-      oFile.write("RIFF#{[lOutputDataSize+36].pack('V')}WAVEfmt #{[16, iHeader.AudioFormat, iHeader.NbrChannels, iHeader.SampleRate, iHeader.SampleRate * lBlockAlign, lBlockAlign, iHeader.NbrBitsPerSample].pack('VvvVVvv')}data#{[lOutputDataSize].pack('V')}")
+      lFormat = "fmt #{[16, iHeader.AudioFormat, iHeader.NbrChannels, iHeader.SampleRate, iHeader.SampleRate * lBlockAlign, lBlockAlign, iHeader.NbrBitsPerSample].pack('VvvVVvv')}"
+      if (lOutputDataSize+36 > RIFFReader::RF64_SIZE_IN_DS64)
+        log_debug "Data size (#{lOutputDataSize}) exceeds 4 GB: write RF64 header"
+        rHeaderData = "RF64#{[RIFFReader::RF64_SIZE_IN_DS64].pack('V')}WAVEds64#{[28, lOutputDataSize+72, lOutputDataSize, iNbrOutputDataSamples, 0].pack('VQ<Q<Q<V')}#{lFormat}data#{[RIFFReader::RF64_SIZE_IN_DS64].pack('V')}"
+      else
+        rHeaderData = "RIFF#{[lOutputDataSize+36].pack('V')}WAVE#{lFormat}data#{[lOutputDataSize].pack('V')}"
+      end
 
-      return rError
+      return rHeaderData
     end
 
     # Get the header from a file.
@@ -249,8 +340,9 @@ module WSK
       iFile.seek(0)
       lBinaryHeader = iFile.read(12)
       # Check if the format is ok
-      if (lBinaryHeader[0..3] != 'RIFF')
-        rError = RuntimeError.new('Invalid header: not RIFF')
+      if ((lBinaryHeader[0..3] != 'RIFF') and
+          (lBinaryHeader[0..3] != 'RF64'))
+        rError = RuntimeError.new('Invalid header: not RIFF nor RF64')
       elsif (lBinaryHeader[8..11] != 'WAVE')
         rError = RuntimeError.new('Invalid header: not WAVE')
       else
@@ -285,6 +377,7 @@ module WSK
 end
 
 require 'WSK/RIFFReader'
+require 'WSK/StreamFile'
 require 'WSK/Model/InputData'
 require 'WSK/Model/Header'
 require 'WSK/FFT'
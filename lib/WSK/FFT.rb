@@ -88,48 +88,54 @@ module WSK
         return [@Header.NbrBitsPerSample, @NbrSamples, @FFTUtils.computeFFT(@Header.NbrChannels, @NbrFreq, @SumCos, @SumSin)]
       end
 
+      # Get the resulting FFT profile directly as a C FFT profile.
+      # This is far more efficient than converting the result of getFFTProfile with FFTUtils#createCFFTProfile, as no Ruby integer is created.
+      #
+      # Return::
+      # * _Object_: The C FFT profile, to be used with FFTUtils#distFFTProfiles
+      def getCFFTProfile
+        return @FFTUtils.computeCFFTProfile(@Header.NbrBitsPerSample, @NbrSamples, @Header.NbrChannels, @NbrFreq, @SumCos, @SumSin)
+      end
+
+      # Initialize the search of the next sample that has an FFT sample similar to a given FFT profile (see FFTUtils#searchFFTSample).
+      # This needs the trigonometric cache, giving the frequencies the FFT profile should have.
+      #
+      # Parameters::
+      # * *iCFFTProfile* (_Object_): The FFT profile, initialized by FFTUtils#createCFFTProfile or getCFFTProfile
+      # * *iThresholds* (<em>list< [Integer,Integer] ></em>): The thresholds that should contain the signal
+      # * *iIdxFirstSample* (_Integer_): First sample we are trying from
+      # * *iIdxLastPossibleSample* (_Integer_): Index of the sample marking the limit of the search
+      # * *iBackwardsSearch* (_Boolean_): Do we search backwards ?
+      # * *iNbrSamplesHop* (_Integer_): Number of samples between 2 consecutive FFT samples
+      # * *iSumMaxFFTDistance* (_Integer_): Maximal sum of the Moving Average distances to consider a sample found
+      # * *iMaxHistoryFFTDistance* (_Integer_): Maximal distance of the Moving Average to consider a sample found
+      # Return::
+      # * _Object_: Container of the FFT search
+      def initFFTSearch(iCFFTProfile, iThresholds, iIdxFirstSample, iIdxLastPossibleSample, iBackwardsSearch, iNbrSamplesHop, iSumMaxFFTDistance, iMaxHistoryFFTDistance)
+        return @FFTUtils.initFFTSearch(@W, (@UseTrigoCache) ? @@TrigoCache : nil, iCFFTProfile, @Header.NbrBitsPerSample, @Header.NbrChannels, iThresholds, iIdxFirstSample, iIdxLastPossibleSample, iBackwardsSearch, @Header.SampleRate/FFTSAMPLE_FREQ, iNbrSamplesHop, FFTNBRSAMPLES_HISTORY, iSumMaxFFTDistance, iMaxHistoryFFTDistance, FFTDIST_MAX)
+      end
+
     end
 
-    # To be used if GMP library is absent.
-#    # Compare 2 FFT profiles and measure their distance.
-#    # Here is an FFT profile structure:
-#    # [ Integer,          Integer,    list<list<Integer>> ]
-#    # [ NbrBitsPerSample, NbrSamples, FFTValues ]
-#    # FFTValues are declined per channel, per frequency index.
-#    # Bits per sample and number of samples are taken into account to relatively compare the profiles.
-#    #
-#    # Parameters::
-#    # * *iProfile1* (<em>[Integer,Integer,list<list<Integer>>]</em>): Profile 1
-#    # * *iProfile2* (<em>[Integer,Integer,list<list<Integer>>]</em>): Profile 2
-#    # Return::
-#    # * _Integer_: Distance (Profile 2 - Profile 1). The scale is given by FFTDIST_MAX.
-#    def distFFTProfiles(iProfile1, iProfile2)
-#      # Return the max of the distances of each frequency coefficient
-#      rMaxDist = 0.0
-#
-#      iNbrBitsPerSample1, iNbrSamples1, iFFT1 = iProfile1
-#      iNbrBitsPerSample2, iNbrSamples2, iFFT2 = iProfile2
-#
-#      # Each value is limited by the maximum value of 2*(NbrSamples*MaxAbsValue)^2
-#      lMaxFFTValue1 = Float(2*((iNbrSamples1*(2**(iNbrBitsPerSample1-1)))**2))
-#      lMaxFFTValue2 = Float(2*((iNbrSamples2*(2**(iNbrBitsPerSample2-1)))**2))
-#      iFFT1.each_with_index do |iFFT1ChannelValues, iIdxFreq|
-#        iFFT2ChannelValues = iFFT2[iIdxFreq]
-#        iFFT1ChannelValues.each_with_index do |iFFT1Value, iIdxChannel|
-#          iFFT2Value = iFFT2ChannelValues[iIdxChannel]
-#          # Compute iFFT2Value - iFFT1Value, on a scale of FFTDIST_MAX
-#          lDist = iFFT2Value/lMaxFFTValue2 - iFFT1Value/lMaxFFTValue1
-##          log_debug "[Freq #{iIdxFreq}] [Ch #{iIdxChannel}] - Distance = #{lDist}"
-#          if (lDist > rMaxDist)
-#            rMaxDist = lDist
-#          end
-#        end
-#      end
-#
-#      return (rMaxDist*FFTDIST_MAX).to_i
-#    end
+    # Get the number of samples between 2 consecutive FFT samples compared with an FFT profile.
+    # It is given in milliseconds by the WSK_FFT_HOP environment variable. By default, FFT samples don't overlap.
+    #
+    # Parameters::
+    # * *iHeader* (<em>WSK::Model::Header</em>): Header of the data
+    # Return::
+    # * _Integer_: Number of samples between 2 FFT samples, at most the number of samples of an FFT sample
+    def getFFTNbrSamplesHop(iHeader)
+      rNbrSamplesHop = iHeader.SampleRate/FFTSAMPLE_FREQ
+
+      if (ENV['WSK_FFT_HOP'] != nil)
+        rNbrSamplesHop = [ [ (ENV['WSK_FFT_HOP'].to_f*iHeader.SampleRate/1000).round, 1 ].max, rNbrSamplesHop ].min
+      end
+
+      return rNbrSamplesHop
+    end
 
-    # Get the next sample that has an FFT buffer similar to a given FFT profile
+    # Get the next sample that has an FFT buffer similar to a given FFT profile.
+    # FFT samples are consecutive, or overlap if a hop is given by the WSK_FFT_HOP environment variable: cut points are then found with a finer resolution.
     #
     # Parameters::
     # * *iIdxFirstSample* (_Integer_): First sample we are trying from
@@ -146,9 +152,6 @@ module WSK
     #   * *2*: The sample could not be found because the limit of search was hit before. The returned sample can be ignored.
     # * _Integer_: Index of the sample (can be 1 after the end)
     def getNextFFTSample(iIdxFirstSample, iFFTProfile, iInputData, iMaxFFTDistance, iThresholds, iBackwardsSearch, iIdxLastPossibleSample)
-      rResultCode = 0
-      rCurrentSample = iIdxFirstSample
-
       if (iBackwardsSearch)
         log_debug "== Looking for the previous sample matching FFT before #{iIdxFirstSample}, with a limit on sample #{iIdxLastPossibleSample} and a FFT distance of #{iMaxFFTDistance} ..."
       else
@@ -160,121 +163,30 @@ module WSK
       # Create the C FFT Profile
       lFFTUtils = FFTUtils::FFTUtils.new
       lReferenceFFTProfile = lFFTUtils.createCFFTProfile(iFFTProfile)
-      # Historical values of FFT diffs to know when it is stable
-      # This is the implementation of the Moving Average algorithm.
-      # We are just interested in the difference of 2 different Moving Averages. Therefore comparing the oldest history value with the new one is enough.
-      # Cycling buffer of size FFTNBRSAMPLES_HISTORY
-      # list< Integer >
-      lHistory = []
-      lIdxOldestHistory = 0
-      # The sum of all the history entries: used to compare with the maximal average distance
-      lSumHistory = 0
+      # Number of samples needed to have a valid FFT
+      lNbrSamplesFFTMax = iInputData.Header.SampleRate/FFTSAMPLE_FREQ
       lSumMaxFFTDistance = (iMaxFFTDistance*FFTNBRSAMPLES_HISTORY*(1+FFTDISTANCE_AVERAGE_HISTORY_TOLERANCE_PC/100)).to_i
       lMaxHistoryFFTDistance = (iMaxFFTDistance*(1+FFTDISTANCE_MAX_HISTORY_TOLERANCE_PC/100)).to_i
-      lContinueSearching = nil
-      if (iBackwardsSearch)
-        lContinueSearching = (rCurrentSample >= iIdxLastPossibleSample)
-      else
-        lContinueSearching = (rCurrentSample <= iIdxLastPossibleSample)
-      end
-      while (lContinueSearching)
-        # Compute the number of samples needed to have a valid FFT.
-        # Modify this number if it exceeds the range we have
-        lNbrSamplesFFTMax = iInputData.Header.SampleRate/FFTSAMPLE_FREQ
-        lIdxBeginFFTSample = nil
-        lIdxEndFFTSample = nil
+      # The search runs natively on windows of the input data, read without copying them.
+      # Each window starts at the first sample needed by the search (ends at the last one for backwards searches).
+      lFFTSearch = lFFTComputing.initFFTSearch(lReferenceFFTProfile, iThresholds, iIdxFirstSample, iIdxLastPossibleSample, iBackwardsSearch, getFFTNbrSamplesHop(iInputData.Header), lSumMaxFFTDistance, lMaxHistoryFFTDistance)
+      lNbrSamplesWindow = lNbrSamplesFFTMax*FFT_SAMPLES_PREFETCH
+      rResultCode, rCurrentSample = lFFTUtils.searchFFTSample(lFFTSearch, '', iIdxFirstSample)
+      while (rResultCode == -1)
+        lIdxNeededSample = rCurrentSample
+        lIdxFirstWindowSample = rCurrentSample
+        lIdxLastWindowSample = [ rCurrentSample+lNbrSamplesWindow-1, iIdxLastPossibleSample ].min
         if (iBackwardsSearch)
-          lIdxBeginFFTSample = rCurrentSample-lNbrSamplesFFTMax+1
-          lIdxEndFFTSample = rCurrentSample
-          if (lIdxBeginFFTSample <= iIdxLastPossibleSample-1)
-            lIdxBeginFFTSample = iIdxLastPossibleSample
-          end
-        else
-          lIdxBeginFFTSample = rCurrentSample
-          lIdxEndFFTSample = rCurrentSample+lNbrSamplesFFTMax-1
-          if (lIdxEndFFTSample >= iIdxLastPossibleSample+1)
-            lIdxEndFFTSample = iIdxLastPossibleSample
-          end
+          lIdxFirstWindowSample = [ rCurrentSample-lNbrSamplesWindow+1, iIdxLastPossibleSample ].max
+          lIdxLastWindowSample = rCurrentSample
         end
-        lNbrSamplesFFT = lIdxEndFFTSample-lIdxBeginFFTSample+1
-        # Load an FFT buffer of this
-        lFFTBuffer = ''
-        lIdxCurrentSample = rCurrentSample
-        if (iBackwardsSearch)
-          iInputData.each_reverse_raw_buffer(lIdxBeginFFTSample, lIdxEndFFTSample, :nbr_samples_prefetch => lNbrSamplesFFTMax*FFT_SAMPLES_PREFETCH ) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-            # First, check that we are still in the thresholds
-            lIdxBufferSampleOut = getSampleBeyondThresholds(iInputRawBuffer, iThresholds, iInputData.Header.NbrBitsPerSample, iNbrChannels, iNbrSamples, iBackwardsSearch)
-            if (lIdxBufferSampleOut != nil)
-              # Cancel this FFT search: the signal is out of the thresholds
-              rCurrentSample = lIdxCurrentSample-iNbrSamples+1+lIdxBufferSampleOut
-              rResultCode = 1
-              break
-            end
-            lFFTBuffer.insert(0, iInputRawBuffer)
-            lIdxCurrentSample -= iNbrSamples
-          end
-        else
-          iInputData.each_raw_buffer(lIdxBeginFFTSample, lIdxEndFFTSample, :nbr_samples_prefetch => lNbrSamplesFFTMax*FFT_SAMPLES_PREFETCH) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-            # First, check that we are still in the thresholds
-            lIdxBufferSampleOut = getSampleBeyondThresholds(iInputRawBuffer, iThresholds, iInputData.Header.NbrBitsPerSample, iNbrChannels, iNbrSamples, iBackwardsSearch)
-            if (lIdxBufferSampleOut != nil)
-              # Cancel this FFT search: the signal is out of the thresholds
-              rCurrentSample = lIdxCurrentSample+lIdxBufferSampleOut
-              rResultCode = 1
-              break
-            end
-            lFFTBuffer.concat(iInputRawBuffer)
-            lIdxCurrentSample += iNbrSamples
-          end
+        lWindow = iInputData.get_raw_window(lIdxFirstWindowSample, lIdxLastWindowSample, :nbr_samples_prefetch => lNbrSamplesWindow, :reverse => iBackwardsSearch)
+        rResultCode, rCurrentSample = lFFTUtils.searchFFTSample(lFFTSearch, lWindow, lIdxFirstWindowSample)
+        # A window that does not contain the needed samples (fewer samples read) would be read again forever
+        if ((rResultCode == -1) and
+            (rCurrentSample == lIdxNeededSample))
+          raise RuntimeError.new("FFT search does not progress: sample #{rCurrentSample} is still needed after reading samples #{lIdxFirstWindowSample} to #{lIdxLastWindowSample} (#{lWindow.size} bytes read)")
         end
-        if (rResultCode == 1)
-          lContinueSearching = false
-        else
-          # Compute its FFT profile
-          lFFTComputing.resetData
-          lFFTComputing.completeFFT(lFFTBuffer, lNbrSamplesFFT)
-          lDist = lFFTUtils.distFFTProfiles(lReferenceFFTProfile, lFFTUtils.createCFFTProfile(lFFTComputing.getFFTProfile), FFTDIST_MAX).abs
-          lHistoryMaxDistance = lHistory.sort[-1]
-          log_debug "FFT distance computed with FFT sample [#{lIdxBeginFFTSample} - #{lIdxEndFFTSample}]: #{lDist}. Sum of history: #{lSumHistory} <? #{lSumMaxFFTDistance}. Max distance of history: #{lHistoryMaxDistance} <? #{lMaxHistoryFFTDistance}"
-          # Detect if the Moving Average is going up and is below the maximal distance
-          if ((lHistory.size == FFTNBRSAMPLES_HISTORY) and
-              (lSumHistory < lSumMaxFFTDistance) and
-              (lHistoryMaxDistance < lMaxHistoryFFTDistance) and
-              (lHistory[lIdxOldestHistory] < lDist))
-            # We got it
-            lContinueSearching = false
-          else
-            # Check next FFT sample
-            if (iBackwardsSearch)
-              rCurrentSample = lIdxBeginFFTSample - 1
-              lContinueSearching = (rCurrentSample >= iIdxLastPossibleSample)
-            else
-              rCurrentSample = lIdxEndFFTSample + 1
-              lContinueSearching = (rCurrentSample <= iIdxLastPossibleSample)
-            end
-            if (lContinueSearching)
-              # Update the history with the new diff
-              if (lHistory[lIdxOldestHistory] == nil)
-                lSumHistory += lDist
-              else
-                lSumHistory += lDist - lHistory[lIdxOldestHistory]
-              end
-              lHistory[lIdxOldestHistory] = lDist
-              lIdxOldestHistory += 1
-              if (lIdxOldestHistory == FFTNBRSAMPLES_HISTORY)
-                lIdxOldestHistory = 0
-              end
-            end
-          end
-        end
-      end
-      if ((rResultCode == 0) and
-          (((iBackwardsSearch) and
-            (rCurrentSample == iIdxLastPossibleSample-1)) or
-           ((!iBackwardsSearch) and
-            (rCurrentSample == iIdxLastPossibleSample+1))))
-        # Limit was hit
-        rResultCode = 2
       end
 
       case rResultCode
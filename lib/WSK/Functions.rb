@@ -113,10 +113,7 @@ module WSK
           if (lIdxCurrentEndSample > iIdxEndSample)
             lIdxCurrentEndSample = iIdxEndSample
           end
-          lRawBuffer = ''
-          iInputData.each_raw_buffer(lIdxCurrentSample, lIdxCurrentEndSample, :nbr_samples_prefetch => iIdxEndSample-lIdxCurrentSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-            lRawBuffer += iInputRawBuffer
-          end
+          lRawBuffer = iInputData.get_raw_window(lIdxCurrentSample, lIdxCurrentEndSample, :nbr_samples_prefetch => iIdxEndSample-lIdxCurrentSample)
           # Profile this buffer
           lChannelLevelValues = @VolumeUtils.measureLevel(lRawBuffer, iInputData.Header.NbrBitsPerSample, iInputData.Header.NbrChannels, lIdxCurrentEndSample - lIdxCurrentSample + 1, iRMSRatio)
           # Combine the channel levels based on the RMS ratio also
@@ -181,7 +178,9 @@ module WSK
         lIdxBufferSample = iIdxBeginSample
         iInputData.each_raw_buffer(iIdxBeginSample, iIdxEndSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
           prepareVolumeUtils
-          oOutputData.pushRawBuffer(@VolumeUtils.applyVolumeFct(lCFunction, iInputRawBuffer, iInputData.Header.NbrBitsPerSample, iInputData.Header.NbrChannels, iNbrSamples, lIdxBufferSample, iUnitDB))
+          oOutputData.fillRawBuffer(iNbrSamples) do |iOutputMappedFile, iOutputOffset|
+            next @VolumeUtils.applyVolumeFct(lCFunction, iInputRawBuffer, iInputData.Header.NbrBitsPerSample, iInputData.Header.NbrChannels, iNbrSamples, lIdxBufferSample, iUnitDB, iOutputMappedFile, iOutputOffset)
+          end
           lIdxBufferSample += iNbrSamples
         end
       end
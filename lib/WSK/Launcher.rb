@@ -20,18 +20,26 @@ module WSK
       @Action = nil
       @DisplayHelp = false
       @Debug = false
+      @ClipLog = nil
+      @NbrThreads = nil
+      @NbrBuffersReadAhead = nil
+      @ReadAheadMemory = nil
+      @BlockSize = nil
+      @IOPolicy = nil
+      @FFTEngine = nil
+      @FFTHop = nil
       parsePlugins
 
       # The command line parser
       @Options = OptionParser.new
-      @Options.banner = 'WSK.rb [--help] [--debug] --input <InputFile> --output <OutputFile> --action <ActionName> -- <ActionOptions>'
+      @Options.banner = 'WSK.rb [--help] [--debug] [--cliplog <Verbosity>] [--threads <NbrThreads>] [--readahead <NbrBuffers>] [--readaheadmemory <MB>] [--blocksize <NbrSamples>] [--iopolicy <Policy>] [--fftengine <Engine>] [--ffthop <Milliseconds>] --input <InputFile> --output <OutputFile> --action <ActionName> -- <ActionOptions>'
       @Options.on( '--input <InputFile>', String,
-        '<InputFile>: WAVE file name to use as input',
+        "<InputFile>: WAVE file name to use as input, or #{STREAM_FILE_NAME} to read the standard input",
         'Specify input file name') do |iArg|
         @InputFileName = iArg
       end
       @Options.on( '--output <OutputFile>', String,
-        '<OutputFile>: WAVE file name to use as output',
+        "<OutputFile>: WAVE file name to use as output, or #{STREAM_FILE_NAME} to write the standard output (logs are then written to the standard error)",
         'Specify output file name') do |iArg|
         @OutputFileName = iArg
       end
@@ -48,6 +56,46 @@ module WSK
         'Activate debug logs') do
         @Debug = true
       end
+      @Options.on( '--cliplog <Verbosity>', [ 'none', 'summary', 'ranges' ],
+        '<Verbosity>: Verbosity of clipped samples reports (none, summary or ranges). Default: summary',
+        'Specify how samples exceeding limits are reported') do |iArg|
+        @ClipLog = iArg
+      end
+      @Options.on( '--threads <NbrThreads>', Integer,
+        '<NbrThreads>: Number of threads processing each buffer (0 to use all processors). Default: 1, or the WSK_THREADS environment variable',
+        'Specify how many threads process samples') do |iArg|
+        @NbrThreads = iArg
+      end
+      @Options.on( '--readahead <NbrBuffers>', Integer,
+        '<NbrBuffers>: Number of buffers read in the background while the current one is processed (0 to disable). Default: 1, or the WSK_READ_AHEAD environment variable',
+        'Specify how many input buffers are read ahead') do |iArg|
+        @NbrBuffersReadAhead = iArg
+      end
+      @Options.on( '--readaheadmemory <MB>', Integer,
+        '<MB>: Maximal memory used by buffers read ahead, in MB. Default: 64, or the WSK_READ_AHEAD_MEMORY environment variable',
+        'Specify the memory cap of input buffers read ahead') do |iArg|
+        @ReadAheadMemory = iArg
+      end
+      @Options.on( '--blocksize <NbrSamples>', Integer,
+        '<NbrSamples>: Number of samples read and written per buffer. Small values lower the latency when streaming. Default: buffers of a few MB, or the WSK_BLOCK_SIZE environment variable',
+        'Specify the number of samples processed per buffer') do |iArg|
+        @BlockSize = iArg
+      end
+      @Options.on( '--iopolicy <Policy>', [ 'cache', 'dontneed', 'direct' ],
+        '<Policy>: How files use the page cache: cache (data stays in cache), dontneed (data is dropped from the cache once processed), direct (data is read without the cache, for sequential scans). Default: the policy of the Action (cache for most of them), or the WSK_IO_POLICY environment variable',
+        'Specify the page cache policy of input and output files') do |iArg|
+        @IOPolicy = iArg
+      end
+      @Options.on( '--fftengine <Engine>', [ 'exact', 'phasor', 'goertzel' ],
+        '<Engine>: How FFT profiles are computed: exact (cos and sin computed for each sample), phasor (rotating phasor, nearly identical results), goertzel (Goertzel recurrence, fastest, results differ slightly). Default: exact, or the WSK_FFT_ENGINE environment variable',
+        'Specify the engine computing FFT profiles') do |iArg|
+        @FFTEngine = iArg
+      end
+      @Options.on( '--ffthop <Milliseconds>', Float,
+        '<Milliseconds>: Time between 2 FFT samples compared with silence FFT profiles. Smaller values find the boundaries of silences more precisely, using overlapping FFT samples computed by sliding. Default: 100 (no overlap), or the WSK_FFT_HOP environment variable',
+        'Specify the resolution of FFT silence detection') do |iArg|
+        @FFTHop = iArg
+      end
     end
 
     # Execute command line arguments
@@ -79,84 +127,149 @@ module WSK
           if (@Debug)
             activate_log_debug(true)
           end
-          # Check mandatory arguments were given
-          if (@InputFileName == nil)
-            lError = RuntimeError.new('Missing --input option. Please specify an input file.')
-          elsif (@OutputFileName == nil)
-            lError = RuntimeError.new('Missing --output option. Please specify an output file.')
-          elsif (@Action == nil)
-            lError = RuntimeError.new('Missing --action option. Please specify an action to perform.')
-          elsif (!File.exists?(@InputFileName))
-            lError = RuntimeError.new("Missing input file #{@InputFileName}")
-          elsif (File.exists?(@OutputFileName))
-            lError = RuntimeError.new("Output file #{@OutputFileName} already exists.")
-          else
-            # Access the Action
-            access_plugin('Actions', @Action) do |ioActionPlugin|
-              lDesc = ioActionPlugin.pluginDescription
-              # Check the output interface required by this plugin
-              lOutputInterfaceName = lDesc[:OutputInterface]
-              if (lOutputInterfaceName == nil)
-                lOutputInterfaceName = 'DirectStream'
-              end
-              # Initialize the variables if options are specified
-              if (lDesc[:Options] == nil)
-                if (!lActionArgs.empty?)
-                  lError = RuntimeError.new("Unknown Action arguments: #{lActionArgs.join(' ')}. Normally no parameter was expected.")
+          if (@ClipLog != nil)
+            # Read by C extensions when reporting clipped samples
+            ENV['WSK_CLIP_LOG'] = @ClipLog
+          end
+          if (@NbrThreads != nil)
+            # Read by C extensions when processing buffers
+            ENV['WSK_THREADS'] = @NbrThreads.to_s
+          end
+          if (@NbrBuffersReadAhead != nil)
+            # Read by input data readers
+            ENV['WSK_READ_AHEAD'] = @NbrBuffersReadAhead.to_s
+          end
+          if (@ReadAheadMemory != nil)
+            # Read by input data readers
+            ENV['WSK_READ_AHEAD_MEMORY'] = @ReadAheadMemory.to_s
+          end
+          if (@BlockSize != nil)
+            # Read by input data readers and output interfaces
+            ENV['WSK_BLOCK_SIZE'] = @BlockSize.to_s
+          end
+          if (@IOPolicy != nil)
+            # Read by input data readers and output interfaces
+            ENV['WSK_IO_POLICY'] = @IOPolicy
+          end
+          if (@FFTEngine != nil)
+            # Read by C extensions when computing FFT profiles
+            ENV['WSK_FFT_ENGINE'] = @FFTEngine
+          end
+          if (@FFTHop != nil)
+            # Read when searching samples matching FFT profiles
+            ENV['WSK_FFT_HOP'] = @FFTHop.to_s
+          end
+          lStdOut = $stdout
+          # Set if the page cache policy of the Action is used for this execution only
+          lActionIOPolicy = false
+          begin
+            if (@OutputFileName == STREAM_FILE_NAME)
+              # The standard output only receives the WAVE file
+              $stdout = $stderr
+            end
+            # Check mandatory arguments were given
+            if (@InputFileName == nil)
+              lError = RuntimeError.new('Missing --input option. Please specify an input file.')
+            elsif (@OutputFileName == nil)
+              lError = RuntimeError.new('Missing --output option. Please specify an output file.')
+            elsif ((@BlockSize != nil) and
+                   (@BlockSize <= 0))
+              lError = RuntimeError.new("Invalid --blocksize option (#{@BlockSize}). Please specify a positive number of samples.")
+            elsif ((ENV['WSK_BLOCK_SIZE'] != nil) and
+                   ((ENV['WSK_BLOCK_SIZE'].strip.match(/^\d+$/) == nil) or
+                    (ENV['WSK_BLOCK_SIZE'].to_i <= 0)))
+              lError = RuntimeError.new("Invalid WSK_BLOCK_SIZE environment variable (#{ENV['WSK_BLOCK_SIZE']}). Please specify a positive number of samples.")
+            elsif ((ENV['WSK_FFT_ENGINE'] != nil) and
+                   (![ 'exact', 'phasor', 'goertzel' ].include?(ENV['WSK_FFT_ENGINE'])))
+              lError = RuntimeError.new("Invalid WSK_FFT_ENGINE environment variable (#{ENV['WSK_FFT_ENGINE']}). Please specify exact, phasor or goertzel.")
+            elsif (@Action == nil)
+              lError = RuntimeError.new('Missing --action option. Please specify an action to perform.')
+            elsif ((@InputFileName != STREAM_FILE_NAME) and
+                   (!File.exists?(@InputFileName)))
+              lError = RuntimeError.new("Missing input file #{@InputFileName}")
+            elsif ((@OutputFileName != STREAM_FILE_NAME) and
+                   (File.exists?(@OutputFileName)))
+              lError = RuntimeError.new("Output file #{@OutputFileName} already exists.")
+            else
+              # Access the Action
+              access_plugin('Actions', @Action) do |ioActionPlugin|
+                lDesc = ioActionPlugin.pluginDescription
+                # Check the output interface required by this plugin
+                lOutputInterfaceName = lDesc[:OutputInterface]
+                if (lOutputInterfaceName == nil)
+                  lOutputInterfaceName = 'DirectStream'
                 end
-              else
-                # Check options
-                lPluginOptions = OptionParser.new
-                # Variables to instantiate
-                lVariables = {}
-                lDesc[:Options].each do |iVariable, iOptionInfo|
-                  # Set the variable correctly when the option is encountered
-                  lPluginOptions.on(*iOptionInfo) do |iArg|
-                    lVariables[iVariable] = iArg
-                  end
+                # Use the page cache policy of the plugin, unless one was specified
+                if ((ENV['WSK_IO_POLICY'] == nil) and
+                    (lDesc[:IOPolicy] != nil))
+                  ENV['WSK_IO_POLICY'] = lDesc[:IOPolicy]
+                  lActionIOPolicy = true
                 end
-                if (lActionArgs.empty?)
-                  lError = RuntimeError.new("Action was expecting arguments: #{lPluginOptions.to_s}. Please specify them after -- separator.")
+                # Initialize the variables if options are specified
+                if (lDesc[:Options] == nil)
+                  if (!lActionArgs.empty?)
+                    lError = RuntimeError.new("Unknown Action arguments: #{lActionArgs.join(' ')}. Normally no parameter was expected.")
+                  end
                 else
-                  # Parse Action's options
-                  begin
-                    lRemainingActionArgs = lPluginOptions.parse(lActionArgs)
-                    if (!lRemainingActionArgs.empty?)
-                      lError = RuntimeError.new("Unknown Action arguments: #{lRemainingActionArgs.join(' ')}. Expected signature: #{lPluginOptions.to_s}")
+                  # Check options
+                  lPluginOptions = OptionParser.new
+                  # Variables to instantiate
+                  lVariables = {}
+                  lDesc[:Options].each do |iVariable, iOptionInfo|
+                    # Set the variable correctly when the option is encountered
+                    lPluginOptions.on(*iOptionInfo) do |iArg|
+                      lVariables[iVariable] = iArg
                     end
-                  rescue Exception
-                    lError = $!
                   end
-                  # Instantiate variables if needed
-                  if (lError == nil)
-                    instantiateVars(ioActionPlugin, lVariables)
+                  if (lActionArgs.empty?)
+                    lError = RuntimeError.new("Action was expecting arguments: #{lPluginOptions.to_s}. Please specify them after -- separator.")
+                  else
+                    # Parse Action's options
+                    begin
+                      lRemainingActionArgs = lPluginOptions.parse(lActionArgs)
+                      if (!lRemainingActionArgs.empty?)
+                        lError = RuntimeError.new("Unknown Action arguments: #{lRemainingActionArgs.join(' ')}. Expected signature: #{lPluginOptions.to_s}")
+                      end
+                    rescue Exception
+                      lError = $!
+                    end
+                    # Instantiate variables if needed
+                    if (lError == nil)
+                      instantiateVars(ioActionPlugin, lVariables)
+                    end
                   end
                 end
-              end
-              # Plugin is initialized
-              if (lError == nil)
-                # Access the output interface plugin
-                access_plugin('OutputInterfaces', lOutputInterfaceName) do |ioOutputPlugin|
-                  # Access the input file
-                  lError = accessInputWaveFile(@InputFileName) do |iInputHeader, iInputData|
-                    lInputSubError = nil
-
-                    # Get the maximal output data samples
-                    lNbrOutputDataSamples = ioActionPlugin.get_nbr_samples(iInputData)
-                    log_debug "Number of samples to be written: #{lNbrOutputDataSamples}"
-
-                    # Access the output file
-                    lInputSubError = accessOutputWaveFile(@OutputFileName, iInputHeader, ioOutputPlugin, lNbrOutputDataSamples) do
-                      # Execute
-                      log_info "Execute Action #{@Action}, reading #{@InputFileName} and writing #{@OutputFileName} using #{lOutputInterfaceName} output interface."
-                      next ioActionPlugin.execute(iInputData, ioOutputPlugin)
-                    end
+                # Plugin is initialized
+                if (lError == nil)
+                  # Access the output interface plugin
+                  access_plugin('OutputInterfaces', lOutputInterfaceName) do |ioOutputPlugin|
+                    # Access the input file
+                    lError = accessInputWaveFile(@InputFileName) do |iInputHeader, iInputData|
+                      lInputSubError = nil
+
+                      # Get the maximal output data samples
+                      lNbrOutputDataSamples = ioActionPlugin.get_nbr_samples(iInputData)
+                      log_debug "Number of samples to be written: #{lNbrOutputDataSamples}"
 
-                    next lInputSubError
+                      # Access the output file
+                      lInputSubError = accessOutputWaveFile(@OutputFileName, iInputHeader, ioOutputPlugin, lNbrOutputDataSamples) do
+                        # Execute
+                        log_info "Execute Action #{@Action}, reading #{@InputFileName} and writing #{@OutputFileName} using #{lOutputInterfaceName} output interface."
+                        next ioActionPlugin.execute(iInputData, ioOutputPlugin)
+                      end
+
+                      next lInputSubError
+                    end
                   end
                 end
               end
             end
+          ensure
+            # Give the standard output and the environment back to the code that launched WSK
+            $stdout = lStdOut
+            if (lActionIOPolicy)
+              ENV.delete('WSK_IO_POLICY')
+            end
           end
         end
       end
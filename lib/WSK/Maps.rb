@@ -20,7 +20,9 @@ module WSK
       lMap = lArithmUtils.createMapFromFunctions(iInputData.Header.NbrBitsPerSample, iFunctions)
       # Apply the map
       iInputData.each_raw_buffer do |iInputRawBuffer, iNbrSamples, iNbrChannels|
-        oOutputData.pushRawBuffer(lArithmUtils.applyMap(lMap, iInputRawBuffer, iInputData.Header.NbrBitsPerSample, iNbrSamples))
+        oOutputData.fillRawBuffer(iNbrSamples) do |iOutputMappedFile, iOutputOffset|
+          next lArithmUtils.applyMap(lMap, iInputRawBuffer, iInputData.Header.NbrBitsPerSample, iNbrSamples, iOutputMappedFile, iOutputOffset)
+        end
       end
     end
 
@@ -12,12 +12,75 @@ module WSK
     # * extract_sub_buffer(iBuffer, iIdxStart, iIdxEnd) -> Buffer
     # * get_nbr_samples_per_buffer -> Integer (number of samples in 1 buffer)
     # * get_nbr_samples -> Integer (total number of samples)
+    # The following virtual method can also be defined to read the next buffers in a background thread while the current one is processed:
+    # * get_sample_size -> Integer (memory size of 1 sample in a buffer, in bytes, or nil if buffers can't be read ahead)
+    # read_buffer must then be callable from any thread.
+    # The following virtual method can also be defined to recycle the memory of buffers:
+    # * recycle_buffer(iBuffer) (called with a buffer that is not used anymore, to be reused by read_buffer)
+    # Buffers given by this class are then only valid until the next buffers are read.
+    # The following virtual method can also be defined to extract windows (see get_window) differently from sub-buffers:
+    # * extract_window(iBuffer, iIdxStart, iIdxEnd) -> Buffer
+    # The number of buffers read ahead is given by the WSK_READ_AHEAD environment variable (default 1), and their memory is capped by the WSK_READ_AHEAD_MEMORY environment variable (in MB, default 64).
+    # stop_read_ahead has to be called once the reader is not used anymore, to stop the background thread.
     class CachedBufferReader
 
+      # Default number of buffers read ahead
+      #   Integer
+      DEFAULT_NBR_BUFFERS_READ_AHEAD = 1
+
+      # Default maximal memory used by buffers read ahead, in MB
+      #   Integer
+      DEFAULT_READ_AHEAD_MEMORY = 64
+
+      # Get the number of samples per buffer set by the WSK_BLOCK_SIZE environment variable.
+      # Invalid values are ignored: buffers would not contain any sample.
+      #
+      # Parameters::
+      # * *iDefaultNbrSamples* (_Integer_): Number of samples per buffer if the variable is not set or invalid
+      # Return::
+      # * _Integer_: Number of samples per buffer
+      def self.get_env_nbr_samples_per_buffer(iDefaultNbrSamples)
+        rNbrSamples = iDefaultNbrSamples
+
+        lStrBlockSize = ENV['WSK_BLOCK_SIZE']
+        if (lStrBlockSize != nil)
+          if ((lStrBlockSize.strip.match(/^\d+$/) != nil) and
+              (lStrBlockSize.to_i > 0))
+            rNbrSamples = lStrBlockSize.to_i
+          else
+            log_warn "Invalid WSK_BLOCK_SIZE environment variable (#{lStrBlockSize}): it should be a positive number of samples. Using buffers of #{iDefaultNbrSamples} samples."
+          end
+        end
+
+        return rNbrSamples
+      end
+
       # Constructor
       def initialize
         @NbrSamples = get_nbr_samples
         @NbrSamplesPerBuffer = get_nbr_samples_per_buffer
+        # Number of buffers to read ahead
+        # Integer
+        @NbrBuffersReadAhead = 0
+        if ((respond_to?(:get_sample_size)) and
+            (get_sample_size != nil))
+          lNbrBuffersReadAhead = (ENV['WSK_READ_AHEAD'] || DEFAULT_NBR_BUFFERS_READ_AHEAD).to_i
+          lMaxNbrBuffersReadAhead = ((ENV['WSK_READ_AHEAD_MEMORY'] || DEFAULT_READ_AHEAD_MEMORY).to_i*1048576)/((@NbrSamplesPerBuffer+1)*get_sample_size)
+          @NbrBuffersReadAhead = [ [ lNbrBuffersReadAhead, lMaxNbrBuffersReadAhead ].min, 0 ].max
+        end
+        # The buffers being read ahead, in the order they were requested, with the queue receiving each one's result and a flag set when it is forgotten
+        # list< [ Integer, Integer, Queue, Boolean ] >
+        @ReadAheadBuffers = []
+        # The background thread reading buffers ahead, created on first use.
+        # It is kept for all buffers, as creating a thread per buffer allocates its stack each time.
+        # Thread
+        @ReadAheadThread = nil
+        # The requests of buffers to be read by the background thread (same entries as @ReadAheadBuffers)
+        # Queue
+        @ReadAheadRequests = Queue.new
+        # Mutex protecting calls to read_buffer
+        # Mutex
+        @ReadMutex = Mutex.new
         # The position of the first sample of the buffer
         # Integer
         @IdxStartBufferSample = nil
@@ -45,18 +108,16 @@ module WSK
         end
         lIdxFirstSample = iIdxStartSample
         while (lIdxFirstSample <= iIdxEndSample)
-          lIdxLastSample = lIdxFirstSample+@NbrSamplesPerBuffer
-          if (lIdxLastSample > iIdxEndSample)
-            lIdxLastSample = iIdxEndSample
-          end
-          # Compute the last sample to prefetch
-          lIdxLastSamplePrefetch = lIdxFirstSample + lNbrSamplesPrefetch
-          if (lIdxLastSamplePrefetch < lIdxLastSample)
-            lIdxLastSamplePrefetch = lIdxLastSample
-          elsif (lIdxLastSamplePrefetch > lIdxFirstSample+@NbrSamplesPerBuffer)
-            lIdxLastSamplePrefetch = lIdxFirstSample+@NbrSamplesPerBuffer
-          end
+          lIdxLastSample, lIdxLastSamplePrefetch = get_forward_window(lIdxFirstSample, iIdxEndSample, lNbrSamplesPrefetch)
           prepare_buffer(lIdxFirstSample, lIdxLastSample, lIdxFirstSample, lIdxLastSamplePrefetch)
+          # Read the next buffers while this one is processed
+          lIdxNextFirstSample = lIdxLastSample+1
+          @NbrBuffersReadAhead.times do
+            break if (lIdxNextFirstSample > iIdxEndSample)
+            lIdxNextLastSample, lIdxNextLastSamplePrefetch = get_forward_window(lIdxNextFirstSample, iIdxEndSample, lNbrSamplesPrefetch)
+            read_buffer_ahead(lIdxNextFirstSample, lIdxNextLastSamplePrefetch)
+            lIdxNextFirstSample = lIdxNextLastSample+1
+          end
           # Check if we need to return a sub-copy of the buffer
           lBuffer = []
           if ((lIdxFirstSample == @IdxStartBufferSample) and
@@ -88,18 +149,16 @@ module WSK
         end
         lIdxLastSample = iIdxEndSample
         while (lIdxLastSample >= iIdxStartSample)
-          lIdxFirstSample = lIdxLastSample-@NbrSamplesPerBuffer
-          if (lIdxFirstSample < iIdxStartSample)
-            lIdxFirstSample = iIdxStartSample
-          end
-          # Compute the first sample to prefetch
-          lIdxFirstSamplePrefetch = lIdxLastSample - lNbrSamplesPrefetch
-          if (lIdxFirstSamplePrefetch > lIdxFirstSample)
-            lIdxFirstSamplePrefetch = lIdxFirstSample
-          elsif (lIdxFirstSamplePrefetch < lIdxLastSample-@NbrSamplesPerBuffer)
-            lIdxFirstSamplePrefetch = lIdxLastSample-@NbrSamplesPerBuffer
-          end
+          lIdxFirstSample, lIdxFirstSamplePrefetch = get_reverse_window(lIdxLastSample, iIdxStartSample, lNbrSamplesPrefetch)
           prepare_buffer(lIdxFirstSample, lIdxLastSample, lIdxFirstSamplePrefetch, lIdxLastSample)
+          # Read the previous buffers while this one is processed
+          lIdxNextLastSample = lIdxFirstSample-1
+          @NbrBuffersReadAhead.times do
+            break if (lIdxNextLastSample < iIdxStartSample)
+            lIdxNextFirstSample, lIdxNextFirstSamplePrefetch = get_reverse_window(lIdxNextLastSample, iIdxStartSample, lNbrSamplesPrefetch)
+            read_buffer_ahead(lIdxNextFirstSamplePrefetch, lIdxNextLastSample)
+            lIdxNextLastSample = lIdxNextFirstSample-1
+          end
           # Check if we need to return a sub-copy of the buffer
           lBuffer = []
           if ((lIdxFirstSample == @IdxStartBufferSample) and
@@ -127,13 +186,77 @@ module WSK
         if ((@Buffer == nil) or
             (iIdxStartSample < @IdxStartBufferSample) or
             (iIdxEndSample > @IdxEndBufferSample))
-          # Read all from the data
-          @Buffer = read_buffer(iIdxStartSamplePrefetch, iIdxEndSamplePrefetch)
+          lOldBuffer = @Buffer
+          # Read all from the data, unless it has been read ahead
+          @Buffer = get_buffer_read_ahead(iIdxStartSamplePrefetch, iIdxEndSamplePrefetch)
+          if (@Buffer == nil)
+            @Buffer = @ReadMutex.synchronize { read_buffer(iIdxStartSamplePrefetch, iIdxEndSamplePrefetch) }
+          end
+          if ((lOldBuffer != nil) and
+              (respond_to?(:recycle_buffer)))
+            @ReadMutex.synchronize { recycle_buffer(lOldBuffer) }
+          end
           @IdxStartBufferSample = iIdxStartSamplePrefetch
           @IdxEndBufferSample = iIdxEndSamplePrefetch
         end
       end
 
+      # Get a contiguous window of samples, at any index.
+      # The window is extracted from the cached buffer, which is read again only if it does not contain the whole window: buffers are never concatenated.
+      #
+      # Parameters::
+      # * *iIdxStartSample* (_Integer_): Index of the first sample of the window
+      # * *iIdxEndSample* (_Integer_): Index of the last sample of the window
+      # * *iOptions* (<em>map<Symbol,Object></em>): Additional options [optional = {}]:
+      #   * *:nbr_samples_prefetch* (_Integer_): Specify a number of samples to effectively read if the data needs to be accessed, as for each_buffer. [optional = 0]
+      #   * *:reverse* (_Boolean_): Are samples prefetched before the window instead of after it, as for each_reverse_buffer ? [optional = false]
+      # Return::
+      # * _Object_: The window
+      def get_window(iIdxStartSample, iIdxEndSample, iOptions = {})
+        rWindow = nil
+
+        lNbrSamplesPrefetch = iOptions[:nbr_samples_prefetch]
+        if (lNbrSamplesPrefetch == nil)
+          lNbrSamplesPrefetch = 0
+        end
+        if (iIdxEndSample - iIdxStartSample > @NbrSamplesPerBuffer)
+          # The window does not fit in a buffer: read it directly
+          rWindow = @ReadMutex.synchronize { read_buffer(iIdxStartSample, iIdxEndSample) }
+        else
+          if (iOptions[:reverse])
+            lIdxFirstSample, lIdxFirstSamplePrefetch = get_reverse_window(iIdxEndSample, iIdxStartSample, lNbrSamplesPrefetch)
+            prepare_buffer(iIdxStartSample, iIdxEndSample, lIdxFirstSamplePrefetch, iIdxEndSample)
+          else
+            lIdxLastSample, lIdxLastSamplePrefetch = get_forward_window(iIdxStartSample, iIdxEndSample, lNbrSamplesPrefetch)
+            prepare_buffer(iIdxStartSample, iIdxEndSample, iIdxStartSample, lIdxLastSamplePrefetch)
+          end
+          if ((iIdxStartSample == @IdxStartBufferSample) and
+              (iIdxEndSample == @IdxEndBufferSample))
+            rWindow = @Buffer
+          elsif (respond_to?(:extract_window))
+            rWindow = extract_window(@Buffer, iIdxStartSample - @IdxStartBufferSample, iIdxEndSample - @IdxStartBufferSample)
+          else
+            rWindow = extract_sub_buffer(@Buffer, iIdxStartSample - @IdxStartBufferSample, iIdxEndSample - @IdxStartBufferSample)
+          end
+        end
+
+        return rWindow
+      end
+
+      # Stop reading buffers ahead.
+      # The background thread is stopped and joined, and buffers being read ahead are forgotten.
+      # Buffers can still be read afterwards, without being read ahead.
+      def stop_read_ahead
+        @NbrBuffersReadAhead = 0
+        forget_buffers_read_ahead(@ReadAheadBuffers.size)
+        if (@ReadAheadThread != nil)
+          # A nil request ends the thread
+          @ReadAheadRequests << nil
+          @ReadAheadThread.join
+          @ReadAheadThread = nil
+        end
+      end
+
       # Get the current buffer
       #
       # Return::
@@ -144,6 +267,125 @@ module WSK
         return @Buffer, @IdxStartBufferSample, @IdxEndBufferSample
       end
 
+      private
+
+      # Get the window of a buffer iterated forward
+      #
+      # Parameters::
+      # * *iIdxFirstSample* (_Integer_): Index of the first sample of the buffer
+      # * *iIdxEndSample* (_Integer_): Index of the last sample of the iteration
+      # * *iNbrSamplesPrefetch* (_Integer_): Number of samples to prefetch
+      # Return::
+      # * _Integer_: Index of the last sample of the buffer
+      # * _Integer_: Index of the last sample to read
+      def get_forward_window(iIdxFirstSample, iIdxEndSample, iNbrSamplesPrefetch)
+        rIdxLastSample = iIdxFirstSample+@NbrSamplesPerBuffer
+        if (rIdxLastSample > iIdxEndSample)
+          rIdxLastSample = iIdxEndSample
+        end
+        # Compute the last sample to prefetch
+        rIdxLastSamplePrefetch = iIdxFirstSample + iNbrSamplesPrefetch
+        if (rIdxLastSamplePrefetch < rIdxLastSample)
+          rIdxLastSamplePrefetch = rIdxLastSample
+        elsif (rIdxLastSamplePrefetch > iIdxFirstSample+@NbrSamplesPerBuffer)
+          rIdxLastSamplePrefetch = iIdxFirstSample+@NbrSamplesPerBuffer
+        end
+
+        return rIdxLastSample, rIdxLastSamplePrefetch
+      end
+
+      # Get the window of a buffer iterated in reverse order
+      #
+      # Parameters::
+      # * *iIdxLastSample* (_Integer_): Index of the last sample of the buffer
+      # * *iIdxStartSample* (_Integer_): Index of the first sample of the iteration
+      # * *iNbrSamplesPrefetch* (_Integer_): Number of samples to prefetch
+      # Return::
+      # * _Integer_: Index of the first sample of the buffer
+      # * _Integer_: Index of the first sample to read
+      def get_reverse_window(iIdxLastSample, iIdxStartSample, iNbrSamplesPrefetch)
+        rIdxFirstSample = iIdxLastSample-@NbrSamplesPerBuffer
+        if (rIdxFirstSample < iIdxStartSample)
+          rIdxFirstSample = iIdxStartSample
+        end
+        # Compute the first sample to prefetch
+        rIdxFirstSamplePrefetch = iIdxLastSample - iNbrSamplesPrefetch
+        if (rIdxFirstSamplePrefetch > rIdxFirstSample)
+          rIdxFirstSamplePrefetch = rIdxFirstSample
+        elsif (rIdxFirstSamplePrefetch < iIdxLastSample-@NbrSamplesPerBuffer)
+          rIdxFirstSamplePrefetch = iIdxLastSample-@NbrSamplesPerBuffer
+        end
+
+        return rIdxFirstSample, rIdxFirstSamplePrefetch
+      end
+
+      # Start reading a buffer in the background thread, unless it is already being read.
+      # Only the last requested buffers are kept, to cap memory.
+      #
+      # Parameters::
+      # * *iIdxStartSample* (_Integer_): Index of the first sample to read
+      # * *iIdxEndSample* (_Integer_): Index of the last sample to read
+      def read_buffer_ahead(iIdxStartSample, iIdxEndSample)
+        if (@ReadAheadBuffers.index { |iReadAheadBuffer| (iReadAheadBuffer[0] == iIdxStartSample) and (iReadAheadBuffer[1] == iIdxEndSample) } == nil)
+          if (@ReadAheadThread == nil)
+            @ReadAheadThread = Thread.new do
+              loop do
+                lRequest = @ReadAheadRequests.pop
+                break if (lRequest == nil)
+                lIdxStartSample, lIdxEndSample, lResult, lForgotten = lRequest
+                # Don't read buffers that were forgotten meanwhile
+                if (!lForgotten)
+                  begin
+                    lResult << @ReadMutex.synchronize { read_buffer(lIdxStartSample, lIdxEndSample) }
+                  rescue Exception
+                    # Errors are reported when the buffer is read again synchronously
+                    lResult << nil
+                  end
+                end
+              end
+            end
+          end
+          lReadAheadBuffer = [ iIdxStartSample, iIdxEndSample, Queue.new, false ]
+          @ReadAheadBuffers << lReadAheadBuffer
+          @ReadAheadRequests << lReadAheadBuffer
+          if (@ReadAheadBuffers.size > @NbrBuffersReadAhead)
+            @ReadAheadBuffers.shift[3] = true
+          end
+        end
+      end
+
+      # Get a buffer that has been read ahead.
+      # Buffers requested before it are forgotten, as the iteration went past them or jumped elsewhere.
+      #
+      # Parameters::
+      # * *iIdxStartSample* (_Integer_): Index of the first sample to read
+      # * *iIdxEndSample* (_Integer_): Index of the last sample to read
+      # Return::
+      # * _Object_: The corresponding buffer, or nil if it was not read ahead
+      def get_buffer_read_ahead(iIdxStartSample, iIdxEndSample)
+        rBuffer = nil
+
+        lIdxReadAheadBuffer = @ReadAheadBuffers.index { |iReadAheadBuffer| (iReadAheadBuffer[0] == iIdxStartSample) and (iReadAheadBuffer[1] == iIdxEndSample) }
+        if (lIdxReadAheadBuffer == nil)
+          forget_buffers_read_ahead(@ReadAheadBuffers.size)
+        else
+          forget_buffers_read_ahead(lIdxReadAheadBuffer)
+          rBuffer = @ReadAheadBuffers.shift[2].pop
+        end
+
+        return rBuffer
+      end
+
+      # Forget the first buffers being read ahead
+      #
+      # Parameters::
+      # * *iNbrBuffers* (_Integer_): Number of buffers to forget
+      def forget_buffers_read_ahead(iNbrBuffers)
+        @ReadAheadBuffers.shift(iNbrBuffers).each do |ioReadAheadBuffer|
+          ioReadAheadBuffer[3] = true
+        end
+      end
+
     end
 
   end
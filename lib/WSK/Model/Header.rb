@@ -36,21 +36,12 @@ module WSK
       # * *iNbrBitsPerSample* (_Integer_): Number of bits per channel's sample
       def initialize(iAudioFormat, iNbrChannels, iSampleRate, iNbrBitsPerSample)
         @AudioFormat, @NbrChannels, @SampleRate, @NbrBitsPerSample = iAudioFormat, iNbrChannels, iSampleRate, iNbrBitsPerSample
-        # The pack/unpack formula to use
-        lStrChannelPackFormula = ''
-        case @NbrBitsPerSample
-        when 8
-          lStrChannelPackFormula = 'C'
-        when 16
-          lStrChannelPackFormula = 's'
-        when 24
-          lStrChannelPackFormula = 'Cs'
-        when 32
-          lStrChannelPackFormula = 'l'
-        else
+        if (![ 8, 16, 24, 32 ].include?(@NbrBitsPerSample))
           raise RuntimeError.new("#{@NbrBitsPerSample} bits PCM data not supported.")
         end
-        @StrSamplePackFormula = lStrChannelPackFormula*@NbrChannels
+        # The PCM codec
+        require 'WSK/CodecUtils/CodecUtils'
+        @CodecUtils = WSK::CodecUtils::CodecUtils.new
       end
 
       # Get decoded samples from an encoded PCM string.
@@ -61,24 +52,7 @@ module WSK
       # Return::
       # * <em>list<Integer></em>: The list of samples (there will be iNbrSamplesToDecode*@NbrChannels values)
       def getDecodedSamples(iEncodedString, iNbrSamplesToDecode)
-        rSamples = iEncodedString.unpack(@StrSamplePackFormula*iNbrSamplesToDecode)
-
-        if (@NbrBitsPerSample == 8)
-          # Values are read unsigned. Shift them.
-          rSamples.map! do |iChannelValue|
-            next iChannelValue-128
-          end
-        elsif (@NbrBitsPerSample == 24)
-          # Each channel value has been decoded into 2 integers. We have to sum them.
-          lRealSamples = []
-          (iNbrSamplesToDecode*@NbrChannels).times do |iIdxChannelSample|
-            lIdxSamples = iIdxChannelSample*2
-            lRealSamples[iIdxChannelSample] = rSamples[lIdxSamples] + rSamples[lIdxSamples+1] * 256
-          end
-          rSamples = lRealSamples
-        end
-
-        return rSamples
+        return @CodecUtils.decodeSamples(iEncodedString, iNbrSamplesToDecode*@NbrChannels, @NbrBitsPerSample)
       end
 
       # Get encoded PCM string from decoded samples
@@ -88,26 +62,7 @@ module WSK
       # Return::
       # * _String_: Encoded PCM samples
       def getEncodedString(iChannelSamples)
-        lRealChannelSamples = nil
-        if (@NbrBitsPerSample == 8)
-          # Values have to be stored unsigned. Shift them.
-          lRealChannelSamples = []
-          iChannelSamples.each do |iChannelValue|
-            lRealChannelSamples << iChannelValue+128
-          end
-        elsif (@NbrBitsPerSample == 24)
-          # Each channel must be split into 2 integer values before encoding.
-          lRealChannelSamples = []
-          iChannelSamples.size.times do |iIdxChannelSample|
-            lIdxReal = iIdxChannelSample*2
-            lRealChannelSamples[lIdxReal] = iChannelSamples[iIdxChannelSample] & 255
-            lRealChannelSamples[lIdxReal+1] = iChannelSamples[iIdxChannelSample] / 256
-          end
-        else
-          lRealChannelSamples = iChannelSamples
-        end
-
-        return lRealChannelSamples.pack(@StrSamplePackFormula*(iChannelSamples.size/@NbrChannels))
+        return @CodecUtils.encodeSamples(@CodecUtils.createRawBuffer((iChannelSamples.size*@NbrBitsPerSample)/8), iChannelSamples, @NbrBitsPerSample)
       end
 
       # Compare with a different object
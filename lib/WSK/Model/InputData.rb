@@ -41,10 +41,16 @@ module WSK
         # Integer
         lSampleSize = (@Header.NbrChannels*@Header.NbrBitsPerSample)/8
         # Read the size of the data
-        rError, lDataSize = RIFFReader.new(@File).setFilePos('data')
+        # The RIFF reader, sharing the chunks directory of the file
+        # WSK::RIFFReader
+        @RIFFReader = RIFFReader.new(@File)
+        rError, lDataSize = @RIFFReader.setFilePos('data')
         if (rError == nil)
           # Check that the data size is coherent
-          if (lDataSize % lSampleSize == 0)
+          if ((lDataSize == RIFFReader::RF64_SIZE_IN_DS64) and
+              (!@File.stat.file?))
+            rError = RuntimeError.new('Data size of the input stream is unknown: its number of samples is needed. Please stream a WAVE file whose header has been written with its final size.')
+          elsif (lDataSize % lSampleSize == 0)
             @NbrSamples = lDataSize / lSampleSize
             @RawReader = RawReader.new(@File, @File.pos, lSampleSize, @NbrSamples)
             @WaveReader = WaveReader.new(@RawReader, @Header)
@@ -57,6 +63,15 @@ module WSK
         return rError
       end
 
+      # Close the data once it is not used anymore.
+      # Stop reading buffers ahead in background threads.
+      def close
+        if (@RawReader != nil)
+          @WaveReader.stop_read_ahead
+          @RawReader.close
+        end
+      end
+
       # Iterate through the samples
       #
       # Parameters::
@@ -65,8 +80,8 @@ module WSK
       #   * *iInputSampleData* (<em>list<Integer></em>): The list of values (1 per channel)
       def each(iIdxBeginSample = 0)
         each_buffer(iIdxBeginSample) do |iBuffer, iNbrSamples|
-          iBuffer.size.times do |iIdxSample|
-            yield(iBuffer[iIdxSample*@Header.NbrChannels..(iIdxSample+1)*@Header.NbrChannels-1])
+          iBuffer.each_slice(@Header.NbrChannels) do |iSampleData|
+            yield(iSampleData)
           end
         end
       end
@@ -142,6 +157,28 @@ module WSK
         end
       end
 
+      # Iterate through the buffers decoded in a native sample buffer.
+      # Values stay packed in native memory: this is far more efficient than iterating over unpacked buffers, and sample buffers can be processed and encoded directly.
+      # The same sample buffer is reused for all iterations: it is only valid until the next iteration.
+      #
+      # Parameters::
+      # * *iIdxBeginSample* (_Integer_): Index of the first sample to begin with [optional = 0]
+      # * *iIdxLastSample* (_Integer_): Index of the last sample to end with [optional = @NbrSamples-1]
+      # * *iOptions* (<em>map<Symbol,Object></em>): Additional options. See CachedBufferReader for documentation. [optional = {}]
+      #   * *:float* (_Boolean_): Are values stored as floats instead of 32 bits integers ? [optional = false]
+      # * *CodeBlock*: The code called for each iteration:
+      #   * *iSampleBuffer* (<em>WSK::SampleBuffer</em>): The sample buffer
+      #   * *iNbrSamples* (_Integer_): The number of samples in this buffer
+      #   * *iNbrChannels* (_Integer_): The number of channels in this buffer
+      def each_sample_buffer(iIdxBeginSample = 0, iIdxLastSample = @NbrSamples-1, iOptions = {})
+        require 'WSK/SampleBuffer/SampleBuffer'
+        lSampleBuffer = WSK::SampleBuffer.new(0, @Header.NbrChannels, iOptions[:float])
+        @RawReader.each_buffer(iIdxBeginSample, iIdxLastSample, iOptions) do |iBuffer, iNbrSamples|
+          lSampleBuffer.decode!(iBuffer, @Header.NbrBitsPerSample, iNbrSamples)
+          yield(lSampleBuffer, iNbrSamples, @Header.NbrChannels)
+        end
+      end
+
       # Iterate through the buffers in the reverse order in raw mode (strings read directly without unpacking).
       # This is far more efficient than iterating over samples or unpacked buffers.
       #
@@ -159,6 +196,32 @@ module WSK
         end
       end
 
+      # Get a contiguous window of raw samples, at any index, without concatenating buffers (see CachedBufferReader#get_window).
+      # The window is only valid until other buffers are read.
+      #
+      # Parameters::
+      # * *iIdxBeginSample* (_Integer_): Index of the first sample of the window
+      # * *iIdxLastSample* (_Integer_): Index of the last sample of the window
+      # * *iOptions* (<em>map<Symbol,Object></em>): Additional options. See CachedBufferReader#get_window for documentation. [optional = {}]
+      # Return::
+      # * _String_: The raw window
+      def get_raw_window(iIdxBeginSample, iIdxLastSample, iOptions = {})
+        return @RawReader.get_window(iIdxBeginSample, iIdxLastSample, iOptions)
+      end
+
+      # Get the location of raw samples in the input file, to copy them without reading them (see RawReader#get_file_range)
+      #
+      # Parameters::
+      # * *iIdxBeginSample* (_Integer_): Index of the first sample
+      # * *iIdxLastSample* (_Integer_): Index of the last sample
+      # Return::
+      # * _Integer_: File descriptor of the input file, or nil if samples can't be copied from it
+      # * _Integer_: Offset of the samples in the file
+      # * _Integer_: Size of the samples
+      def get_raw_file_range(iIdxBeginSample, iIdxLastSample)
+        return @RawReader.get_file_range(iIdxBeginSample, iIdxLastSample)
+      end
+
       # Get a sample's data
       #
       # Parameters::
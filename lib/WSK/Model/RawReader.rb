@@ -11,6 +11,12 @@ module WSK
 
     # Implement a RAW file reader using cached buffer reader.
     # Buffers returned are of type String.
+    # Regular files are mapped in memory when possible: buffers are then frozen Strings viewing the mapping directly, without copying data.
+    # Otherwise buffers not used anymore are recycled to read the next ones, without allocating memory.
+    # The page cache policy is given by the WSK_IO_POLICY environment variable:
+    # * cache (default): Data is mapped, and stays in the page cache.
+    # * dontneed: Data is read, and dropped from the page cache once read.
+    # * direct: Data is read with O_DIRECT, without using the page cache. This suits sequential scans of big files.
     class RawReader < CachedBufferReader
 
       # Buffer size.
@@ -18,6 +24,11 @@ module WSK
       #   Integer
       BUFFER_SIZE = 8388608
 
+      # Can windows be copied from buffers without creating substrings ?
+      # String#bytesplice accepts a source range since Ruby 3.3.
+      #   Boolean
+      COPY_WINDOWS = ((RUBY_VERSION.split('.').map { |iNumber| iNumber.to_i } <=> [ 3, 3 ]) >= 0)
+
       # Constructor
       #
       # Parameters::
@@ -27,15 +38,97 @@ module WSK
       # * *iNbrSamples* (_Integer_): Total number of samples
       def initialize(iFile, iFirstSampleFilePos, iSampleSize, iNbrSamples)
         @File, @FirstSampleFilePos, @SampleSize, @NbrSamples = iFile, iFirstSampleFilePos, iSampleSize, iNbrSamples
+        # The container of the mapped data, or nil if data is read from the file
+        # Object
+        @MappedFile = nil
+        # The last access advice given on the mapped data
+        # Integer
+        @Advice = nil
+        lDataSize = @NbrSamples*@SampleSize
+        lStat = @File.stat
+        # IO utils, used to map data and to apply page cache policies
+        # WSK::IOUtils::IOUtils
+        @IOUtils = nil
+        # Buffers not used anymore, whose memory is reused to read next buffers
+        # list< String >
+        @FreeBuffers = []
+        # Windows extracted from buffers read from the file, reused for each window, per thread
+        # map< Thread, String >
+        @Windows = {}
+        # Is the file regular ? Streams must be read in order, and can't be copied from their file descriptor.
+        # Boolean
+        @RegularFile = lStat.file?
+        # Page cache policy (cache, dontneed or direct). Streams don't use the page cache.
+        # String
+        @IOPolicy = 'cache'
+        if (@RegularFile)
+          @IOPolicy = (ENV['WSK_IO_POLICY'] || 'cache')
+          begin
+            require 'WSK/IOUtils/IOUtils'
+            @IOUtils = WSK::IOUtils::IOUtils.new
+          rescue LoadError
+            log_debug "Unable to load IOUtils, raw data will be read using the page cache: #{$!}"
+            @IOPolicy = 'cache'
+          end
+        end
+        # Range of the file read so far, dropped from the page cache with the dontneed policy
+        # Integer
+        @ReadPos = nil
+        @ReadEndPos = nil
+        # The file opened with O_DIRECT, or nil if none
+        # File
+        @DirectFile = nil
+        if (@IOPolicy == 'direct')
+          begin
+            # File::DIRECT is only defined on systems supporting it, and some filesystems refuse it.
+            @DirectFile = File.open(@File.path, File::RDONLY | File::DIRECT)
+            # Aligned memory receiving data read with O_DIRECT, before it is copied in buffers
+            # Object
+            @AlignedBuffer = @IOUtils.createAlignedBuffer
+            log_debug 'Raw data read without the page cache'
+          rescue NameError, SystemCallError
+            log_debug "Unable to read raw data without the page cache, it will be dropped from it instead: #{$!}"
+            @IOPolicy = 'dontneed'
+          end
+        end
+        # Mapped data stays in the page cache: only map it with the cache policy.
+        # Don't map data exceeding the file (truncated files): accessing it would crash
+        if ((@IOUtils != nil) and
+            (@IOPolicy == 'cache') and
+            (lDataSize > 0) and
+            (@FirstSampleFilePos + lDataSize <= lStat.size))
+          begin
+            @MappedFile = @IOUtils.mapFile(@File.fileno, @FirstSampleFilePos, lDataSize)
+            log_debug "Raw data mapped in memory (#{lDataSize} bytes)"
+          rescue RuntimeError
+            log_debug "Unable to map raw data in memory, it will be read: #{$!}"
+            @MappedFile = nil
+          end
+        end
         super()
       end
 
-      # Get the number of samples read per buffer
+      # Get the number of samples read per buffer.
+      # It can be set by the WSK_BLOCK_SIZE environment variable.
       #
       # Return::
       # * _Integer_: Nnumber of samples in 1 buffer
       def get_nbr_samples_per_buffer
-        return BUFFER_SIZE/@SampleSize
+        return CachedBufferReader.get_env_nbr_samples_per_buffer(BUFFER_SIZE/@SampleSize)
+      end
+
+      # Get the memory size of 1 sample in a buffer.
+      # Defining it makes buffers being read ahead in a background thread.
+      #
+      # Return::
+      # * _Integer_: Size of 1 sample, in bytes, or nil if buffers can't be read ahead
+      def get_sample_size
+        # Streams are not read in background threads
+        if (@RegularFile)
+          return @SampleSize
+        else
+          return nil
+        end
       end
 
       # Get the total number of samples
@@ -54,9 +147,125 @@ module WSK
       # Return::
       # * _Object_: The corresponding buffer
       def read_buffer(iIdxStartSample, iIdxEndSample)
-        @File.seek(@FirstSampleFilePos + iIdxStartSample*@SampleSize)
-        log_debug "Raw read samples [#{iIdxStartSample} - #{iIdxEndSample}]"
-        return @File.read((iIdxEndSample-iIdxStartSample+1)*@SampleSize)
+        if (@MappedFile == nil)
+          lOffset = @FirstSampleFilePos + iIdxStartSample*@SampleSize
+          lSize = (iIdxEndSample-iIdxStartSample+1)*@SampleSize
+          log_debug "Raw read samples [#{iIdxStartSample} - #{iIdxEndSample}]"
+          if (@RegularFile)
+            lBuffer = @FreeBuffers.pop
+            if (lBuffer == nil)
+              lBuffer = String.new
+            end
+            if (@IOPolicy == 'direct')
+              begin
+                return @IOUtils.readFileDirect(@AlignedBuffer, @DirectFile.fileno, lOffset, lSize, lBuffer)
+              rescue RuntimeError
+                log_debug "Unable to read raw data without the page cache, it will be dropped from it instead: #{$!}"
+                @IOPolicy = 'dontneed'
+              end
+            end
+            @File.seek(lOffset)
+            rBuffer = @File.read(lSize, lBuffer)
+            if (@IOPolicy == 'dontneed')
+              # Data read is not needed in the page cache anymore.
+              # Drop all the data read so far: pages read ahead by the system are only dropped once their reading is complete.
+              if (@ReadPos == nil)
+                @ReadPos, @ReadEndPos = lOffset, lOffset + lSize
+              else
+                @ReadPos = [ @ReadPos, lOffset ].min
+                @ReadEndPos = [ @ReadEndPos, lOffset + lSize ].max
+              end
+              @IOUtils.adviseFile(@File.fileno, WSK::IOUtils::IOUtils::ADVICE_DONTNEED, @ReadPos, @ReadEndPos - @ReadPos)
+            end
+            return rBuffer
+          else
+            @File.seek(lOffset)
+            return @File.read(lSize)
+          end
+        else
+          log_debug "Raw mapped samples [#{iIdxStartSample} - #{iIdxEndSample}]"
+          lOffset = iIdxStartSample*@SampleSize
+          # Prefetched samples can go beyond the data: stop at its end, as reading the file would do
+          lSize = ([ iIdxEndSample, @NbrSamples-1 ].min-iIdxStartSample+1)*@SampleSize
+          # Start paging in the whole buffer before it gets processed
+          @IOUtils.adviseMappedFile(@MappedFile, WSK::IOUtils::IOUtils::ADVICE_WILLNEED, lOffset, lSize)
+          return @IOUtils.getMappedView(@MappedFile, lOffset, lSize)
+        end
+      end
+
+      # Extract a window from a buffer (see CachedBufferReader#get_window).
+      # Windows of buffers read from the file are copied in the same String each time: substrings would share the buffers' memory, which could then not be recycled.
+      # Such a window is only valid until the next window is extracted by the same thread.
+      #
+      # Parameters::
+      # * *iBuffer* (_Object_): The buffer to extract from
+      # * *iIdxStartSample* (_Integer_): Index of the first sample to begin with
+      # * *iIdxEndSample* (_Integer_): Index of the last sample to end with
+      # Return::
+      # * _Object_: The window
+      def extract_window(iBuffer, iIdxStartSample, iIdxEndSample)
+        if ((@MappedFile == nil) and
+            (COPY_WINDOWS))
+          lWindow = @ReadMutex.synchronize do
+            lThreadWindow = @Windows[Thread.current]
+            if (lThreadWindow == nil)
+              # Forget the windows of threads that are dead
+              @Windows.delete_if { |iThread, iWindow| !iThread.alive? }
+              lThreadWindow = String.new
+              @Windows[Thread.current] = lThreadWindow
+            end
+            next lThreadWindow
+          end
+          lWindow.bytesplice(0, lWindow.bytesize, iBuffer, iIdxStartSample*@SampleSize, (iIdxEndSample-iIdxStartSample+1)*@SampleSize)
+          return lWindow
+        else
+          return extract_sub_buffer(iBuffer, iIdxStartSample, iIdxEndSample)
+        end
+      end
+
+      # Close the reader once it is not used anymore.
+      # Stop reading buffers ahead, and release the memory and files used to read buffers.
+      # Buffers already given remain valid.
+      def close
+        stop_read_ahead
+        @FreeBuffers = []
+        @Windows = {}
+        if (@DirectFile != nil)
+          @DirectFile.close
+          @DirectFile = nil
+          @IOPolicy = 'dontneed'
+        end
+      end
+
+      # Recycle a buffer that is not used anymore.
+      # Only buffers read from regular files are reused: mapped views don't own memory.
+      #
+      # Parameters::
+      # * *iBuffer* (_Object_): The buffer
+      def recycle_buffer(iBuffer)
+        # Keep enough buffers to read the ones read ahead
+        if ((@MappedFile == nil) and
+            (@RegularFile) and
+            (@FreeBuffers.size <= @NbrBuffersReadAhead))
+          @FreeBuffers << iBuffer
+        end
+      end
+
+      # Get the location of samples in the file, to copy them without reading them
+      #
+      # Parameters::
+      # * *iIdxStartSample* (_Integer_): Index of the first sample
+      # * *iIdxEndSample* (_Integer_): Index of the last sample
+      # Return::
+      # * _Integer_: File descriptor of the file, or nil if samples can't be copied from it
+      # * _Integer_: Offset of the samples in the file
+      # * _Integer_: Size of the samples
+      def get_file_range(iIdxStartSample, iIdxEndSample)
+        if (@RegularFile)
+          return @File.fileno, @FirstSampleFilePos + iIdxStartSample*@SampleSize, (iIdxEndSample-iIdxStartSample+1)*@SampleSize
+        else
+          return nil, nil, nil
+        end
       end
 
       # Extract a sub-buffer for the given index range
@@ -68,7 +277,59 @@ module WSK
       # Return::
       # * _Object_: The sub buffer
       def extract_sub_buffer(iBuffer, iIdxStartSample, iIdxEndSample)
-        return iBuffer[iIdxStartSample*@SampleSize..(iIdxEndSample+1)*@SampleSize-1]
+        if (@MappedFile == nil)
+          return iBuffer[iIdxStartSample*@SampleSize..(iIdxEndSample+1)*@SampleSize-1]
+        else
+          # iBuffer is always the current buffer
+          return @IOUtils.getMappedView(@MappedFile, (@IdxStartBufferSample+iIdxStartSample)*@SampleSize, (iIdxEndSample-iIdxStartSample+1)*@SampleSize)
+        end
+      end
+
+      # Iterate through the buffers.
+      # Mapped data is advised to be accessed sequentially.
+      #
+      # Parameters::
+      # * *iIdxStartSample* (_Integer_): Index of the first sample to begin with [optional = 0]
+      # * *iIdxEndSample* (_Integer_): Index of the last sample to end with [optional = @NbrSamples-1]
+      # * *iOptions* (<em>map<Symbol,Object></em>): Additional options [optional = {}] (see CachedBufferReader#each_buffer)
+      # * *CodeBlock*: The code called for each iteration:
+      #   * *iBuffer* (_String_): The buffer
+      #   * *iNbrSamples* (_Integer_): The number of samples in this buffer
+      def each_buffer(iIdxStartSample = 0, iIdxEndSample = @NbrSamples-1, iOptions = {})
+        advise(WSK::IOUtils::IOUtils::ADVICE_SEQUENTIAL) if (@MappedFile != nil)
+        super(iIdxStartSample, iIdxEndSample, iOptions) do |iBuffer, iNbrSamples|
+          yield(iBuffer, iNbrSamples)
+        end
+      end
+
+      # Iterate through the buffers in reverse order.
+      # Mapped data is advised to be accessed randomly, as read-ahead would fetch pages in the wrong direction.
+      #
+      # Parameters::
+      # * *iIdxStartSample* (_Integer_): Index of the first sample to begin with [optional = 0]
+      # * *iIdxEndSample* (_Integer_): Index of the last sample to end with [optional = @NbrSamples-1]
+      # * *iOptions* (<em>map<Symbol,Object></em>): Additional options [optional = {}] (see CachedBufferReader#each_reverse_buffer)
+      # * *CodeBlock*: The code called for each iteration:
+      #   * *iBuffer* (_String_): The buffer
+      #   * *iNbrSamples* (_Integer_): The number of samples in this buffer
+      def each_reverse_buffer(iIdxStartSample = 0, iIdxEndSample = @NbrSamples-1, iOptions = {})
+        advise(WSK::IOUtils::IOUtils::ADVICE_RANDOM) if (@MappedFile != nil)
+        super(iIdxStartSample, iIdxEndSample, iOptions) do |iBuffer, iNbrSamples|
+          yield(iBuffer, iNbrSamples)
+        end
+      end
+
+      private
+
+      # Give an access advice on the whole mapped data, if it differs from the last one
+      #
+      # Parameters::
+      # * *iAdvice* (_Integer_): The advice (one of IOUtils::ADVICE_* constants)
+      def advise(iAdvice)
+        if (iAdvice != @Advice)
+          @IOUtils.adviseMappedFile(@MappedFile, iAdvice, 0, @NbrSamples*@SampleSize)
+          @Advice = iAdvice
+        end
       end
 
     end
@@ -27,12 +27,13 @@ module WSK
         super()
       end
 
-      # Get the number of samples read per buffer
+      # Get the number of samples read per buffer.
+      # It can be set by the WSK_BLOCK_SIZE environment variable.
       #
       # Return::
       # * _Integer_: Nnumber of samples in 1 buffer
       def get_nbr_samples_per_buffer
-        return NBR_CHANNEL_SAMPLES_PER_BUFFER/@Header.NbrChannels
+        return CachedBufferReader.get_env_nbr_samples_per_buffer(NBR_CHANNEL_SAMPLES_PER_BUFFER/@Header.NbrChannels)
       end
 
       # Get the total number of samples
@@ -51,25 +52,11 @@ module WSK
       # Return::
       # * _Object_: The corresponding buffer
       def read_buffer(iIdxStartSample, iIdxEndSample)
-        lRawBuffer = nil
-        lNbrSamplesToRead = iIdxEndSample - iIdxStartSample + 1
-        @RawReader.each_buffer(iIdxStartSample, iIdxEndSample) do |iBuffer, iNbrSamples|
-          if (lRawBuffer == nil)
-            if (lNbrSamplesToRead == iNbrSamples)
-              # We have the buffer directly. No copy.
-              lRawBuffer = iBuffer
-            else
-              # We will need to concatenate other buffers. Clone it.
-              lRawBuffer = iBuffer.clone
-            end
-          else
-            # Concatenate
-            lRawBuffer.concat(iBuffer)
-          end
-        end
+        # Get the raw samples in 1 window, without concatenating raw buffers
+        lRawBuffer = @RawReader.get_window(iIdxStartSample, iIdxEndSample)
         log_debug "Decode samples [#{iIdxStartSample} - #{iIdxEndSample}]"
         
-        return @Header.getDecodedSamples(lRawBuffer, lNbrSamplesToRead)
+        return @Header.getDecodedSamples(lRawBuffer, iIdxEndSample - iIdxStartSample + 1)
       end
 
       # Extract a sub-buffer for the given index range
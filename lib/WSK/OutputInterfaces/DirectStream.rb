@@ -7,15 +7,29 @@ module WSK
 
   module OutputInterfaces
 
+    # Output interface writing data in the file, through a buffer.
+    # The page cache policy is given by the WSK_IO_POLICY environment variable (see WSK::Model::RawReader).
+    # Written data can't bypass the page cache: with the dontneed and direct policies, it is written to the disk and dropped from the page cache regularly.
     class DirectStream
 
       # Here we define the buffer size.
-      # The buffer will be used to store contiguous audio data in RAM.
+      # The buffer will be used to store contiguous encoded audio data in RAM.
       # Each OutputData object will never use more than this size.
       # It is expressed in bytes.
       #   Integer
       BUFFER_SIZE = 2097152
 
+      # Size of the silent buffer written repeatedly when silence can't be stored as a hole in the file.
+      # It is also the minimal size of silence stored as a hole.
+      # It is expressed in bytes.
+      #   Integer
+      SILENT_BUFFER_SIZE = 65536
+
+      # Size of written data that is written to the disk at once, before being dropped from the page cache (see dropWrittenData).
+      # It is expressed in bytes.
+      #   Integer
+      CACHE_DROP_SIZE = 16777216
+
       # Initialize the plugin
       #
       # Parameters::
@@ -33,13 +47,45 @@ module WSK
         # Integer
         @SampleSize = (@Header.NbrChannels*@Header.NbrBitsPerSample)/8
         # Compute the number of samples to store in the buffer
-        @NbrSamplesPerBuffer = BUFFER_SIZE/@SampleSize
+        require 'WSK/Model/CachedBufferReader'
+        @NbrSamplesPerBuffer = WSK::Model::CachedBufferReader.get_env_nbr_samples_per_buffer(BUFFER_SIZE/@SampleSize)
         # The position of the last written sample in the buffer
         # Integer
         @IdxCurrentBufferSample = 0
-        # The buffer itself, list of channels values
-        # list< Integer >
-        @Buffer = []
+        # The buffer itself, encoded channels values
+        # String
+        require 'WSK/CodecUtils/CodecUtils'
+        @CodecUtils = WSK::CodecUtils::CodecUtils.new
+        @Buffer = @CodecUtils.createRawBuffer(@NbrSamplesPerBuffer*@SampleSize)
+        # Encoded silent samples written when silence can't be stored as a hole, created on first use
+        # String
+        @SilentBuffer = nil
+        # Can silence be stored as holes in the file ?
+        # Only regular files opened as File objects support it, and 8 bits silence is not made of null bytes.
+        # Boolean
+        @SilenceAsHoles = ((@File.respond_to?(:truncate)) and
+                           (@File.stat.file?) and
+                           (@Header.NbrBitsPerSample != 8))
+        # IO utils copying file ranges from the kernel, or nil if not available
+        # WSK::IOUtils::IOUtils
+        @IOUtils = nil
+        begin
+          require 'WSK/IOUtils/IOUtils'
+          @IOUtils = WSK::IOUtils::IOUtils.new
+        rescue LoadError
+          log_debug "Unable to load IOUtils, file ranges will be copied by reading them: #{$!}"
+        end
+        # Page cache policy (cache, dontneed or direct). Streams don't use the page cache.
+        # String
+        @IOPolicy = 'cache'
+        if ((@IOUtils != nil) and
+            (@File.stat.file?))
+          @IOPolicy = (ENV['WSK_IO_POLICY'] || 'cache')
+        end
+        # Positions in the file of written data that is being written to the disk, and that will be dropped from the page cache
+        # Integer
+        @WritingPos = 0
+        @WritingEndPos = 0
 
         return rError
       end
@@ -52,6 +98,7 @@ module WSK
         if (!@Buffer.empty?)
           flushBuffer
         end
+        dropWrittenData(true)
 
         return @NbrSamplesWritten
       end
@@ -62,7 +109,7 @@ module WSK
       # * *iSampleData* (<em>list<Integer></em>): The list of channel values for this sample
       def pushSample(iSampleData)
         # Write data in the buffer
-        @Buffer += iSampleData
+        @CodecUtils.encodeSamples(@Buffer, iSampleData, @Header.NbrBitsPerSample)
         @IdxCurrentBufferSample += 1
         if (@IdxCurrentBufferSample == @NbrSamplesPerBuffer)
           # We have to flush the buffer
@@ -76,7 +123,7 @@ module WSK
       # * *iBuffer* (<em>list<Integer></em>): The list of channel values for this buffer
       def pushBuffer(iBuffer)
         # Write data in the current buffer
-        @Buffer += iBuffer
+        @CodecUtils.encodeSamples(@Buffer, iBuffer, @Header.NbrBitsPerSample)
         @IdxCurrentBufferSample += iBuffer.size/@Header.NbrChannels
         if (@IdxCurrentBufferSample >= @NbrSamplesPerBuffer)
           # We have to flush the buffer
@@ -89,13 +136,134 @@ module WSK
       # Parameters::
       # * *iRawBuffer* (_String_): The raw buffer
       def pushRawBuffer(iRawBuffer)
-        # First, flush eventually remaining buffer to encode
+        lNbrSamples = iRawBuffer.size/@SampleSize
+        if ((!@Buffer.empty?) and
+            (@IdxCurrentBufferSample + lNbrSamples < @NbrSamplesPerBuffer))
+          # Append it to the samples already in the buffer
+          @Buffer << iRawBuffer
+          @IdxCurrentBufferSample += lNbrSamples
+        else
+          # First, flush eventually remaining buffer
+          if (!@Buffer.empty?)
+            flushBuffer
+          end
+          # Then write our raw buffer directly
+          writeData(iRawBuffer)
+          updateProgress(lNbrSamples)
+        end
+      end
+
+      # Add a native sample buffer.
+      # Its values are encoded directly, without being unpacked in Ruby: values exceeding the range of samples are clipped.
+      #
+      # Parameters::
+      # * *iSampleBuffer* (<em>WSK::SampleBuffer</em>): The sample buffer
+      def pushSampleBuffer(iSampleBuffer)
+        lNbrSamples = iSampleBuffer.nbrSamples
+        if ((!@Buffer.empty?) and
+            (@IdxCurrentBufferSample + lNbrSamples < @NbrSamplesPerBuffer))
+          # Append it to the samples already in the buffer
+          iSampleBuffer.encode(@Header.NbrBitsPerSample, @Buffer)
+          @IdxCurrentBufferSample += lNbrSamples
+        else
+          # First, flush eventually remaining buffer
+          if (!@Buffer.empty?)
+            flushBuffer
+          end
+          # Then encode it where the output is written
+          fillRawBuffer(lNbrSamples) do |iOutputMappedFile, iOutputOffset|
+            next iSampleBuffer.encode(@Header.NbrBitsPerSample, iOutputMappedFile, iOutputOffset)
+          end
+        end
+      end
+
+      # Add a raw buffer computed by a C extension.
+      # The code block is given where the output is to be written: with no mapped file, it returns the computed String.
+      #
+      # Parameters::
+      # * *iNbrSamples* (_Integer_): Number of samples computed
+      # * *CodeBlock*: The code computing the samples:
+      #   * *iOutputMappedFile* (_Object_): The container of a mapped file to write samples into, or nil to return them
+      #   * *iOutputOffset* (_Integer_): Offset in the mapped file to write samples at, or nil
+      #   * Return::
+      #   * _String_: The computed raw buffer, or nil if it was written in the mapped file
+      def fillRawBuffer(iNbrSamples)
+        pushRawBuffer(yield(nil, nil))
+      end
+
+      # Add a range of samples from an input data, unchanged.
+      # Samples are copied by the kernel when possible (copy_file_range, sendfile or splice), without being read: filesystems supporting it can even share data blocks with the input file.
+      # Otherwise they are read and written as raw buffers.
+      #
+      # Parameters::
+      # * *iInputData* (<em>WSK::Model::InputData</em>): The input data
+      # * *iIdxFirstSample* (_Integer_): Index of the first sample to copy
+      # * *iIdxLastSample* (_Integer_): Index of the last sample to copy
+      def pushFileRange(iInputData, iIdxFirstSample, iIdxLastSample)
+        lIdxNextSample = iIdxFirstSample
+        if ((@IOUtils != nil) and
+            (iIdxLastSample >= iIdxFirstSample))
+          lInFileNo, lInOffset, lSize = iInputData.get_raw_file_range(iIdxFirstSample, iIdxLastSample)
+          if (lInFileNo != nil)
+            # First, flush eventually remaining buffer
+            if (!@Buffer.empty?)
+              flushBuffer
+            end
+            @File.flush
+            lNbrSamplesCopied, lNbrBytesExceeding = @IOUtils.copyFileRange(lInFileNo, lInOffset, @File.fileno, lSize).divmod(@SampleSize)
+            log_debug "#{lNbrSamplesCopied} samples copied by the kernel"
+            dropWrittenData
+            if (lNbrBytesExceeding > 0)
+              # Complete the last sample copied partially
+              iInputData.each_raw_buffer(iIdxFirstSample+lNbrSamplesCopied, iIdxFirstSample+lNbrSamplesCopied) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
+                writeData(iInputRawBuffer[lNbrBytesExceeding..-1])
+              end
+              lNbrSamplesCopied += 1
+            end
+            updateProgress(lNbrSamplesCopied)
+            lIdxNextSample += lNbrSamplesCopied
+          end
+        end
+        # Then write the samples that could not be copied
+        if (lIdxNextSample <= iIdxLastSample)
+          iInputData.each_raw_buffer(lIdxNextSample, iIdxLastSample) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
+            pushRawBuffer(iInputRawBuffer)
+          end
+        end
+      end
+
+      # Add silent samples.
+      # Silence is stored as a hole at the end of regular files, without writing it.
+      # This can also be called after finalize, to pad the file.
+      #
+      # Parameters::
+      # * *iNbrSamples* (_Integer_): Number of silent samples
+      def pushSilence(iNbrSamples)
+        # First, flush eventually remaining buffer
         if (!@Buffer.empty?)
           flushBuffer
         end
-        # Then write our raw buffer
-        @File.write(iRawBuffer)
-        updateProgress(iRawBuffer.size/@SampleSize)
+        lSilenceSize = iNbrSamples*@SampleSize
+        if ((@SilenceAsHoles) and
+            (lSilenceSize >= SILENT_BUFFER_SIZE))
+          # Extend the file: the filesystem stores silence as a hole if it supports sparse files
+          @File.flush
+          lSilenceEndPos = @File.pos + lSilenceSize
+          @File.truncate(lSilenceEndPos)
+          @File.seek(lSilenceEndPos)
+        else
+          if (@SilentBuffer == nil)
+            @SilentBuffer = @Header.getEncodedString([0]*@Header.NbrChannels)*(SILENT_BUFFER_SIZE/@SampleSize)
+          end
+          lNbrCompleteBuffers, lLastBufferSize = lSilenceSize.divmod(@SilentBuffer.size)
+          lNbrCompleteBuffers.times do
+            writeData(@SilentBuffer)
+          end
+          if (lLastBufferSize > 0)
+            writeData(@SilentBuffer[0, lLastBufferSize])
+          end
+        end
+        updateProgress(iNbrSamples)
       end
 
       # Loop on a range of samples split into buffers
@@ -123,10 +291,45 @@ module WSK
       # Write the buffer to the disk
       def flushBuffer
         # Write it
-        @File.write(@Header.getEncodedString(@Buffer))
-        updateProgress(@Buffer.size/@Header.NbrChannels)
+        writeData(@Buffer)
+        updateProgress(@Buffer.size/@SampleSize)
         @IdxCurrentBufferSample = 0
-        @Buffer = []
+        @CodecUtils.clearRawBuffer(@Buffer)
+      end
+
+      # Write data in the file, at its current position
+      #
+      # Parameters::
+      # * *iData* (_String_): The data to write
+      def writeData(iData)
+        @File.write(iData)
+        dropWrittenData
+      end
+
+      # Drop written data from the page cache, if the page cache policy requires it.
+      # Writing new data to the disk is started, and data whose writing was started before is waited for and dropped: writes are not waited for as soon as they are started.
+      #
+      # Parameters::
+      # * *iAll* (_Boolean_): Do we drop all the data written so far ? Otherwise data is dropped by chunks of CACHE_DROP_SIZE bytes. [optional = false]
+      def dropWrittenData(iAll = false)
+        if (@IOPolicy != 'cache')
+          lPos = @File.pos
+          if ((iAll) or
+              (lPos - @WritingEndPos >= CACHE_DROP_SIZE))
+            @File.flush
+            if (iAll)
+              lDropEndPos = lPos
+            else
+              # Start writing new data
+              @IOUtils.syncFileRange(@File.fileno, @WritingEndPos, lPos - @WritingEndPos, false)
+              lDropEndPos = @WritingEndPos
+            end
+            # Data must be on the disk to be dropped
+            @IOUtils.syncFileRange(@File.fileno, @WritingPos, lDropEndPos - @WritingPos, true)
+            @IOUtils.adviseFile(@File.fileno, WSK::IOUtils::IOUtils::ADVICE_DONTNEED, @WritingPos, lDropEndPos - @WritingPos)
+            @WritingPos, @WritingEndPos = lDropEndPos, lPos
+          end
+        end
       end
 
       # Add a samples' number to the progression
@@ -0,0 +1,184 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'WSK/OutputInterfaces/DirectStream'
+
+module WSK
+
+  module OutputInterfaces
+
+    # Output interface writing data in a file mapped in memory.
+    # The whole data is allocated on disk first, then C extensions compute their results directly in the mapping (see fillRawBuffer), without intermediate Strings.
+    # Data that can't be mapped (streams, samples exceeding the expected number) is written as with DirectStream.
+    class MappedFile < DirectStream
+
+      # Initialize the plugin
+      #
+      # Parameters::
+      # * *oFile* (_IO_): The file descriptor. Don't use it externally as long as it is used by this class.
+      # * *iHeader* (<em>WSK::Model::Header</em>): Corresponding file header
+      # * *iNbrOutputDataSamples* (_Integer_): The number of output data samples
+      # Return::
+      # * _Exception_: An error, or nil in case of success
+      def initInterface(oFile, iHeader, iNbrOutputDataSamples)
+        rError = super(oFile, iHeader, iNbrOutputDataSamples)
+
+        # The container of the mapped data, or nil if data is written in the file
+        # Object
+        @MappedData = nil
+        # Has the mapping been tried already ? It is created on the first write, as the header is written after the interface is initialized.
+        # Boolean
+        @MappingTried = false
+        # Positions in the file of the mapped data's beginning and end
+        # Integer
+        @MappedDataPos = nil
+        @MappedDataEndPos = nil
+
+        return rError
+      end
+
+      # Finalize writing.
+      # The mapping is released explicitly: samples written afterwards (padding) are written in the file.
+      #
+      # Return::
+      # * _Integer_: The number of samples written
+      def finalize
+        rNbrSamplesWritten = super
+
+        if (@MappedData != nil)
+          @IOUtils.unmapFile(@MappedData)
+          @MappedData = nil
+        end
+
+        return rNbrSamplesWritten
+      end
+
+      # Add a raw buffer computed by a C extension.
+      # If the samples fit in the mapped data, they are computed directly in it.
+      #
+      # Parameters::
+      # * *iNbrSamples* (_Integer_): Number of samples computed
+      # * *CodeBlock*: The code computing the samples:
+      #   * *iOutputMappedFile* (_Object_): The container of a mapped file to write samples into, or nil to return them
+      #   * *iOutputOffset* (_Integer_): Offset in the mapped file to write samples at, or nil
+      #   * Return::
+      #   * _String_: The computed raw buffer, or nil if it was written in the mapped file
+      def fillRawBuffer(iNbrSamples)
+        # First, flush eventually remaining buffer
+        if (!@Buffer.empty?)
+          flushBuffer
+        end
+        lPos = getMappedPos(iNbrSamples*@SampleSize)
+        if (lPos == nil)
+          super
+        else
+          yield(@MappedData, lPos - @MappedDataPos)
+          @File.seek(lPos + iNbrSamples*@SampleSize)
+          updateProgress(iNbrSamples)
+        end
+      end
+
+      # Add silent samples.
+      # Mapped data is already silent: it is just skipped.
+      #
+      # Parameters::
+      # * *iNbrSamples* (_Integer_): Number of silent samples
+      def pushSilence(iNbrSamples)
+        # First, flush eventually remaining buffer
+        if (!@Buffer.empty?)
+          flushBuffer
+        end
+        lPos = getMappedPos(iNbrSamples*@SampleSize)
+        if ((lPos == nil) or
+            (@Header.NbrBitsPerSample == 8))
+          super(iNbrSamples)
+        else
+          @File.seek(lPos + iNbrSamples*@SampleSize)
+          updateProgress(iNbrSamples)
+        end
+      end
+
+      private
+
+      # Write data in the file, at its current position.
+      # The part of it belonging to the mapped data is written in the mapping.
+      #
+      # Parameters::
+      # * *iData* (_String_): The data to write
+      def writeData(iData)
+        lPos = getMappedPos(0)
+        if (lPos == nil)
+          super(iData)
+        else
+          lMappedSize = [ iData.size, @MappedDataEndPos - lPos ].min
+          if (lMappedSize == iData.size)
+            @IOUtils.writeMappedFile(@MappedData, lPos - @MappedDataPos, iData)
+          else
+            @IOUtils.writeMappedFile(@MappedData, lPos - @MappedDataPos, iData[0, lMappedSize])
+          end
+          @File.seek(lPos + lMappedSize)
+          if (lMappedSize < iData.size)
+            # Samples exceeding the expected ones
+            super(iData[lMappedSize..-1])
+          end
+        end
+      end
+
+      # Get the current position in the file, if data of a given size begins in the mapped data.
+      # Map the data the first time it is called.
+      #
+      # Parameters::
+      # * *iSize* (_Integer_): Size of the data that has to fit in the mapped data. 0 just requires the current position to be in it.
+      # Return::
+      # * _Integer_: The current position in the file, or nil if the data is not in the mapped data
+      def getMappedPos(iSize)
+        rPos = nil
+
+        if (!@MappingTried)
+          mapData
+        end
+        if (@MappedData != nil)
+          lPos = @File.pos
+          if ((lPos >= @MappedDataPos) and
+              (lPos < @MappedDataEndPos) and
+              (lPos + iSize <= @MappedDataEndPos))
+            rPos = lPos
+          end
+        end
+
+        return rPos
+      end
+
+      # Allocate and map the whole data in memory.
+      # Only regular files opened for read and write can be mapped.
+      # Mapped data stays in the page cache: it is only mapped with the cache policy.
+      def mapData
+        @MappingTried = true
+        lDataSize = @NbrSamples*@SampleSize
+        if ((@IOUtils != nil) and
+            (@IOPolicy == 'cache') and
+            (lDataSize > 0) and
+            (@File.stat.file?))
+          begin
+            @File.flush
+            # Samples already written precede the current position
+            lPos = @File.pos - @NbrSamplesWritten*@SampleSize
+            @IOUtils.allocateFile(@File.fileno, lPos, lDataSize)
+            @MappedData = @IOUtils.mapFileForWrite(@File.fileno, lPos, lDataSize)
+            @MappedDataPos = lPos
+            @MappedDataEndPos = lPos + lDataSize
+            log_debug "Output data mapped in memory (#{lDataSize} bytes)"
+          rescue RuntimeError
+            log_debug "Unable to map output data in memory, it will be written: #{$!}"
+            @MappedData = nil
+          end
+        end
+      end
+
+    end
+
+  end
+
+end
@@ -5,15 +5,52 @@
 
 module WSK
 
-  # Class reading RIFF files
+  # Class reading RIFF files.
+  # RF64 files are also supported: 64 bits chunk sizes are read from their ds64 chunk.
+  # Chunks are indexed in a directory while they are looked for, and the directory is shared by all readers of the same file in this process.
   class RIFFReader
 
+    # Chunk size marking that the real size is stored in the ds64 chunk of RF64 files
+    #   Integer
+    RF64_SIZE_IN_DS64 = 0xFFFFFFFF
+
+    # Size of the blocks read from the file when indexing chunks.
+    # It is expressed in bytes.
+    #   Integer
+    SCAN_BLOCK_SIZE = 4096
+
+    # Maximal number of files whose directories are kept
+    #   Integer
+    MAX_NBR_DIRECTORIES = 64
+
     # Constructor
     #
     # Parameters::
     # * *iFile* (_IO_): File to read
     def initialize(iFile)
       @File = iFile
+      if (defined?(@@Directories) == nil)
+        # The directories of regular files, per file identity
+        # map< list<Object>, map<Symbol,Object> >
+        @@Directories = {}
+      end
+      lStat = @File.stat
+      if (lStat.file?)
+        # Files modified since they were indexed get a new directory
+        lFileKey = [ lStat.dev, lStat.ino, lStat.size, lStat.mtime ]
+        @Directory = @@Directories[lFileKey]
+        if (@Directory == nil)
+          @Directory = newDirectory
+          if (@@Directories.size == MAX_NBR_DIRECTORIES)
+            @@Directories.delete(@@Directories.keys.first)
+          end
+          @@Directories[lFileKey] = @Directory
+        else
+          log_debug 'Reuse RIFF chunks directory'
+        end
+      else
+        @Directory = newDirectory
+      end
     end
 
     # Position the file on the data associated to a given RIFF name
@@ -27,32 +64,115 @@ module WSK
       rError = nil
       rSize = nil
 
-      # Loop through the names until we find ours
-      @File.seek(12)
-      lRIFFName, rSize = @File.read(8).unpack('a4V')
-      lCurrentPos = 20
-      while (lRIFFName != nil)
-        if (lRIFFName == iRIFFName)
-          # We are positioned correctly
-          lRIFFName = nil
-          log_debug "Found RIFF chunk #{iRIFFName} of size #{rSize}"
-        else
-          log_debug "Skip RIFF chunk #{lRIFFName} of size #{rSize}"
-          # Go to the next chunk
-          @File.seek(lCurrentPos + rSize)
-          lData = @File.read(8)
-          lCurrentPos += rSize + 8
-          if (lData == nil)
-            # End of the file
-            rError = RuntimeError.new("End of file met: no RIFF #{iRIFFName} chunk found.")
-            lRIFFName = nil
-          else
-            lRIFFName, rSize = lData.unpack('a4V')
+      # Index chunks until we find ours
+      lChunks = @Directory[:Chunks]
+      while ((lChunks[iRIFFName] == nil) and
+             (@Directory[:NextChunkPos] != nil))
+        indexNextChunk
+      end
+      if (lChunks[iRIFFName] == nil)
+        rError = RuntimeError.new("End of file met: no RIFF #{iRIFFName} chunk found.")
+      else
+        lDataPos, rSize = lChunks[iRIFFName]
+        log_debug "Found RIFF chunk #{iRIFFName} of size #{rSize}"
+        @File.seek(lDataPos)
+      end
+
+      return rError, rSize
+    end
+
+    private
+
+    # Create a new directory, reading the beginning of the file
+    #
+    # Return::
+    # * <em>map<Symbol,Object></em>: The directory
+    def newDirectory
+      rDirectory = {
+        # The chunks indexed so far: position of their data and size, per RIFF name
+        # map< String, [ Integer, Integer ] >
+        :Chunks => {},
+        # The position of the next chunk to index, or nil if all were indexed
+        # Integer
+        :NextChunkPos => 12,
+        # The 64 bits chunk sizes of RF64 files, per RIFF name
+        # map< String, Integer >
+        :DS64Sizes => {},
+        # The last block read from the file, and its position
+        # String
+        :Block => nil,
+        # Integer
+        :BlockPos => nil
+      }
+      @Directory = rDirectory
+      if (readAt(0, 4) == 'RF64')
+        lRIFFName, lSize = readAt(12, 8).unpack('a4V')
+        if (lRIFFName == 'ds64')
+          lDS64Data = readAt(20, lSize)
+          # RIFF size, data size, number of samples and number of entries of the table
+          lRIFFSize, lDataSize, lNbrSamples, lNbrTableEntries = lDS64Data.unpack('Q<Q<Q<V')
+          rDirectory[:DS64Sizes]['data'] = lDataSize
+          lNbrTableEntries.times do |iIdxEntry|
+            lChunkName, lChunkSize = lDS64Data[28+iIdxEntry*12..39+iIdxEntry*12].unpack('a4Q<')
+            rDirectory[:DS64Sizes][lChunkName] = lChunkSize
           end
+          log_debug "RF64 chunk sizes: #{rDirectory[:DS64Sizes].inspect}"
         end
       end
 
-      return rError, rSize
+      return rDirectory
+    end
+
+    # Index the next chunk of the file
+    def indexNextChunk
+      lChunkPos = @Directory[:NextChunkPos]
+      lChunkHeader = readAt(lChunkPos, 8)
+      if ((lChunkHeader == nil) or
+          (lChunkHeader.size < 8))
+        # End of the file
+        @Directory[:NextChunkPos] = nil
+        @Directory[:Block] = nil
+      else
+        lRIFFName, lSize = lChunkHeader.unpack('a4V')
+        if ((lSize == RF64_SIZE_IN_DS64) and
+            (@Directory[:DS64Sizes][lRIFFName] != nil))
+          lSize = @Directory[:DS64Sizes][lRIFFName]
+        end
+        log_debug "Index RIFF chunk #{lRIFFName} of size #{lSize}"
+        # Only the first chunk of a given name is used
+        if (@Directory[:Chunks][lRIFFName] == nil)
+          @Directory[:Chunks][lRIFFName] = [ lChunkPos + 8, lSize ]
+        end
+        @Directory[:NextChunkPos] = lChunkPos + 8 + lSize
+      end
+    end
+
+    # Read data from the file, using the last block read if it contains it already
+    #
+    # Parameters::
+    # * *iPos* (_Integer_): Position of the data
+    # * *iSize* (_Integer_): Size of the data
+    # Return::
+    # * _String_: The data, or nil if the end of the file is met
+    def readAt(iPos, iSize)
+      rData = nil
+
+      lBlock = @Directory[:Block]
+      lBlockPos = @Directory[:BlockPos]
+      if ((lBlock == nil) or
+          (iPos < lBlockPos) or
+          (iPos + iSize > lBlockPos + lBlock.size))
+        @File.seek(iPos)
+        lBlock = @File.read((iSize > SCAN_BLOCK_SIZE) ? iSize : SCAN_BLOCK_SIZE)
+        lBlockPos = iPos
+        @Directory[:Block] = lBlock
+        @Directory[:BlockPos] = lBlockPos
+      end
+      if (lBlock != nil)
+        rData = lBlock[iPos - lBlockPos, iSize]
+      end
+
+      return rData
     end
 
   end
@@ -0,0 +1,152 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+module WSK
+
+  # Give file accesses to a stream that can't be seeked (pipes, terminals...).
+  # The beginning of the stream is kept in memory, so that headers can be read again.
+  # Seeking forward skips data, and seeking backward is only possible in the beginning of the stream that has been kept.
+  class StreamFile
+
+    # Size of the beginning of the stream that is kept in memory.
+    # It is expressed in bytes.
+    #   Integer
+    HISTORY_SIZE = 1048576
+
+    # Size of the blocks read when skipping data.
+    # It is expressed in bytes.
+    #   Integer
+    SKIP_BLOCK_SIZE = 65536
+
+    # Constructor
+    #
+    # Parameters::
+    # * *iIO* (_IO_): The stream to read
+    def initialize(iIO)
+      @IO = iIO
+      # The beginning of the stream already read
+      # String
+      @History = ''
+      @History.force_encoding('BINARY') if @History.respond_to?(:force_encoding)
+      # Number of bytes already read from the stream
+      # Integer
+      @StreamPos = 0
+      # Current position
+      # Integer
+      @Pos = 0
+    end
+
+    # Get the current position
+    #
+    # Return::
+    # * _Integer_: The current position
+    def pos
+      return @Pos
+    end
+
+    # Set the current position.
+    # Throws an exception if the position has already been read and is not kept anymore.
+    #
+    # Parameters::
+    # * *iPos* (_Integer_): The new position
+    # Return::
+    # * _Integer_: 0, as IO#seek
+    def seek(iPos)
+      checkPos(iPos)
+      @Pos = iPos
+
+      return 0
+    end
+
+    # Read data from the current position
+    #
+    # Parameters::
+    # * *iSize* (_Integer_): Number of bytes to read
+    # Return::
+    # * _String_: The data, or nil if the end of the stream was met, as IO#read
+    def read(iSize)
+      rData = nil
+
+      if (@Pos < @History.size)
+        # Begin with the data kept
+        rData = @History[@Pos, iSize]
+        @Pos += rData.size
+      end
+      if ((rData == nil) or
+          (rData.size < iSize))
+        checkPos(@Pos)
+        # Skip data up to the current position
+        while (@StreamPos < @Pos)
+          lSkippedData = readStream([ @Pos-@StreamPos, SKIP_BLOCK_SIZE ].min)
+          break if (lSkippedData == nil)
+        end
+        if (@StreamPos == @Pos)
+          lData = readStream(iSize - ((rData == nil) ? 0 : rData.size))
+          if (lData != nil)
+            @Pos += lData.size
+            if (rData == nil)
+              rData = lData
+            else
+              rData.concat(lData)
+            end
+          end
+        end
+      end
+
+      return rData
+    end
+
+    # Get the status of the stream
+    #
+    # Return::
+    # * <em>File::Stat</em>: The status
+    def stat
+      return @IO.stat
+    end
+
+    # Get the file descriptor of the stream
+    #
+    # Return::
+    # * _Integer_: The file descriptor
+    def fileno
+      return @IO.fileno
+    end
+
+    private
+
+    # Check that data from a given position can still be read.
+    # Throws an exception if it has already been read and is not kept anymore.
+    #
+    # Parameters::
+    # * *iPos* (_Integer_): The position
+    def checkPos(iPos)
+      if ((iPos >= @History.size) and
+          (iPos < @StreamPos))
+        raise RuntimeError.new("Can't seek back to position #{iPos} in a stream: only its first #{@History.size} bytes are kept, and #{@StreamPos} bytes were read already. Please use an action reading its data once, from the beginning to the end.")
+      end
+    end
+
+    # Read the next data of the stream, and keep it if it belongs to its beginning
+    #
+    # Parameters::
+    # * *iSize* (_Integer_): Number of bytes to read
+    # Return::
+    # * _String_: The data, or nil if the end of the stream was met
+    def readStream(iSize)
+      rData = @IO.read(iSize)
+
+      if (rData != nil)
+        if (@StreamPos < HISTORY_SIZE)
+          @History.concat(rData[0, HISTORY_SIZE-@StreamPos])
+        end
+        @StreamPos += rData.size
+      end
+
+      return rData
+    end
+
+  end
+
+end
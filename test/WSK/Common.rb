@@ -72,6 +72,132 @@ module WSKTest
       end
     end
 
+    # Generate a Wave file containing given samples
+    #
+    # Parameters::
+    # * *iHeader* (<em>WSK::Model::Header</em>): The header of the Wave file
+    # * *iSamples* (<em>list<Integer></em>): The values of the samples, channel after channel
+    # * _CodeBlock_: The code called once the Wave file is generated:
+    #   * *iWaveFileName* (_String_): The name of the generated Wave file
+    def genSamplesWave(iHeader, iSamples)
+      lTmpDir = "#{Dir.tmpdir}/WSKReg"
+      FileUtils::mkdir_p(lTmpDir)
+      lTempWaveFileName = "#{lTmpDir}/TmpSamplesWave_#{[ iHeader.NbrChannels, iHeader.SampleRate, iHeader.NbrBitsPerSample, iSamples ].hash}.wav"
+      if (!File.exists?(lTempWaveFileName))
+        File.open(lTempWaveFileName, 'wb') do |oFile|
+          writeHeader(oFile, iHeader, iSamples.size/iHeader.NbrChannels)
+          oFile.write(iHeader.getEncodedString(iSamples))
+        end
+      end
+      # Launch the test
+      begin
+        yield(lTempWaveFileName)
+      rescue Exception
+        log_err "Error: #{$!}\n#{$!.backtrace.join("\n")}\nFile \"#{lTempWaveFileName}\" can be used to investigate the error."
+        raise
+      end
+    end
+
+    # Get random samples: a sine over noise
+    #
+    # Parameters::
+    # * *iNbrSamples* (_Integer_): Number of samples
+    # * *iNbrChannels* (_Integer_): Number of channels
+    # * *iNbrBitsPerSample* (_Integer_): Number of bits per sample
+    # * *iSeed* (_Integer_): Seed of the noise [optional = 0]
+    # Return::
+    # * <em>list<Integer></em>: The values of the samples, channel after channel
+    def getRandomSamples(iNbrSamples, iNbrChannels, iNbrBitsPerSample, iSeed = 0)
+      lRandom = Random.new(iSeed)
+      lAmplitude = 2**(iNbrBitsPerSample-3)
+
+      return Array.new(iNbrSamples*iNbrChannels) do |iIdx|
+        (lAmplitude*Math.sin((iIdx/iNbrChannels)*2*Math::PI*(440+100*(iIdx%iNbrChannels))/44100) + lRandom.rand(-lAmplitude..lAmplitude)).round
+      end
+    end
+
+    # Set environment variables for a block of code.
+    # All WSK environment variables are restored afterwards, including the ones set by the command line.
+    #
+    # Parameters::
+    # * *iVariables* (<em>map<String,String></em>): The variables to set, or to remove if their value is nil [optional = {}]
+    # * _CodeBlock_: The code called with those variables
+    # Return::
+    # * _Object_: The result of the code block
+    def withEnv(iVariables = {})
+      lOldVariables = ENV.to_hash.select { |iName, iValue| iName.start_with?('WSK_') }
+      begin
+        iVariables.each do |iName, iValue|
+          if (iValue == nil)
+            ENV.delete(iName)
+          else
+            ENV[iName] = iValue
+          end
+        end
+        return yield
+      ensure
+        ENV.keys.each do |iName|
+          ENV.delete(iName) if (iName.start_with?('WSK_'))
+        end
+        lOldVariables.each do |iName, iValue|
+          ENV[iName] = iValue
+        end
+      end
+    end
+
+    # Run WSK with command line arguments.
+    # The output file is removed first if it exists.
+    #
+    # Parameters::
+    # * *iOutputFileName* (_String_): The output file name
+    # * *iArgs* (<em>list<String></em>): The other command line arguments
+    # * *iVariables* (<em>map<String,String></em>): Environment variables to set (see withEnv) [optional = {}]
+    # Return::
+    # * _Integer_: The error code returned by WSK
+    def runWSK(iOutputFileName, iArgs, iVariables = {})
+      File.unlink(iOutputFileName) if (File.exist?(iOutputFileName))
+
+      return withEnv(iVariables) do
+        next WSK::Launcher.new.execute([ '--output', iOutputFileName ] + iArgs)
+      end
+    end
+
+    # Read the samples of a Wave file
+    #
+    # Parameters::
+    # * *iFileName* (_String_): The Wave file name
+    # Return::
+    # * <em>WSK::Model::Header</em>: The header
+    # * <em>list<Integer></em>: The values of the samples, channel after channel
+    def readSamplesWave(iFileName)
+      rHeader = nil
+      rSamples = []
+
+      lError = accessInputWaveFile(iFileName) do |iInputHeader, iInputData|
+        rHeader = iInputHeader
+        iInputData.each_buffer do |iBuffer, iNbrSamples, iNbrChannels|
+          rSamples.concat(iBuffer)
+        end
+        next nil
+      end
+      raise lError if (lError != nil)
+
+      return rHeader, rSamples
+    end
+
+    # Get the name of a temporary file
+    #
+    # Parameters::
+    # * *iBaseName* (_String_): Base name of the file
+    # Return::
+    # * _String_: The file name
+    def getTmpFileName(iBaseName)
+      lTmpDir = "#{Dir.tmpdir}/WSKReg"
+      FileUtils::mkdir_p(lTmpDir)
+
+      return "#{lTmpDir}/#{iBaseName}"
+    end
+
   end
 
 end
@@ -0,0 +1,249 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'WSK/FFT'
+require 'WSK/FFTUtils/FFTUtils'
+
+module WSKTest
+
+  class FFT < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+    include WSK::FFT
+
+    # Compute the FFT profile of samples, in several buffers
+    #
+    # Parameters::
+    # * *iHeader* (<em>WSK::Model::Header</em>): Header of the samples
+    # * *iSamples* (<em>list<Integer></em>): The samples, interleaved
+    # * *iUseTrigoCache* (_Boolean_): Do we use the trigonometric cache ? [optional = false]
+    # Return::
+    # * <em>[Integer,Integer,list<list<Integer>>]</em>: The FFT profile
+    def computeFFTProfile(iHeader, iSamples, iUseTrigoCache = false)
+      lFFTComputing = WSK::FFT::FFTComputing.new(iUseTrigoCache, iHeader)
+      lNbrSamples = iSamples.size/iHeader.NbrChannels
+      [ 0, lNbrSamples/4, lNbrSamples/2, lNbrSamples ].each_cons(2) do |iIdxBeginSample, iIdxEndSample|
+        lFFTComputing.completeFFT(iHeader.getEncodedString(iSamples[iIdxBeginSample*iHeader.NbrChannels...iIdxEndSample*iHeader.NbrChannels]), iIdxEndSample-iIdxBeginSample)
+      end
+
+      return lFFTComputing.getFFTProfile
+    end
+
+    # Test that FFT engines give FFT profiles close to exact ones
+    def testEngines
+      [ 16, 24 ].each do |iNbrBitsPerSample|
+        lHeader = WSK::Model::Header.new(1, 2, 44100, iNbrBitsPerSample)
+        lSamples = getRandomSamples(4410, 2, iNbrBitsPerSample)
+        lExactProfile = withEnv('WSK_FFT_ENGINE' => 'exact') { computeFFTProfile(lHeader, lSamples) }
+        assert_equal(lExactProfile, withEnv('WSK_FFT_ENGINE' => nil) { computeFFTProfile(lHeader, lSamples) })
+        lExactCoeffs = lExactProfile[2].flatten
+        lMaxCoeff = lExactCoeffs.max
+        # Maximal differences with exact coefficients, relatively to the biggest one
+        {
+          'phasor' => 1e-6,
+          'goertzel' => 1e-3
+        }.each do |iEngine, iTolerance|
+          lProfile = withEnv('WSK_FFT_ENGINE' => iEngine) { computeFFTProfile(lHeader, lSamples) }
+          assert_equal(lExactProfile[0..1], lProfile[0..1])
+          assert_equal(lExactProfile[2].map { |iChannelCoeffs| iChannelCoeffs.size }, lProfile[2].map { |iChannelCoeffs| iChannelCoeffs.size })
+          lMaxDifference = lProfile[2].flatten.zip(lExactCoeffs).map { |iCoeff, iExactCoeff| (iCoeff-iExactCoeff).abs }.max
+          assert(lMaxDifference <= lMaxCoeff*iTolerance, "#{iEngine} coefficients differ from exact ones by #{lMaxDifference} (maximal coefficient: #{lMaxCoeff}) on #{iNbrBitsPerSample} bits")
+        end
+      end
+    end
+
+    # Test that FFT profiles computed with the trigo cache are the exact ones
+    def testTrigoCacheProfiles
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lNbrSamplesFFT = 44100/FFTSAMPLE_FREQ
+      [ 8, 16, 24 ].each do |iNbrBitsPerSample|
+        lHeader = WSK::Model::Header.new(1, 2, 44100, iNbrBitsPerSample)
+        # Noise of low level, as measured on silences, and signals
+        lRandom = Random.new(0)
+        [
+          Array.new(lNbrSamplesFFT*2) { lRandom.rand(-7..7) },
+          getRandomSamples(lNbrSamplesFFT, 2, iNbrBitsPerSample)
+        ].each do |iSamples|
+          lExactProfile = withEnv('WSK_FFT_ENGINE' => 'exact') { computeFFTProfile(lHeader, iSamples) }
+          lCachedProfile = computeFFTProfile(lHeader, iSamples, true)
+          assert_equal(lExactProfile, lCachedProfile, "FFT profiles differ on #{iNbrBitsPerSample} bits")
+          assert_equal(0, lFFTUtils.distFFTProfiles(lFFTUtils.createCFFTProfile(lExactProfile), lFFTUtils.createCFFTProfile(lCachedProfile), FFTDIST_MAX))
+        end
+      end
+    end
+
+    # Test that sliding FFTs give the FFT profiles of the windows they slide to, forwards and backwards
+    def testSlidingFFT
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lNbrFreq = FREQINDEX_LAST - FREQINDEX_FIRST + 1
+      lW = lFFTUtils.createWi(FREQINDEX_FIRST, FREQINDEX_LAST, lHeader.SampleRate)
+      lNbrSamplesFFT = lHeader.SampleRate/FFTSAMPLE_FREQ
+      # Windows slide over more FFT samples than the FFT searches do before resetting their sums
+      lNbrSlidFFTSamples = 24
+      lSamples = getRandomSamples(lNbrSamplesFFT*(lNbrSlidFFTSamples+1), 2, 16)
+      lSlidingFFT = lFFTUtils.initSlidingFFT(lW, lNbrFreq, 2, 16)
+      lResetSlidingFFT = lFFTUtils.initSlidingFFT(lW, lNbrFreq, 2, 16)
+      [ lNbrSamplesFFT, lNbrSamplesFFT/10 ].each do |iNbrSamplesHop|
+        [ false, true ].each do |iBackwards|
+          lIdxBeginSample = (iBackwards) ? lNbrSamplesFFT*lNbrSlidFFTSamples : 0
+          lFFTUtils.resetSlidingFFT(lSlidingFFT, lHeader.getEncodedString(lSamples[lIdxBeginSample*2...(lIdxBeginSample+lNbrSamplesFFT)*2]), lNbrSamplesFFT)
+          lNbrSlidFFTSamples.times do |iIdxFFTSample|
+            (lNbrSamplesFFT/iNbrSamplesHop).times do
+              if (iBackwards)
+                lFFTUtils.slideSlidingFFT(lSlidingFFT, lHeader.getEncodedString(lSamples[(lIdxBeginSample-iNbrSamplesHop)*2...(lIdxBeginSample+lNbrSamplesFFT)*2]), iNbrSamplesHop, true)
+                lIdxBeginSample -= iNbrSamplesHop
+              else
+                lFFTUtils.slideSlidingFFT(lSlidingFFT, lHeader.getEncodedString(lSamples[lIdxBeginSample*2...(lIdxBeginSample+lNbrSamplesFFT+iNbrSamplesHop)*2]), iNbrSamplesHop, false)
+                lIdxBeginSample += iNbrSamplesHop
+              end
+            end
+            lWindowSamples = lSamples[lIdxBeginSample*2...(lIdxBeginSample+lNbrSamplesFFT)*2]
+            lProfile = lFFTUtils.getSlidingFFTProfile(lSlidingFFT)
+            # Sums computed directly on the window, in floating point
+            lFFTUtils.resetSlidingFFT(lResetSlidingFFT, lHeader.getEncodedString(lWindowSamples), lNbrSamplesFFT)
+            lResetProfile = lFFTUtils.getSlidingFFTProfile(lResetSlidingFFT)
+            assert_equal(lResetProfile[0..1], lProfile[0..1])
+            lMaxCoeff = lResetProfile[2].flatten.max
+            lMaxDifference = lProfile[2].flatten.zip(lResetProfile[2].flatten).map { |iCoeff, iResetCoeff| (iCoeff-iResetCoeff).abs }.max
+            assert(lMaxDifference <= lMaxCoeff*1e-9, "Sliding FFT coefficients differ from the window's ones by #{lMaxDifference} (maximal coefficient: #{lMaxCoeff}) after #{iIdxFFTSample+1} FFT samples slid by hops of #{iNbrSamplesHop} samples (backwards: #{iBackwards})")
+            # Exact FFT profile of the window, whose trigonometric values are rounded to floats
+            if (iNbrSamplesHop == lNbrSamplesFFT)
+              lExactProfile = withEnv('WSK_FFT_ENGINE' => 'exact') { computeFFTProfile(lHeader, lWindowSamples) }
+              assert_equal(lExactProfile[0..1], lProfile[0..1])
+              lMaxDifference = lProfile[2].flatten.zip(lExactProfile[2].flatten).map { |iCoeff, iExactCoeff| (iCoeff-iExactCoeff).abs }.max
+              assert(lMaxDifference <= lMaxCoeff*1e-3, "Sliding FFT coefficients differ from exact ones by #{lMaxDifference} (maximal coefficient: #{lMaxCoeff}) after #{iIdxFFTSample+1} FFT samples (backwards: #{iBackwards})")
+            end
+          end
+        end
+      end
+    end
+
+    # Test that silences are found with FFT samples overlapping by small hops
+    def testCutFirstSignalHops
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lRandom = Random.new(0)
+      # Silence is a hum under low noise, that is within thresholds
+      lSilenceSamples = lambda { |iNbrSamples| Array.new(iNbrSamples*2) { |iIdx| (200*Math.sin((iIdx/2)*2*Math::PI*100/44100)).round + lRandom.rand(-20..20) } }
+      # Low signal is within thresholds too, but differs from silence by its FFT
+      lLowSignalSamples = lambda { |iNbrSamples| Array.new(iNbrSamples*2) { |iIdx| (300*Math.sin((iIdx/2)*2*Math::PI*1000/44100)).round + lRandom.rand(-20..20) } }
+      lIdxLowSignalSample = 187425
+      lIdxSignalSample = 220500
+      lSamples = lSilenceSamples.call(22050) + getRandomSamples(44100, 2, 16) + lLowSignalSamples.call(33075) + lSilenceSamples.call(88200) + lLowSignalSamples.call(lIdxSignalSample-lIdxLowSignalSample) + getRandomSamples(44100, 2, 16)
+      lNoiseFFTFileName = nil
+      genSamplesWave(lHeader, lSilenceSamples.call(44100)) do |iWaveFileName|
+        lTmpDir = File.dirname(getTmpFileName('fft.result'))
+        Dir.chdir(lTmpDir) do
+          assert_equal(0, runWSK(getTmpFileName('FFT_NoiseFFT.wav'), [ '--input', iWaveFileName, '--action', 'FFT' ]))
+        end
+        lNoiseFFTFileName = "#{lTmpDir}/fft.result"
+      end
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('FFT_CutFirstSignalHops.wav')
+        lCutSamples = {}
+        # Hops of 1 window, and of less than 1 window: FFT samples are then slid more than the number of FFT samples after which sums are reset
+        [ nil, '100', '10', '1' ].each do |iFFTHop|
+          assert_equal(0, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'CutFirstSignal', '--', '--silencethreshold', '500', '--noisefft', lNoiseFFTFileName, '--silencemin', '1s' ], 'WSK_FFT_HOP' => iFFTHop))
+          lOutputHeader, lOutputSamples = readSamplesWave(lOutputFileName)
+          assert_equal(lHeader, lOutputHeader)
+          lIdxCutSample = (lSamples.size-lOutputSamples.size)/2
+          assert(lIdxCutSample >= lIdxLowSignalSample-lHeader.SampleRate/FFTSAMPLE_FREQ, "Cut at sample #{lIdxCutSample} with a hop of #{iFFTHop} ms removed part of the silence")
+          assert(lIdxCutSample <= lIdxSignalSample, "Cut at sample #{lIdxCutSample} with a hop of #{iFFTHop} ms removed part of the signal")
+          assert_equal(lSamples[lIdxCutSample*2..-1], lOutputSamples)
+          lCutSamples[iFFTHop] = lIdxCutSample
+        end
+        # A hop of 1 window is the default one
+        assert_equal(lCutSamples[nil], lCutSamples['100'])
+        # The --ffthop option is the same as the environment variable
+        assert_equal(0, runWSK(lOutputFileName, [ '--ffthop', '10', '--input', iWaveFileName, '--action', 'CutFirstSignal', '--', '--silencethreshold', '500', '--noisefft', lNoiseFFTFileName, '--silencemin', '1s' ]))
+        assert_equal(lSamples[lCutSamples['10']*2..-1], readSamplesWave(lOutputFileName)[1])
+      end
+    end
+
+    # Test that unknown FFT engines are refused
+    def testUnknownEngine
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      withEnv('WSK_FFT_ENGINE' => 'fast') do
+        assert_raise(RuntimeError) { computeFFTProfile(lHeader, [0]*20) }
+      end
+      genSamplesWave(lHeader, getRandomSamples(100, 2, 16)) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('FFT_UnknownEngine.wav')
+        assert_equal(1, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'FFT' ], 'WSK_FFT_ENGINE' => 'fast'))
+        assert_equal(1, runWSK(lOutputFileName, [ '--fftengine', 'fast', '--input', iWaveFileName, '--action', 'FFT' ]))
+      end
+    end
+
+    # Test that C FFT profiles are created only from valid FFT profiles
+    def testCFFTProfileInvalid
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 100, []]) }
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 100, [[]]]) }
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 100, [nil]]) }
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 100, [[1, 2], [3]]]) }
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 100, [[1, 2], 3]]) }
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 0, [[1, 2]]]) }
+      assert_raise(RuntimeError) { lFFTUtils.createCFFTProfile([16, 100]) }
+    end
+
+    # Test that FFT profiles are compared only with FFT values of the same dimensions
+    def testCFFTProfileDimensions
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lStereoProfile = lFFTUtils.createCFFTProfile([16, 100, [[1, 2], [3, 4]]])
+      assert_equal(0, lFFTUtils.distFFTProfiles(lStereoProfile, lStereoProfile, FFTDIST_MAX))
+      assert_raise(RuntimeError) { lFFTUtils.distFFTProfiles(lStereoProfile, lFFTUtils.createCFFTProfile([16, 100, [[1], [3]]]), FFTDIST_MAX) }
+      assert_raise(RuntimeError) { lFFTUtils.distFFTProfiles(lFFTUtils.createCFFTProfile([16, 100, [[1], [3]]]), lStereoProfile, FFTDIST_MAX) }
+      assert_raise(RuntimeError) { lFFTUtils.distFFTProfiles(lStereoProfile, lFFTUtils.createCFFTProfile([16, 100, [[1, 2], [3, 4], [5, 6]]]), FFTDIST_MAX) }
+      # Sliding FFTs
+      lSlidingFFT = lFFTUtils.initSlidingFFT(lFFTUtils.createWi(0, 1, 44100), 2, 2, 16)
+      assert_raise(RuntimeError) { lFFTUtils.distSlidingFFTProfile(lStereoProfile, lSlidingFFT, FFTDIST_MAX) }
+      lFFTUtils.resetSlidingFFT(lSlidingFFT, WSK::Model::Header.new(1, 2, 44100, 16).getEncodedString(getRandomSamples(100, 2, 16)), 100)
+      assert_equal(lFFTUtils.distFFTProfiles(lStereoProfile, lFFTUtils.createCFFTProfile(lFFTUtils.getSlidingFFTProfile(lSlidingFFT)), FFTDIST_MAX), lFFTUtils.distSlidingFFTProfile(lStereoProfile, lSlidingFFT, FFTDIST_MAX))
+      assert_raise(RuntimeError) { lFFTUtils.distSlidingFFTProfile(lFFTUtils.createCFFTProfile([16, 100, [[1], [3]]]), lSlidingFFT, FFTDIST_MAX) }
+      assert_raise(RuntimeError) { lFFTUtils.distSlidingFFTProfile(lFFTUtils.createCFFTProfile([16, 100, [[1, 2]]]), lSlidingFFT, FFTDIST_MAX) }
+    end
+
+    # Test that FFT searches refuse reference profiles having other frequencies or channels than the searched data
+    def testFFTSearchDimensions
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lFFTComputing = WSK::FFT::FFTComputing.new(true, lHeader)
+      lNbrFreq = FREQINDEX_LAST - FREQINDEX_FIRST + 1
+      lStereoProfile = lFFTUtils.createCFFTProfile([16, 4410, [[1, 2]]*lNbrFreq])
+      lMonoProfile = lFFTUtils.createCFFTProfile([16, 4410, [[1]]*lNbrFreq])
+      lFewFreqProfile = lFFTUtils.createCFFTProfile([16, 4410, [[1, 2]]*(lNbrFreq-1)])
+      [ 4410, 441 ].each do |iNbrSamplesHop|
+        assert_not_nil(lFFTComputing.initFFTSearch(lStereoProfile, [[-100, 100]]*2, 0, 44099, false, iNbrSamplesHop, 0, 0))
+        assert_raise(RuntimeError) { lFFTComputing.initFFTSearch(lMonoProfile, [[-100, 100]]*2, 0, 44099, false, iNbrSamplesHop, 0, 0) }
+        assert_raise(RuntimeError) { lFFTComputing.initFFTSearch(lFewFreqProfile, [[-100, 100]]*2, 0, 44099, false, iNbrSamplesHop, 0, 0) }
+        assert_raise(RuntimeError) { lFFTComputing.initFFTSearch(lStereoProfile, [[-100, 100]], 0, 44099, false, iNbrSamplesHop, 0, 0) }
+        assert_raise(RuntimeError) { WSK::FFT::FFTComputing.new(false, lHeader).initFFTSearch(lStereoProfile, [[-100, 100]]*2, 0, 44099, false, iNbrSamplesHop, 0, 0) }
+      end
+    end
+
+    # Test that FFT searches stop when windows read don't contain the needed samples
+    def testFFTSearchNoProgress
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      genSamplesWave(lHeader, getRandomSamples(44100, 2, 16)) do |iWaveFileName|
+        accessInputWaveFile(iWaveFileName) do |iInputHeader, iInputData|
+          lFFTComputing = WSK::FFT::FFTComputing.new(false, iInputHeader)
+          iInputData.each_raw_buffer(0, 4409) do |iInputRawBuffer, iNbrSamples, iNbrChannels|
+            lFFTComputing.completeFFT(iInputRawBuffer, iNbrSamples)
+          end
+          lFFTProfile = lFFTComputing.getFFTProfile
+          # Windows truncated to 100 samples
+          def iInputData.get_raw_window(iIdxFirstSample, iIdxLastSample, iOptions = {})
+            return super(iIdxFirstSample, [ iIdxLastSample, iIdxFirstSample + 99 ].min, iOptions)
+          end
+          assert_raise(RuntimeError) { getNextFFTSample(0, lFFTProfile, iInputData, 0, [[-2**15, 2**15-1]]*2, false, 44099) }
+          assert_raise(RuntimeError) { getNextFFTSample(44099, lFFTProfile, iInputData, 0, [[-2**15, 2**15-1]]*2, true, 0) }
+          next nil
+        end
+      end
+    end
+
+  end
+
+end
@@ -0,0 +1,117 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+module WSKTest
+
+  class IOPolicies < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Run an Action with each page cache policy, and check that their outputs are the same
+    #
+    # Parameters::
+    # * *iWaveFileName* (_String_): The input file name
+    # * *iAction* (_String_): The Action name
+    # * *iActionArgs* (<em>list<String></em>): The Action arguments
+    # Return::
+    # * _String_: The output data, the same for all policies
+    def getIOPoliciesOutput(iWaveFileName, iAction, iActionArgs)
+      rOutput = nil
+
+      lOutputFileName = getTmpFileName("IOPolicies_#{iAction}.wav")
+      # The default policy, given by the Action or the environment variable, then each policy given on the command line
+      [
+        [ [], {} ],
+        [ [], { 'WSK_IO_POLICY' => 'dontneed' } ],
+        [ [ '--iopolicy', 'cache' ], {} ],
+        [ [ '--iopolicy', 'dontneed' ], {} ],
+        [ [ '--iopolicy', 'direct' ], {} ],
+        [ [ '--iopolicy', 'direct', '--blocksize', '300' ], { 'WSK_IO_POLICY' => 'cache' } ]
+      ].each do |iLauncherArgs, iVariables|
+        assert_equal(0, runWSK(lOutputFileName, iLauncherArgs + [ '--input', iWaveFileName, '--action', iAction, '--' ] + iActionArgs, iVariables))
+        lOutput = File.binread(lOutputFileName)
+        if (rOutput == nil)
+          rOutput = lOutput
+        else
+          assert_equal(rOutput, lOutput)
+        end
+      end
+
+      return rOutput
+    end
+
+    # Test that Actions writing samples directly, by ranges or as silence give the same outputs with each page cache policy
+    def testIOPoliciesDirectStream
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(5000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('IOPolicies_Output.wav')
+        File.binwrite(lOutputFileName, getIOPoliciesOutput(iWaveFileName, 'Cut', [ '--begin', '101', '--end', '4100' ]))
+        assert_equal([ lHeader, lSamples[202..8201] ], readSamplesWave(lOutputFileName))
+        File.binwrite(lOutputFileName, getIOPoliciesOutput(iWaveFileName, 'SilenceInserter', [ '--begin', '20000', '--end', '10' ]))
+        assert_equal([ lHeader, [0]*40000 + lSamples + [0]*20 ], readSamplesWave(lOutputFileName))
+        File.binwrite(lOutputFileName, getIOPoliciesOutput(iWaveFileName, 'DCShifter', [ '--offset', '-1' ]))
+        assert_equal([ lHeader, lSamples.map { |iValue| [ iValue-1, -32768 ].max } ], readSamplesWave(lOutputFileName))
+      end
+    end
+
+    # Test that Actions whose output is mapped in memory with the cache policy give the same outputs with each page cache policy
+    def testIOPoliciesMappedFile
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 24)
+      lSamples = getRandomSamples(5000, 2, 24)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('IOPolicies_Output.wav')
+        File.binwrite(lOutputFileName, getIOPoliciesOutput(iWaveFileName, 'Multiply', [ '--coeff', '1/1' ]))
+        assert_equal([ lHeader, lSamples ], readSamplesWave(lOutputFileName))
+        getIOPoliciesOutput(iWaveFileName, 'Multiply', [ '--coeff', '2/3' ])
+      end
+    end
+
+    # Test that the Analyze Action, scanning its input with the direct policy by default, gives the same results with each page cache policy
+    def testIOPoliciesAnalyze
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(5000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lAnalyzeFileName = getTmpFileName('IOPolicies_Analyze.wav')
+        lResults = []
+        Dir.chdir(File.dirname(lAnalyzeFileName)) do
+          [ [], [ '--iopolicy', 'cache' ], [ '--iopolicy', 'dontneed' ], [ '--iopolicy', 'direct' ] ].each do |iLauncherArgs|
+            File.unlink('analyze.result') if (File.exist?('analyze.result'))
+            assert_equal(0, runWSK(lAnalyzeFileName, iLauncherArgs + [ '--input', iWaveFileName, '--action', 'Analyze' ]))
+            lResults << File.open('analyze.result', 'rb') { |iFile| Marshal.load(iFile.read) }
+          end
+          File.unlink('analyze.result')
+        end
+        assert_equal(5000, lResults[0][:NbrDataSamples])
+        assert_equal([ 0, 1 ].map { |iIdxChannel| lSamples.values_at(*(iIdxChannel...10000).step(2).to_a).max }, lResults[0][:MaxValues])
+        lResults[1..-1].each do |iResult|
+          assert_equal(lResults[0], iResult)
+        end
+      end
+    end
+
+    # Test that the page cache policy of an Action is not kept for the next Actions run in the same process
+    def testIOPolicyOfAction
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      genSamplesWave(lHeader, getRandomSamples(5000, 2, 16)) do |iWaveFileName|
+        lAnalyzeFileName = getTmpFileName('IOPolicies_Analyze.wav')
+        Dir.chdir(File.dirname(lAnalyzeFileName)) do
+          [ nil, 'dontneed' ].each do |iIOPolicy|
+            withEnv('WSK_IO_POLICY' => iIOPolicy) do
+              File.unlink(lAnalyzeFileName) if (File.exist?(lAnalyzeFileName))
+              # Not using runWSK, as it restores the environment itself
+              assert_equal(0, WSK::Launcher.new.execute([ '--input', iWaveFileName, '--output', lAnalyzeFileName, '--action', 'Analyze' ]))
+              assert_equal(iIOPolicy, ENV['WSK_IO_POLICY'])
+            end
+          end
+          File.unlink('analyze.result')
+        end
+      end
+    end
+
+  end
+
+end
@@ -0,0 +1,136 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+module WSKTest
+
+  class InputData < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Test that threads reading buffers ahead are stopped once input files are released
+    def testReadAheadThreadStopped
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      genSamplesWave(lHeader, getRandomSamples(1000, 2, 16)) do |iWaveFileName|
+        withEnv('WSK_BLOCK_SIZE' => '100', 'WSK_READ_AHEAD' => '2') do
+          lNbrThreads = Thread.list.size
+          3.times do
+            accessInputWaveFile(iWaveFileName) do |iInputHeader, iInputData|
+              iInputData.each_raw_buffer do |iRawBuffer, iNbrSamples, iNbrChannels|
+              end
+              assert_equal(lNbrThreads+1, Thread.list.size)
+              next nil
+            end
+            assert_equal(lNbrThreads, Thread.list.size)
+          end
+        end
+      end
+    end
+
+    # Test that buffers read ahead give the same samples as buffers read synchronously, whatever the iteration
+    def testReadAheadBuffers
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(1000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        [ 'cache', 'dontneed' ].each do |iIOPolicy|
+          [
+            [ { 'WSK_READ_AHEAD' => '0' }, false ],
+            [ { 'WSK_READ_AHEAD' => nil }, true ],
+            [ { 'WSK_READ_AHEAD' => '3' }, true ],
+            # Memory is too small to read buffers ahead
+            [ { 'WSK_READ_AHEAD' => '3', 'WSK_READ_AHEAD_MEMORY' => '0' }, false ]
+          ].each do |iReadAheadVariables, iReadAhead|
+            withEnv({ 'WSK_BLOCK_SIZE' => '100', 'WSK_IO_POLICY' => iIOPolicy }.merge(iReadAheadVariables)) do
+              lNbrThreads = Thread.list.size
+              accessInputWaveFile(iWaveFileName) do |iInputHeader, iInputData|
+                # Whole file, then a range, forwards and backwards
+                [ [ 0, 999 ], [ 123, 876 ] ].each do |iIdxFirstSample, iIdxLastSample|
+                  lExpectedRawBuffer = lHeader.getEncodedString(lSamples[iIdxFirstSample*2..iIdxLastSample*2+1])
+                  lRawBuffers = []
+                  iInputData.each_raw_buffer(iIdxFirstSample, iIdxLastSample) do |iRawBuffer, iNbrSamples, iNbrChannels|
+                    assert_equal(iNbrSamples*4, iRawBuffer.size)
+                    lRawBuffers << iRawBuffer.dup
+                  end
+                  assert_equal(lExpectedRawBuffer, lRawBuffers.join, "Forward buffers differ with #{iReadAheadVariables.inspect} and #{iIOPolicy} IO policy")
+                  lRawBuffers = []
+                  iInputData.each_reverse_raw_buffer(iIdxFirstSample, iIdxLastSample) do |iRawBuffer, iNbrSamples, iNbrChannels|
+                    assert_equal(iNbrSamples*4, iRawBuffer.size)
+                    lRawBuffers << iRawBuffer.dup
+                  end
+                  assert_equal(lExpectedRawBuffer, lRawBuffers.reverse.join, "Reverse buffers differ with #{iReadAheadVariables.inspect} and #{iIOPolicy} IO policy")
+                end
+                # Iterations stopped before buffers read ahead are used, and windows read meanwhile
+                lIdxSample = 500
+                iInputData.each_raw_buffer(lIdxSample) do |iRawBuffer, iNbrSamples, iNbrChannels|
+                  assert_equal(lHeader.getEncodedString(lSamples[lIdxSample*2...(lIdxSample+iNbrSamples)*2]), iRawBuffer)
+                  assert_equal(lHeader.getEncodedString(lSamples[20..61]), iInputData.get_raw_window(10, 30).dup)
+                  lIdxSample += iNbrSamples
+                  break if (lIdxSample > 700)
+                end
+                lIdxSample = 400
+                iInputData.each_reverse_raw_buffer(0, lIdxSample-1) do |iRawBuffer, iNbrSamples, iNbrChannels|
+                  assert_equal(lHeader.getEncodedString(lSamples[(lIdxSample-iNbrSamples)*2...lIdxSample*2]), iRawBuffer)
+                  lIdxSample -= iNbrSamples
+                end
+                assert_equal(0, lIdxSample)
+                # Buffers are read ahead by a background thread
+                assert_equal((iReadAhead) ? lNbrThreads+1 : lNbrThreads, Thread.list.size)
+                next nil
+              end
+            end
+          end
+        end
+      end
+    end
+
+    # Test that invalid block sizes are ignored by readers
+    def testInvalidBlockSize
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(1000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        [ '0', '-5', 'abc' ].each do |iBlockSize|
+          withEnv('WSK_BLOCK_SIZE' => iBlockSize) do
+            assert_equal([ lHeader, lSamples ], readSamplesWave(iWaveFileName))
+          end
+        end
+      end
+    end
+
+    # Test that the command line refuses invalid block sizes
+    def testInvalidBlockSizeCommandLine
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      genSamplesWave(lHeader, getRandomSamples(1000, 2, 16)) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('InputData_InvalidBlockSize.wav')
+        assert_equal(1, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'Cut', '--', '--begin', '0', '--end', '10' ], 'WSK_BLOCK_SIZE' => '0'))
+        assert_equal(1, runWSK(lOutputFileName, [ '--blocksize', '-1', '--input', iWaveFileName, '--action', 'Cut', '--', '--begin', '0', '--end', '10' ]))
+        assert(!File.exist?(lOutputFileName))
+      end
+    end
+
+    # Test that windows copied for threads that are dead are released
+    def testWindowsOfDeadThreadsReleased
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(1000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        # Windows are copied from buffers read from the file
+        withEnv('WSK_BLOCK_SIZE' => '100', 'WSK_IO_POLICY' => 'dontneed') do
+          accessInputWaveFile(iWaveFileName) do |iInputHeader, iInputData|
+            5.times do |iIdxThread|
+              Thread.new do
+                lIdxFirstSample = iIdxThread*100 + 10
+                assert_equal(lHeader.getEncodedString(lSamples[lIdxFirstSample*2..(lIdxFirstSample+20)*2+1]), iInputData.get_raw_window(lIdxFirstSample, lIdxFirstSample+20, :nbr_samples_prefetch => 50))
+              end.join
+            end
+            iInputData.get_raw_window(10, 30, :nbr_samples_prefetch => 50)
+            assert(iInputData.instance_variable_get(:@RawReader).instance_variable_get(:@Windows).size <= 2)
+            next nil
+          end
+        end
+      end
+    end
+
+  end
+
+end
@@ -0,0 +1,76 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+module WSKTest
+
+  class LargeFiles < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Size of the data of the large file, in bytes
+    #   Integer
+    LARGE_DATA_SIZE = 6*1024*1024*1024
+
+    # Test that a 6 GB file is streamed through Analyze and Cut.
+    # The file is sparse: only a few samples are written after the 4 GB limit.
+    # Run only if WSK_TEST_LARGE_FILES=1 (see test/run.rb), as filesystems without sparse files need 6 GB of free space.
+    def testAnalyzeCutRF64
+      lHeader = WSK::Model::Header.new(1, 2, 96000, 24)
+      lSampleSize = 6
+      lNbrSamples = LARGE_DATA_SIZE/lSampleSize
+      # Index of the samples set after 4 GB
+      lIdxMarkedSample = 4294967296/lSampleSize + 1000
+      lTmpDir = "#{Dir.tmpdir}/WSKReg"
+      FileUtils::mkdir_p(lTmpDir)
+      lLargeFileName = "#{lTmpDir}/Large_RF64.wav"
+      lCutFileName = "#{lTmpDir}/Large_RF64_Cut.wav"
+      lAnalyzeFileName = "#{lTmpDir}/Large_RF64_Analyze.wav"
+      [ lLargeFileName, lCutFileName, lAnalyzeFileName ].each do |iFileName|
+        File.unlink(iFileName) if (File.exist?(iFileName))
+      end
+      begin
+        # Generate the file without writing its data
+        File.open(lLargeFileName, 'wb') do |oFile|
+          assert_equal(nil, writeHeader(oFile, lHeader, lNbrSamples))
+          lFirstSampleFilePos = oFile.pos
+          oFile.seek(lFirstSampleFilePos + lIdxMarkedSample*lSampleSize)
+          oFile.write(lHeader.getEncodedString([8388607, -8388608, -1, 1]))
+          oFile.truncate(lFirstSampleFilePos + LARGE_DATA_SIZE)
+        end
+        File.open(lLargeFileName, 'rb') do |iFile|
+          assert_equal('RF64', iFile.read(4))
+        end
+        # Analyze it
+        Dir.chdir(lTmpDir) do
+          File.unlink('analyze.result') if (File.exist?('analyze.result'))
+          assert_equal(0, WSK::Launcher.new.execute([ '--input', lLargeFileName, '--output', lAnalyzeFileName, '--action', 'Analyze' ]))
+          lResult = File.open('analyze.result', 'rb') { |iFile| Marshal.load(iFile.read) }
+          assert_equal(lNbrSamples, lResult[:NbrDataSamples])
+          assert_equal([8388607, 1], lResult[:MaxValues])
+          assert_equal([-1, -8388608], lResult[:MinValues])
+        end
+        # Cut the samples after 4 GB
+        assert_equal(0, WSK::Launcher.new.execute([ '--input', lLargeFileName, '--output', lCutFileName, '--action', 'Cut', '--', '--begin', (lIdxMarkedSample-1).to_s, '--end', (lIdxMarkedSample+2).to_s ]))
+        accessInputWaveFile(lCutFileName) do |iInputHeader, iInputData|
+          assert_equal(lHeader, iInputHeader)
+          assert_equal(4, iInputData.NbrSamples)
+          lValues = []
+          iInputData.each do |iSampleData|
+            lValues.concat(iSampleData)
+          end
+          assert_equal([0, 0, 8388607, -8388608, -1, 1, 0, 0], lValues)
+          next nil
+        end
+      ensure
+        [ lLargeFileName, lCutFileName, lAnalyzeFileName ].each do |iFileName|
+          File.unlink(iFileName) if (File.exist?(iFileName))
+        end
+      end
+    end
+
+  end
+
+end
@@ -0,0 +1,158 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+module WSKTest
+
+  class OutputInterfaces < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Get the files mapped in memory by this process
+    #
+    # Return::
+    # * <em>list<String></em>: The mapped file names
+    def getMappedFileNames
+      return File.readlines('/proc/self/maps').map { |iLine| iLine.split(' ', 6)[5] }.compact.map { |iFileName| iFileName.strip }
+    end
+
+    # Test that samples pushed in DirectStream are accumulated and written in order, whatever the way they are pushed
+    def testDirectStreamAccumulation
+      require 'WSK/OutputInterfaces/DirectStream'
+      require 'WSK/SampleBuffer/SampleBuffer'
+      [ 8, 16, 24 ].each do |iNbrBitsPerSample|
+        lHeader = WSK::Model::Header.new(1, 2, 44100, iNbrBitsPerSample)
+        lSamples = getRandomSamples(1000, 2, iNbrBitsPerSample)
+        lOutputFileName = getTmpFileName("OutputInterfaces_DirectStream#{iNbrBitsPerSample}.wav")
+        withEnv('WSK_BLOCK_SIZE' => '100') do
+          lOutputInterface = WSK::OutputInterfaces::DirectStream.new
+          assert_equal(nil, accessOutputWaveFile(lOutputFileName, lHeader, lOutputInterface, 1310) do
+            lIdxSample = 0
+            # Samples pushed one by one fill more than a buffer
+            150.times do
+              lOutputInterface.pushSample(lSamples[lIdxSample*2..lIdxSample*2+1])
+              lIdxSample += 1
+            end
+            # Small and big buffers, appended to pending samples or not
+            [ 30, 250, 1 ].each do |iNbrSamples|
+              lOutputInterface.pushBuffer(lSamples[lIdxSample*2...(lIdxSample+iNbrSamples)*2])
+              lIdxSample += iNbrSamples
+            end
+            [ 20, 20, 300 ].each do |iNbrSamples|
+              lOutputInterface.pushRawBuffer(lHeader.getEncodedString(lSamples[lIdxSample*2...(lIdxSample+iNbrSamples)*2]))
+              lIdxSample += iNbrSamples
+            end
+            lOutputInterface.pushSample(lSamples[lIdxSample*2..lIdxSample*2+1])
+            lIdxSample += 1
+            [ 10, 200 ].each do |iNbrSamples|
+              lOutputInterface.pushSampleBuffer(WSK::SampleBuffer.fromArray(lSamples[lIdxSample*2...(lIdxSample+iNbrSamples)*2], 2))
+              lIdxSample += iNbrSamples
+            end
+            lOutputInterface.pushBuffer(lSamples[lIdxSample*2...(lIdxSample+18)*2])
+            lIdxSample += 18
+            assert_equal(1000, lIdxSample)
+            # Silence after pending samples
+            lOutputInterface.pushSilence(300)
+            lOutputInterface.pushSample([ 1, -1 ])
+            lOutputInterface.pushSilence(9)
+            next nil
+          end)
+        end
+        assert_equal([ lHeader, lSamples + [0]*600 + [ 1, -1 ] + [0]*18 ], readSamplesWave(lOutputFileName))
+      end
+    end
+
+    # Test that ranges of input files copied by the kernel are written as ranges copied sample by sample
+    def testDirectStreamFileRange
+      require 'WSK/OutputInterfaces/DirectStream'
+      [ 8, 16, 24 ].each do |iNbrBitsPerSample|
+        lHeader = WSK::Model::Header.new(1, 2, 44100, iNbrBitsPerSample)
+        lSamples = getRandomSamples(2000, 2, iNbrBitsPerSample)
+        genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+          lOutputFileName = getTmpFileName("OutputInterfaces_FileRange#{iNbrBitsPerSample}.wav")
+          [ 'cache', 'dontneed', 'direct' ].each do |iIOPolicy|
+            withEnv('WSK_IO_POLICY' => iIOPolicy, 'WSK_BLOCK_SIZE' => '100') do
+              [ true, false ].each do |iCopyByKernel|
+                assert_equal(nil, accessInputWaveFile(iWaveFileName) do |iInputHeader, iInputData|
+                  if (!iCopyByKernel)
+                    # Input data not accessible by the kernel, as with streamed inputs
+                    iInputData.define_singleton_method(:get_raw_file_range) do |iIdxFirstSample, iIdxLastSample|
+                      next nil
+                    end
+                  end
+                  lOutputInterface = WSK::OutputInterfaces::DirectStream.new
+                  next accessOutputWaveFile(lOutputFileName, lHeader, lOutputInterface, 1004) do
+                    # Ranges after pending samples, at odd positions, empty or of 1 sample
+                    lOutputInterface.pushSample([ 1, -1 ])
+                    lOutputInterface.pushFileRange(iInputData, 3, 1002)
+                    lOutputInterface.pushFileRange(iInputData, 1500, 1499)
+                    lOutputInterface.pushFileRange(iInputData, 1999, 1999)
+                    lOutputInterface.pushSilence(2)
+                    next nil
+                  end
+                end)
+                assert_equal([ lHeader, [ 1, -1 ] + lSamples[6..2005] + lSamples[3998..3999] + [0]*4 ], readSamplesWave(lOutputFileName))
+              end
+              # Cut Action, padded with silence beyond the input data
+              assert_equal(0, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'Cut', '--', '--begin', '7', '--end', '2100' ]))
+              assert_equal([ lHeader, lSamples[14..-1] + [0]*202 ], readSamplesWave(lOutputFileName))
+            end
+          end
+        end
+      end
+    end
+
+    # Test that long silences stored as holes read as the silences written sample by sample
+    def testSilenceHoles
+      # Check if the temporary directory stores holes without allocating them
+      lProbeFileName = getTmpFileName('OutputInterfaces_Probe.bin')
+      File.open(lProbeFileName, 'wb') do |oFile|
+        oFile.truncate(1048576)
+      end
+      lSparse = (File.stat(lProbeFileName).blocks*512 < 1048576)
+      File.unlink(lProbeFileName)
+      [ 8, 16, 24 ].each do |iNbrBitsPerSample|
+        lHeader = WSK::Model::Header.new(1, 2, 44100, iNbrBitsPerSample)
+        lSamples = getRandomSamples(1000, 2, iNbrBitsPerSample)
+        genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+          lOutputFileName = getTmpFileName("OutputInterfaces_Silence#{iNbrBitsPerSample}.wav")
+          # Silences below and above the silent buffer size, the big one being a hole except for 8 bits
+          [ [ 100, 200000 ], [ 200000, 100 ], [ 16383, 16384 ] ].each do |iBeginSilence, iEndSilence|
+            [ 'cache', 'dontneed' ].each do |iIOPolicy|
+              assert_equal(0, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'SilenceInserter', '--', '--begin', iBeginSilence.to_s, '--end', iEndSilence.to_s ], 'WSK_IO_POLICY' => iIOPolicy))
+              assert_equal([ lHeader, [0]*(iBeginSilence*2) + lSamples + [0]*(iEndSilence*2) ], readSamplesWave(lOutputFileName))
+              if ((lSparse) and
+                  (iNbrBitsPerSample != 8) and
+                  ([ iBeginSilence, iEndSilence ].max == 200000))
+                assert(File.stat(lOutputFileName).blocks*512 < File.size(lOutputFileName))
+              end
+            end
+          end
+        end
+      end
+    end
+
+    # Test that files mapped in memory are written as files written directly, and are unmapped once written
+    def testMappedFile
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(5000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lMappedFileName = getTmpFileName('OutputInterfaces_Mapped.wav')
+        lWrittenFileName = getTmpFileName('OutputInterfaces_Written.wav')
+        # Only the cache policy maps files
+        assert_equal(0, runWSK(lMappedFileName, [ '--blocksize', '300', '--input', iWaveFileName, '--action', 'Multiply', '--', '--coeff', '2/3' ], 'WSK_IO_POLICY' => 'cache'))
+        if (File.exists?('/proc/self/maps'))
+          assert(!getMappedFileNames.include?(File.expand_path(lMappedFileName)))
+        end
+        assert_equal(0, runWSK(lWrittenFileName, [ '--blocksize', '300', '--input', iWaveFileName, '--action', 'Multiply', '--', '--coeff', '2/3' ], 'WSK_IO_POLICY' => 'dontneed'))
+        assert_equal(File.binread(lWrittenFileName), File.binread(lMappedFileName))
+        assert_equal(0, runWSK(lMappedFileName, [ '--input', iWaveFileName, '--action', 'Multiply', '--', '--coeff', '1/1' ], 'WSK_IO_POLICY' => 'cache'))
+        assert_equal([ lHeader, lSamples ], readSamplesWave(lMappedFileName))
+      end
+    end
+
+  end
+
+end
@@ -0,0 +1,73 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'rbconfig'
+
+module WSKTest
+
+  class PCMCodecs < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Number of samples exercising vectorized loops and their remainders
+    NBR_SAMPLES = 1003
+
+    # Run WSK in another process with a given SIMD instructions level.
+    # The level is read once per process from the WSK_SIMD environment variable.
+    #
+    # Parameters::
+    # * *iSIMDLevel* (_String_): The SIMD level, or nil for the one of the CPU
+    # * *iOutputFileName* (_String_): The output file name
+    # * *iArgs* (<em>list<String></em>): The other command line arguments
+    def runWSKSIMD(iSIMDLevel, iOutputFileName, iArgs)
+      File.unlink(iOutputFileName) if (File.exist?(iOutputFileName))
+      lCmd = [ RbConfig.ruby ] + $:.map { |iDir| "-I#{iDir}" } + [ File.expand_path("#{File.dirname(__FILE__)}/../../bin/WSK.rb"), '--output', iOutputFileName ] + iArgs
+      withEnv('WSK_SIMD' => iSIMDLevel) do
+        system(*lCmd, :out => File::NULL, :err => File::NULL)
+      end
+      assert($?.success?, "WSK failed with WSK_SIMD=#{iSIMDLevel.inspect}")
+    end
+
+    # Check that samples are decoded and encoded the same way with each SIMD instructions level.
+    # Samples go through maps (decoding and encoding integers) and mixes (encoding saturated floats).
+    #
+    # Parameters::
+    # * *iNbrBitsPerSample* (_Integer_): Number of bits per sample
+    # * *iSIMDLevels* (<em>list<String></em>): The SIMD levels to check
+    def checkSIMDLevels(iNbrBitsPerSample, iSIMDLevels)
+      lMaxValue = 2**(iNbrBitsPerSample-1)
+      [ 1, 2, 3 ].each do |iNbrChannels|
+        lHeader = WSK::Model::Header.new(1, iNbrChannels, 44100, iNbrBitsPerSample)
+        # Values covering the whole range
+        lSamples = Array.new(NBR_SAMPLES*iNbrChannels) { |iIdx| ((iIdx*7919) % (2*lMaxValue)) - lMaxValue }
+        lMixedSamples = lSamples.map { |iValue| [ [ iValue*2, lMaxValue-1 ].min, -lMaxValue ].max }
+        genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+          lOutputFileName = getTmpFileName("PCMCodecs_#{iNbrBitsPerSample}_#{iNbrChannels}.wav")
+          iSIMDLevels.each do |iSIMDLevel|
+            runWSKSIMD(iSIMDLevel, lOutputFileName, [ '--input', iWaveFileName, '--action', 'Multiply', '--', '--coeff', '1/1' ])
+            assert_equal([ lHeader, lSamples ], readSamplesWave(lOutputFileName), "Decoding differs with WSK_SIMD=#{iSIMDLevel.inspect}")
+            runWSKSIMD(iSIMDLevel, lOutputFileName, [ '--input', iWaveFileName, '--action', 'Mix', '--', '--files', "#{iWaveFileName}|1" ])
+            assert_equal([ lHeader, lMixedSamples ], readSamplesWave(lOutputFileName), "Encoding differs with WSK_SIMD=#{iSIMDLevel.inspect}")
+          end
+        end
+      end
+    end
+
+    # Test that 8 and 16 bits codecs give the same results with each SIMD instructions level
+    def testSIMDLevels8And16Bits
+      [ 8, 16 ].each do |iNbrBitsPerSample|
+        checkSIMDLevels(iNbrBitsPerSample, [ 'none', 'sse2', 'avx2', nil ])
+      end
+    end
+
+    # Test that 24 bits codecs give the same results with each SIMD instructions level
+    def testSIMDLevels24Bits
+      checkSIMDLevels(24, [ 'none', 'sse2', 'ssse3', 'avx2', nil ])
+    end
+
+  end
+
+end
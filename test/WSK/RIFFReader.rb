@@ -0,0 +1,95 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+module WSKTest
+
+  class RIFFReader < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Write a Wave file having a LIST chunk between its fmt and data chunks
+    #
+    # Parameters::
+    # * *iFileName* (_String_): The file name
+    # * *iHeader* (<em>WSK::Model::Header</em>): The header
+    # * *iSamples* (<em>list<Integer></em>): The values of the samples, channel after channel
+    # * *iListSize* (_Integer_): Size of the LIST chunk
+    def writeWaveWithList(iFileName, iHeader, iSamples, iListSize)
+      lData = iHeader.getEncodedString(iSamples)
+      # The fmt chunk of the header written by WSK
+      lFormat = getHeaderData(iHeader, 0)[12..35]
+      File.open(iFileName, 'wb') do |oFile|
+        oFile.write("RIFF#{[lData.size+iListSize+44].pack('V')}WAVE#{lFormat}LIST#{[iListSize].pack('V')}#{'L'*iListSize}data#{[lData.size].pack('V')}#{lData}")
+      end
+    end
+
+    # Get the chunks directory used by a RIFF reader of a file
+    #
+    # Parameters::
+    # * *iFileName* (_String_): The file name
+    # Return::
+    # * <em>map<Symbol,Object></em>: The directory
+    def getDirectory(iFileName)
+      return File.open(iFileName, 'rb') do |iFile|
+        next WSK::RIFFReader.new(iFile).instance_variable_get(:@Directory)
+      end
+    end
+
+    # Test that chunks are found in any order, and that their directory is shared by readers of the same file
+    def testChunksDirectory
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(1000, 2, 16)
+      lFileName = getTmpFileName('RIFFReader_Chunks.wav')
+      # The LIST chunk exceeds the blocks read when indexing chunks
+      writeWaveWithList(lFileName, lHeader, lSamples, 5000)
+      assert_equal([ lHeader, lSamples ], readSamplesWave(lFileName))
+      File.open(lFileName, 'rb') do |iFile|
+        lRIFFReader = WSK::RIFFReader.new(iFile)
+        assert_equal([ nil, 5000 ], lRIFFReader.setFilePos('LIST'))
+        assert_equal('L'*5000, iFile.read(5000))
+        assert_equal([ nil, 16 ], lRIFFReader.setFilePos('fmt '))
+        assert_equal(getHeaderData(lHeader, 0)[20..35], iFile.read(16))
+        assert_equal([ nil, 4000 ], lRIFFReader.setFilePos('data'))
+        assert_equal(lHeader.getEncodedString(lSamples), iFile.read(4000))
+        lError, lSize = lRIFFReader.setFilePos('cue ')
+        assert_kind_of(RuntimeError, lError)
+        assert_equal(nil, lSize)
+      end
+      # Readers of the file reuse the same directory, with all chunks indexed
+      lDirectory = getDirectory(lFileName)
+      assert_same(lDirectory, getDirectory(lFileName))
+      assert_equal([ 'fmt ', 'LIST', 'data' ], lDirectory[:Chunks].keys)
+      assert_equal(nil, lDirectory[:NextChunkPos])
+      assert_equal([ lHeader, lSamples ], readSamplesWave(lFileName))
+    end
+
+    # Test that files modified after their chunks were indexed are indexed again
+    def testChunksDirectoryInvalidated
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(1000, 2, 16)
+      lFileName = getTmpFileName('RIFFReader_Modified.wav')
+      writeWaveWithList(lFileName, lHeader, lSamples, 100)
+      assert_equal([ lHeader, lSamples ], readSamplesWave(lFileName))
+      lDirectory = getDirectory(lFileName)
+      # Data moved and file size changed
+      lOtherSamples = getRandomSamples(900, 2, 16, 1)
+      writeWaveWithList(lFileName, lHeader, lOtherSamples, 200)
+      assert_equal([ lHeader, lOtherSamples ], readSamplesWave(lFileName))
+      assert_not_same(lDirectory, getDirectory(lFileName))
+      # Data moved with the same file size: only the modification time changed
+      lDirectory = getDirectory(lFileName)
+      lMTime = File.mtime(lFileName)
+      lSize = File.size(lFileName)
+      writeWaveWithList(lFileName, lHeader, getRandomSamples(850, 2, 16, 2), 400)
+      assert_equal(lSize, File.size(lFileName))
+      File.utime(lMTime+10, lMTime+10, lFileName)
+      assert_equal([ lHeader, getRandomSamples(850, 2, 16, 2) ], readSamplesWave(lFileName))
+      assert_not_same(lDirectory, getDirectory(lFileName))
+    end
+
+  end
+
+end
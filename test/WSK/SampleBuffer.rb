@@ -0,0 +1,139 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'WSK/SampleBuffer/SampleBuffer'
+
+module WSKTest
+
+  class SampleBuffer < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Test that values are kept through arrays and raw buffers, for each PCM format
+    def testRoundTrips
+      assert_equal([1, -2, 3, -4], WSK::SampleBuffer.fromArray([1, -2, 3, -4], 2).toArray)
+      assert_equal([0.5, -1.5], WSK::SampleBuffer.fromArray([0.5, -1.5], 1, true).toArray)
+      [ 8, 16, 24 ].each do |iNbrBitsPerSample|
+        lHeader = WSK::Model::Header.new(1, 2, 44100, iNbrBitsPerSample)
+        lSamples = getRandomSamples(1000, 2, iNbrBitsPerSample)
+        lRawBuffer = lHeader.getEncodedString(lSamples)
+        [ false, true ].each do |iFloat|
+          lBuffer = WSK::SampleBuffer.decode(lRawBuffer, iNbrBitsPerSample, 2, 1000, iFloat)
+          assert_equal([ 1000, 2, iFloat ], [ lBuffer.nbrSamples, lBuffer.nbrChannels, lBuffer.float? ])
+          assert_equal(lSamples, lBuffer.toArray.map { |iValue| iValue.to_i })
+          assert_equal(lRawBuffer, lBuffer.encode(iNbrBitsPerSample))
+          assert_equal('Header' + lRawBuffer, lBuffer.encode(iNbrBitsPerSample, 'Header'.b))
+          assert_equal(lRawBuffer, WSK::SampleBuffer.fromArray(lSamples, 2, iFloat).encode(iNbrBitsPerSample))
+        end
+      end
+    end
+
+    # Test that values exceeding the PCM range are saturated when encoded
+    def testEncodeSaturated
+      lHeader = WSK::Model::Header.new(1, 1, 44100, 16)
+      assert_equal(lHeader.getEncodedString([32767, -32768, 5]), WSK::SampleBuffer.fromArray([40000, -40000, 5], 1).encode(16))
+      assert_equal(lHeader.getEncodedString([32767, -32768, 5]), WSK::SampleBuffer.fromArray([40000.0, -40000.0, 5.0], 1, true).encode(16))
+    end
+
+    # Test that invalid sample buffers are refused
+    def testInvalidBuffers
+      assert_raise(RuntimeError) { WSK::SampleBuffer.fromArray([1, 2], 0) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.fromArray([1, 2], -1) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.fromArray([1, 2, 3], 2) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.new(1, 0) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.decode('1234', 16, 2, 2) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.decode('1234', 12, 1, 2) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.decode('12345678', 32, 1, 2) }
+      assert_raise(RuntimeError) { WSK::SampleBuffer.fromArray([1, 2], 1).encode(32) }
+      lBuffer = WSK::SampleBuffer.fromArray([1, 2, 3, 4], 2)
+      assert_raise(RuntimeError) { lBuffer[2, 0] }
+      assert_raise(RuntimeError) { lBuffer[0, 2] = 0 }
+      assert_raise(RuntimeError) { lBuffer.channel(2) }
+      assert_raise(RuntimeError) { lBuffer.slice(1, 2) }
+      assert_raise(ZeroDivisionError) { lBuffer.fade!(0, 1, 0) }
+    end
+
+    # Test that views share values with their sample buffer
+    def testViews
+      lBuffer = WSK::SampleBuffer.fromArray([0, 1, 10, 11, 20, 21, 30, 31], 2)
+      lChannel = lBuffer.channel(1)
+      assert_equal([ 4, 1 ], [ lChannel.nbrSamples, lChannel.nbrChannels ])
+      assert_equal([1, 11, 21, 31], lChannel.toArray)
+      lSlice = lBuffer.slice(1, 2)
+      assert_equal([10, 11, 20, 21], lSlice.toArray)
+      # Views of views
+      lSliceChannel = lSlice.channel(0)
+      assert_equal([10, 20], lSliceChannel.toArray)
+      assert_equal(20, lSliceChannel[1, 0])
+      # Modifications through views are seen by all of them
+      lChannel[2, 0] = -21
+      lSliceChannel[0, 0] = -10
+      assert_equal([0, 1, -10, 11, 20, -21, 30, 31], lBuffer.toArray)
+      assert_equal([-10, 11, 20, -21], lSlice.toArray)
+      lBuffer[3, 1] = 131
+      assert_equal([1, 11, -21, 131], lChannel.toArray)
+      # Operations only modify the viewed values
+      lChannel.scale!(2)
+      assert_equal([0, 2, -10, 22, 20, -42, 30, 262], lBuffer.toArray)
+      lSlice.offset!(1)
+      assert_equal([0, 2, -9, 23, 21, -41, 30, 262], lBuffer.toArray)
+      # Encoded views are interleaved
+      assert_equal(WSK::Model::Header.new(1, 1, 44100, 16).getEncodedString([23, -41]), lSlice.channel(1).encode(16))
+    end
+
+    # Test that decoding reuses the sample buffer, and is seen by its views
+    def testDecodeInPlace
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lBuffer = WSK::SampleBuffer.new(3, 2)
+      assert_equal([0]*6, lBuffer.toArray)
+      lChannel = lBuffer.channel(1)
+      assert_equal(lBuffer, lBuffer.decode!(lHeader.getEncodedString([1, 2, 3, 4]), 16, 2))
+      assert_equal([1, 2, 3, 4], lBuffer.toArray)
+      assert_equal([2, 4, 0], lChannel.toArray)
+      # Growing the storage detaches previous views
+      lBuffer.decode!(lHeader.getEncodedString([5, 6, 7, 8, 9, 10, 11, 12]), 16, 4)
+      assert_equal([5, 6, 7, 8, 9, 10, 11, 12], lBuffer.toArray)
+      assert_equal([2, 4, 0], lChannel.toArray)
+      assert_raise(RuntimeError) { lChannel.decode!(lHeader.getEncodedString([1, 2]), 16, 1) }
+      assert_raise(RuntimeError) { lBuffer.slice(1, 2).decode!(lHeader.getEncodedString([1, 2]), 16, 1) }
+    end
+
+    # Test operations on integer values
+    def testIntOperations
+      lBuffer = WSK::SampleBuffer.fromArray([3, -3, 5, -5], 2)
+      # Rounded to the nearest, halves away from zero
+      assert_equal([2, -2, 3, -3], lBuffer.scale!(0.5).toArray)
+      assert_equal([-2, -6, -1, -7], lBuffer.offset!(-4).toArray)
+      assert_equal([-2, -5, -1, -5], lBuffer.clamp!(-5, -1).toArray)
+      assert_equal([2**31-1, -2**31], WSK::SampleBuffer.fromArray([2**30, -2**30], 1).scale!(4).toArray)
+      assert_equal([2**31-1, -2**31+30], WSK::SampleBuffer.fromArray([2**31-10, -2**31+10], 1).offset!(20).toArray)
+      # Fades are rounded down, as Ruby integer divisions
+      lValues = [7, -7, 100, -100, 33, -33, 1000, -1000]
+      lBuffer = WSK::SampleBuffer.fromArray(lValues, 2)
+      lBuffer.fade!(3, -2, 4)
+      lExpected = []
+      4.times do |iIdxSample|
+        2.times do |iIdxChannel|
+          lExpected << (lValues[iIdxSample*2+iIdxChannel]*(3-2*iIdxSample))/4
+        end
+      end
+      assert_equal(lExpected, lBuffer.toArray)
+    end
+
+    # Test operations on float values
+    def testFloatOperations
+      lBuffer = WSK::SampleBuffer.fromArray([1.5, -2.0, 4.0, -8.0], 2, true)
+      assert_equal([0.75, -1.0, 2.0, -4.0], lBuffer.scale!(0.5).toArray)
+      assert_equal([1.0, -0.75, 2.25, -3.75], lBuffer.offset!(0.25).toArray)
+      assert_equal([1.0, -0.5, 2.0, -0.5], lBuffer.clamp!(-0.5, 2).toArray)
+      assert_equal([0.0, 0.0, 1.0, -0.25], lBuffer.fade!(0, 1, 2).toArray)
+      lBuffer[1, 1] = 0.125
+      assert_equal(0.125, lBuffer[1, 1])
+    end
+
+  end
+
+end
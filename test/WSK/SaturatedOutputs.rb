@@ -0,0 +1,90 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'WSK/ArithmUtils/ArithmUtils'
+
+module WSKTest
+
+  class SaturatedOutputs < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Get the warnings logged by arithmetic C extensions while running some code
+    #
+    # Parameters::
+    # * _CodeBlock_: The code to run
+    # Return::
+    # * <em>list<String></em>: The logged warnings
+    def getArithmWarnings
+      rWarnings = []
+
+      WSK::ArithmUtils::ArithmUtils.send(:define_method, :log_warn) do |iMessage|
+        rWarnings << iMessage
+      end
+      begin
+        yield
+      ensure
+        WSK::ArithmUtils::ArithmUtils.send(:remove_method, :log_warn)
+      end
+
+      return rWarnings
+    end
+
+    # Test that samples saturated by Multiply and Mix are reported with each verbosity
+    def testClipReports
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      # Channel 0 clips in 3 ranges once doubled, and channel 1 in more ranges than reported
+      lSamples = [0]*2000
+      [ 10, 11, 12 ].each do |iIdxSample|
+        lSamples[iIdxSample*2] = 20000
+      end
+      lSamples[500*2] = -20000
+      lSamples[998*2] = 30000
+      lSamples[999*2] = 16384
+      lIdxRangesSamples = (0...70).map { |iIdxRange| 100+iIdxRange*3 }
+      lIdxRangesSamples.each do |iIdxSample|
+        lSamples[iIdxSample*2+1] = 16384
+      end
+      lSummary = [
+        '@10-999,0 - 6 samples exceeding limits in 3 ranges (peak overshoot: 27233), saturated',
+        "@100-#{lIdxRangesSamples[-1]},1 - 70 samples exceeding limits in 70 ranges (peak overshoot: 1), saturated"
+      ]
+      lRanges = [
+        lSummary[0],
+        '@10-12,0 - Samples exceeding limits',
+        '@500-500,0 - Samples exceeding limits',
+        '@998-999,0 - Samples exceeding limits',
+        lSummary[1]
+      ] + lIdxRangesSamples[0..63].map { |iIdxSample| "@#{iIdxSample}-#{iIdxSample},1 - Samples exceeding limits" } + [
+        "@#{lIdxRangesSamples[63]+1}-#{lIdxRangesSamples[-1]},1 - 6 more ranges exceeding limits"
+      ]
+      lExpectedSamples = lSamples.map { |iValue| [ [ iValue*2, 32767 ].min, -32768 ].max }
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('SaturatedOutputs.wav')
+        [
+          [ 'Multiply', [ '--coeff', '2/1' ] ],
+          [ 'Mix', [ '--files', "#{iWaveFileName}|1" ] ]
+        ].each do |iAction, iActionArgs|
+          # Verbosities changed by the command line and the environment in the same process
+          [
+            [ [ '--cliplog', 'ranges' ], {}, lRanges ],
+            [ [ '--cliplog', 'summary' ], {}, lSummary ],
+            [ [ '--cliplog', 'none' ], {}, [] ],
+            [ [], { 'WSK_CLIP_LOG' => 'ranges' }, lRanges ],
+            [ [], { 'WSK_CLIP_LOG' => nil }, lSummary ]
+          ].each do |iLauncherArgs, iVariables, iExpectedWarnings|
+            assert_equal(iExpectedWarnings, getArithmWarnings do
+              assert_equal(0, runWSK(lOutputFileName, iLauncherArgs + [ '--input', iWaveFileName, '--action', iAction, '--' ] + iActionArgs, iVariables))
+            end, "Wrong clip report for #{iAction} with #{iLauncherArgs.inspect} #{iVariables.inspect}")
+            assert_equal([ lHeader, lExpectedSamples ], readSamplesWave(lOutputFileName))
+          end
+        end
+      end
+    end
+
+  end
+
+end
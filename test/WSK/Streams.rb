@@ -0,0 +1,91 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'rbconfig'
+
+module WSKTest
+
+  class Streams < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+
+    # Run WSK in another process, streaming its standard input and output
+    #
+    # Parameters::
+    # * *iInput* (_String_): The data given to the standard input
+    # * *iArgs* (<em>list<String></em>): The command line arguments
+    # Return::
+    # * _String_: The data written to the standard output
+    def runWSKProcess(iInput, iArgs)
+      rOutput = nil
+
+      lCmd = [ RbConfig.ruby ] + $:.map { |iDir| "-I#{iDir}" } + [ File.expand_path("#{File.dirname(__FILE__)}/../../bin/WSK.rb") ] + iArgs
+      IO.popen(lCmd, 'r+b', :err => File::NULL) do |ioPipe|
+        lWriter = Thread.new do
+          ioPipe.write(iInput)
+          ioPipe.close_write
+        end
+        rOutput = ioPipe.read
+        lWriter.join
+      end
+      assert_equal(0, $?.exitstatus)
+
+      return rOutput
+    end
+
+    # Test that a file is cut from the standard input to the standard output
+    def testCutStdinStdout
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lSamples = getRandomSamples(5000, 2, 16)
+      genSamplesWave(lHeader, lSamples) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('Streams_Cut.wav')
+        File.open(lOutputFileName, 'wb') do |oFile|
+          oFile.write(runWSKProcess(File.binread(iWaveFileName), [ '--blocksize', '300', '--input', '-', '--output', '-', '--action', 'Cut', '--', '--begin', '100', '--end', '4099' ]))
+        end
+        assert_equal([ lHeader, lSamples[200..8199] ], readSamplesWave(lOutputFileName))
+      end
+    end
+
+    # Test that streamed outputs are the same as files written by the Multiply Action, whose output is mapped in memory for files
+    def testMultiplyStdout
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      genSamplesWave(lHeader, getRandomSamples(5000, 2, 16)) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('Streams_Multiply.wav')
+        assert_equal(0, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'Multiply', '--', '--coeff', '2/3' ]))
+        assert_equal(File.binread(lOutputFileName), runWSKProcess('', [ '--blocksize', '300', '--input', iWaveFileName, '--output', '-', '--action', 'Multiply', '--', '--coeff', '2/3' ]))
+      end
+    end
+
+    # Test that the standard output is given back once WSK streamed its output in the same process, even on errors
+    def testStdoutRestored
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      genSamplesWave(lHeader, getRandomSamples(5000, 2, 16)) do |iWaveFileName|
+        lOutputFileName = getTmpFileName('Streams_Restored.wav')
+        lStreamedFileName = getTmpFileName('Streams_Streamed.wav')
+        assert_equal(0, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', 'Cut', '--', '--begin', '100', '--end', '4099' ]))
+        lStdOut = $stdout
+        # Redirect the standard output stream to a file
+        lSavedStdOut = STDOUT.dup
+        STDOUT.reopen(lStreamedFileName, 'wb')
+        begin
+          assert_equal(0, WSK::Launcher.new.execute([ '--input', iWaveFileName, '--output', '-', '--action', 'Cut', '--', '--begin', '100', '--end', '4099' ]))
+          lStdOutAfterStream = $stdout
+          # Missing --input option
+          assert_equal(1, WSK::Launcher.new.execute([ '--output', '-', '--action', 'Cut', '--', '--begin', '100', '--end', '4099' ]))
+          lStdOutAfterError = $stdout
+        ensure
+          STDOUT.reopen(lSavedStdOut)
+          lSavedStdOut.close
+        end
+        assert_same(lStdOut, lStdOutAfterStream)
+        assert_same(lStdOut, lStdOutAfterError)
+        assert_equal(File.binread(lOutputFileName), File.binread(lStreamedFileName))
+      end
+    end
+
+  end
+
+end
@@ -0,0 +1,106 @@
+#--
+# Copyright (c) 2009 - 2012 Muriel Salvan (muriel@x-aeon.com)
+# Licensed under the terms specified in LICENSE file. No warranty is provided.
+#++
+
+require 'WSK/FFT'
+require 'WSK/FFTUtils/FFTUtils'
+
+module WSKTest
+
+  class Threads < ::Test::Unit::TestCase
+
+    include WSKTest::Common
+    include WSK::Common
+    include WSK::FFT
+
+    # Test that other Ruby threads run while C extensions process buffers
+    def testGVLReleased
+      lFFTUtils = WSK::FFTUtils::FFTUtils.new
+      lNbrFreq = FREQINDEX_LAST - FREQINDEX_FIRST + 1
+      lW = lFFTUtils.createWi(FREQINDEX_FIRST, FREQINDEX_LAST, 44100)
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      lNbrSamples = 88200
+      lRawBuffer = lHeader.getEncodedString(getRandomSamples(lNbrSamples, 2, 16))
+      lSumCos = lFFTUtils.initSumArray(lNbrFreq, 2)
+      lSumSin = lFFTUtils.initSumArray(lNbrFreq, 2)
+      # Times at which another thread runs
+      lTimes = []
+      lRunning = true
+      lThread = Thread.new do
+        while (lRunning)
+          lTimes << Process.clock_gettime(Process::CLOCK_MONOTONIC)
+          sleep 0.001
+        end
+      end
+      begin
+        # Wait for the thread to run
+        sleep 0.01 while (lTimes.empty?)
+        lBeginTime = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        lFFTUtils.completeSumCosSin(lRawBuffer, 0, 16, lNbrSamples, 2, lNbrFreq, lW, nil, lSumCos, lSumSin)
+        lEndTime = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      ensure
+        lRunning = false
+        lThread.join
+      end
+      # Holding the GVL, the C extension would not let the thread run during the computation
+      lNbrRuns = lTimes.select { |iTime| (iTime > lBeginTime) and (iTime < lEndTime) }.size
+      assert(lNbrRuns >= 5, "Thread ran #{lNbrRuns} times during #{((lEndTime-lBeginTime)*1000).to_i} ms of computation")
+    end
+
+    # Run an Action with 1 thread and with several threads, and check that their outputs and results are the same
+    #
+    # Parameters::
+    # * *iWaveFileName* (_String_): The input file name
+    # * *iAction* (_String_): The Action name
+    # * *iActionArgs* (<em>list<String></em>): The Action arguments
+    # * *iResultFileNames* (<em>list<String></em>): The result files written by the Action in the current directory
+    def checkThreadsOutputs(iWaveFileName, iAction, iActionArgs, iResultFileNames)
+      lOutputFileName = getTmpFileName("Threads_#{iAction}.wav")
+      lOutputs = []
+      Dir.chdir(File.dirname(lOutputFileName)) do
+        [ '1', '4', '0' ].each do |iNbrThreads|
+          iResultFileNames.each do |iResultFileName|
+            File.unlink(iResultFileName) if (File.exist?(iResultFileName))
+          end
+          # Keep what the Action prints
+          lStdOut = $stdout
+          $stdout = StringIO.new
+          begin
+            assert_equal(0, runWSK(lOutputFileName, [ '--input', iWaveFileName, '--action', iAction, '--' ] + iActionArgs, 'WSK_THREADS' => iNbrThreads))
+            lPrinted = $stdout.string
+          ensure
+            $stdout = lStdOut
+          end
+          lOutputs << [ iNbrThreads, lPrinted, File.binread(lOutputFileName) ] + iResultFileNames.map { |iResultFileName| File.binread(iResultFileName) }
+        end
+        iResultFileNames.each do |iResultFileName|
+          File.unlink(iResultFileName)
+        end
+      end
+      lOutputs[1..-1].each do |iOutput|
+        assert_equal(lOutputs[0][1..-1], iOutput[1..-1], "#{iAction} differs with WSK_THREADS=#{iOutput[0]}")
+      end
+    end
+
+    # Test that Actions processing buffers by slices in several threads give the same outputs as with 1 thread
+    def testThreadsOutputs
+      require 'stringio'
+      lHeader = WSK::Model::Header.new(1, 2, 44100, 16)
+      # Enough samples per buffer to be split in several slices
+      lNbrSamples = 200000
+      genSamplesWave(lHeader, getRandomSamples(lNbrSamples, 2, 16)) do |iWaveFileName|
+        genSamplesWave(lHeader, getRandomSamples(lNbrSamples, 2, 16, 1)) do |iWaveFileName2|
+          checkThreadsOutputs(iWaveFileName, 'Analyze', [], [ 'analyze.result' ])
+          # Saturated samples make the slices merge their clip reports
+          checkThreadsOutputs(iWaveFileName, 'Mix', [ '--files', "#{iWaveFileName2}|3" ], [])
+          checkThreadsOutputs(iWaveFileName, 'Compare', [ '--inputfile2', iWaveFileName2, '--coeff', '2', '--genmap', '1' ], [ 'distortion.diffmap', 'invert.map' ])
+          checkThreadsOutputs(iWaveFileName, 'ApplyVolumeFct', [ '--function', File.expand_path("#{File.dirname(__FILE__)}/../WSKFiles/Functions/Simple.fct.rb"), '--begin', '0', '--end', (lNbrSamples-1).to_s, '--unitdb', '0' ], [])
+          checkThreadsOutputs(iWaveFileName, 'FFT', [], [ 'fft.result' ])
+        end
+      end
+    end
+
+  end
+
+end
@@ -14,6 +14,10 @@ $: << "#{lWSKRootDir}/lib"
 $: << "#{lWSKRootDir}/ext"
 
 # Run all tests
+# Tests on large files need several GB of disk space: they are run only if the WSK_TEST_LARGE_FILES environment variable is set to 1
 Dir.glob("#{lWSKRootDir}/test/WSK/**/*").sort.each do |iFileName|
-  require iFileName
+  if ((File.basename(iFileName) != 'LargeFiles.rb') or
+      (ENV['WSK_TEST_LARGE_FILES'] == '1'))
+    require iFileName
+  end
 end